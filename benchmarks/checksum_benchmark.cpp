@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <tins/utils/checksum_utils.h>
+#include <tins/endianness.h>
+
+using std::cout;
+using std::endl;
+using std::setw;
+using std::fixed;
+using std::setprecision;
+using std::vector;
+using std::memcpy;
+
+using namespace Tins;
+
+typedef std::chrono::steady_clock clock_type;
+
+// The word by word loop Utils::sum_range used before it was vectorized
+uint16_t reference_sum_range(const uint8_t* start, const uint8_t* end) {
+    uint32_t checksum(0);
+    const uint8_t* last = end;
+    uint16_t buffer = 0;
+    uint16_t padding = 0;
+    const uint8_t* ptr = start;
+
+    if (((end - start) & 1) == 1) {
+        last = end - 1;
+        padding = Endian::host_to_le<uint16_t>(*(end - 1));
+    }
+
+    while (ptr < last) {
+        memcpy(&buffer, ptr, sizeof(uint16_t));
+        checksum += buffer;
+        ptr += sizeof(uint16_t);
+    }
+
+    checksum += padding;
+    while (checksum >> 16) {
+        checksum = (checksum & 0xffff) + (checksum >> 16);
+    }
+    return checksum;
+}
+
+// The nibble table based loop Utils::crc32 used before slicing-by-8
+uint32_t reference_crc32(const uint8_t* data, uint32_t data_size) {
+    uint32_t i, crc = 0;
+    static uint32_t crc_table[] = {
+        0x4DBDF21C, 0x500AE278, 0x76D3D2D4, 0x6B64C2B0,
+        0x3B61B38C, 0x26D6A3E8, 0x000F9344, 0x1DB88320,
+        0xA005713C, 0xBDB26158, 0x9B6B51F4, 0x86DC4190,
+        0xD6D930AC, 0xCB6E20C8, 0xEDB71064, 0xF0000000
+    };
+
+    for (i = 0; i < data_size; ++i) {
+        crc = (crc >> 4) ^ crc_table[(crc ^ data[i]) & 0x0F];
+        crc = (crc >> 4) ^ crc_table[(crc ^ (data[i] >> 4)) & 0x0F];
+    }
+
+    return crc;
+}
+
+uint32_t reference_crc32_range(const uint8_t* start, const uint8_t* end) {
+    return reference_crc32(start, static_cast<uint32_t>(end - start));
+}
+
+uint32_t crc32_range(const uint8_t* start, const uint8_t* end) {
+    return Utils::crc32(start, static_cast<uint32_t>(end - start));
+}
+
+// Runs the function over the buffer for roughly 200ms and returns GB/s
+template <typename Function>
+double measure(Function function, const vector<uint8_t>& buffer, size_t size) {
+    const uint8_t* start = &buffer[0];
+    const size_t iterations = std::max<size_t>(1, (size_t(1) << 27) / size);
+    volatile uint32_t sink = 0;
+    size_t total_iterations = 0;
+    const clock_type::time_point begin = clock_type::now();
+    clock_type::duration elapsed;
+    do {
+        for (size_t i = 0; i < iterations; ++i) {
+            sink = sink + function(start, start + size);
+        }
+        total_iterations += iterations;
+        elapsed = clock_type::now() - begin;
+    } while (elapsed < std::chrono::milliseconds(200));
+    const double seconds = std::chrono::duration<double>(elapsed).count();
+    return (double(total_iterations) * size) / seconds / 1e9;
+}
+
+template <typename Function>
+bool run(const char* title, Function reference, Function current,
+         const vector<uint8_t>& buffer) {
+    const size_t sizes[] = { 20, 40, 64, 128, 256, 576, 1500, 4096, 9000, 65535 };
+    cout << title << ", GB/s" << endl
+         << "      size     scalar     current    speedup" << endl;
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+        const size_t size = sizes[i];
+        if (reference(&buffer[0], &buffer[0] + size) != current(&buffer[0], &buffer[0] + size)) {
+            cout << "Mismatch for size " << size << endl;
+            return false;
+        }
+        const double reference_rate = measure(reference, buffer, size);
+        const double current_rate = measure(current, buffer, size);
+        cout << setw(10) << size << setw(11) << reference_rate << setw(12) << current_rate
+             << setw(10) << current_rate / reference_rate << "x" << endl;
+    }
+    cout << endl;
+    return true;
+}
+
+int main() {
+    vector<uint8_t> buffer(65536);
+    for (size_t i = 0; i < buffer.size(); ++i) {
+        buffer[i] = static_cast<uint8_t>(rand());
+    }
+
+    cout << fixed << setprecision(2);
+    if (!run("Internet checksum (Utils::sum_range)", &reference_sum_range,
+             &Utils::sum_range, buffer)) {
+        return 1;
+    }
+    if (!run("CRC32 (Utils::crc32)", &reference_crc32_range, &crc32_range, buffer)) {
+        return 1;
+    }
+}
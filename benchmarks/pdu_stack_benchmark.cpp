@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <tins/pdu_stack.h>
+#include <tins/ethernetII.h>
+#include <tins/ip.h>
+#include <tins/udp.h>
+#include <tins/rawpdu.h>
+
+using std::cout;
+using std::endl;
+using std::setw;
+using std::fixed;
+using std::setprecision;
+using std::vector;
+
+using namespace Tins;
+
+typedef std::chrono::steady_clock clock_type;
+typedef PDUStack<EthernetII, IP, UDP, RawPDU> telemetry_stack;
+
+// Parses the packet, changes a field and serializes it back using a PDU chain
+size_t chain_round_trip(const vector<uint8_t>& packet) {
+    EthernetII eth(&packet[0], static_cast<uint32_t>(packet.size()));
+    eth.rfind_pdu<UDP>().dport(9001);
+    return eth.serialize().size();
+}
+
+// Does the same as chain_round_trip using a PDUStack
+size_t stack_round_trip(const vector<uint8_t>& packet) {
+    telemetry_stack stack(&packet[0], static_cast<uint32_t>(packet.size()));
+    stack.get<UDP>().dport(9001);
+    return stack.serialize().size();
+}
+
+// Runs the function for roughly 200ms and returns the nanoseconds per call
+template <typename Function>
+double measure(Function function, const vector<uint8_t>& packet) {
+    const size_t iterations = 10000;
+    volatile size_t sink = 0;
+    size_t total_iterations = 0;
+    const clock_type::time_point begin = clock_type::now();
+    clock_type::duration elapsed;
+    do {
+        for (size_t i = 0; i < iterations; ++i) {
+            sink = sink + function(packet);
+        }
+        total_iterations += iterations;
+        elapsed = clock_type::now() - begin;
+    } while (elapsed < std::chrono::milliseconds(200));
+    const double nanoseconds = std::chrono::duration<double, std::nano>(elapsed).count();
+    return nanoseconds / total_iterations;
+}
+
+int main() {
+    const size_t payload_sizes[] = { 16, 128, 512, 1400 };
+    cout << fixed << setprecision(1)
+         << "Ethernet/IP/UDP parse and serialize, ns per packet" << endl
+         << "   payload      chain      stack    speedup" << endl;
+    for (size_t i = 0; i < sizeof(payload_sizes) / sizeof(payload_sizes[0]); ++i) {
+        const size_t payload_size = payload_sizes[i];
+        EthernetII eth = EthernetII("00:01:02:03:04:05", "06:07:08:09:0a:0b") /
+                         IP("192.168.0.1", "192.168.0.100") /
+                         UDP(9000, 1234) /
+                         RawPDU(RawPDU::payload_type(payload_size, 0x2a));
+        const vector<uint8_t> packet = eth.serialize();
+        if (chain_round_trip(packet) != stack_round_trip(packet)) {
+            cout << "Mismatch for payload size " << payload_size << endl;
+            return 1;
+        }
+        const double chain_time = measure(&chain_round_trip, packet);
+        const double stack_time = measure(&stack_round_trip, packet);
+        cout << setw(10) << payload_size << setw(11) << chain_time << setw(11) << stack_time
+             << setw(10) << chain_time / stack_time << "x" << endl;
+    }
+}
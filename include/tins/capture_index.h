@@ -0,0 +1,246 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef TINS_CAPTURE_INDEX_H
+#define TINS_CAPTURE_INDEX_H
+
+#include <tins/config.h>
+
+#ifdef TINS_HAVE_PCAP
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <tins/timestamp.h>
+#include <tins/macros.h>
+
+namespace Tins {
+
+class IndexedFileReader;
+
+/**
+ * \class CaptureIndex
+ * \brief A sparse index of the packets in a pcap or pcapng file.
+ *
+ * Building an index reads the whole capture file once and records a 
+ * checkpoint every few packets. Each checkpoint stores a packet's number, 
+ * its timestamp and the offset of its record in the file. The index can 
+ * be saved to a sidecar file and loaded later on, so that the capture 
+ * only needs to be read once. 
+ *
+ * An IndexedFileReader uses the index to jump to the checkpoint that 
+ * precedes a timestamp or packet number and only scans the packets from 
+ * that point on.
+ *
+ * \code
+ * CaptureIndex index = CaptureIndex::build("capture.pcap");
+ * index.save("capture.pcap.idx");
+ *
+ * // Later on
+ * IndexedFileReader reader("capture.pcap", CaptureIndex::load("capture.pcap.idx"));
+ * \endcode
+ *
+ * \sa IndexedFileReader
+ */
+class TINS_API CaptureIndex {
+public:
+    /**
+     * \brief The formats of the files that can be indexed.
+     */
+    enum file_format {
+        PCAP = 1,
+        PCAPNG = 2
+    };
+
+    /**
+     * \brief A position inside the capture file.
+     */
+    struct checkpoint {
+        /**
+         * \brief The newest timestamp among this packet and every packet 
+         * before it.
+         *
+         * This is the packet's own timestamp unless the capture contains 
+         * packets that are out of order.
+         */
+        Timestamp timestamp;
+
+        /**
+         * The packet's number, starting from 0.
+         */
+        uint64_t packet_number;
+
+        /**
+         * The offset of the packet's record or block in the file.
+         */
+        uint64_t offset;
+
+        /**
+         * The index of the pcapng section the packet belongs to. This is 
+         * always 0 on pcap files.
+         */
+        uint32_t section;
+    };
+
+    /**
+     * \brief The position of a pcapng section and its interface descriptions.
+     */
+    struct section {
+        /**
+         * The offset of the section header block.
+         */
+        uint64_t offset;
+
+        /**
+         * The offsets of the interface description blocks in this section.
+         */
+        std::vector<uint64_t> interface_offsets;
+    };
+
+    /**
+     * The type used to store the checkpoints.
+     */
+    typedef std::vector<checkpoint> checkpoints_type;
+
+    /**
+     * The type used to store the pcapng sections.
+     */
+    typedef std::vector<section> sections_type;
+
+    /**
+     * The default amount of packets between two checkpoints.
+     */
+    static const uint32_t DEFAULT_INTERVAL;
+
+    /**
+     * \brief Default constructs an empty index.
+     */
+    CaptureIndex();
+
+    /**
+     * \brief Builds the index of a capture file.
+     *
+     * The file's format is detected automatically.
+     *
+     * \param file_name The pcap or pcapng file to be indexed.
+     * \param interval The amount of packets between two checkpoints.
+     */
+    static CaptureIndex build(const std::string& file_name, 
+                              uint32_t interval = DEFAULT_INTERVAL);
+
+    /**
+     * \brief Loads an index previously stored using CaptureIndex::save.
+     *
+     * A pcap_error is thrown if the file can't be read or it's not a 
+     * valid index.
+     *
+     * \param file_name The index file to be loaded.
+     */
+    static CaptureIndex load(const std::string& file_name);
+
+    /**
+     * \brief Stores this index in a file.
+     *
+     * \param file_name The file in which to store the index.
+     */
+    void save(const std::string& file_name) const;
+
+    /**
+     * \brief Finds the checkpoint from which to look for a timestamp.
+     *
+     * Every packet before the returned checkpoint is older than the 
+     * given timestamp. If the index is empty, a null pointer is returned.
+     *
+     * \param timestamp The timestamp to look for.
+     */
+    const checkpoint* find_timestamp(const Timestamp& timestamp) const;
+
+    /**
+     * \brief Finds the checkpoint from which to look for a packet.
+     *
+     * This is the last checkpoint whose packet number is not greater than 
+     * the given one. If the index is empty, a null pointer is returned.
+     *
+     * \param packet_number The packet number to look for.
+     */
+    const checkpoint* find_packet(uint64_t packet_number) const;
+
+    /**
+     * \brief Retrieves the indexed file's format.
+     */
+    file_format format() const;
+
+    /**
+     * \brief Retrieves the indexed file's size.
+     */
+    uint64_t file_size() const;
+
+    /**
+     * \brief Retrieves the amount of packets in the indexed file.
+     */
+    uint64_t packet_count() const;
+
+    /**
+     * \brief Retrieves the amount of packets between two checkpoints.
+     */
+    uint32_t interval() const;
+
+    /**
+     * \brief Retrieves the checkpoints, sorted by packet number.
+     */
+    const checkpoints_type& checkpoints() const;
+
+    /**
+     * \brief Retrieves the pcapng sections that contain checkpoints.
+     *
+     * This is empty on pcap files.
+     */
+    const sections_type& sections() const;
+private:
+    friend class IndexedFileReader;
+
+    static file_format detect_format(const std::string& file_name, uint64_t& size);
+    void build_pcap(const std::string& file_name);
+    void build_pcapng(const std::string& file_name);
+    void add_packet(const Timestamp& timestamp, uint64_t offset, uint32_t section);
+
+    checkpoints_type checkpoints_;
+    sections_type sections_;
+    uint64_t file_size_;
+    uint64_t packet_count_;
+    uint64_t newest_timestamp_;
+    uint32_t interval_;
+    file_format format_;
+};
+
+} // Tins
+
+#endif // TINS_HAVE_PCAP
+
+#endif // TINS_CAPTURE_INDEX_H
@@ -0,0 +1,324 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef TINS_CAPTURE_PIPELINE_H
+#define TINS_CAPTURE_PIPELINE_H
+
+#include <tins/config.h>
+
+#if defined(TINS_HAVE_PCAP) && defined(TINS_HAVE_CXX11)
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <functional>
+#include <exception>
+#include <stdint.h>
+#include <tins/packet.h>
+#include <tins/raw_packet.h>
+#include <tins/sniffer.h>
+#include <tins/ring_sniffer.h>
+#include <tins/macros.h>
+#include <tins/detail/type_traits.h>
+
+namespace Tins {
+
+/**
+ * \class CapturePipeline
+ * \brief Splits the capture and the processing of packets among threads.
+ *
+ * When a network card only provides a single queue, packets can only be 
+ * captured from one thread. This class keeps that thread doing nothing 
+ * but pulling frames and distributing them among a set of workers, which 
+ * parse and process them in parallel.
+ *
+ * The capture thread computes a symmetric hash over each frame's 5-tuple 
+ * (see CapturePipeline::flow_hash) and copies the frame into the queue of 
+ * the worker chosen by it. This means both directions of a flow are always 
+ * handled by the same worker and in the order in which they were captured, 
+ * so per-flow state such as a StreamFollower can be kept per worker 
+ * without any locking.
+ *
+ * Each worker has a single producer, single consumer ring of fixed size.
+ * If a worker falls behind and its ring is full, frames for it are 
+ * dropped rather than stalling the capture thread. The amount of queued
+ * and dropped frames can be retrieved using CapturePipeline::stats.
+ *
+ * Workers can parse packets using a PDUArena, so PDUs are allocated out 
+ * of memory that is reused from one packet to the next. This is disabled
+ * by default, see CapturePipeline::set_use_pdu_arena.
+ *
+ * The functor passed to CapturePipeline::run or CapturePipeline::start 
+ * is copied once per worker, so a functor object holding its state by 
+ * value gets its own instance on each thread:
+ *
+ * \code
+ * struct Worker {
+ *     bool operator()(Packet& packet) {
+ *         follower.process_packet(packet);
+ *         return true;
+ *     }
+ *
+ *     TCPIP::StreamFollower follower;
+ * };
+ *
+ * Sniffer sniffer("eth0");
+ * CapturePipeline pipeline(4);
+ * // Blocks until sniffing is done
+ * pipeline.run(sniffer, Worker());
+ * \endcode
+ */
+class TINS_API CapturePipeline {
+public:
+    /**
+     * \brief The default amount of frames each worker's queue can hold.
+     *
+     * This is 4096 by default.
+     */
+    static const uint32_t DEFAULT_QUEUE_SIZE;
+
+    /**
+     * \brief The statistics of a single worker.
+     */
+    struct statistics {
+        /**
+         * The amount of frames that were pushed into this worker's queue.
+         */
+        uint64_t enqueued;
+
+        /**
+         * The amount of frames that were dropped because the queue was full.
+         */
+        uint64_t dropped;
+
+        /**
+         * The amount of frames currently waiting in the queue.
+         */
+        uint32_t queue_depth;
+    };
+
+    /**
+     * \brief Constructs a CapturePipeline.
+     *
+     * \param worker_count The amount of worker threads to use.
+     * \param queue_size The amount of frames each worker's queue can hold.
+     * This is rounded up to a power of 2.
+     */
+    CapturePipeline(uint32_t worker_count, uint32_t queue_size = DEFAULT_QUEUE_SIZE);
+
+    /**
+     * \brief Destructor.
+     *
+     * If the workers are running, they're stopped and joined.
+     */
+    ~CapturePipeline();
+
+    /**
+     * \brief Processes every packet captured by a sniffer until sniffing 
+     * is done.
+     *
+     * The calling thread becomes the capture thread. The functor must 
+     * implement one of the signatures accepted by BaseSniffer::sniff_loop.
+     *
+     * This returns once the sniffer runs out of packets, when 
+     * CapturePipeline::stop is called or as soon as any worker's functor 
+     * returns false. Frames that were queued by then are still processed, 
+     * except by the worker whose functor returned false, which discards 
+     * them. If a functor throws anything other than malformed_packet or 
+     * pdu_not_found, the pipeline is stopped and the exception is rethrown 
+     * from here.
+     *
+     * When the sniffer reads from a file, the capture thread waits for 
+     * room in the workers' queues rather than dropping frames.
+     *
+     * \param sniffer The sniffer from which to capture packets.
+     * \param function The callback handler object which should process packets.
+     */
+    template <typename Functor>
+    void run(BaseSniffer& sniffer, Functor function);
+
+    #ifdef TINS_HAVE_PACKET_RING
+    /**
+     * \brief Processes every packet captured by a RingSniffer until 
+     * sniffing is done.
+     *
+     * This works just like CapturePipeline::run(BaseSniffer&, Functor).
+     *
+     * \param sniffer The sniffer from which to capture packets.
+     * \param function The callback handler object which should process packets.
+     */
+    template <typename Functor>
+    void run(RingSniffer& sniffer, Functor function);
+    #endif // TINS_HAVE_PACKET_RING
+
+    /**
+     * \brief Starts the worker threads.
+     *
+     * This is only needed when feeding frames manually through 
+     * CapturePipeline::push. CapturePipeline::finish has to be 
+     * called once there are no more frames to push.
+     *
+     * \param link_type The link layer type of the frames, as one of 
+     * libpcap's DLT_* constants.
+     * \param function The callback handler object which should process packets.
+     */
+    template <typename Functor>
+    void start(int link_type, Functor function);
+
+    /**
+     * \brief Queues a frame on the worker that handles its flow.
+     *
+     * The frame is copied, so it doesn't need to outlive this call. 
+     * This must always be called from the same thread.
+     *
+     * \param frame The frame to be queued.
+     * \return false if the worker's queue was full and the frame was 
+     * dropped, true otherwise.
+     */
+    bool push(const RawPacket& frame);
+
+    /**
+     * \brief Waits for the workers to process every queued frame and 
+     * joins them.
+     *
+     * If a worker's functor threw an exception, it's rethrown here.
+     */
+    void finish();
+
+    /**
+     * \brief Stops the pipeline.
+     *
+     * This can be called from any thread. Capture stops, but frames that 
+     * were already queued are still processed.
+     */
+    void stop();
+
+    /**
+     * \brief Retrieves the statistics of a worker.
+     *
+     * \param worker The index of the worker.
+     */
+    statistics stats(uint32_t worker) const;
+
+    /**
+     * Retrieves the amount of workers.
+     */
+    uint32_t worker_count() const;
+
+    /**
+     * \brief Sets whether workers allocate PDUs using a PDUArena.
+     *
+     * This is worth enabling when the functor doesn't keep packets 
+     * around, as each worker's arena keeps reusing the same memory. This 
+     * must be called before the workers are started.
+     *
+     * \param value Whether to use an arena on each worker.
+     */
+    void set_use_pdu_arena(bool value);
+
+    /**
+     * \brief Computes a symmetric hash over a frame's 5-tuple.
+     *
+     * The addresses, ports and transport protocol of a frame are hashed in 
+     * a way that both directions of a flow produce the same value. Ports 
+     * are only used for TCP, UDP and SCTP, and never on IP fragments, so 
+     * every fragment of a datagram produces the same value. Frames that 
+     * don't carry IPv4 or IPv6 have a hash of 0.
+     *
+     * \param data The frame's contents.
+     * \param size The size of the frame.
+     * \param link_type The link layer type of the frame, as one of 
+     * libpcap's DLT_* constants.
+     */
+    static uint32_t flow_hash(const uint8_t* data, uint32_t size, int link_type);
+private:
+    struct worker;
+    typedef std::function<bool(Packet&)> callback_type;
+
+    CapturePipeline(const CapturePipeline&);
+    CapturePipeline& operator=(const CapturePipeline&);
+
+    static void capture_handler(u_char* user, const struct pcap_pkthdr* h, 
+                                const u_char* bytes);
+
+    void start_workers(int link_type, std::vector<callback_type>& callbacks);
+    void run_worker(worker& current);
+    bool enqueue(const RawPacket& frame, bool wait);
+    void capture(BaseSniffer& sniffer);
+    #ifdef TINS_HAVE_PACKET_RING
+    void capture(RingSniffer& sniffer);
+    #endif // TINS_HAVE_PACKET_RING
+    void set_capture_stopper(const std::function<void()>& stopper);
+    void set_error(std::exception_ptr error);
+
+    std::vector<std::unique_ptr<worker> > workers_;
+    std::mutex lock_;
+    std::function<void()> capture_stopper_;
+    std::exception_ptr error_;
+    std::atomic<bool> stopped_;
+    std::atomic<bool> finishing_;
+    uint32_t queue_size_;
+    int link_type_;
+    bool running_;
+    bool use_pdu_arena_;
+};
+
+template <typename Functor>
+void CapturePipeline::start(int link_type, Functor function) {
+    std::vector<callback_type> callbacks;
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        callbacks.push_back([function](Packet& packet) mutable {
+            return Internals::invoke_loop_cb(function, packet);
+        });
+    }
+    start_workers(link_type, callbacks);
+}
+
+template <typename Functor>
+void CapturePipeline::run(BaseSniffer& sniffer, Functor function) {
+    start(sniffer.link_type(), function);
+    capture(sniffer);
+    finish();
+}
+
+#ifdef TINS_HAVE_PACKET_RING
+template <typename Functor>
+void CapturePipeline::run(RingSniffer& sniffer, Functor function) {
+    start(sniffer.link_type(), function);
+    capture(sniffer);
+    finish();
+}
+#endif // TINS_HAVE_PACKET_RING
+
+} // Tins
+
+#endif // TINS_HAVE_PCAP && TINS_HAVE_CXX11
+
+#endif // TINS_CAPTURE_PIPELINE_H
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef TINS_PCAPNG_HELPERS_H
+#define TINS_PCAPNG_HELPERS_H
+
+#include <stdint.h>
+
+/**
+ * \cond
+ */
+
+namespace Tins {
+namespace Internals {
+namespace Pcapng {
+
+enum BlockType {
+    SECTION_HEADER = 0x0a0d0d0a,
+    INTERFACE_DESCRIPTION = 1,
+    PACKET = 2,
+    SIMPLE_PACKET = 3,
+    ENHANCED_PACKET = 6
+};
+
+enum OptionCode {
+    END_OF_OPTIONS = 0,
+    IF_NAME = 2,
+    IF_TSRESOL = 9,
+    IF_TSOFFSET = 14
+};
+
+const uint32_t BYTE_ORDER_MAGIC = 0x1a2b3c4d;
+const uint16_t MAJOR_VERSION = 1;
+const uint16_t MINOR_VERSION = 0;
+
+// Every block starts with its type and length and ends with its length again
+const uint32_t BLOCK_HEADER_SIZE = 8;
+const uint32_t BLOCK_TRAILER_SIZE = 4;
+
+inline uint32_t pad_length(uint32_t length) {
+    return (length + 3) & ~3U;
+}
+
+} // Pcapng
+} // Internals
+} // Tins
+
+/**
+ * \endcond
+ */
+
+#endif // TINS_PCAPNG_HELPERS_H
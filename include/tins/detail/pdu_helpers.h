@@ -39,6 +39,9 @@
  */
 
 namespace Tins {
+
+class RawPDU;
+
 namespace Internals {
 
 PDU* pdu_from_flag(Constants::Ethernet::e flag, const uint8_t* buffer,
@@ -51,6 +54,14 @@ PDU* pdu_from_dlt_flag(int flag, const uint8_t* buffer,
 #endif // TINS_HAVE_PCAP
 PDU* pdu_from_flag(PDU::PDUType type, const uint8_t* buffer, uint32_t size);
 
+// Creates the RawPDU holding a parsed payload. This borrows the buffer if
+// there's a RawPDU::borrow_scope alive on this thread and copies it otherwise
+RawPDU* raw_pdu_from_buffer(const uint8_t* buffer, uint32_t size);
+
+// Copies the payloads borrowed by the RawPDUs in the given chain. Sources 
+// that release their buffer before the parsed PDU goes away use this
+void own_raw_payloads(PDU* pdu);
+
 Constants::Ethernet::e pdu_flag_to_ether_type(PDU::PDUType flag);
 PDU::PDUType ether_type_to_pdu_flag(Constants::Ethernet::e flag);
 Constants::IP::e pdu_flag_to_ip_type(PDU::PDUType flag);
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef TINS_SNIFFER_HELPERS_H
+#define TINS_SNIFFER_HELPERS_H
+
+#include <tins/config.h>
+
+#ifdef TINS_HAVE_PCAP
+
+#include <stdint.h>
+#include <pcap.h>
+
+/**
+ * \cond
+ */
+
+namespace Tins {
+
+class PDU;
+
+namespace Internals {
+
+struct sniff_data {
+    sniff_data() : tv(), pdu(0), packet_processed(true) { }
+
+    struct timeval tv;
+    PDU* pdu;
+    bool packet_processed;
+};
+
+// Returns the handler used to parse frames of the given link layer type. 
+// The handler expects a pointer to a sniff_data as its user argument.
+pcap_handler sniff_handler_from_link_type(int link_type, bool extract_raw);
+
+// Capture files store LINKTYPE_* values, which match the DLT_* ones except
+// for LINKTYPE_RAW. The upper bits may carry extra flags, such as the FCS length.
+const uint32_t linktype_raw = 101;
+const uint32_t linktype_mask = 0x03ffffff;
+
+inline int link_type_from_file(uint32_t link_type) {
+    link_type &= linktype_mask;
+    return link_type == linktype_raw ? DLT_RAW : static_cast<int>(link_type);
+}
+
+inline uint32_t link_type_to_file(int link_type) {
+    return link_type == DLT_RAW ? linktype_raw : static_cast<uint32_t>(link_type);
+}
+
+} // Internals
+} // Tins
+
+/**
+ * \endcond
+ */
+
+#endif // TINS_HAVE_PCAP
+
+#endif // TINS_SNIFFER_HELPERS_H
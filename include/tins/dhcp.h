@@ -35,6 +35,7 @@
 #include <tins/bootp.h>
 #include <tins/macros.h>
 #include <tins/pdu_option.h>
+#include <tins/pdu_option_view.h>
 #include <tins/cxxstd.h>
 
 namespace Tins {
@@ -170,6 +171,11 @@ public:
      * The type used to store the DHCP options.
      */
     typedef std::vector<option> options_type;
+
+    /**
+     * The type returned by DHCP::option_views.
+     */
+    typedef PDUOptionRange<option> option_views_type;
     
     /**
      * \brief Extracts metadata for this protocol based on the buffer provided
@@ -214,6 +220,7 @@ public:
          * \param opt The option to be added.
          */
         void add_option(option &&opt) {
+            materialize_options();
             internal_add_option(opt);
             options_.push_back(std::move(opt));
         }
@@ -483,7 +490,27 @@ public:
      * \brief Getter for the options list.
      * \return The option list.
      */
-    const options_type options() const { return options_; }
+    const options_type options() const { 
+        materialize_options();
+        return options_; 
+    }
+
+    /**
+     * \brief Getter for views over the stored options.
+     *
+     * Unlike DHCP::options, this doesn't build the options of a lazily 
+     * parsed message.
+     *
+     * \sa LazyOptions
+     * \return The range of option views.
+     */
+    option_views_type option_views() const {
+        if (raw_options_.pending()) {
+            return option_views_type(raw_options_.begin(), raw_options_.end(), 
+                                     &DHCP::parse_option_view);
+        }
+        return option_views_type(options_);
+    }
     
     /**
      * \brief Getter for the PDU's type.
@@ -522,8 +549,15 @@ private:
     serialization_type serialize_list(const std::vector<ipaddress_type>& ip_list);
     options_type::const_iterator search_option_iterator(OptionTypes opt) const;
     options_type::iterator search_option_iterator(OptionTypes opt);
+    static const uint8_t* parse_option_view(const uint8_t* ptr, const uint8_t* end,
+                                            PDUOptionView<option>& view);
+
+    void materialize_options() const {
+        Internals::materialize_options(options_, raw_options_, &DHCP::parse_option_view);
+    }
     
-    options_type options_;
+    mutable options_type options_;
+    mutable Internals::option_bytes raw_options_;
     uint32_t size_;
 };
 
@@ -34,6 +34,7 @@
 
 #include <tins/pdu.h>
 #include <tins/pdu_option.h>
+#include <tins/pdu_option_view.h>
 #include <tins/small_uint.h>
 #include <tins/hw_address.h>
 #include <tins/endianness.h>
@@ -68,6 +69,11 @@ public:
      */
     typedef std::vector<option> options_type;
 
+    /**
+     * The type returned by Dot11::option_views.
+     */
+    typedef PDUOptionRange<option> option_views_type;
+
     /**
      * \brief This PDU's flag.
      */
@@ -587,6 +593,7 @@ public:
          * \param opt The option to be added.
          */
         void add_option(option &&opt) {
+            materialize_options();
             internal_add_option(opt);
             options_.push_back(std::move(opt));
         }
@@ -643,9 +650,27 @@ public:
      * \return The options list.
      */
     const options_type& options() const {
+        materialize_options();
         return options_;
     }
 
+    /**
+     * \brief Getter for views over the stored options.
+     *
+     * Unlike Dot11::options, this doesn't build the options of a lazily 
+     * parsed frame.
+     *
+     * \sa LazyOptions
+     * \return The range of option views.
+     */
+    option_views_type option_views() const {
+        if (raw_options_.pending()) {
+            return option_views_type(raw_options_.begin(), raw_options_.end(), 
+                                     &Dot11::parse_option_view);
+        }
+        return option_views_type(options_);
+    }
+
     /**
      * \brief Allocates an Dot11 PDU from a buffer.
      * 
@@ -711,11 +736,17 @@ private:
     void write_serialization(uint8_t* buffer, uint32_t total_sz);
     options_type::const_iterator search_option_iterator(OptionTypes type) const;
     options_type::iterator search_option_iterator(OptionTypes type);
+    static const uint8_t* parse_option_view(const uint8_t* ptr, const uint8_t* end,
+                                            PDUOptionView<option>& view);
 
+    void materialize_options() const {
+        Internals::materialize_options(options_, raw_options_, &Dot11::parse_option_view);
+    }
 
     dot11_header header_;
     uint32_t options_size_;
-    options_type options_;
+    mutable options_type options_;
+    mutable Internals::option_bytes raw_options_;
 };
 
 } // Tins
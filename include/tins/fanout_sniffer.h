@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef TINS_FANOUT_SNIFFER_H
+#define TINS_FANOUT_SNIFFER_H
+
+#include <tins/config.h>
+
+#if defined(TINS_HAVE_PCAP) && defined(TINS_HAVE_PACKET_RING)
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <stdint.h>
+#include <tins/ring_sniffer.h>
+#include <tins/macros.h>
+
+namespace Tins {
+
+/**
+ * \class FanoutSniffer
+ * \brief Captures packets using several sockets joined to a PACKET_FANOUT 
+ * group, each of them handled by its own thread.
+ *
+ * A single sniffer can only process packets as fast as a single core 
+ * allows. This class opens one RingSniffer per worker on the same device 
+ * and joins all of them to a PACKET_FANOUT group, so the kernel splits 
+ * the captured traffic among them. Each worker runs its own sniffing loop 
+ * on a thread pinned to a CPU.
+ *
+ * The way packets are split depends on the fanout mode:
+ *
+ * - FanoutSniffer::HASH sends every packet in a flow, in both directions,
+ *   to the same worker. IP fragments are reassembled by the kernel before 
+ *   being hashed, so they don't end up on a different worker.
+ * - FanoutSniffer::CPU sends packets to the worker with the same index as
+ *   the CPU on which they were received.
+ * - FanoutSniffer::ROUND_ROBIN spreads packets evenly among workers.
+ *
+ * In hash mode, per-flow state such as a StreamFollower can be kept per 
+ * worker without any locking. The functor passed to FanoutSniffer::sniff_loop
+ * is copied once per worker, so a functor object that holds the state by 
+ * value gets its own instance on each thread:
+ *
+ * \code
+ * struct Worker {
+ *     bool operator()(Packet& packet) {
+ *         follower.process_packet(packet);
+ *         return true;
+ *     }
+ *
+ *     TCPIP::StreamFollower follower;
+ * };
+ *
+ * FanoutSniffer sniffer("eth0", 4, FanoutSniffer::HASH);
+ * sniffer.sniff_loop(Worker());
+ * \endcode
+ *
+ * Note that the ring related options in the SnifferConfiguration apply 
+ * to each of the workers' rings.
+ */
+class TINS_API FanoutSniffer {
+public:
+    /**
+     * The way packets are split among workers.
+     */
+    enum FanoutMode {
+        HASH,
+        ROUND_ROBIN,
+        CPU
+    };
+
+    /**
+     * \brief Constructs a FanoutSniffer.
+     *
+     * \param device The device from which to capture packets.
+     * \param worker_count The amount of workers to use.
+     * \param mode The way packets are split among workers.
+     * \param configuration The configuration to use on each worker's sniffer.
+     */
+    FanoutSniffer(const std::string& device, uint32_t worker_count, 
+                  FanoutMode mode = HASH,
+                  const SnifferConfiguration& configuration = SnifferConfiguration());
+
+    /**
+     * \brief Starts a sniffing loop on every worker.
+     *
+     * The functor is copied once per worker and its copy is used as 
+     * the callback of that worker's RingSniffer::sniff_loop, so it must
+     * implement one of the signatures accepted by BaseSniffer::sniff_loop.
+     * 
+     * This blocks until every worker is done. A worker stops when its 
+     * functor returns false, when it sniffed max_packets packets (if it 
+     * is != 0) or when FanoutSniffer::stop_sniff is called. If a worker 
+     * throws an exception, the rest of them are stopped and the exception 
+     * is rethrown from this method.
+     *
+     * \param function The callback handler object which should process packets.
+     * \param max_packets The maximum amount of packets each worker should 
+     * sniff. 0 == infinite.
+     */
+    template <typename Functor>
+    void sniff_loop(Functor function, uint32_t max_packets = 0);
+
+    /**
+     * \brief Starts a sniffing loop on every worker which hands out frames
+     * without copying or parsing them.
+     *
+     * This works just like FanoutSniffer::sniff_loop, but uses 
+     * RingSniffer::sniff_frames on each worker.
+     *
+     * \param function The callback handler object which should process frames.
+     * \param max_packets The maximum amount of frames each worker should 
+     * sniff. 0 == infinite.
+     */
+    template <typename Functor>
+    void sniff_frames(Functor function, uint32_t max_packets = 0);
+
+    /**
+     * \brief Stops the sniffing loop on every worker.
+     *
+     * This can be called from any thread.
+     */
+    void stop_sniff();
+
+    /**
+     * \brief Sets the CPUs to which workers are pinned.
+     *
+     * Worker i is pinned to cpus[i % cpus.size()]. By default, worker i 
+     * is pinned to CPU i, modulo the amount of CPUs available. If the list 
+     * is empty, worker threads are not pinned at all.
+     *
+     * \param cpus The list of CPUs to use.
+     */
+    void set_cpu_affinity(const std::vector<unsigned>& cpus);
+
+    /**
+     * Retrieves the amount of workers.
+     */
+    uint32_t worker_count() const;
+
+    /**
+     * \brief Retrieves the sniffer used by a worker.
+     *
+     * \param index The index of the worker.
+     */
+    RingSniffer& worker(uint32_t index);
+
+    /**
+     * Retrieves the PACKET_FANOUT group identifier used.
+     */
+    uint16_t group_id() const;
+private:
+    typedef std::function<void(RingSniffer&)> worker_function;
+
+    FanoutSniffer(const FanoutSniffer&);
+    FanoutSniffer& operator=(const FanoutSniffer&);
+
+    void run_workers(const worker_function& function);
+
+    std::vector<std::unique_ptr<RingSniffer> > sniffers_;
+    std::vector<unsigned> cpus_;
+    uint16_t group_id_;
+};
+
+template <typename Functor>
+void FanoutSniffer::sniff_loop(Functor function, uint32_t max_packets) {
+    run_workers([&](RingSniffer& sniffer) {
+        sniffer.sniff_loop(function, max_packets);
+    });
+}
+
+template <typename Functor>
+void FanoutSniffer::sniff_frames(Functor function, uint32_t max_packets) {
+    run_workers([&](RingSniffer& sniffer) {
+        sniffer.sniff_frames(function, max_packets);
+    });
+}
+
+} // Tins
+
+#endif // TINS_HAVE_PCAP && TINS_HAVE_PACKET_RING
+
+#endif // TINS_FANOUT_SNIFFER_H
@@ -0,0 +1,240 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef TINS_INDEXED_FILE_READER_H
+#define TINS_INDEXED_FILE_READER_H
+
+#include <tins/config.h>
+
+#ifdef TINS_HAVE_PCAP
+
+#include <string>
+#include <stdint.h>
+#include <tins/packet.h>
+#include <tins/raw_packet.h>
+#include <tins/capture_index.h>
+#include <tins/macros.h>
+#include <tins/exceptions.h>
+#include <tins/detail/type_traits.h>
+
+namespace Tins {
+
+class MappedFileSniffer;
+class PcapngReader;
+
+/**
+ * \class IndexedFileReader
+ * \brief Reads a pcap or pcapng file starting at any packet or timestamp.
+ *
+ * This class uses a CaptureIndex to seek into a capture file. Seeking 
+ * jumps to the closest checkpoint that precedes the requested packet and 
+ * only reads the packets that follow it, rather than the whole file. 
+ * pcap files are read using a MappedFileSniffer, while pcapng files are 
+ * read using a PcapngReader.
+ *
+ * \code
+ * CaptureIndex index = CaptureIndex::load("capture.pcap.idx");
+ * IndexedFileReader reader("capture.pcap", index);
+ * // Read every packet captured in the 5 minutes after start_time
+ * if (reader.seek(start_time)) {
+ *     reader.sniff_loop([&](Packet& packet) {
+ *         if (packet.timestamp().seconds() >= start_time.seconds() + 300) {
+ *             return false;
+ *         }
+ *         // ...
+ *         return true;
+ *     });
+ * }
+ * \endcode
+ *
+ * \sa CaptureIndex
+ */
+class TINS_API IndexedFileReader {
+public:
+    /**
+     * \brief Constructs an IndexedFileReader.
+     *
+     * A pcap_error is thrown if the index was not built for this file.
+     *
+     * \param file_name The capture file to be read.
+     * \param index The file's index.
+     */
+    IndexedFileReader(const std::string& file_name, const CaptureIndex& index);
+
+    /**
+     * \brief Destructor.
+     */
+    ~IndexedFileReader();
+
+    /**
+     * \brief Moves to the first packet whose timestamp is not older than 
+     * the given one.
+     *
+     * \param timestamp The timestamp to look for.
+     * \return false if there is no such packet, true otherwise.
+     */
+    bool seek(const Timestamp& timestamp);
+
+    /**
+     * \brief Moves to the packet with the given number.
+     *
+     * \param packet_number The packet number, starting from 0.
+     * \return false if the file doesn't contain as many packets, true 
+     * otherwise.
+     */
+    bool seek_packet(uint64_t packet_number);
+
+    /**
+     * \brief Moves to the first packet in the file.
+     */
+    void rewind();
+
+    /**
+     * \brief Reads the next packet without parsing it.
+     *
+     * The provided RawPacket is only valid until the next packet is read.
+     *
+     * \param frame The object in which to store the frame.
+     * \return false if there are no more packets, true otherwise.
+     */
+    bool next_frame(RawPacket& frame);
+
+    /**
+     * \brief Reads one packet and parses it.
+     *
+     * This behaves just like BaseSniffer::next_packet.
+     *
+     * \return The next packet. If there are no more packets, PtrPacket::pdu
+     * will return 0. Caller takes ownership of the PDU pointer stored in
+     * the PtrPacket.
+     */
+    PtrPacket next_packet();
+
+    /**
+     * \brief Starts a sniffing loop, using a callback functor for every
+     * packet from the current position on.
+     *
+     * This behaves just like BaseSniffer::sniff_loop.
+     *
+     * \param function The callback handler object which should process packets.
+     * \param max_packets The maximum amount of packets to read. 0 == infinite.
+     */
+    template <typename Functor>
+    void sniff_loop(Functor function, uint32_t max_packets = 0);
+
+    /**
+     * \brief Starts a sniffing loop which hands out frames without parsing 
+     * them.
+     *
+     * This behaves just like MappedFileSniffer::sniff_frames.
+     *
+     * \param function The callback handler object which should process frames.
+     * \param max_packets The maximum amount of frames to read. 0 == infinite.
+     */
+    template <typename Functor>
+    void sniff_frames(Functor function, uint32_t max_packets = 0);
+
+    /**
+     * \brief Sets whether to extract RawPDUs or fully parsed packets.
+     *
+     * \sa BaseSniffer::set_extract_raw_pdus
+     * \param value Whether to extract RawPDUs or not.
+     */
+    void set_extract_raw_pdus(bool value);
+
+    /**
+     * \brief Retrieves the number of the packet that will be read next.
+     */
+    uint64_t packet_number() const;
+
+    /**
+     * \brief Retrieves the index used by this reader.
+     */
+    const CaptureIndex& index() const;
+private:
+    IndexedFileReader(const IndexedFileReader&);
+    IndexedFileReader& operator=(const IndexedFileReader&);
+
+    void restore(const CaptureIndex::checkpoint& point);
+    bool read_frame(RawPacket& frame);
+    int link_type(const RawPacket& frame) const;
+
+    CaptureIndex index_;
+    MappedFileSniffer* pcap_reader_;
+    PcapngReader* pcapng_reader_;
+    RawPacket pending_frame_;
+    uint64_t packet_number_;
+    bool has_pending_frame_;
+    bool extract_raw_;
+};
+
+template <typename Functor>
+void IndexedFileReader::sniff_loop(Functor function, uint32_t max_packets) {
+    while (true) {
+        Packet packet(next_packet());
+        if (!packet) {
+            return;
+        }
+        try {
+            // If the functor returns false, we're done
+            if (!Tins::Internals::invoke_loop_cb(function, packet)) {
+                return;
+            }
+        }
+        catch(malformed_packet&) { }
+        catch(pdu_not_found&) { }
+        if (max_packets && --max_packets == 0) {
+            return;
+        }
+    }
+}
+
+template <typename Functor>
+void IndexedFileReader::sniff_frames(Functor function, uint32_t max_packets) {
+    RawPacket frame;
+    while (next_frame(frame)) {
+        try {
+            // If the functor returns false, we're done
+            if (!function(frame)) {
+                return;
+            }
+        }
+        catch(malformed_packet&) { }
+        catch(pdu_not_found&) { }
+        if (max_packets && --max_packets == 0) {
+            return;
+        }
+    }
+}
+
+} // Tins
+
+#endif // TINS_HAVE_PCAP
+
+#endif // TINS_INDEXED_FILE_READER_H
@@ -35,6 +35,7 @@
 #include <tins/endianness.h>
 #include <tins/ip_address.h>
 #include <tins/pdu_option.h>
+#include <tins/pdu_option_view.h>
 #include <tins/macros.h>
 #include <tins/cxxstd.h>
 
@@ -245,6 +246,11 @@ public:
      */
     typedef std::vector<option> options_type;
 
+    /**
+     * The type returned by IP::option_views.
+     */
+    typedef PDUOptionRange<option> option_views_type;
+
     /**
      * \brief Extracts metadata for this protocol based on the buffer provided
      *
@@ -413,9 +419,27 @@ public:
      * \return The stored options.
      */
     const options_type& options() const {
+        materialize_options();
         return options_;
     }
 
+    /**
+     * \brief Getter for views over the stored options.
+     *
+     * Unlike IP::options, this doesn't build the options of a lazily 
+     * parsed datagram.
+     *
+     * \sa LazyOptions
+     * \return The range of option views.
+     */
+    option_views_type option_views() const {
+        if (raw_options_.pending()) {
+            return option_views_type(raw_options_.begin(), raw_options_.end(), 
+                                     &IP::parse_option_view);
+        }
+        return option_views_type(options_);
+    }
+
     /* Setters */
 
     /**
@@ -527,6 +551,7 @@ public:
          * \param opt The option to be added.
          */
         void add_option(option &&opt) {
+            materialize_options();
             options_.push_back(std::move(opt));
         }
 
@@ -540,6 +565,7 @@ public:
          */
         template<typename... Args>
         void add_option(Args&&... args) {
+            materialize_options();
             options_.emplace_back(std::forward<Args>(args)...);
         }
     #endif
@@ -762,14 +788,22 @@ private:
     uint32_t pad_options_size(uint32_t size) const;
     void init_ip_fields();
     void write_serialization(uint8_t* buffer, uint32_t total_sz);
-    void write_option(const option& opt, Memory::OutputMemoryStream& stream);
+    static void write_option(const PDUOptionView<option>& opt, 
+                             Memory::OutputMemoryStream& stream);
+    static const uint8_t* parse_option_view(const uint8_t* ptr, const uint8_t* end,
+                                            PDUOptionView<option>& view);
     void add_route_option(option_identifier id, const generic_route_option_type& data);
     generic_route_option_type search_route_option(option_identifier id) const;
     void checksum(uint16_t new_check);
     options_type::const_iterator search_option_iterator(option_identifier id) const;
     options_type::iterator search_option_iterator(option_identifier id);
 
-    options_type options_;
+    void materialize_options() const {
+        Internals::materialize_options(options_, raw_options_, &IP::parse_option_view);
+    }
+
+    mutable options_type options_;
+    mutable Internals::option_bytes raw_options_;
     ip_header header_;
 };
 
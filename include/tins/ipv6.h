@@ -36,6 +36,7 @@
 #include <tins/endianness.h>
 #include <tins/small_uint.h>
 #include <tins/pdu_option.h>
+#include <tins/pdu_option_view.h>
 #include <tins/ipv6_address.h>
 
 namespace Tins {
@@ -256,6 +257,7 @@ public:
      *  \return The stored headers.
      */
     const headers_type& headers() const {
+        materialize_headers();
         return ext_headers_;
     }
 
@@ -377,6 +379,7 @@ public:
      * \param header The extension header to be added.
      */
     void add_header(ext_header&& header) {
+        materialize_headers();
         ext_headers_.emplace_back(std::move(header));
     }
 
@@ -387,6 +390,7 @@ public:
      */
     template <typename... Args>
     void add_header(Args&&... args) {
+        materialize_headers();
         ext_headers_.emplace_back(std::forward<Args>(args)...);
     }
 
@@ -411,6 +415,7 @@ private:
     static bool is_extension_header(uint8_t header_id);
     static uint32_t get_padding_size(const ext_header& header);
     static std::vector<header_option_type> parse_header_options(const uint8_t* data, size_t size);
+    void materialize_headers() const;
 
     TINS_BEGIN_PACK
     struct ipv6_header {
@@ -433,7 +438,8 @@ private:
     } TINS_END_PACK;
 
     ipv6_header header_;
-    headers_type ext_headers_;
+    mutable headers_type ext_headers_;
+    mutable Internals::option_bytes raw_headers_;
     uint8_t next_header_;
 };
 }
@@ -0,0 +1,289 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef TINS_MAPPED_FILE_SNIFFER_H
+#define TINS_MAPPED_FILE_SNIFFER_H
+
+#include <tins/config.h>
+
+#ifdef TINS_HAVE_PCAP
+
+#include <string>
+#include <stdint.h>
+#include <pcap.h>
+#include <tins/packet.h>
+#include <tins/raw_packet.h>
+#include <tins/sniffer.h>
+#include <tins/macros.h>
+#include <tins/exceptions.h>
+#include <tins/detail/type_traits.h>
+
+namespace Tins {
+
+/**
+ * \class MappedFileSniffer
+ * \brief Reads pcap files by mapping them into memory.
+ *
+ * This sniffer reads the same files as FileSniffer, but rather than using 
+ * libpcap to read each record into a buffer, it maps the whole file into 
+ * memory and walks through its records in place. Both microsecond and 
+ * nanosecond resolution pcap files are supported, in either byte order. 
+ * pcapng files are not supported.
+ *
+ * Frames can be read without copying them through MappedFileSniffer::next_frame 
+ * and MappedFileSniffer::sniff_frames. The RawPackets handed out by these 
+ * point into the mapped file, so they stay valid for as long as the sniffer 
+ * is alive.
+ *
+ * MappedFileSniffer::next_packet and MappedFileSniffer::sniff_loop parse 
+ * records into PDUs using the same link layer dispatching that BaseSniffer 
+ * uses, so they behave just like their FileSniffer counterparts. Payloads
+ * parsed while a RawPDU::borrow_scope is alive point into the mapped file.
+ *
+ * \code
+ * MappedFileSniffer sniffer("capture.pcap");
+ * sniffer.sniff_frames([&](const RawPacket& frame) {
+ *     PacketView view = frame.view();
+ *     // ...
+ *     return true;
+ * });
+ * \endcode
+ *
+ * Timestamps are always handed out with microsecond resolution. 
+ * A file that ends in the middle of a record is treated as if it ended 
+ * right before it.
+ */
+class TINS_API MappedFileSniffer {
+public:
+    /**
+     * \brief Constructs a MappedFileSniffer.
+     *
+     * Only the filter set in the configuration is used.
+     *
+     * \param file_name The pcap file which will be read.
+     * \param configuration The configuration object to use to setup the sniffer.
+     */
+    MappedFileSniffer(const std::string& file_name,
+                      const SnifferConfiguration& configuration = SnifferConfiguration());
+
+    /**
+     * \brief Destructor.
+     *
+     * This unmaps the file.
+     */
+    ~MappedFileSniffer();
+
+    /**
+     * \brief Reads the next record without copying it.
+     *
+     * The provided RawPacket will point to the next record's data inside
+     * the mapped file.
+     *
+     * \param frame The object in which to store the frame.
+     * \return false if there are no more records, true otherwise.
+     */
+    bool next_frame(RawPacket& frame);
+
+    /**
+     * \brief Reads one packet and parses it.
+     *
+     * This behaves just like BaseSniffer::next_packet.
+     *
+     * \return The next packet. If there are no more packets, PtrPacket::pdu
+     * will return 0. Caller takes ownership of the PDU pointer stored in
+     * the PtrPacket.
+     */
+    PtrPacket next_packet();
+
+    /**
+     * \brief Starts a sniffing loop, using a callback functor for every
+     * packet in the file.
+     *
+     * This behaves just like BaseSniffer::sniff_loop.
+     *
+     * \param function The callback handler object which should process packets.
+     * \param max_packets The maximum amount of packets to read. 0 == infinite.
+     */
+    template <typename Functor>
+    void sniff_loop(Functor function, uint32_t max_packets = 0);
+
+    /**
+     * \brief Starts a sniffing loop which hands out frames without copying 
+     * or parsing them.
+     *
+     * The functor must implement an operator with the following signature:
+     *
+     * \code
+     * bool(const RawPacket&);
+     * \endcode
+     *
+     * Reading will stop when either max_packets are read (if it is != 0), 
+     * when the functor returns false or when there are no more records.
+     * Both malformed_packet and pdu_not_found exceptions thrown by the 
+     * functor are caught.
+     *
+     * \param function The callback handler object which should process frames.
+     * \param max_packets The maximum amount of frames to read. 0 == infinite.
+     */
+    template <typename Functor>
+    void sniff_frames(Functor function, uint32_t max_packets = 0);
+
+    /**
+     * \brief Sets a filter on this sniffer.
+     *
+     * The filter is compiled using libpcap and run on every record.
+     *
+     * \param filter The filter to be set.
+     * \return True iif it was possible to apply the filter.
+     */
+    bool set_filter(const std::string& filter);
+
+    /**
+     * \brief Sets whether to extract RawPDUs or fully parsed packets.
+     *
+     * \sa BaseSniffer::set_extract_raw_pdus
+     * \param value Whether to extract RawPDUs or not.
+     */
+    void set_extract_raw_pdus(bool value);
+
+    /**
+     * \brief Moves back to the first record in the file.
+     *
+     * Records are read from then on until the end of the file.
+     */
+    void rewind();
+
+    /**
+     * \brief Retrieves the offset within the file of the next record.
+     */
+    uint64_t position() const;
+
+    /**
+     * \brief Moves to the record that starts at the given offset.
+     *
+     * The offset must point to the beginning of a record, such as one 
+     * previously returned by MappedFileSniffer::position.
+     *
+     * \param offset The offset within the file.
+     */
+    void seek(uint64_t offset);
+
+    /**
+     * \brief Retrieves the size of the file.
+     */
+    uint64_t file_size() const;
+
+    /**
+     * \brief Retrieves this file's link type.
+     *
+     * This is one of the DLT_* constants defined by libpcap.
+     */
+    int link_type() const;
+
+    /**
+     * \brief Retrieves the snapshot length stored in the file's header.
+     */
+    uint32_t snap_len() const;
+
+    /**
+     * \brief Indicates whether the file stores timestamps with nanosecond 
+     * resolution.
+     */
+    bool has_nanosecond_timestamps() const;
+private:
+    friend class SnifferConfiguration;
+    friend class ParallelFileProcessor;
+
+    MappedFileSniffer(const MappedFileSniffer&);
+    MappedFileSniffer& operator=(const MappedFileSniffer&);
+
+    void map_file(const std::string& file_name);
+    void unmap_file();
+    void parse_file_header();
+    void clear_filter();
+    uint32_t read_field(uint64_t offset) const;
+    void set_read_range(uint64_t begin, uint64_t end);
+
+    const uint8_t* data_;
+    uint64_t size_;
+    uint64_t offset_;
+    uint64_t end_;
+    int link_type_;
+    uint32_t snap_len_;
+    bpf_program filter_;
+    bool has_filter_;
+    bool swap_bytes_;
+    bool nanosecond_timestamps_;
+    bool extract_raw_;
+};
+
+template <typename Functor>
+void MappedFileSniffer::sniff_loop(Functor function, uint32_t max_packets) {
+    while (true) {
+        Packet packet(next_packet());
+        if (!packet) {
+            return;
+        }
+        try {
+            // If the functor returns false, we're done
+            if (!Tins::Internals::invoke_loop_cb(function, packet)) {
+                return;
+            }
+        }
+        catch(malformed_packet&) { }
+        catch(pdu_not_found&) { }
+        if (max_packets && --max_packets == 0) {
+            return;
+        }
+    }
+}
+
+template <typename Functor>
+void MappedFileSniffer::sniff_frames(Functor function, uint32_t max_packets) {
+    RawPacket frame;
+    while (next_frame(frame)) {
+        try {
+            // If the functor returns false, we're done
+            if (!function(frame)) {
+                return;
+            }
+        }
+        catch(malformed_packet&) { }
+        catch(pdu_not_found&) { }
+        if (max_packets && --max_packets == 0) {
+            return;
+        }
+    }
+}
+
+} // Tins
+
+#endif // TINS_HAVE_PCAP
+
+#endif // TINS_MAPPED_FILE_SNIFFER_H
@@ -104,12 +104,26 @@ public:
     const Timestamp& timestamp() const {
         return ts_;
     }
+
+    /**
+     * \brief Returns the identifier of the interface this packet was
+     * captured on.
+     *
+     * \sa Packet::interface_id
+     */
+    uint32_t interface_id() const {
+        return interface_id_;
+    }
 private:
     friend class BaseSniffer;
     friend class SnifferIterator;
+    friend class RingSniffer;
+    friend class MappedFileSniffer;
+    friend class PcapngReader;
+    friend class IndexedFileReader;
     
-    PacketWrapper(pdu_type pdu, const Timestamp& ts) 
-    : pdu_(pdu), ts_(ts) {}
+    PacketWrapper(pdu_type pdu, const Timestamp& ts, uint32_t interface_id = 0) 
+    : pdu_(pdu), ts_(ts), interface_id_(interface_id) {}
     
     PacketWrapper(const PacketWrapper&);
     PacketWrapper& operator=(const PacketWrapper&);
@@ -118,6 +132,7 @@ private:
 
     pdu_type pdu_;
     timestamp_type ts_;
+    uint32_t interface_id_;
 };
 
 /**
@@ -142,7 +157,7 @@ public:
      * The PDU* will be set to a null pointer.
      */
     Packet() 
-    : pdu_(0) { }
+    : pdu_(0), interface_id_(0) { }
     
     /**
      * \brief Constructs a Packet from a PDU* and a Timestamp.
@@ -150,7 +165,7 @@ public:
      * The PDU is cloned using PDU::clone.
      */
     Packet(const PDU* apdu, const Timestamp& tstamp) 
-    : pdu_(apdu->clone()), ts_(tstamp) { }
+    : pdu_(apdu->clone()), ts_(tstamp), interface_id_(0) { }
 
     /**
      * \brief Constructs a Packet from a PDU& and a Timestamp.
@@ -158,7 +173,7 @@ public:
      * The PDU is cloned using PDU::clone.
      */
     Packet(const PDU& apdu, const Timestamp& tstamp) 
-    : pdu_(apdu.clone()), ts_(tstamp) { }
+    : pdu_(apdu.clone()), ts_(tstamp), interface_id_(0) { }
 
     /**
      * \brief Constructs a Packet from a PDU* and a Timestamp.
@@ -169,7 +184,7 @@ public:
      * of scope.
      */
     Packet(PDU* apdu, const Timestamp& tstamp, own_pdu) 
-    : pdu_(apdu), ts_(tstamp) { }
+    : pdu_(apdu), ts_(tstamp), interface_id_(0) { }
     
     /**
      * \brief Constructs a Packet from a const PDU&.
@@ -180,7 +195,7 @@ public:
      * 
      */
     Packet(const PDU& rhs) 
-    : pdu_(rhs.clone()), ts_(Timestamp::current_time()) { }
+    : pdu_(rhs.clone()), ts_(Timestamp::current_time()), interface_id_(0) { }
     
     /**
      * \brief Constructs a Packet from a RefPacket.
@@ -189,20 +204,22 @@ public:
      * 
      */
     Packet(const RefPacket& pck) 
-    : pdu_(pck.pdu().clone()), ts_(pck.timestamp()) { }
+    : pdu_(pck.pdu().clone()), ts_(pck.timestamp()), 
+      interface_id_(pck.interface_id()) { }
 
     /**
      * \brief Constructs a Packet from a PtrPacket object.
      */
     Packet(const PtrPacket& pck)
-    : pdu_(pck.pdu()), ts_(pck.timestamp()) { }
+    : pdu_(pck.pdu()), ts_(pck.timestamp()), interface_id_(pck.interface_id()) { }
     
     /**
      * \brief Copy constructor.
      * 
      * This calls PDU::clone on the rhs's PDU* member.
      */
-    Packet(const Packet& rhs) : ts_(rhs.timestamp()) {
+    Packet(const Packet& rhs) 
+    : ts_(rhs.timestamp()), interface_id_(rhs.interface_id()) {
         pdu_ = rhs.pdu() ? rhs.pdu()->clone() : 0;
     }
     
@@ -215,6 +232,7 @@ public:
         if (this != &rhs) {
             delete pdu_;
             ts_ = rhs.timestamp();
+            interface_id_ = rhs.interface_id();
             pdu_ = rhs.pdu() ? rhs.pdu()->clone() : 0;
         }
         return* this;
@@ -224,7 +242,8 @@ public:
     /**
      * Move constructor.
      */
-    Packet(Packet &&rhs) TINS_NOEXCEPT : pdu_(rhs.pdu()), ts_(rhs.timestamp()) {
+    Packet(Packet &&rhs) TINS_NOEXCEPT 
+    : pdu_(rhs.pdu()), ts_(rhs.timestamp()), interface_id_(rhs.interface_id()) {
         rhs.pdu_ = nullptr;
     }
     
@@ -237,6 +256,7 @@ public:
             pdu_ = std::move(rhs.pdu_);
             rhs.pdu_ = std::move(tmp);
             ts_ = rhs.timestamp();
+            interface_id_ = rhs.interface_id();
         }
         return* this;
     }
@@ -257,6 +277,28 @@ public:
     const Timestamp& timestamp() const {
         return ts_;
     }
+
+    /**
+     * \brief Returns the identifier of the interface this packet was 
+     * captured on.
+     *
+     * Capture files which contain packets from several interfaces, such 
+     * as pcapng ones, identify each of them by their index within the 
+     * file. Packets that don't come from such a file use interface 0.
+     */
+    uint32_t interface_id() const {
+        return interface_id_;
+    }
+
+    /**
+     * \brief Sets the identifier of the interface this packet was 
+     * captured on.
+     *
+     * \param new_interface_id The new interface identifier.
+     */
+    void interface_id(uint32_t new_interface_id) {
+        interface_id_ = new_interface_id;
+    }
     
     /**
      * \brief Returns the stored PDU*. 
@@ -315,6 +357,7 @@ public:
 private:
     PDU* pdu_;
     Timestamp ts_;
+    uint32_t interface_id_;
 };
 }
 
@@ -0,0 +1,298 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef TINS_PACKET_REPLAYER_H
+#define TINS_PACKET_REPLAYER_H
+
+#include <tins/config.h>
+
+#if defined(TINS_HAVE_PCAP) && defined(TINS_HAVE_CXX11)
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <stdint.h>
+#include <tins/macros.h>
+#include <tins/hw_address.h>
+#include <tins/ip_address.h>
+#include <tins/raw_packet.h>
+#include <tins/network_interface.h>
+#include <tins/mapped_file_sniffer.h>
+
+namespace Tins {
+
+class PacketSender;
+
+/**
+ * \class PacketReplayer
+ * \brief Sends the packets stored in a pcap file, keeping their original 
+ * timing.
+ *
+ * Packets are sent at the same intervals at which they were captured. 
+ * These intervals can be scaled using PacketReplayer::speed and 
+ * PacketReplayer::max_rate paces the PacketSender the file is replayed 
+ * through, so that packets are never sent faster than a certain rate.
+ *
+ * The file is read using a MappedFileSniffer on a background thread, 
+ * which also applies any address rewriting and queues each frame, ready 
+ * to be sent, along with the time at which it's due. The thread that 
+ * replays the file only waits for each frame's time to come and sends it, 
+ * so timing stays accurate even at high rates. Waiting sleeps until 
+ * shortly before each frame is due and spins for the rest.
+ *
+ * If the sender can't keep up, frames are sent as soon as possible and 
+ * the schedule isn't shifted, so the sender catches up once it can. 
+ * How late frames were sent is available through 
+ * PacketReplayer::statistics::max_delay.
+ *
+ * Only Ethernet captures can be replayed. Rewriting hardware addresses 
+ * patches each frame in place. Rewriting IPv4 addresses parses the frame 
+ * and serializes it back, which updates every checksum.
+ *
+ * \code
+ * PacketReplayer replayer("production.pcap");
+ * replayer.dst_hw_addr("00:11:22:33:44:55");
+ * replayer.rewrite_address("10.0.0.1", "192.168.1.1");
+ * // Twice as fast as it was captured, but no more than 100k packets per second
+ * replayer.speed(2.0);
+ * replayer.max_rate(100000);
+ * // Replay the file 10 times
+ * replayer.loop_count(10);
+ *
+ * PacketSender sender;
+ * PacketReplayer::statistics stats = replayer.replay(sender, "eth1");
+ * \endcode
+ */
+class TINS_API PacketReplayer {
+public:
+    /**
+     * \brief The default amount of frames that are queued ahead of time.
+     */
+    static const uint32_t DEFAULT_PREFETCH_SIZE;
+
+    /**
+     * \brief The statistics of a replay.
+     */
+    struct statistics {
+        /**
+         * The amount of frames sent.
+         */
+        uint64_t packets;
+
+        /**
+         * The amount of bytes sent.
+         */
+        uint64_t bytes;
+
+        /**
+         * The amount of times the whole file was sent.
+         */
+        uint32_t loops;
+
+        /**
+         * The amount of seconds the replay took.
+         */
+        double elapsed;
+
+        /**
+         * The largest amount of seconds a frame was sent after it was due.
+         */
+        double max_delay;
+    };
+
+    /**
+     * \brief The type of the functor that sends each frame.
+     *
+     * The frame's timestamp is the one it was captured with.
+     */
+    typedef std::function<void(const RawPacket&)> send_callback_type;
+
+    /**
+     * \brief Constructs a PacketReplayer.
+     *
+     * If the file doesn't store Ethernet frames, a std::runtime_error 
+     * is thrown.
+     *
+     * \param file_name The pcap file to be replayed.
+     * \param configuration The configuration used to read the file. 
+     * Only its filter is used.
+     */
+    PacketReplayer(const std::string& file_name,
+                   const SnifferConfiguration& configuration = SnifferConfiguration());
+
+    /**
+     * \brief Sets the speed at which the file is replayed.
+     *
+     * The intervals between frames are divided by this value, so 2.0 
+     * replays the file twice as fast as it was captured. A speed of 0 
+     * ignores the original timing and sends frames as fast as possible. 
+     * This is 1.0 by default.
+     *
+     * \param multiplier The speed multiplier.
+     */
+    void speed(double multiplier);
+
+    /**
+     * \brief Sets the maximum amount of frames sent per second.
+     *
+     * Frames that were captured closer to each other than this rate 
+     * allows are spaced out. A rate of 0, the default, sets no limit.
+     *
+     * The rate is kept by the PacketSender given to 
+     * PacketReplayer::replay(PacketSender&, const NetworkInterface&), 
+     * whose pacing is enabled at this rate while replaying, replacing 
+     * any pacing settings it had. Replays through a functor aren't 
+     * limited; the functor can pace its own sender through 
+     * PacketSender::enable_pacing.
+     *
+     * \param packets_per_second The maximum rate.
+     */
+    void max_rate(uint64_t packets_per_second);
+
+    /**
+     * \brief Sets how many times the file is replayed.
+     *
+     * A count of 0 replays it until PacketReplayer::stop is called. 
+     * This is 1 by default.
+     *
+     * \param count The amount of times to replay the file.
+     */
+    void loop_count(uint32_t count);
+
+    /**
+     * \brief Sets the amount of frames that are queued ahead of time.
+     *
+     * \param size The amount of frames.
+     */
+    void prefetch_size(uint32_t size);
+
+    /**
+     * \brief Sets the source hardware address of every frame.
+     *
+     * \param address The address to use.
+     */
+    void src_hw_addr(const HWAddress<6>& address);
+
+    /**
+     * \brief Sets the destination hardware address of every frame.
+     *
+     * \param address The address to use.
+     */
+    void dst_hw_addr(const HWAddress<6>& address);
+
+    /**
+     * \brief Replaces an IPv4 address with another one.
+     *
+     * Both the source and destination addresses of every IPv4 packet 
+     * are replaced if they match.
+     *
+     * \param from The address to be replaced.
+     * \param to The address to replace it with.
+     */
+    void rewrite_address(IPv4Address from, IPv4Address to);
+
+    /**
+     * \brief Replays the file through a PacketSender.
+     *
+     * This blocks until the file has been replayed as many times as 
+     * indicated by PacketReplayer::loop_count, or until 
+     * PacketReplayer::stop is called.
+     *
+     * \param sender The sender to be used.
+     * \param iface The interface in which to send the frames.
+     */
+    statistics replay(PacketSender& sender, const NetworkInterface& iface);
+
+    /**
+     * \brief Replays the file through a functor.
+     *
+     * This works just like PacketReplayer::replay(PacketSender&, const NetworkInterface&),
+     * but each frame is handed to the provided functor when it's due. 
+     * PacketReplayer::max_rate doesn't apply here.
+     *
+     * \param callback The functor that sends each frame.
+     */
+    statistics replay(send_callback_type callback);
+
+    /**
+     * \brief Stops an ongoing replay.
+     *
+     * This can be called from any thread.
+     */
+    void stop();
+private:
+    // A frame ready to be sent, along with the time at which it's due
+    struct queued_frame {
+        std::vector<uint8_t> data;
+        Timestamp timestamp;
+        uint32_t original_size;
+        // Nanoseconds since the replay started
+        uint64_t due;
+        // The pass over the file this frame was read in
+        uint32_t loop;
+    };
+
+    PacketReplayer(const PacketReplayer&);
+    PacketReplayer& operator=(const PacketReplayer&);
+
+    void prefetch();
+    bool prepare_frame(const RawPacket& frame, std::vector<uint8_t>& buffer);
+
+    MappedFileSniffer reader_;
+    std::map<IPv4Address, IPv4Address> address_map_;
+    HWAddress<6> src_hw_addr_;
+    HWAddress<6> dst_hw_addr_;
+    double speed_;
+    uint64_t max_rate_;
+    uint32_t loop_count_;
+    uint32_t prefetch_size_;
+    bool rewrite_src_hw_addr_;
+    bool rewrite_dst_hw_addr_;
+    // The queue shared with the prefetching thread
+    std::vector<queued_frame> queue_;
+    size_t queue_head_;
+    size_t queue_count_;
+    bool prefetch_done_;
+    uint32_t loops_;
+    std::exception_ptr error_;
+    std::mutex lock_;
+    std::condition_variable queue_cond_;
+    std::atomic<bool> stopped_;
+};
+
+} // Tins
+
+#endif // TINS_HAVE_PCAP && TINS_HAVE_CXX11
+
+#endif // TINS_PACKET_REPLAYER_H
@@ -42,6 +42,7 @@
 #include <tins/network_interface.h>
 #include <tins/macros.h>
 #include <tins/cxxstd.h>
+#include <tins/utils/pdu_utils.h>
 
 struct timeval;
 struct sockaddr;
@@ -107,6 +108,37 @@ class PDU;
  * PacketSender also supports sending a packet and waiting for a response.
  * This can be done by using PacketSender::send_recv.
  *
+ * When sending many packets at once, PacketSender::send_batch serializes 
+ * them into a single buffer and hands them to the kernel using as few 
+ * system calls as possible:
+ *
+ * \code
+ * std::vector<EthernetII> packets = ...;
+ * sender.send_batch(packets.begin(), packets.end(), "eth0");
+ * \endcode
+ *
+ * On Linux, layer 2 PDUs can also be sent through a PACKET_MMAP transmit 
+ * ring. Once it's enabled using PacketSender::enable_tx_ring, layer 2 PDUs 
+ * are written into frames that are shared with the kernel, and a single 
+ * system call hands every frame written so far over to it. This works 
+ * best along with PacketSender::send_batch, which only hands the frames 
+ * over once the ring is full or the batch is complete:
+ *
+ * \code
+ * sender.enable_tx_ring(2048, 8192);
+ * sender.send_batch(packets.begin(), packets.end(), "eth0");
+ * \endcode
+ *
+ * The rate at which packets are sent can be limited using 
+ * PacketSender::enable_pacing:
+ *
+ * \code
+ * // At most 100k packets and 500 Mbps, in bursts of up to 64 packets
+ * sender.enable_pacing(100000, 500000000, 64);
+ * sender.send_batch(packets.begin(), packets.end(), "eth0");
+ * std::cout << sender.pacing_stats().packets_per_second << std::endl;
+ * \endcode
+ *
  * This class opens sockets as it needs to, and closes them when the object
  * is destructed.
  *
@@ -120,6 +152,75 @@ public:
      */
     static const uint32_t DEFAULT_TIMEOUT;
 
+    /**
+     * The default amount of packets that can be sent back to back when 
+     * pacing.
+     */
+    static const uint32_t DEFAULT_PACING_BURST;
+
+    /**
+     * \brief The rates achieved while pacing.
+     *
+     * \sa PacketSender::pacing_stats
+     */
+    struct pacing_statistics {
+        /**
+         * The amount of packets sent since pacing was enabled.
+         */
+        uint64_t packets;
+
+        /**
+         * The amount of bytes sent since pacing was enabled.
+         */
+        uint64_t bytes;
+
+        /**
+         * The amount of seconds elapsed since pacing was enabled.
+         */
+        double elapsed;
+
+        /**
+         * The configured packet rate, or 0 if packets aren't limited.
+         */
+        double target_packets_per_second;
+
+        /**
+         * The configured bit rate, or 0 if bits aren't limited.
+         */
+        double target_bits_per_second;
+
+        /**
+         * The packet rate achieved since pacing was enabled.
+         */
+        double packets_per_second;
+
+        /**
+         * The bit rate achieved since pacing was enabled.
+         */
+        double bits_per_second;
+    };
+
+    #ifdef TINS_HAVE_PACKET_SENDER_TX_RING
+    /**
+     * The default size of each of the transmit ring's frames.
+     */
+    static const uint32_t DEFAULT_TX_FRAME_SIZE;
+
+    /**
+     * The default amount of frames in the transmit ring.
+     */
+    static const uint32_t DEFAULT_TX_FRAME_COUNT;
+
+    /**
+     * Indicates how the frames in the transmit ring are handed over 
+     * to the kernel.
+     */
+    enum TxFlushMode {
+        BLOCKING_FLUSH,    ///< Wait until the kernel has sent every frame.
+        NON_BLOCKING_FLUSH ///< Return as soon as the kernel has been notified.
+    };
+    #endif // TINS_HAVE_PACKET_SENDER_TX_RING
+
     /** 
      * Flags to indicate the socket type.
      */
@@ -173,6 +274,18 @@ public:
             _timeout = rhs._timeout;
             timeout_usec_ = rhs.timeout_usec_;
             default_iface_ = rhs.default_iface_;
+            batch_socket_ = INVALID_RAW_SOCKET;
+            #ifdef TINS_HAVE_PACKET_SENDER_PCAP_SENDPACKET
+                batch_handle_ = 0;
+            #endif // TINS_HAVE_PACKET_SENDER_PCAP_SENDPACKET
+            batching_ = false;
+            pacer_ = rhs.pacer_;
+            #ifdef TINS_HAVE_PACKET_SENDER_TX_RING
+                tx_ring_ = rhs.tx_ring_;
+                tx_ring_address_ = std::move(rhs.tx_ring_address_);
+                rhs.tx_ring_.buffer = 0;
+                rhs.tx_ring_.enabled = false;
+            #endif // TINS_HAVE_PACKET_SENDER_TX_RING
             return* this;
         }
     #endif
@@ -193,6 +306,93 @@ public:
     void open_l2_socket(const NetworkInterface& iface = NetworkInterface());
     #endif // !_WIN32 || defined(TINS_HAVE_PACKET_SENDER_PCAP_SENDPACKET)
 
+    #ifdef TINS_HAVE_PACKET_SENDER_TX_RING
+    /**
+     * \brief Sends layer 2 PDUs through a PACKET_MMAP transmit ring.
+     *
+     * The ring is set up on the layer 2 socket, so if that socket is 
+     * already open, it's closed and will be opened again the next 
+     * time it's needed.
+     *
+     * The frame size limits the size of the PDUs that can be sent, as 
+     * each frame also holds a small header. It has to be a multiple of 
+     * 16. The amount of frames may be rounded up so that the ring's 
+     * blocks are filled.
+     *
+     * When the flush mode is BLOCKING_FLUSH, handing the frames over to 
+     * the kernel waits until they've been sent. Otherwise, the frames 
+     * are sent in the background and are reused once the kernel is done 
+     * with them, so the sender only waits when the ring is full.
+     *
+     * If the frame size or the frame count are invalid, a 
+     * std::runtime_error is thrown.
+     *
+     * \param frame_size The size of each of the ring's frames.
+     * \param frame_count The amount of frames in the ring.
+     * \param mode The way in which frames are handed over to the kernel.
+     */
+    void enable_tx_ring(uint32_t frame_size = DEFAULT_TX_FRAME_SIZE,
+                        uint32_t frame_count = DEFAULT_TX_FRAME_COUNT,
+                        TxFlushMode mode = BLOCKING_FLUSH);
+
+    /**
+     * \brief Stops using the transmit ring.
+     *
+     * If the layer 2 socket is open, it's closed and will be opened 
+     * again the next time it's needed.
+     */
+    void disable_tx_ring();
+
+    /**
+     * \brief Indicates whether layer 2 PDUs are sent through a transmit ring.
+     */
+    bool tx_ring_enabled() const;
+    #endif // TINS_HAVE_PACKET_SENDER_TX_RING
+
+    /**
+     * \brief Limits the rate at which packets are sent.
+     *
+     * Packets are paced using a token bucket. A packet is only sent once 
+     * there are enough tokens for it at both the packet and the bit rate,
+     * while up to burst_size packets can be sent back to back after the 
+     * sender has been idle. Waiting sleeps until shortly before the packet
+     * is due and spins for the rest, so rates are kept precisely without 
+     * burning a whole CPU at low rates.
+     *
+     * Pacing combines with PacketSender::send_batch and the transmit 
+     * ring: batches are handed over to the kernel one burst at a time, 
+     * so each system call still sends burst_size packets.
+     *
+     * The bit rate takes into account the size of the PDUs as they're 
+     * handed over to the kernel, so the link layer header the kernel 
+     * adds to layer 3 PDUs isn't counted.
+     *
+     * Calling this again resets the statistics returned by 
+     * PacketSender::pacing_stats. If both rates are 0 or the burst size 
+     * is 0, a std::runtime_error is thrown.
+     *
+     * \param packets_per_second The packet rate, or 0 not to limit it.
+     * \param bits_per_second The bit rate, or 0 not to limit it.
+     * \param burst_size The amount of packets that can be sent back to back.
+     */
+    void enable_pacing(uint64_t packets_per_second, uint64_t bits_per_second = 0,
+                       uint32_t burst_size = DEFAULT_PACING_BURST);
+
+    /**
+     * \brief Stops limiting the rate at which packets are sent.
+     */
+    void disable_pacing();
+
+    /**
+     * \brief Indicates whether the rate at which packets are sent is limited.
+     */
+    bool pacing_enabled() const;
+
+    /**
+     * \brief Retrieves the rates achieved since pacing was enabled.
+     */
+    pacing_statistics pacing_stats() const;
+
     /** 
      * \brief Opens a layer 3 socket, using the corresponding protocol
      * for the given flag.
@@ -268,6 +468,58 @@ public:
      */
     void send(PDU& pdu, const NetworkInterface& iface);
 
+    /**
+     * \brief Sends all the PDUs in the range [start, end).
+     *
+     * Each PDU is sent just like PacketSender::send(PDU&, const NetworkInterface&)
+     * would, but rather than issuing one system call per PDU, consecutive 
+     * PDUs that go through the same socket are serialized into a buffer 
+     * that is reused across calls and sent together. On Linux this uses 
+     * sendmmsg, so up to 1024 PDUs are sent using a single system call. 
+     * When pcap_sendpacket is used to send layer 2 PDUs, they're sent one 
+     * after the other once the batch is complete. When the transmit ring 
+     * is enabled, layer 2 PDUs are written into it and handed over to the 
+     * kernel once the ring is full or the batch is complete.
+     *
+     * Dereferencing the iterators must at some point yield a PDU&, so 
+     * both containers of PDUs and of pointers to them can be used.
+     *
+     * If any send error occurs, a socket_write_error is thrown and the 
+     * PDUs that were not sent yet are discarded.
+     *
+     * \param start A forward iterator pointing to the first PDU to be sent.
+     * \param end A forward iterator pointing to one past the last PDU.
+     * \param iface The network interface in which to send link layer PDUs.
+     */
+    template<typename ForwardIterator>
+    void send_batch(ForwardIterator start, ForwardIterator end, 
+                    const NetworkInterface& iface) {
+        begin_batch();
+        try {
+            while (start != end) {
+                send(Utils::dereference_until_pdu(*start++), iface);
+            }
+        }
+        catch (...) {
+            end_batch(false);
+            throw;
+        }
+        end_batch(true);
+    }
+
+    /**
+     * \brief Sends all the PDUs in the range [start, end) using the 
+     * default interface.
+     *
+     * \sa PacketSender::send_batch
+     * \param start A forward iterator pointing to the first PDU to be sent.
+     * \param end A forward iterator pointing to one past the last PDU.
+     */
+    template<typename ForwardIterator>
+    void send_batch(ForwardIterator start, ForwardIterator end) {
+        send_batch(start, end, default_iface_);
+    }
+
     /** 
      * \brief Sends a PDU and waits for its response. 
      * 
@@ -342,6 +594,22 @@ public:
      */
     void send_l2(PDU& pdu, struct sockaddr* link_addr, uint32_t len_addr, 
       const NetworkInterface& iface = NetworkInterface());
+
+    /** 
+     * \brief Sends an already serialized level 2 packet.
+     *
+     * This method is used internally. You should just use PacketTemplate::send.
+     * 
+     * This works just like PacketSender::send_l2(PDU&, struct sockaddr*, uint32_t, 
+     * const NetworkInterface&), but the packet is sent as is.
+     * 
+     * \param buffer The packet's data.
+     * \param size The size of the packet's data.
+     * \param link_addr The sockaddr struct which will be used to send the packet.
+     * \param len_addr The sockaddr struct length.
+     */
+    void send_l2(const uint8_t* buffer, uint32_t size, struct sockaddr* link_addr, 
+      uint32_t len_addr, const NetworkInterface& iface = NetworkInterface());
     #endif // !_WIN32 || TINS_HAVE_PACKET_SENDER_PCAP_SENDPACKET
 
     /** 
@@ -376,11 +644,79 @@ public:
      * \param type The socket protocol type.
      */
     void send_l3(PDU& pdu, struct sockaddr* link_addr, uint32_t len_addr, SocketType type);
+
+    /** 
+     * \brief Sends an already serialized level 3 packet.
+     *
+     * This method is used internally. You should just use PacketTemplate::send.
+     * 
+     * This works just like PacketSender::send_l3(PDU&, struct sockaddr*, uint32_t, 
+     * SocketType), but the packet is sent as is.
+     * 
+     * \param buffer The packet's data.
+     * \param size The size of the packet's data.
+     * \param link_addr The sockaddr struct which will be used to send the packet.
+     * \param len_addr The sockaddr struct length.
+     * \param type The socket protocol type.
+     */
+    void send_l3(const uint8_t* buffer, uint32_t size, struct sockaddr* link_addr, 
+                 uint32_t len_addr, SocketType type);
 private:
     static const int INVALID_RAW_SOCKET;
 
     typedef std::map<SocketType, int> SocketTypeMap;
 
+    // A packet to be sent, which is either a PDU or an already serialized buffer
+    struct outgoing_packet {
+        outgoing_packet(PDU& pdu);
+        outgoing_packet(const uint8_t* data, uint32_t size);
+
+        uint32_t size() const;
+        void write(uint8_t* buffer, uint32_t size) const;
+
+        PDU* pdu;
+        const uint8_t* data;
+        uint32_t data_size;
+    };
+
+    // A PDU queued by send_batch
+    struct batch_entry {
+        uint32_t data_offset;
+        uint32_t data_size;
+        uint32_t address_offset;
+        uint32_t address_size;
+    };
+
+    // The token bucket used when pacing. Times are in nanoseconds
+    struct pacer {
+        uint64_t packets_per_second;
+        uint64_t bits_per_second;
+        uint32_t burst_size;
+        // The time at which the bucket will be full again
+        uint64_t next_send;
+        uint64_t start;
+        uint64_t packets;
+        uint64_t bytes;
+        bool enabled;
+    };
+
+    #ifdef TINS_HAVE_PACKET_SENDER_TX_RING
+    // The layer 2 socket's transmit ring. The buffer is only mapped 
+    // while the socket is open
+    struct tx_ring {
+        uint8_t* buffer;
+        uint32_t frame_size;
+        uint32_t frame_count;
+        uint32_t frames_per_block;
+        uint32_t block_size;
+        uint32_t current_frame;
+        uint32_t pending_frames;
+        uint64_t pending_bytes;
+        TxFlushMode mode;
+        bool enabled;
+    };
+    #endif // TINS_HAVE_PACKET_SENDER_TX_RING
+
     PacketSender(const PacketSender&);
     PacketSender& operator=(const PacketSender&);
     int find_type(SocketType type);
@@ -396,6 +732,37 @@ private:
         pcap_t* make_pcap_handle(const NetworkInterface& iface) const;
     #endif // TINS_HAVE_PACKET_SENDER_PCAP_SENDPACKET
     
+    void begin_batch();
+    void end_batch(bool flush);
+    void flush_batch();
+    void send_batch_entries(size_t first, size_t last);
+    void clear_batch();
+    void queue_batch(const outgoing_packet& packet, int sock, struct sockaddr* link_addr,
+                     uint32_t len_addr);
+    #ifdef TINS_HAVE_PACKET_SENDER_PCAP_SENDPACKET
+        void queue_batch(const outgoing_packet& packet, pcap_t* handle);
+    #endif // TINS_HAVE_PACKET_SENDER_PCAP_SENDPACKET
+    void add_batch_entry(const outgoing_packet& packet, struct sockaddr* link_addr, 
+                         uint32_t len_addr);
+    const uint8_t* serialize_packet(const outgoing_packet& packet, uint32_t& size);
+    #if !defined(_WIN32) || defined(TINS_HAVE_PACKET_SENDER_PCAP_SENDPACKET)
+        void send_l2_packet(const outgoing_packet& packet, struct sockaddr* link_addr,
+                            uint32_t len_addr, const NetworkInterface& iface);
+    #endif // !_WIN32 || TINS_HAVE_PACKET_SENDER_PCAP_SENDPACKET
+    void send_l3_packet(const outgoing_packet& packet, struct sockaddr* link_addr,
+                        uint32_t len_addr, SocketType type);
+    void wait_pacing(uint32_t packets, uint64_t bytes);
+    #ifdef TINS_HAVE_PACKET_SENDER_TX_RING
+        void setup_tx_ring();
+        void unmap_tx_ring();
+        uint8_t* tx_ring_frame(uint32_t index) const;
+        void wait_tx_ring_frame(const uint8_t* frame);
+        void queue_tx_ring(const outgoing_packet& packet, struct sockaddr* link_addr,
+                           uint32_t len_addr);
+        void flush_tx_ring();
+        void discard_tx_ring();
+    #endif // TINS_HAVE_PACKET_SENDER_TX_RING
+
     PDU* recv_match_loop(const std::vector<int>& sockets, 
                          PDU& pdu,
                          struct sockaddr* link_addr, 
@@ -422,6 +789,23 @@ private:
         typedef std::map<NetworkInterface, pcap_t*> PcapHandleMap; 
         PcapHandleMap pcap_handles_;
     #endif // TINS_HAVE_PACKET_SENDER_PCAP_SENDPACKET
+    // Reused to serialize the PDUs that are sent one at a time
+    std::vector<uint8_t> buffer_;
+    // The PDUs queued by send_batch, their addresses and where to send them
+    std::vector<uint8_t> batch_buffer_;
+    std::vector<uint8_t> batch_addresses_;
+    std::vector<batch_entry> batch_entries_;
+    int batch_socket_;
+    #ifdef TINS_HAVE_PACKET_SENDER_PCAP_SENDPACKET
+        pcap_t* batch_handle_;
+    #endif // TINS_HAVE_PACKET_SENDER_PCAP_SENDPACKET
+    bool batching_;
+    pacer pacer_;
+    #ifdef TINS_HAVE_PACKET_SENDER_TX_RING
+        tx_ring tx_ring_;
+        // The address the frames waiting in the ring will be sent to
+        std::vector<uint8_t> tx_ring_address_;
+    #endif // TINS_HAVE_PACKET_SENDER_TX_RING
 };
 
 } // Tins
@@ -0,0 +1,254 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef TINS_PACKET_TEMPLATE_H
+#define TINS_PACKET_TEMPLATE_H
+
+#include <vector>
+#include <stdint.h>
+#include <tins/macros.h>
+#include <tins/ip_address.h>
+#include <tins/ipv6_address.h>
+#include <tins/network_interface.h>
+
+namespace Tins {
+
+class PDU;
+class PacketSender;
+
+/**
+ * \class PacketTemplate
+ * \brief A serialized packet whose fields can be modified in place.
+ *
+ * Sending lots of packets that only differ in a few fields, such as 
+ * probes that only change the destination address, port and sequence 
+ * number, means serializing the whole PDU chain and computing its 
+ * checksums every time. A PacketTemplate instead serializes a PDU 
+ * chain once and remembers where the network and transport layer 
+ * headers start. Modifying one of their fields writes the new value 
+ * straight into the serialized packet and updates the IP and TCP/UDP 
+ * checksums incrementally, as described in RFC 1624, so the cost 
+ * doesn't depend on the packet's size.
+ *
+ * The network layer is the last IP or IPv6 PDU before the first TCP or 
+ * UDP PDU in the chain, and the transport layer is that TCP or UDP PDU. 
+ * Trying to modify a field that isn't present throws field_not_present.
+ *
+ * \code
+ * EthernetII packet = EthernetII(gateway_mac, my_mac) / IP("0.0.0.0", my_ip) / TCP();
+ * packet.rfind_pdu<TCP>().set_flag(TCP::SYN, 1);
+ *
+ * PacketTemplate probe(packet);
+ * PacketSender sender;
+ * for (size_t i = 0; i < targets.size(); ++i) {
+ *     probe.dst_addr(targets[i].address);
+ *     probe.dport(targets[i].port);
+ *     probe.seq(i);
+ *     probe.send(sender, "eth0");
+ * }
+ * \endcode
+ */
+class TINS_API PacketTemplate {
+public:
+    /**
+     * \brief The fields that can be modified.
+     */
+    enum field_type {
+        IP_ID,
+        TTL,
+        SRC_ADDR,
+        DST_ADDR,
+        SPORT,
+        DPORT,
+        SEQ,
+        ACK_SEQ
+    };
+
+    /**
+     * \brief Constructs a PacketTemplate by serializing a PDU.
+     *
+     * The PDU is not referenced after the constructor returns.
+     *
+     * \param pdu The PDU to be serialized.
+     */
+    explicit PacketTemplate(PDU& pdu);
+
+    /**
+     * \brief Indicates whether this template contains the given field.
+     *
+     * \param field The field to look for.
+     */
+    bool has_field(field_type field) const;
+
+    /**
+     * \brief Retrieves the offset of a field within the serialized packet.
+     *
+     * If the field is not present, field_not_present is thrown.
+     *
+     * \param field The field whose offset should be retrieved.
+     */
+    uint32_t field_offset(field_type field) const;
+
+    /**
+     * \brief Retrieves the size of a field.
+     *
+     * If the field is not present, field_not_present is thrown.
+     *
+     * \param field The field whose size should be retrieved.
+     */
+    uint32_t field_size(field_type field) const;
+
+    /**
+     * \brief Sets the IPv4 identification field.
+     *
+     * \param new_id The new identification.
+     */
+    void id(uint16_t new_id);
+
+    /**
+     * \brief Sets the IPv4 time to live or the IPv6 hop limit field.
+     *
+     * \param new_ttl The new time to live.
+     */
+    void ttl(uint8_t new_ttl);
+
+    /**
+     * \brief Sets the IPv4 source address field.
+     *
+     * \param new_src_addr The new source address.
+     */
+    void src_addr(IPv4Address new_src_addr);
+
+    /**
+     * \brief Sets the IPv4 destination address field.
+     *
+     * \param new_dst_addr The new destination address.
+     */
+    void dst_addr(IPv4Address new_dst_addr);
+
+    /**
+     * \brief Sets the IPv6 source address field.
+     *
+     * \param new_src_addr The new source address.
+     */
+    void src_addr(const IPv6Address& new_src_addr);
+
+    /**
+     * \brief Sets the IPv6 destination address field.
+     *
+     * \param new_dst_addr The new destination address.
+     */
+    void dst_addr(const IPv6Address& new_dst_addr);
+
+    /**
+     * \brief Sets the TCP or UDP source port field.
+     *
+     * \param new_sport The new source port.
+     */
+    void sport(uint16_t new_sport);
+
+    /**
+     * \brief Sets the TCP or UDP destination port field.
+     *
+     * \param new_dport The new destination port.
+     */
+    void dport(uint16_t new_dport);
+
+    /**
+     * \brief Sets the TCP sequence number field.
+     *
+     * \param new_seq The new sequence number.
+     */
+    void seq(uint32_t new_seq);
+
+    /**
+     * \brief Sets the TCP acknowledgement number field.
+     *
+     * \param new_ack_seq The new acknowledgement number.
+     */
+    void ack_seq(uint32_t new_ack_seq);
+
+    /**
+     * \brief Writes a field's value and updates the checksums that cover it.
+     *
+     * The value must be field_size(field) bytes long and be in network 
+     * byte order. If the field is not present, field_not_present is 
+     * thrown.
+     *
+     * \param field The field to be written.
+     * \param value The field's new value.
+     */
+    void patch(field_type field, const uint8_t* value);
+
+    /**
+     * \brief Retrieves a pointer to the serialized packet.
+     */
+    const uint8_t* data() const;
+
+    /**
+     * \brief Retrieves the size of the serialized packet.
+     */
+    uint32_t size() const;
+
+    /**
+     * \brief Sends the serialized packet.
+     *
+     * If the template's outermost PDU was an IP or IPv6 PDU, the packet 
+     * is sent through a layer 3 socket to its current destination 
+     * address. Otherwise, it's sent as a link layer frame through the 
+     * given interface.
+     *
+     * \param sender The PacketSender to use.
+     * \param iface The interface to use when sending link layer frames.
+     */
+    void send(PacketSender& sender, const NetworkInterface& iface = NetworkInterface());
+private:
+    enum layer_type {
+        NO_LAYER,
+        IPV4_LAYER,
+        IPV6_LAYER,
+        TCP_LAYER,
+        UDP_LAYER
+    };
+
+    bool find_field(field_type field, uint32_t& offset, uint32_t& size) const;
+    void write_field(field_type field, const uint8_t* value, uint32_t value_size);
+
+    std::vector<uint8_t> buffer_;
+    uint32_t network_offset_;
+    uint32_t transport_offset_;
+    layer_type network_type_;
+    layer_type transport_type_;
+    // The outermost PDU's type, or NO_LAYER if it's a link layer PDU
+    layer_type outer_type_;
+};
+
+} // Tins
+
+#endif // TINS_PACKET_TEMPLATE_H
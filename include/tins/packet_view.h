@@ -0,0 +1,551 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef TINS_PACKET_VIEW_H
+#define TINS_PACKET_VIEW_H
+
+#include <stdint.h>
+#include <cstddef>
+#include <tins/pdu.h>
+#include <tins/macros.h>
+#include <tins/endianness.h>
+#include <tins/exceptions.h>
+#include <tins/memory_helpers.h>
+#include <tins/hw_address.h>
+#include <tins/ip_address.h>
+#include <tins/ipv6_address.h>
+
+namespace Tins {
+
+class EthernetII;
+class Dot1Q;
+class IP;
+class IPv6;
+class TCP;
+class UDP;
+class ICMP;
+
+/**
+ * \class PacketView
+ * \brief Read-only view over the layers contained in a raw frame.
+ *
+ * Unlike constructing a PDU chain out of a buffer, building a PacketView
+ * performs no memory allocations nor copies the buffer's contents. The 
+ * layers are identified using each protocol's <tt>extract_metadata</tt>
+ * function and only their offsets inside the buffer are stored. 
+ *
+ * Since the view only references the buffer, the buffer must outlive the
+ * view. This is what makes it useful inside a sniffing callback or when
+ * iterating the records of a capture file: the frame is inspected in place
+ * and only the packets the application is interested in have to be 
+ * converted into a PDU.
+ *
+ * Header fields can be read using PacketView::header, which returns a 
+ * lightweight accessor for the given protocol:
+ *
+ * \code
+ * PacketView view(buffer, buffer_size);
+ * if (view.has_layer(PDU::TCP)) {
+ *     // Both of these are read straight from the buffer
+ *     IPv4Address src = view.header<IP>().src_addr();
+ *     uint16_t dport = view.header<TCP>().dport();
+ * }
+ * \endcode
+ *
+ * The supported protocols are EthernetII, Dot1Q, IP, IPv6, TCP, UDP and
+ * ICMP. ARP layers are identified as well, but there's no header accessor
+ * for them. Whatever follows the last identified layer is exposed as a
+ * PDU::RAW layer, which is also what PacketView::payload points to.
+ */
+class TINS_API PacketView {
+public:
+    /**
+     * The maximum amount of layers a view can hold.
+     */
+    static const size_t MAX_LAYERS = 8;
+
+    /**
+     * \brief Describes a single layer inside the viewed buffer.
+     */
+    struct layer {
+        /**
+         * The type of the PDU this layer represents.
+         */
+        PDU::PDUType type;
+
+        /**
+         * The offset of this layer's header from the start of the buffer.
+         */
+        uint32_t offset;
+
+        /**
+         * The size of this layer's header.
+         */
+        uint32_t header_size;
+    };
+
+    /**
+     * \brief Accessor for the fields of a protocol's header.
+     *
+     * This is specialized for each of the supported protocols. Each 
+     * specialization reads fields directly from the viewed buffer.
+     */
+    template <typename T>
+    class header_view;
+
+    /**
+     * \brief Default constructs an empty view.
+     */
+    PacketView();
+
+    /**
+     * \brief Constructs a view over a buffer.
+     *
+     * The buffer is not copied, so it must be kept alive for as long as 
+     * this view is used.
+     *
+     * If the first layer can't be parsed or any of the identified headers
+     * is truncated, a malformed_packet exception is thrown.
+     *
+     * \param buffer The buffer to be viewed.
+     * \param total_sz The size of the buffer.
+     * \param first_layer The type of the outermost layer in the buffer.
+     */
+    PacketView(const uint8_t* buffer, uint32_t total_sz,
+               PDU::PDUType first_layer = PDU::ETHERNET_II);
+
+    /**
+     * \brief Getter for the viewed buffer.
+     */
+    const uint8_t* buffer() const {
+        return buffer_;
+    }
+
+    /**
+     * \brief Getter for the viewed buffer's size.
+     */
+    uint32_t size() const {
+        return size_;
+    }
+
+    /**
+     * \brief Returns the amount of layers found in the buffer.
+     */
+    size_t layer_count() const {
+        return layer_count_;
+    }
+
+    /**
+     * \brief Returns the layer at the given index.
+     *
+     * Index 0 is the outermost layer.
+     *
+     * \param index The index of the layer to be retrieved.
+     */
+    const layer& layer_at(size_t index) const {
+        return layers_[index];
+    }
+
+    /**
+     * \brief Finds the first layer of the given type.
+     *
+     * \param type The type of the layer to be searched.
+     * \return A pointer to the layer or 0 if it's not present.
+     */
+    const layer* find_layer(PDU::PDUType type) const;
+
+    /**
+     * \brief Finds the first layer of the given type.
+     *
+     * If the layer is not present, a pdu_not_found exception is thrown.
+     *
+     * \param type The type of the layer to be searched.
+     */
+    const layer& rfind_layer(PDU::PDUType type) const;
+
+    /**
+     * \brief Indicates whether a layer of the given type is present.
+     *
+     * \param type The type of the layer to be searched.
+     */
+    bool has_layer(PDU::PDUType type) const {
+        return find_layer(type) != 0;
+    }
+
+    /**
+     * \brief Returns a pointer to the start of the given layer's header.
+     *
+     * \param lyr The layer, which must belong to this view.
+     */
+    const uint8_t* layer_data(const layer& lyr) const {
+        return buffer_ + lyr.offset;
+    }
+
+    /**
+     * \brief Returns a pointer to the payload of the innermost layer.
+     *
+     * This is the data that would be stored in the RawPDU at the end
+     * of the equivalent PDU chain.
+     */
+    const uint8_t* payload() const {
+        return buffer_ + payload_offset_;
+    }
+
+    /**
+     * \brief Returns the size of the payload of the innermost layer.
+     *
+     * Note that link layer padding is not considered part of the payload
+     * when the network layer header advertises a shorter length.
+     */
+    uint32_t payload_size() const {
+        return payload_size_;
+    }
+
+    /**
+     * \brief Returns an accessor for the first header of type T.
+     *
+     * If the layer is not present, a pdu_not_found exception is thrown.
+     *
+     * \code
+     * uint16_t port = view.header<TCP>().dport();
+     * \endcode
+     */
+    template <typename T>
+    header_view<T> header() const {
+        return header_view<T>(layer_data(rfind_layer(header_view<T>::pdu_flag)));
+    }
+private:
+    void parse(PDU::PDUType type);
+    void add_layer(PDU::PDUType type, uint32_t offset, uint32_t header_size);
+
+    const uint8_t* buffer_;
+    uint32_t size_;
+    uint32_t payload_offset_;
+    uint32_t payload_size_;
+    size_t layer_count_;
+    layer layers_[MAX_LAYERS];
+};
+
+/**
+ * \cond
+ */
+namespace Internals {
+
+template <typename T>
+T read_be_field(const uint8_t* ptr) {
+    T value;
+    Memory::read_value(ptr, value);
+    return Endian::be_to_host(value);
+}
+
+} // Internals
+/**
+ * \endcond
+ */
+
+/**
+ * \brief Accessor for EthernetII headers.
+ */
+template <>
+class PacketView::header_view<EthernetII> {
+public:
+    static const PDU::PDUType pdu_flag = PDU::ETHERNET_II;
+    typedef HWAddress<6> address_type;
+
+    explicit header_view(const uint8_t* ptr) : ptr_(ptr) { }
+
+    address_type dst_addr() const {
+        return address_type(ptr_);
+    }
+
+    address_type src_addr() const {
+        return address_type(ptr_ + address_type::address_size);
+    }
+
+    uint16_t payload_type() const {
+        return Internals::read_be_field<uint16_t>(ptr_ + 12);
+    }
+private:
+    const uint8_t* ptr_;
+};
+
+/**
+ * \brief Accessor for Dot1Q headers.
+ */
+template <>
+class PacketView::header_view<Dot1Q> {
+public:
+    static const PDU::PDUType pdu_flag = PDU::DOT1Q;
+
+    explicit header_view(const uint8_t* ptr) : ptr_(ptr) { }
+
+    uint8_t priority() const {
+        return ptr_[0] >> 5;
+    }
+
+    uint8_t cfi() const {
+        return (ptr_[0] >> 4) & 1;
+    }
+
+    uint16_t id() const {
+        return Internals::read_be_field<uint16_t>(ptr_) & 0x0fff;
+    }
+
+    uint16_t payload_type() const {
+        return Internals::read_be_field<uint16_t>(ptr_ + 2);
+    }
+private:
+    const uint8_t* ptr_;
+};
+
+/**
+ * \brief Accessor for IP headers.
+ */
+template <>
+class PacketView::header_view<IP> {
+public:
+    static const PDU::PDUType pdu_flag = PDU::IP;
+    typedef IPv4Address address_type;
+
+    explicit header_view(const uint8_t* ptr) : ptr_(ptr) { }
+
+    uint8_t version() const {
+        return ptr_[0] >> 4;
+    }
+
+    uint8_t head_len() const {
+        return ptr_[0] & 0x0f;
+    }
+
+    uint8_t tos() const {
+        return ptr_[1];
+    }
+
+    uint16_t tot_len() const {
+        return Internals::read_be_field<uint16_t>(ptr_ + 2);
+    }
+
+    uint16_t id() const {
+        return Internals::read_be_field<uint16_t>(ptr_ + 4);
+    }
+
+    uint16_t fragment_offset() const {
+        return Internals::read_be_field<uint16_t>(ptr_ + 6) & 0x1fff;
+    }
+
+    uint8_t flags() const {
+        return Internals::read_be_field<uint16_t>(ptr_ + 6) >> 13;
+    }
+
+    bool is_fragmented() const {
+        return (Internals::read_be_field<uint16_t>(ptr_ + 6) & 0x3fff) != 0;
+    }
+
+    uint8_t ttl() const {
+        return ptr_[8];
+    }
+
+    uint8_t protocol() const {
+        return ptr_[9];
+    }
+
+    uint16_t checksum() const {
+        return Internals::read_be_field<uint16_t>(ptr_ + 10);
+    }
+
+    address_type src_addr() const {
+        uint32_t value;
+        Memory::read_value(ptr_ + 12, value);
+        return address_type(value);
+    }
+
+    address_type dst_addr() const {
+        uint32_t value;
+        Memory::read_value(ptr_ + 16, value);
+        return address_type(value);
+    }
+private:
+    const uint8_t* ptr_;
+};
+
+/**
+ * \brief Accessor for IPv6 headers.
+ */
+template <>
+class PacketView::header_view<IPv6> {
+public:
+    static const PDU::PDUType pdu_flag = PDU::IPv6;
+    typedef IPv6Address address_type;
+
+    explicit header_view(const uint8_t* ptr) : ptr_(ptr) { }
+
+    uint8_t version() const {
+        return ptr_[0] >> 4;
+    }
+
+    uint8_t traffic_class() const {
+        return static_cast<uint8_t>((ptr_[0] << 4) | (ptr_[1] >> 4));
+    }
+
+    uint32_t flow_label() const {
+        return Internals::read_be_field<uint32_t>(ptr_) & 0x000fffff;
+    }
+
+    uint16_t payload_length() const {
+        return Internals::read_be_field<uint16_t>(ptr_ + 4);
+    }
+
+    uint8_t next_header() const {
+        return ptr_[6];
+    }
+
+    uint8_t hop_limit() const {
+        return ptr_[7];
+    }
+
+    address_type src_addr() const {
+        return address_type(ptr_ + 8);
+    }
+
+    address_type dst_addr() const {
+        return address_type(ptr_ + 8 + address_type::address_size);
+    }
+private:
+    const uint8_t* ptr_;
+};
+
+/**
+ * \brief Accessor for TCP headers.
+ */
+template <>
+class PacketView::header_view<TCP> {
+public:
+    static const PDU::PDUType pdu_flag = PDU::TCP;
+
+    explicit header_view(const uint8_t* ptr) : ptr_(ptr) { }
+
+    uint16_t sport() const {
+        return Internals::read_be_field<uint16_t>(ptr_);
+    }
+
+    uint16_t dport() const {
+        return Internals::read_be_field<uint16_t>(ptr_ + 2);
+    }
+
+    uint32_t seq() const {
+        return Internals::read_be_field<uint32_t>(ptr_ + 4);
+    }
+
+    uint32_t ack_seq() const {
+        return Internals::read_be_field<uint32_t>(ptr_ + 8);
+    }
+
+    uint8_t data_offset() const {
+        return ptr_[12] >> 4;
+    }
+
+    /**
+     * \brief Returns the flags byte, which can be tested using TCP::Flags.
+     */
+    uint8_t flags() const {
+        return ptr_[13];
+    }
+
+    uint16_t window() const {
+        return Internals::read_be_field<uint16_t>(ptr_ + 14);
+    }
+
+    uint16_t checksum() const {
+        return Internals::read_be_field<uint16_t>(ptr_ + 16);
+    }
+
+    uint16_t urg_ptr() const {
+        return Internals::read_be_field<uint16_t>(ptr_ + 18);
+    }
+private:
+    const uint8_t* ptr_;
+};
+
+/**
+ * \brief Accessor for UDP headers.
+ */
+template <>
+class PacketView::header_view<UDP> {
+public:
+    static const PDU::PDUType pdu_flag = PDU::UDP;
+
+    explicit header_view(const uint8_t* ptr) : ptr_(ptr) { }
+
+    uint16_t sport() const {
+        return Internals::read_be_field<uint16_t>(ptr_);
+    }
+
+    uint16_t dport() const {
+        return Internals::read_be_field<uint16_t>(ptr_ + 2);
+    }
+
+    uint16_t length() const {
+        return Internals::read_be_field<uint16_t>(ptr_ + 4);
+    }
+
+    uint16_t checksum() const {
+        return Internals::read_be_field<uint16_t>(ptr_ + 6);
+    }
+private:
+    const uint8_t* ptr_;
+};
+
+/**
+ * \brief Accessor for ICMP headers.
+ */
+template <>
+class PacketView::header_view<ICMP> {
+public:
+    static const PDU::PDUType pdu_flag = PDU::ICMP;
+
+    explicit header_view(const uint8_t* ptr) : ptr_(ptr) { }
+
+    uint8_t type() const {
+        return ptr_[0];
+    }
+
+    uint8_t code() const {
+        return ptr_[1];
+    }
+
+    uint16_t checksum() const {
+        return Internals::read_be_field<uint16_t>(ptr_ + 2);
+    }
+private:
+    const uint8_t* ptr_;
+};
+
+} // Tins
+
+#endif // TINS_PACKET_VIEW_H
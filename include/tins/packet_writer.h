@@ -31,6 +31,9 @@
 #define TINS_PACKET_WRITER_H
 
 #include <string>
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
 #include <tins/macros.h>
 #include <tins/cxxstd.h>
 #include <tins/utils/pdu_utils.h>
@@ -44,6 +47,8 @@ struct timeval;
 namespace Tins {
 class PDU;
 class Packet;
+class RawPacket;
+class Timestamp;
 
 /**
  * \class PacketWriter
@@ -76,6 +81,22 @@ class Packet;
  * writer.write(smart_ptr);
  * writer.write(vt.begin(), vt.end());
  * \endcode
+ *
+ * Packets that were captured and don't need to be modified can be written
+ * using PacketWriter::write_raw, which stores their bytes as they are 
+ * rather than parsing and serializing them again:
+ *
+ * \code
+ * PacketWriter writer("/tmp/file.pcap", DataLinkType<EthernetII>());
+ * MappedFileSniffer sniffer("/tmp/input.pcap");
+ * sniffer.sniff_frames([&](const RawPacket& frame) {
+ *     writer.write_raw(frame);
+ *     return true;
+ * });
+ * \endcode
+ *
+ * Packets are accumulated in a write buffer, which is written to the file 
+ * once it's full. Its size can be set when constructing the writer.
  */
 class TINS_API PacketWriter {
 public:
@@ -94,6 +115,11 @@ public:
         SLL = DLT_LINUX_SLL
     };
 
+    /**
+     * \brief The default size of the write buffer.
+     */
+    static const size_t DEFAULT_BUFFER_SIZE;
+
     /**
      * \brief Constructs a PacketWriter.
      *
@@ -110,14 +136,19 @@ public:
      * writer.write(packet);
      * \endcode
      * 
-     * \param file_name The file in which to store the written PDUs.
+     * \param file_name The file in which to store the written PDUs, or 
+     * "-" to write them to the standard output.
      * \param lt A DataLinkType that represents the link layer
      * protocol to use.
+     * \param buffer_size The size of the write buffer. Larger buffers 
+     * perform fewer, larger writes. This is ignored on Windows and when 
+     * writing to the standard output.
      * \sa PcapIdentifier.
      */
     template<typename T>
-    PacketWriter(const std::string& file_name, const DataLinkType<T>& lt) {
-        init(file_name, lt.get_type());
+    PacketWriter(const std::string& file_name, const DataLinkType<T>& lt, 
+                 size_t buffer_size = DEFAULT_BUFFER_SIZE) {
+        init(file_name, lt.get_type(), buffer_size);
     }
 
     /**
@@ -126,11 +157,14 @@ public:
      * \deprecated Use the PacketWriter(const std::string&, const DataLinkType<T>&)
      * constructor.
      * 
-     * \param file_name The file in which to store the written PDUs.
+     * \param file_name The file in which to store the written PDUs, or 
+     * "-" to write them to the standard output.
      * \param lt The link type which will be written to this file.
+     * \param buffer_size The size of the write buffer.
      * \sa LinkType.
      */
-    PacketWriter(const std::string& file_name, LinkType lt);
+    PacketWriter(const std::string& file_name, LinkType lt, 
+                 size_t buffer_size = DEFAULT_BUFFER_SIZE);
     
     #if TINS_IS_CXX11
         /**
@@ -210,16 +244,47 @@ public:
             write(Utils::dereference_until_pdu(*start++));
         }
     }
+
+    /**
+     * \brief Writes a packet's bytes to this file.
+     *
+     * The data is stored as is, so it must start with a header of the 
+     * link layer type this file was created with.
+     *
+     * \param data The packet's data.
+     * \param size The size of the packet's data.
+     * \param timestamp The packet's timestamp.
+     * \param original_size The packet's size on the wire, which can be 
+     * larger than size if it was truncated when captured.
+     */
+    void write_raw(const uint8_t* data, uint32_t size, const Timestamp& timestamp, 
+                   uint32_t original_size);
+
+    /**
+     * \brief Writes a frame's bytes to this file.
+     *
+     * The frame's timestamp and original size are kept.
+     *
+     * \param frame The frame to be written.
+     */
+    void write_raw(const RawPacket& frame);
+
+    /**
+     * \brief Writes every buffered packet to the file.
+     */
+    void flush();
 private:
     // You shall not copy
     PacketWriter(const PacketWriter&);
     PacketWriter& operator=(const PacketWriter&);
 
-    void init(const std::string& file_name, int link_type);
+    void init(const std::string& file_name, int link_type, size_t buffer_size);
     void write(PDU& pdu, const struct timeval& tv);
 
     pcap_t* handle_;
     pcap_dumper_t* dumper_; 
+    // Reused to serialize the PDUs that are written
+    std::vector<uint8_t> buffer_;
 };
 
 } // Tins
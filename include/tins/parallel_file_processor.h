@@ -0,0 +1,260 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef TINS_PARALLEL_FILE_PROCESSOR_H
+#define TINS_PARALLEL_FILE_PROCESSOR_H
+
+#include <tins/config.h>
+
+#if defined(TINS_HAVE_PCAP) && defined(TINS_HAVE_CXX11)
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <stdint.h>
+#include <tins/mapped_file_sniffer.h>
+#include <tins/sniffer.h>
+#include <tins/macros.h>
+
+namespace Tins {
+
+/**
+ * \class ParallelFileProcessor
+ * \brief Processes the packets in a pcap file using several threads.
+ *
+ * Reading a file through a sniffer processes its packets one after the 
+ * other on a single thread. This class splits a pcap file into chunks of 
+ * whole records and hands them out to a set of worker threads, each of 
+ * which reads the records in its chunks through its own MappedFileSniffer.
+ *
+ * Chunks are found by walking through the records' headers, which doesn't 
+ * touch the packets' contents. This happens on the calling thread while 
+ * the workers process the chunks found so far, so the file is only read 
+ * from disk once.
+ *
+ * Results are computed using map_reduce: every worker gets its own copy 
+ * of an initial state which the functor updates with each packet, 
+ * and once the whole file is processed, the workers' states are merged 
+ * using a reducer. Since no locking is involved, the functor should only 
+ * modify the state it's given:
+ *
+ * \code
+ * typedef std::map<IPv4Address, size_t> counters_type;
+ *
+ * ParallelFileProcessor processor("capture.pcap");
+ * counters_type counters = processor.map_reduce(
+ *     counters_type(),
+ *     [](counters_type& counters, Packet& packet) {
+ *         if (const IP* ip = packet.pdu()->find_pdu<IP>()) {
+ *             counters[ip->src_addr()]++;
+ *         }
+ *     },
+ *     [](counters_type& total, const counters_type& partial) {
+ *         for (const auto& entry : partial) {
+ *             total[entry.first] += entry.second;
+ *         }
+ *     }
+ * );
+ * \endcode
+ *
+ * Each chunk is processed in order by a single worker, but chunks are 
+ * processed concurrently and in no particular order, so the reducer 
+ * should not depend on how packets were split among workers.
+ */
+class TINS_API ParallelFileProcessor {
+public:
+    /**
+     * \brief The default size of each chunk.
+     *
+     * This is 8 MB by default.
+     */
+    static const uint64_t DEFAULT_CHUNK_SIZE;
+
+    /**
+     * \brief Constructs a ParallelFileProcessor.
+     *
+     * The file is not opened until it is processed. Only the filter set
+     * in the configuration is used.
+     *
+     * \param file_name The pcap file to be processed.
+     * \param worker_count The amount of worker threads to use. If this is
+     * 0, one worker per hardware thread is used.
+     * \param configuration The configuration used to setup each worker's 
+     * sniffer.
+     */
+    ParallelFileProcessor(const std::string& file_name, uint32_t worker_count = 0,
+                          const SnifferConfiguration& configuration = SnifferConfiguration());
+
+    /**
+     * \brief Processes every packet in the file and merges the results.
+     *
+     * The functor must implement an operator with the following signature:
+     *
+     * \code
+     * void(State& state, Packet& packet);
+     * \endcode
+     *
+     * The reducer must implement an operator with the following signature:
+     *
+     * \code
+     * void(State& total, const State& partial);
+     * \endcode
+     *
+     * The functor is called concurrently from every worker thread, each 
+     * one using its own copy of the initial state. The reducer is then 
+     * used on the calling thread to merge every state into the first one.
+     *
+     * Both malformed_packet and pdu_not_found exceptions thrown by the 
+     * functor are caught. If any other exception is thrown, the workers 
+     * are stopped and it is rethrown by this method.
+     *
+     * \param initial The state every worker starts with.
+     * \param function The functor which processes packets.
+     * \param reducer The functor used to merge the workers' states.
+     * \return The merged state.
+     */
+    template <typename State, typename Functor, typename Reducer>
+    State map_reduce(const State& initial, Functor function, Reducer reducer);
+
+    /**
+     * \brief Processes every frame in the file without parsing them and 
+     * merges the results.
+     *
+     * This works just like ParallelFileProcessor::map_reduce, but the 
+     * functor is given the RawPackets handed out by MappedFileSniffer::sniff_frames.
+     * This means it must implement an operator with the following signature:
+     *
+     * \code
+     * void(State& state, const RawPacket& frame);
+     * \endcode
+     *
+     * \param initial The state every worker starts with.
+     * \param function The functor which processes frames.
+     * \param reducer The functor used to merge the workers' states.
+     * \return The merged state.
+     */
+    template <typename State, typename Functor, typename Reducer>
+    State map_reduce_frames(const State& initial, Functor function, Reducer reducer);
+
+    /**
+     * \brief Sets the size of each chunk.
+     *
+     * Chunks always contain whole records, so they'll be slightly larger
+     * than this. Smaller chunks balance work better among workers, while 
+     * larger ones have less overhead.
+     *
+     * \param size The chunk size, in bytes.
+     */
+    void set_chunk_size(uint64_t size);
+
+    /**
+     * \brief Sets whether to extract RawPDUs or fully parsed packets.
+     *
+     * \sa BaseSniffer::set_extract_raw_pdus
+     * \param value Whether to extract RawPDUs or not.
+     */
+    void set_extract_raw_pdus(bool value);
+
+    /**
+     * \brief Sets whether workers allocate PDUs using a PDUArena.
+     *
+     * This is disabled by default. It's worth enabling when the functor 
+     * doesn't keep packets around, as each worker's arena keeps reusing 
+     * the same memory.
+     *
+     * \param value Whether to use an arena on each worker.
+     */
+    void set_use_pdu_arena(bool value);
+
+    /**
+     * Retrieves the amount of workers.
+     */
+    uint32_t worker_count() const;
+
+    /**
+     * Retrieves the size of each chunk.
+     */
+    uint64_t chunk_size() const;
+private:
+    typedef std::function<void(uint32_t, MappedFileSniffer&)> worker_function;
+
+    template <typename State, typename Reducer>
+    static State reduce(std::vector<State>& states, Reducer& reducer);
+
+    void run_workers(const worker_function& function);
+
+    std::string file_name_;
+    SnifferConfiguration configuration_;
+    uint32_t worker_count_;
+    uint64_t chunk_size_;
+    bool extract_raw_;
+    bool use_pdu_arena_;
+};
+
+template <typename State, typename Functor, typename Reducer>
+State ParallelFileProcessor::map_reduce(const State& initial, Functor function,
+                                        Reducer reducer) {
+    std::vector<State> states(worker_count_, initial);
+    run_workers([&](uint32_t index, MappedFileSniffer& sniffer) {
+        State& state = states[index];
+        sniffer.sniff_loop([&](Packet& packet) {
+            function(state, packet);
+            return true;
+        });
+    });
+    return reduce(states, reducer);
+}
+
+template <typename State, typename Functor, typename Reducer>
+State ParallelFileProcessor::map_reduce_frames(const State& initial, Functor function,
+                                               Reducer reducer) {
+    std::vector<State> states(worker_count_, initial);
+    run_workers([&](uint32_t index, MappedFileSniffer& sniffer) {
+        State& state = states[index];
+        sniffer.sniff_frames([&](const RawPacket& frame) {
+            function(state, frame);
+            return true;
+        });
+    });
+    return reduce(states, reducer);
+}
+
+template <typename State, typename Reducer>
+State ParallelFileProcessor::reduce(std::vector<State>& states, Reducer& reducer) {
+    for (size_t i = 1; i < states.size(); ++i) {
+        reducer(states[0], static_cast<const State&>(states[i]));
+    }
+    return states[0];
+}
+
+} // Tins
+
+#endif // TINS_HAVE_PCAP && TINS_HAVE_CXX11
+
+#endif // TINS_PARALLEL_FILE_PROCESSOR_H
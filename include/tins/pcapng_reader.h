@@ -0,0 +1,281 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef TINS_PCAPNG_READER_H
+#define TINS_PCAPNG_READER_H
+
+#include <tins/config.h>
+
+#ifdef TINS_HAVE_PCAP
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <stdint.h>
+#include <tins/packet.h>
+#include <tins/raw_packet.h>
+#include <tins/macros.h>
+#include <tins/exceptions.h>
+#include <tins/detail/type_traits.h>
+
+namespace Tins {
+
+class CaptureIndex;
+class IndexedFileReader;
+
+/**
+ * \class PcapngReader
+ * \brief Reads packets from pcapng files.
+ *
+ * This class reads pcapng files one block at a time, so it can be used 
+ * on files of any size as well as on pipes. Section header, interface 
+ * description, enhanced packet, simple packet and the obsolete packet 
+ * blocks are understood, while every other block is skipped. Files that 
+ * contain several sections are supported, each of them in either byte order.
+ *
+ * A pcapng file can contain packets captured on several interfaces, each
+ * with its own link layer type and timestamp resolution. Every packet is
+ * parsed using its interface's link layer type and its timestamp is 
+ * converted using the interface's resolution and offset. The interface 
+ * a packet was captured on is available through Packet::interface_id 
+ * and RawPacket::interface_id, and its description through 
+ * PcapngReader::interfaces.
+ *
+ * \code
+ * PcapngReader reader("capture.pcapng");
+ * reader.sniff_loop([&](Packet& packet) {
+ *     const PcapngReader::interface_description& iface = 
+ *         reader.interfaces()[packet.interface_id()];
+ *     // ...
+ *     return true;
+ * });
+ * \endcode
+ *
+ * Timestamps are always handed out with microsecond resolution.
+ */
+class TINS_API PcapngReader {
+public:
+    /**
+     * \brief Describes an interface in the current section.
+     */
+    struct interface_description {
+        /**
+         * The interface's link layer type, one of the DLT_* constants 
+         * defined by libpcap.
+         */
+        int link_type;
+
+        /**
+         * The snapshot length used, 0 if unlimited.
+         */
+        uint32_t snap_len;
+
+        /**
+         * The interface's name, if it was stored in the file.
+         */
+        std::string name;
+
+        /**
+         * The amount of timestamp units per second.
+         */
+        uint64_t timestamp_units;
+
+        /**
+         * The amount of seconds added to every timestamp.
+         */
+        int64_t timestamp_offset;
+    };
+
+    /**
+     * The type used to store the interfaces in the current section.
+     */
+    typedef std::vector<interface_description> interfaces_type;
+
+    /**
+     * \brief Constructs a PcapngReader.
+     *
+     * \param file_name The pcapng file which will be read.
+     */
+    PcapngReader(const std::string& file_name);
+
+    /**
+     * \brief Destructor.
+     *
+     * This closes the file.
+     */
+    ~PcapngReader();
+
+    /**
+     * \brief Reads the next packet without parsing it.
+     *
+     * The provided RawPacket will point to the packet's data inside the 
+     * reader's buffer, so it's only valid until the next block is read.
+     *
+     * \param frame The object in which to store the frame.
+     * \return false if there are no more packets, true otherwise.
+     */
+    bool next_frame(RawPacket& frame);
+
+    /**
+     * \brief Reads one packet and parses it.
+     *
+     * This behaves just like BaseSniffer::next_packet, setting the 
+     * packet's interface identifier as well.
+     *
+     * \return The next packet. If there are no more packets, PtrPacket::pdu
+     * will return 0. Caller takes ownership of the PDU pointer stored in
+     * the PtrPacket.
+     */
+    PtrPacket next_packet();
+
+    /**
+     * \brief Starts a sniffing loop, using a callback functor for every
+     * packet in the file.
+     *
+     * This behaves just like BaseSniffer::sniff_loop.
+     *
+     * \param function The callback handler object which should process packets.
+     * \param max_packets The maximum amount of packets to read. 0 == infinite.
+     */
+    template <typename Functor>
+    void sniff_loop(Functor function, uint32_t max_packets = 0);
+
+    /**
+     * \brief Starts a sniffing loop which hands out frames without parsing 
+     * them.
+     *
+     * The functor must implement an operator with the following signature:
+     *
+     * \code
+     * bool(const RawPacket&);
+     * \endcode
+     *
+     * Reading will stop when either max_packets are read (if it is != 0), 
+     * when the functor returns false or when there are no more packets.
+     * Both malformed_packet and pdu_not_found exceptions thrown by the 
+     * functor are caught.
+     *
+     * \param function The callback handler object which should process frames.
+     * \param max_packets The maximum amount of frames to read. 0 == infinite.
+     */
+    template <typename Functor>
+    void sniff_frames(Functor function, uint32_t max_packets = 0);
+
+    /**
+     * \brief Sets whether to extract RawPDUs or fully parsed packets.
+     *
+     * \sa BaseSniffer::set_extract_raw_pdus
+     * \param value Whether to extract RawPDUs or not.
+     */
+    void set_extract_raw_pdus(bool value);
+
+    /**
+     * \brief Retrieves the interfaces described so far in the current 
+     * section.
+     *
+     * A packet's interface identifier is its interface's index in this 
+     * list.
+     */
+    const interfaces_type& interfaces() const;
+private:
+    friend class CaptureIndex;
+    friend class IndexedFileReader;
+
+    PcapngReader(const PcapngReader&);
+    PcapngReader& operator=(const PcapngReader&);
+
+    void seek(uint64_t offset);
+    void restore_section(uint64_t section_offset, 
+                         const std::vector<uint64_t>& interface_offsets);
+    bool read_block();
+    void parse_section_header();
+    void parse_interface_description();
+    bool parse_packet(RawPacket& frame);
+    uint16_t read_uint16(uint32_t offset) const;
+    uint32_t read_uint32(uint32_t offset) const;
+    uint64_t read_uint64(uint32_t offset) const;
+    Timestamp make_timestamp(const interface_description& iface, uint64_t value) const;
+
+    FILE* file_;
+    std::vector<uint8_t> block_;
+    interfaces_type interfaces_;
+    // Offsets of the interface descriptions in the current section
+    std::vector<uint64_t> interface_offsets_;
+    uint64_t offset_;
+    uint64_t block_offset_;
+    uint64_t section_offset_;
+    uint32_t block_type_;
+    bool swap_bytes_;
+    bool extract_raw_;
+};
+
+template <typename Functor>
+void PcapngReader::sniff_loop(Functor function, uint32_t max_packets) {
+    while (true) {
+        Packet packet(next_packet());
+        if (!packet) {
+            return;
+        }
+        try {
+            // If the functor returns false, we're done
+            if (!Tins::Internals::invoke_loop_cb(function, packet)) {
+                return;
+            }
+        }
+        catch(malformed_packet&) { }
+        catch(pdu_not_found&) { }
+        if (max_packets && --max_packets == 0) {
+            return;
+        }
+    }
+}
+
+template <typename Functor>
+void PcapngReader::sniff_frames(Functor function, uint32_t max_packets) {
+    RawPacket frame;
+    while (next_frame(frame)) {
+        try {
+            // If the functor returns false, we're done
+            if (!function(frame)) {
+                return;
+            }
+        }
+        catch(malformed_packet&) { }
+        catch(pdu_not_found&) { }
+        if (max_packets && --max_packets == 0) {
+            return;
+        }
+    }
+}
+
+} // Tins
+
+#endif // TINS_HAVE_PCAP
+
+#endif // TINS_PCAPNG_READER_H
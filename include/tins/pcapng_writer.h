@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef TINS_PCAPNG_WRITER_H
+#define TINS_PCAPNG_WRITER_H
+
+#include <tins/config.h>
+
+#ifdef TINS_HAVE_PCAP
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <stdint.h>
+#include <tins/macros.h>
+#include <tins/data_link_type.h>
+
+namespace Tins {
+
+class PDU;
+class Packet;
+class RawPacket;
+class Timestamp;
+
+/**
+ * \class PcapngWriter
+ * \brief Writes packets to a pcapng file.
+ *
+ * Unlike PacketWriter, this class can store packets captured on several
+ * interfaces, each with its own link layer type, in a single file. 
+ * Interfaces are added through PcapngWriter::add_interface, which returns 
+ * the identifier to use when writing packets captured on it.
+ *
+ * Blocks are accumulated in a buffer and written to the file once it's 
+ * full, when PcapngWriter::flush is called or when the writer is destroyed.
+ *
+ * \code
+ * PcapngWriter writer("/tmp/file.pcapng");
+ * uint32_t eth = writer.add_interface(DataLinkType<EthernetII>(), "eth0");
+ * uint32_t wlan = writer.add_interface(DataLinkType<RadioTap>(), "wlan0");
+ *
+ * writer.write(ethernet_packet, eth);
+ * writer.write(radiotap_packet, wlan);
+ * \endcode
+ *
+ * Timestamps are written with microsecond resolution.
+ */
+class TINS_API PcapngWriter {
+public:
+    /**
+     * \brief The default size of the write buffer.
+     *
+     * This is 1 MB by default.
+     */
+    static const size_t DEFAULT_BUFFER_SIZE;
+
+    /**
+     * \brief Constructs a PcapngWriter.
+     *
+     * The file is created and its section header is written right away.
+     *
+     * \param file_name The file in which to store the written packets.
+     * \param buffer_size The size of the write buffer.
+     */
+    PcapngWriter(const std::string& file_name, size_t buffer_size = DEFAULT_BUFFER_SIZE);
+
+    /**
+     * \brief Destructor.
+     *
+     * Writes any buffered blocks and closes the file.
+     */
+    ~PcapngWriter();
+
+    /**
+     * \brief Adds an interface to the file.
+     *
+     * \param lt A DataLinkType that represents the link layer protocol 
+     * used on the interface.
+     * \param name The interface's name. Nothing is stored if it's empty.
+     * \param snap_len The snapshot length used on the interface, 0 if unlimited.
+     * \return The identifier of the new interface.
+     */
+    template <typename T>
+    uint32_t add_interface(const DataLinkType<T>& lt, const std::string& name = "",
+                           uint32_t snap_len = 0) {
+        return add_interface(lt.get_type(), name, snap_len);
+    }
+
+    /**
+     * \brief Adds an interface to the file.
+     *
+     * \param link_type The link layer type used on the interface, one of the
+     * DLT_* constants defined by libpcap.
+     * \param name The interface's name. Nothing is stored if it's empty.
+     * \param snap_len The snapshot length used on the interface, 0 if unlimited.
+     * \return The identifier of the new interface.
+     */
+    uint32_t add_interface(int link_type, const std::string& name = "",
+                           uint32_t snap_len = 0);
+
+    /**
+     * \brief Writes a PDU to this file.
+     *
+     * The current time is used as the packet's timestamp.
+     *
+     * \param pdu The PDU to be written.
+     * \param interface_id The identifier of the interface the packet was 
+     * captured on.
+     */
+    void write(PDU& pdu, uint32_t interface_id = 0);
+
+    /**
+     * \brief Writes a Packet to this file.
+     *
+     * The packet's timestamp and interface identifier are used.
+     *
+     * \param packet The packet to be written.
+     */
+    void write(Packet& packet);
+
+    /**
+     * \brief Writes a frame to this file without parsing it.
+     *
+     * The frame's timestamp, original size and interface identifier 
+     * are used.
+     *
+     * \param frame The frame to be written.
+     */
+    void write(const RawPacket& frame);
+
+    /**
+     * \brief Writes every buffered block to the file.
+     */
+    void flush();
+
+    /**
+     * Retrieves the amount of interfaces added.
+     */
+    uint32_t interface_count() const;
+private:
+    PcapngWriter(const PcapngWriter&);
+    PcapngWriter& operator=(const PcapngWriter&);
+
+    void write_packet(const uint8_t* data, uint32_t size, uint32_t original_size,
+                      const Timestamp& ts, uint32_t interface_id);
+    void write_packet(PDU& pdu, const Timestamp& ts, uint32_t interface_id);
+    void begin_packet(uint32_t size, uint32_t original_size, const Timestamp& ts,
+                      uint32_t interface_id);
+    void end_packet(uint32_t size);
+    void begin_block(uint32_t type, uint32_t length);
+    void append(const void* data, size_t size);
+    void append_uint16(uint16_t value);
+    void append_uint32(uint32_t value);
+    void append_padding(uint32_t size);
+    void write_buffer();
+
+    FILE* file_;
+    std::vector<uint8_t> buffer_;
+    size_t buffer_size_;
+    uint32_t interface_count_;
+};
+
+} // Tins
+
+#endif // TINS_HAVE_PCAP
+
+#endif // TINS_PCAPNG_WRITER_H
@@ -33,6 +33,7 @@
 
 #include <stdint.h>
 #include <vector>
+#include <new>
 #include <tins/macros.h>
 #include <tins/cxxstd.h>
 #include <tins/exceptions.h>
@@ -103,6 +104,18 @@ typedef std::vector<uint8_t> byte_array;
  * // Now serialize it. This is a std::vector<uint8_t>.
  * PDU::serialization_type buffer = packet.serialize();
  * \endcode
+ *
+ * When serializing many packets, PDU::serialize_into avoids allocating 
+ * a new buffer each time by writing into one provided by the caller:
+ *
+ * \code
+ * PDU::serialization_type buffer;
+ * for (size_t i = 0; i < packets.size(); ++i) {
+ *     // The buffer only grows when a packet is larger than all previous ones
+ *     size_t size = packets[i].serialize_into(buffer);
+ *     // ...
+ * }
+ * \endcode
  */
 class TINS_API PDU {
 public:
@@ -232,11 +245,12 @@ public:
          * \param rhs The PDU to be moved.
          */
         PDU(PDU &&rhs) TINS_NOEXCEPT 
-        : inner_pdu_(0), parent_pdu_(0) {
+        : inner_pdu_(0), parent_pdu_(0), layer_index_(0) {
             std::swap(inner_pdu_, rhs.inner_pdu_);
             if (inner_pdu_) {
                 inner_pdu_->parent_pdu(this);
             }
+            rhs.invalidate_layer_index();
         }
         
         /**
@@ -251,6 +265,8 @@ public:
             if (inner_pdu_) {
                 inner_pdu_->parent_pdu(this);
             }
+            invalidate_layer_index();
+            rhs.invalidate_layer_index();
             return* this;
         }
     #endif
@@ -263,6 +279,47 @@ public:
      */
     virtual ~PDU();
 
+    /**
+     * \brief Allocates memory for a PDU.
+     *
+     * If a PDUArena is in use on the calling thread, the memory is taken
+     * from it. Otherwise, the global operator new is used.
+     *
+     * \sa PDUArena
+     */
+    static void* operator new(size_t size);
+
+    /**
+     * \brief Allocates memory for a PDU without throwing.
+     *
+     * \return The allocated memory or 0 if the allocation failed.
+     */
+    static void* operator new(size_t size, const std::nothrow_t&) TINS_NOEXCEPT;
+
+    /**
+     * \brief Placement new, constructs a PDU in the given memory.
+     */
+    static void* operator new(size_t, void* where) TINS_NOEXCEPT {
+        return where;
+    }
+
+    /**
+     * \brief Releases memory allocated using PDU::operator new.
+     */
+    static void operator delete(void* ptr);
+
+    /**
+     * \brief Releases memory allocated using the non throwing operator new.
+     */
+    static void operator delete(void* ptr, const std::nothrow_t&) TINS_NOEXCEPT;
+
+    /**
+     * \brief Placement delete, does nothing.
+     */
+    static void operator delete(void*, void*) TINS_NOEXCEPT {
+
+    }
+
     /** \brief The header's size
      */
     virtual uint32_t header_size() const = 0;
@@ -348,24 +405,52 @@ public:
      */
     serialization_type serialize();
 
+    /**
+     * \brief Serializes the whole chain of PDUs into the given buffer.
+     *
+     * This works just like PDU::serialize, but the serialization is 
+     * written at the beginning of the provided buffer rather than into 
+     * a newly allocated one.
+     *
+     * If the buffer is smaller than size(), a serialization_error is 
+     * thrown and nothing is written.
+     *
+     * \param buffer The buffer in which to write the serialization.
+     * \param capacity The size of the buffer.
+     * \return The size of the serialization.
+     */
+    size_t serialize_into(uint8_t* buffer, size_t capacity);
+
+    /**
+     * \brief Serializes the whole chain of PDUs into the given vector.
+     *
+     * The vector is resized so that it contains exactly the serialization. 
+     * As resizing a vector never releases its memory, serializing many 
+     * PDUs into the same vector only allocates when a PDU is larger than 
+     * the ones serialized before it.
+     *
+     * \param buffer The vector in which to write the serialization.
+     * \return The size of the serialization.
+     */
+    size_t serialize_into(serialization_type& buffer);
+
     /**
      * \brief Finds and returns the first PDU that matches the given flag.
      *
      * This method searches for the first PDU which has the same type flag as
      * the given one. If the first PDU matches that flag, it is returned.
      * If no PDU matches, 0 is returned.
+     *
+     * If this PDU's layers were indexed through PDU::build_layer_index, as 
+     * sniffers do for the packets they parse, this takes constant time 
+     * instead of walking the chain. Lookups never modify the PDU, so they're
+     * safe to use concurrently on a PDU that isn't being modified.
+     *
      * \param flag The flag which being searched.
      */
     template<typename T> 
     T* find_pdu(PDUType type = T::pdu_flag) {
-        PDU* pdu = this;
-        while (pdu) {
-            if (pdu->matches_flag(type)) {
-                return static_cast<T*>(pdu);
-            }
-            pdu = pdu->inner_pdu();
-        }
-        return 0;
+        return static_cast<T*>(find_layer(type));
     }
     
     /**
@@ -375,7 +460,7 @@ public:
      */
     template<typename T> 
     const T* find_pdu(PDUType type = T::pdu_flag) const {
-        return const_cast<PDU*>(this)->find_pdu<T>(type);
+        return static_cast<const T*>(find_layer(type));
     }
 
     /**
@@ -403,9 +488,30 @@ public:
      */
     template<typename T> 
     const T& rfind_pdu(PDUType type = T::pdu_flag) const {
-        return const_cast<PDU*>(this)->rfind_pdu<T>(type);
+        const T* ptr = find_pdu<T>(type);
+        if (!ptr) {
+            throw pdu_not_found();
+        }
+        return* ptr;
     }
 
+    /**
+     * \brief Indexes the layers in this chain so PDU::find_pdu takes 
+     * constant time.
+     *
+     * The index holds the first layer of each type in the chain. It's 
+     * discarded whenever the chain is modified, after which lookups walk 
+     * the chain again until this is called once more. Lookups of types that
+     * other types match as well, such as DOT11, and on chains that contain 
+     * user defined PDUs or more than 8 distinct types of layers always walk
+     * the chain.
+     *
+     * Sniffers call this on every packet they parse, so it only needs to 
+     * be called on chains built some other way. This can only be called on 
+     * the outermost PDU in a chain, and does nothing otherwise.
+     */
+    void build_layer_index();
+
     /**
      * \brief Clones this packet.
      *
@@ -523,10 +629,68 @@ protected:
      */
     virtual void write_serialization(uint8_t* buffer, uint32_t total_sz) = 0;
 private:
+    #if TINS_IS_CXX11
+        // Serializes its layers without linking them through inner_pdu_
+        template <typename... Layers>
+        friend class PDUStack;
+    #endif // TINS_IS_CXX11
+
+    // The first layer of each type in a chain. Only the outermost PDU in a
+    // chain keeps one, which is built by build_layer_index
+    struct layer_index {
+        // The amount of distinct layer types an index holds. Chains with more
+        // of them aren't indexed
+        static const uint32_t capacity = 8;
+        // Types that other types match as well (e.g. every 802.11 frame 
+        // matches DOT11), which can't be looked up by their exact type
+        static const uint64_t base_types = (1ULL << DOT11) | (1ULL << DOT11_CONTROL) |
+                                           (1ULL << DOT11_DATA) | (1ULL << DOT11_MANAGEMENT);
+
+        static bool indexable(PDUType type) {
+            return type < 64 && ((base_types >> type) & 1) == 0;
+        }
+
+        static uint32_t count_bits(uint64_t value) {
+            #if defined(__GNUC__) || defined(__clang__)
+                return static_cast<uint32_t>(__builtin_popcountll(value));
+            #else
+                uint32_t count = 0;
+                for (; value; value &= value - 1) {
+                    ++count;
+                }
+                return count;
+            #endif
+        }
+
+        PDU* find(PDUType type) const {
+            const uint64_t bit = 1ULL << type;
+            return (types & bit) ? layers[count_bits(types & (bit - 1))] : 0;
+        }
+
+        // A bit for each type of layer in the chain
+        uint64_t types;
+        // The first layer of each type in types, in the order of their bits
+        PDU* layers[capacity];
+        // Whether the chain could be indexed. Layers of user defined types 
+        // can match any type, so chains containing them aren't
+        bool complete;
+    };
+
+    PDU* find_layer(PDUType type) const {
+        if (layer_index_ && layer_index_->complete && layer_index::indexable(type)) {
+            return layer_index_->find(type);
+        }
+        return search_layer(type);
+    }
+
+    PDU* search_layer(PDUType type) const;
     void parent_pdu(PDU* parent);
+    void invalidate_layer_index();
+    void free_layer_index();
 
     PDU* inner_pdu_;
     PDU* parent_pdu_;
+    layer_index* layer_index_;
 };
 
 /**
@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef TINS_PDU_ARENA_H
+#define TINS_PDU_ARENA_H
+
+#include <cstddef>
+#include <stdint.h>
+#include <tins/config.h>
+#include <tins/macros.h>
+
+namespace Tins {
+
+/**
+ * \cond
+ */
+namespace Internals {
+
+struct pdu_arena_state;
+
+void* allocate_pdu(size_t size);
+void deallocate_pdu(void* ptr);
+
+} // Internals
+/**
+ * \endcond
+ */
+
+#ifdef TINS_HAVE_CXX11
+
+/**
+ * \class PDUArena
+ * \brief Allocates PDUs out of a recyclable block of memory.
+ *
+ * Parsing a packet allocates one object per layer, which are later freed 
+ * one by one once the packet is discarded. When an arena is in use on a 
+ * thread, every PDU allocated on that thread is instead carved out of the 
+ * arena's memory, which makes both allocating and freeing them nearly free.
+ *
+ * An arena is used by creating a PDUArena::scope object on the thread 
+ * that parses packets. Every PDU that is created while the scope is alive, 
+ * including the ones built by sniffers, is placed in the arena. Nothing 
+ * else needs to change: PDUs are still deleted as usual, by the Packet 
+ * that holds them or by calling delete.
+ *
+ * The arena's memory is split into blocks. A block is reused as soon as 
+ * every PDU allocated out of it has been deleted, so a few long lived PDUs
+ * only keep their own blocks from being reused. In the common case of 
+ * processing one packet at a time, the same block is reused over and over
+ * as each Packet is released:
+ *
+ * \code
+ * PDUArena arena;
+ * PDUArena::scope use_arena(arena);
+ *
+ * // Every packet's PDU chain is allocated in the arena
+ * sniffer.sniff_loop(callback);
+ * \endcode
+ *
+ * PDUs allocated in an arena can be freed from any thread and can outlive 
+ * the arena object itself, in which case each block is released once the 
+ * last PDU in it is deleted. Note that only the PDU objects themselves 
+ * are placed in the arena: the buffers they use to hold options and 
+ * payloads are still allocated using std::allocator.
+ *
+ * Programs that never use an arena are not affected by it: their PDUs 
+ * are allocated and freed using the global operator new and delete.
+ */
+class TINS_API PDUArena {
+public:
+    /**
+     * \brief The default size of each of the arena's blocks.
+     *
+     * This is 65536 by default.
+     */
+    static const size_t DEFAULT_BLOCK_SIZE;
+
+    /**
+     * \brief Uses an arena on the current thread while it's alive.
+     *
+     * Scopes can be nested, in which case the innermost one is used.
+     */
+    class TINS_API scope {
+    public:
+        /**
+         * \brief Starts using an arena on the current thread.
+         *
+         * \param arena The arena to use.
+         */
+        scope(PDUArena& arena);
+
+        /**
+         * Restores the arena that was being used before this scope.
+         */
+        ~scope();
+    private:
+        scope(const scope&);
+        scope& operator=(const scope&);
+
+        PDUArena* previous_;
+    };
+
+    /**
+     * \brief Constructs an arena.
+     *
+     * Memory is allocated in blocks of the given size as it's needed. PDUs 
+     * that don't fit in a block are allocated using the global operator new.
+     * Blocks are allocated in whole pages, so sizes which are a multiple of
+     * the page size waste no memory.
+     *
+     * \param block_size The size of each block.
+     */
+    PDUArena(size_t block_size = DEFAULT_BLOCK_SIZE);
+
+    /**
+     * \brief Destructor.
+     *
+     * Blocks which still hold PDUs are released once the last PDU in them
+     * is deleted.
+     */
+    ~PDUArena();
+
+    /**
+     * \brief Retrieves the amount of PDUs in this arena which haven't 
+     * been deleted yet.
+     */
+    size_t live_allocations() const;
+
+    /**
+     * \brief Retrieves the amount of memory reserved by this arena.
+     */
+    size_t capacity() const;
+
+    /**
+     * \brief Retrieves the arena being used on the current thread.
+     *
+     * \return The arena in use, or 0 if there's none.
+     */
+    static PDUArena* current();
+private:
+    friend class scope;
+    friend void* Internals::allocate_pdu(size_t size);
+
+    PDUArena(const PDUArena&);
+    PDUArena& operator=(const PDUArena&);
+
+    void* allocate(size_t size);
+
+    Internals::pdu_arena_state* state_;
+};
+
+#endif // TINS_HAVE_CXX11
+
+} // Tins
+
+#endif // TINS_PDU_ARENA_H
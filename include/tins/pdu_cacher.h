@@ -146,7 +146,7 @@ public:
 private:
     void write_serialization(uint8_t* buffer, uint32_t total_sz) {
         if (cached_serialization_.size() != total_sz) {
-            cached_serialization_ = cached_.serialize();
+            cached_.serialize_into(cached_serialization_);
         }
         std::memcpy(buffer, &*cached_serialization_.begin(), cached_serialization_.size());
     }
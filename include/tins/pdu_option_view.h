@@ -0,0 +1,509 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef TINS_PDU_OPTION_VIEW_H
+#define TINS_PDU_OPTION_VIEW_H
+
+#include <vector>
+#include <iterator>
+#include <cstddef>
+#include <cstring>
+#include <stdint.h>
+#include <tins/config.h>
+#include <tins/macros.h>
+#include <tins/cxxstd.h>
+
+namespace Tins {
+
+/**
+ * \class LazyOptions
+ * \brief Controls whether options are parsed lazily on the current thread.
+ *
+ * By default, protocols that carry options (TCP, IP, IPv6 extension 
+ * headers, DHCP and the tagged parameters in 802.11 management frames) 
+ * turn every option into a PDUOption while being parsed. While a 
+ * LazyOptions::scope is alive on a thread, PDUs parsed on it instead 
+ * validate their options and keep a copy of their raw bytes. These are 
+ * only turned into PDUOption objects the first time they are accessed via
+ * options(), search_option() or any of the methods that modify them. 
+ * 
+ * Applications that rarely look at options avoid all of that work:
+ *
+ * \code
+ * LazyOptions::scope lazy;
+ * sniffer.sniff_loop([&](PDU& pdu) {
+ *     const TCP& tcp = pdu.rfind_pdu<TCP>();
+ *     // No PDUOption was created while parsing this segment
+ *     for (const auto& opt : tcp.option_views()) {
+ *         process(opt.option(), opt.data_ptr(), opt.data_size());
+ *     }
+ *     return true;
+ * });
+ * \endcode
+ */
+class TINS_API LazyOptions {
+public:
+    #ifdef TINS_HAVE_CXX11
+    /**
+     * \brief Makes options parsed on the current thread be lazy while 
+     * it's alive.
+     *
+     * PDUs parsed while a scope is alive build their options the first 
+     * time options(), search_option() or IPv6::headers() is called on them.
+     * These are const methods that modify the PDU's mutable members, so 
+     * calling them on the same PDU from several threads at once is a data 
+     * race, even though each thread only reads it. Call one of them before
+     * sharing such a PDU between threads.
+     *
+     * Scopes can be nested.
+     */
+    class TINS_API scope {
+    public:
+        /**
+         * \brief Starts parsing options lazily on the current thread.
+         */
+        scope();
+
+        /**
+         * \brief Restores the behavior used before this scope was created.
+         */
+        ~scope();
+    private:
+        scope(const scope&);
+        scope& operator=(const scope&);
+
+        bool previous_;
+    };
+    #endif // TINS_HAVE_CXX11
+
+    /**
+     * \brief Indicates whether options parsed on the current thread are lazy.
+     *
+     * This is true while a LazyOptions::scope is alive on this thread.
+     */
+    static bool enabled();
+};
+
+/**
+ * \class PDUOptionView
+ * \brief Non-owning view of an option stored in a PDU.
+ *
+ * Views reference the option's data wherever the PDU keeps it, either in
+ * the raw bytes held by a lazily parsed PDU or in one of its PDUOption
+ * objects, so creating them never allocates. A view is valid until the 
+ * PDU it was taken from is modified or destroyed.
+ *
+ * \tparam Option The PDUOption type this is a view of.
+ */
+template <typename Option>
+class PDUOptionView {
+public:
+    /**
+     * The type of the option's identifier.
+     */
+    typedef typename Option::option_type option_type;
+
+    /**
+     * \brief Default constructs an empty view.
+     */
+    PDUOptionView() 
+    : option_(), data_(0), size_(0), length_(0) { }
+
+    /**
+     * \brief Constructs a view of an option's data.
+     *
+     * \param opt The option type.
+     * \param data The beginning of the option's data.
+     * \param size The size of the option's data.
+     * \param length The value of the option's length field.
+     */
+    PDUOptionView(option_type opt, const uint8_t* data, uint16_t size, uint16_t length)
+    : option_(opt), data_(data), size_(size), length_(length) { }
+
+    /**
+     * \brief Constructs a view of a PDUOption.
+     *
+     * \param opt The option to reference.
+     */
+    explicit PDUOptionView(const Option& opt)
+    : option_(opt.option()), data_(opt.data_ptr()), 
+      size_(static_cast<uint16_t>(opt.data_size())), 
+      length_(static_cast<uint16_t>(opt.length_field())) { }
+
+    /**
+     * \brief Retrieves the option's type.
+     */
+    option_type option() const {
+        return option_;
+    }
+
+    /**
+     * \brief Retrieves a pointer to the option's data.
+     */
+    const uint8_t* data_ptr() const {
+        return data_;
+    }
+
+    /**
+     * \brief Retrieves the size of the option's data.
+     */
+    size_t data_size() const {
+        return size_;
+    }
+
+    /**
+     * \brief Retrieves the option's length field.
+     *
+     * \sa PDUOption::length_field
+     */
+    size_t length_field() const {
+        return length_;
+    }
+
+    /**
+     * \brief Copies this option into a PDUOption.
+     *
+     * The returned option can be used to convert the option's data by
+     * using PDUOption::to.
+     */
+    Option to_option() const {
+        return Option(option_, length_, data_, data_ + size_);
+    }
+private:
+    option_type option_;
+    const uint8_t* data_;
+    uint16_t size_;
+    uint16_t length_;
+};
+
+/**
+ * \class PDUOptionIterator
+ * \brief Forward iterator over the options stored in a PDU.
+ *
+ * This iterates either the raw option bytes kept by a lazily parsed PDU
+ * or the PDUOption objects stored in it, yielding a PDUOptionView for each
+ * option. Iterating doesn't allocate.
+ *
+ * \tparam Option The PDUOption type being iterated.
+ */
+template <typename Option>
+class PDUOptionIterator {
+public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef PDUOptionView<Option> value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const value_type* pointer;
+    typedef const value_type& reference;
+
+    /**
+     * \brief Parses the option that starts at ptr into view.
+     *
+     * Returns a pointer past the parsed option or a null pointer if the 
+     * options list ends at ptr. Throws malformed_packet if the option
+     * is invalid.
+     */
+    typedef const uint8_t* (*parse_function)(const uint8_t* ptr, const uint8_t* end,
+                                             value_type& view);
+
+    /**
+     * \brief Constructs an end iterator.
+     */
+    PDUOptionIterator() 
+    : parse_(0), current_(0), next_(0), end_(0), option_(0), options_end_(0) { }
+
+    /**
+     * \brief Constructs an iterator over raw option bytes.
+     *
+     * \param start The beginning of the options.
+     * \param end The end of the options.
+     * \param parse The function used to parse each option.
+     */
+    PDUOptionIterator(const uint8_t* start, const uint8_t* end, parse_function parse)
+    : parse_(parse), current_(start), next_(0), end_(end), option_(0), options_end_(0) {
+        parse_current();
+    }
+
+    /**
+     * \brief Constructs an iterator over a range of PDUOptions.
+     *
+     * \param start The first option.
+     * \param end One past the last option.
+     */
+    PDUOptionIterator(const Option* start, const Option* end)
+    : parse_(0), current_(0), next_(0), end_(0), option_(start), options_end_(end) {
+        view_current();
+    }
+
+    reference operator*() const {
+        return view_;
+    }
+
+    pointer operator->() const {
+        return &view_;
+    }
+
+    PDUOptionIterator& operator++() {
+        if (current_) {
+            current_ = next_;
+            parse_current();
+        }
+        else {
+            ++option_;
+            view_current();
+        }
+        return *this;
+    }
+
+    PDUOptionIterator operator++(int) {
+        PDUOptionIterator output = *this;
+        ++*this;
+        return output;
+    }
+
+    bool operator==(const PDUOptionIterator& rhs) const {
+        return current_ == rhs.current_ && option_ == rhs.option_;
+    }
+
+    bool operator!=(const PDUOptionIterator& rhs) const {
+        return !(*this == rhs);
+    }
+private:
+    void parse_current() {
+        if (current_ == end_ || !(next_ = parse_(current_, end_, view_))) {
+            current_ = 0;
+        }
+    }
+
+    void view_current() {
+        if (option_ == options_end_) {
+            option_ = 0;
+        }
+        else {
+            view_ = value_type(*option_);
+        }
+    }
+
+    parse_function parse_;
+    const uint8_t* current_;
+    const uint8_t* next_;
+    const uint8_t* end_;
+    const Option* option_;
+    const Option* options_end_;
+    value_type view_;
+};
+
+/**
+ * \class PDUOptionRange
+ * \brief The range of option views returned by a PDU's option_views method.
+ *
+ * \tparam Option The PDUOption type being iterated.
+ */
+template <typename Option>
+class PDUOptionRange {
+public:
+    typedef PDUOptionIterator<Option> iterator;
+    typedef iterator const_iterator;
+
+    /**
+     * \brief Constructs a range over raw option bytes.
+     */
+    PDUOptionRange(const uint8_t* start, const uint8_t* end, 
+                   typename iterator::parse_function parse) 
+    : begin_(start, end, parse) { }
+
+    /**
+     * \brief Constructs a range over a list of PDUOptions.
+     */
+    PDUOptionRange(const std::vector<Option>& options) {
+        if (!options.empty()) {
+            begin_ = iterator(&options[0], &options[0] + options.size());
+        }
+    }
+
+    /**
+     * \brief Returns an iterator to the first option.
+     */
+    iterator begin() const {
+        return begin_;
+    }
+
+    /**
+     * \brief Returns an iterator past the last option.
+     */
+    iterator end() const {
+        return iterator();
+    }
+
+    /**
+     * \brief Indicates whether there are no options in this range.
+     */
+    bool empty() const {
+        return begin_ == end();
+    }
+private:
+    iterator begin_;
+};
+
+/**
+ * \cond
+ */
+namespace Internals {
+
+// The raw option bytes kept by a lazily parsed PDU. These are allocated only
+// when options are parsed lazily, so that PDUs which aren't only pay for a 
+// pointer and a size
+class option_bytes {
+public:
+    option_bytes() 
+    : data_(0), size_(0) { }
+
+    option_bytes(const option_bytes& rhs) 
+    : data_(0), size_(0) {
+        *this = rhs;
+    }
+
+    #if TINS_IS_CXX11
+    option_bytes(option_bytes&& rhs) TINS_NOEXCEPT
+    : data_(rhs.data_), size_(rhs.size_) {
+        rhs.data_ = 0;
+        rhs.size_ = 0;
+    }
+
+    option_bytes& operator=(option_bytes&& rhs) TINS_NOEXCEPT {
+        if (this != &rhs) {
+            delete[] data_;
+            data_ = rhs.data_;
+            size_ = rhs.size_;
+            rhs.data_ = 0;
+            rhs.size_ = 0;
+        }
+        return *this;
+    }
+    #endif // TINS_IS_CXX11
+
+    option_bytes& operator=(const option_bytes& rhs) {
+        if (this != &rhs) {
+            if (rhs.pending()) {
+                assign(rhs.begin(), rhs.end());
+            }
+            else {
+                clear();
+            }
+        }
+        return *this;
+    }
+
+    ~option_bytes() {
+        delete[] data_;
+    }
+
+    // An empty region has no options, so it's never kept
+    void assign(const uint8_t* start, const uint8_t* end) {
+        const uint32_t size = static_cast<uint32_t>(end - start);
+        if (size == 0) {
+            clear();
+            return;
+        }
+        if (size != size_) {
+            uint8_t* data = new uint8_t[size];
+            delete[] data_;
+            data_ = data;
+            size_ = size;
+        }
+        std::memcpy(data_, start, size_);
+    }
+
+    void clear() {
+        delete[] data_;
+        data_ = 0;
+        size_ = 0;
+    }
+
+    // Whether these bytes haven't been turned into options yet
+    bool pending() const {
+        return data_ != 0;
+    }
+
+    const uint8_t* begin() const {
+        return data_;
+    }
+
+    const uint8_t* end() const {
+        return data_ + size_;
+    }
+
+    uint32_t size() const {
+        return size_;
+    }
+private:
+    uint8_t* data_;
+    uint32_t size_;
+};
+
+// Parses the options in [start, end). These are either stored in options 
+// or, if options are lazy on this thread, validated and copied into bytes
+template <typename Option>
+void parse_options(const uint8_t* start, const uint8_t* end, 
+                   std::vector<Option>& options, option_bytes& bytes,
+                   typename PDUOptionIterator<Option>::parse_function parse) {
+    PDUOptionIterator<Option> iter(start, end, parse), last;
+    if (LazyOptions::enabled()) {
+        while (iter != last) {
+            ++iter;
+        }
+        bytes.assign(start, end);
+    }
+    else {
+        for (; iter != last; ++iter) {
+            options.push_back(iter->to_option());
+        }
+    }
+}
+
+// Turns the bytes kept by a lazily parsed PDU into options, if any
+template <typename Option>
+void materialize_options(std::vector<Option>& options, option_bytes& bytes,
+                         typename PDUOptionIterator<Option>::parse_function parse) {
+    if (bytes.pending()) {
+        PDUOptionIterator<Option> iter(bytes.begin(), bytes.end(), parse), last;
+        for (; iter != last; ++iter) {
+            options.push_back(iter->to_option());
+        }
+        bytes.clear();
+    }
+}
+
+} // Internals
+/**
+ * \endcond
+ */
+
+} // Tins
+
+#endif // TINS_PDU_OPTION_VIEW_H
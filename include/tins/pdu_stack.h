@@ -0,0 +1,507 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef TINS_PDU_STACK_H
+#define TINS_PDU_STACK_H
+
+#include <tins/cxxstd.h>
+
+#if TINS_IS_CXX11
+
+#include <tuple>
+#include <type_traits>
+#include <algorithm>
+#include <cstring>
+#include <stdint.h>
+#include <tins/pdu.h>
+#include <tins/rawpdu.h>
+#include <tins/endianness.h>
+#include <tins/exceptions.h>
+
+namespace Tins {
+
+class IP;
+class IPv6;
+
+/**
+ * \cond
+ */
+namespace Internals {
+
+template <size_t... Indexes>
+struct stack_indexes { };
+
+template <size_t N, size_t... Indexes>
+struct make_stack_indexes : make_stack_indexes<N - 1, N - 1, Indexes...> { };
+
+template <size_t... Indexes>
+struct make_stack_indexes<0, Indexes...> {
+    typedef stack_indexes<Indexes...> type;
+};
+
+// The position of T in Layers
+template <typename T, typename... Layers>
+struct stack_index;
+
+template <typename T, typename... Rest>
+struct stack_index<T, T, Rest...> : std::integral_constant<size_t, 0> { };
+
+template <typename T, typename U, typename... Rest>
+struct stack_index<T, U, Rest...> 
+: std::integral_constant<size_t, 1 + stack_index<T, Rest...>::value> { };
+
+// The amount of bytes after a layer's header that belong to it. These bound
+// the payload the same way each PDU's constructor bounds its inner PDU
+inline uint32_t stack_payload_size(const PDU*, const uint8_t*, uint32_t header_size,
+                                   uint32_t total_sz) {
+    return total_sz - header_size;
+}
+
+inline uint32_t stack_payload_size(const IP*, const uint8_t* buffer, uint32_t header_size,
+                                   uint32_t total_sz) {
+    uint16_t tot_len;
+    std::memcpy(&tot_len, buffer + 2, sizeof(tot_len));
+    tot_len = Endian::be_to_host(tot_len);
+    const uint32_t stream_size = total_sz - header_size;
+    // A zero total length is used by TCP segmentation offload
+    if (tot_len != 0) {
+        const uint32_t advertised_length = static_cast<uint32_t>(tot_len) - header_size;
+        return (std::min)(stream_size, advertised_length);
+    }
+    return stream_size;
+}
+
+inline uint32_t stack_payload_size(const IPv6*, const uint8_t* buffer, uint32_t header_size,
+                                   uint32_t total_sz) {
+    uint16_t payload_length;
+    std::memcpy(&payload_length, buffer + 4, sizeof(payload_length));
+    payload_length = Endian::be_to_host(payload_length);
+    // Jumbograms use a zero payload length
+    if (payload_length == 0) {
+        return total_sz - header_size;
+    }
+    // The extension headers are part of the advertised payload length
+    const uint32_t actual_length = static_cast<uint32_t>(payload_length) + 40 - header_size;
+    if (TINS_UNLIKELY(total_sz - header_size < actual_length)) {
+        throw malformed_packet();
+    }
+    return actual_length;
+}
+
+template <typename T>
+T make_stack_layer(const uint8_t* buffer, uint32_t total_sz) {
+    return T(buffer, total_sz);
+}
+
+template <>
+inline RawPDU make_stack_layer<RawPDU>(const uint8_t* buffer, uint32_t total_sz) {
+    if (RawPDU::borrowing()) {
+        return RawPDU(buffer, total_sz, RawPDU::borrow_tag());
+    }
+    return RawPDU(buffer, total_sz);
+}
+
+inline void own_stack_layer(PDU&) {
+
+}
+
+inline void own_stack_layer(RawPDU& layer) {
+    layer.own();
+}
+
+} // Internals
+/**
+ * \endcond
+ */
+
+/**
+ * \class PDUStack
+ * \brief A fixed sequence of protocol layers stored by value.
+ *
+ * A PDUStack holds one object of each of the given PDU types, in the same
+ * order they appear on the wire, inside a single std::tuple. Unlike a chain
+ * of PDUs, parsing a packet into a stack doesn't allocate the layers and 
+ * accessing them doesn't need to walk the chain or cast:
+ *
+ * \code
+ * typedef PDUStack<EthernetII, IP, UDP, RawPDU> telemetry_packet;
+ *
+ * telemetry_packet packet(buffer, size);
+ * packet.get<IP>().ttl(32);
+ * packet.get<UDP>().dport(9000);
+ * telemetry_packet::serialization_type output = packet.serialize();
+ * \endcode
+ *
+ * Each layer is parsed by its own constructor, given only the bytes that 
+ * belong to its header, so every layer but the last is left without an
+ * inner PDU. The last layer is constructed out of the rest of the packet,
+ * so it may still own inner PDUs (e.g. a TCP layer holding its payload).
+ * Layer sizes are computed using each class' header_size and trailer_size
+ * overrides directly rather than through PDU's virtual interface.
+ *
+ * When serializing, the layers are temporarily linked into a chain so that
+ * fields which depend on the surrounding layers, like IP's protocol or 
+ * UDP's checksum, are filled in exactly as they would be for a PDU chain.
+ *
+ * Every layer but the last must provide a static extract_metadata method,
+ * which is used to find where each header ends. Layers should not be given 
+ * inner PDUs, other than the last one.
+ *
+ * \tparam Layers The PDU types, outermost first.
+ */
+template <typename... Layers>
+class PDUStack {
+public:
+    static_assert(sizeof...(Layers) > 0, "A PDUStack needs at least one layer");
+
+    /**
+     * The type used to store the layers.
+     */
+    typedef std::tuple<Layers...> layers_type;
+
+    /**
+     * The type returned by PDUStack::serialize.
+     */
+    typedef PDU::serialization_type serialization_type;
+
+    /**
+     * \brief The type of the layer at the given position.
+     */
+    template <size_t I>
+    struct layer {
+        typedef typename std::tuple_element<I, layers_type>::type type;
+    };
+
+    /**
+     * The type of the outermost layer.
+     */
+    typedef typename layer<0>::type first_layer_type;
+
+    /**
+     * The number of layers in this stack.
+     */
+    static const size_t layer_count = sizeof...(Layers);
+
+    /**
+     * \brief Default constructs every layer.
+     */
+    PDUStack() { }
+
+    /**
+     * \brief Constructs a stack out of copies of the given layers.
+     *
+     * The inner PDUs of every layer but the last one are not copied.
+     *
+     * \param layers The layers, outermost first.
+     */
+    PDUStack(const Layers&... layers) 
+    : layers_(layers...) {
+        drop_inner_pdus(std::integral_constant<size_t, 0>());
+    }
+
+    /**
+     * \brief Parses a packet into a stack.
+     *
+     * If the packet's layers don't match this stack's, pdu_not_found is
+     * thrown. This includes IP fragments and unknown protocols, which can
+     * only be parsed by stacks whose next layer is a RawPDU. Each layer's 
+     * constructor can throw malformed_packet.
+     *
+     * \param buffer The buffer to be parsed.
+     * \param total_sz The size of the buffer.
+     */
+    PDUStack(const uint8_t* buffer, uint32_t total_sz)
+    : layers_(parse(buffer, total_sz, typename Internals::make_stack_indexes<layer_count>::type())) {
+
+    }
+
+    /**
+     * \brief Constructs a stack out of a PDU chain.
+     *
+     * The chain is serialized and parsed back into the stack, so it's 
+     * subject to the same checks as PDUStack(const uint8_t*, uint32_t).
+     *
+     * \param pdu The first PDU in the chain.
+     */
+    explicit PDUStack(PDU& pdu) 
+    : PDUStack(pdu.serialize(), owned_tag()) {
+
+    }
+
+    /**
+     * \brief Retrieves the layer at the given position.
+     */
+    template <size_t I>
+    typename layer<I>::type& get() {
+        return std::get<I>(layers_);
+    }
+
+    /**
+     * \brief Retrieves the layer at the given position.
+     */
+    template <size_t I>
+    const typename layer<I>::type& get() const {
+        return std::get<I>(layers_);
+    }
+
+    /**
+     * \brief Retrieves the layer of the given type.
+     */
+    template <typename T>
+    T& get() {
+        return std::get<Internals::stack_index<T, Layers...>::value>(layers_);
+    }
+
+    /**
+     * \brief Retrieves the layer of the given type.
+     */
+    template <typename T>
+    const T& get() const {
+        return std::get<Internals::stack_index<T, Layers...>::value>(layers_);
+    }
+
+    /**
+     * \brief Retrieves the layers.
+     */
+    const layers_type& layers() const {
+        return layers_;
+    }
+
+    /**
+     * \brief Retrieves the size of this stack once serialized.
+     *
+     * This is not const, since trailers like EthernetII's padding depend
+     * on the inner layers, which are temporarily linked to compute them.
+     */
+    uint32_t size() {
+        chain_link link(*this);
+        return layers_size(std::integral_constant<size_t, 0>());
+    }
+
+    /**
+     * \brief Serializes this stack.
+     *
+     * \sa PDU::serialize
+     */
+    serialization_type serialize() {
+        chain_link link(*this);
+        serialization_type buffer(layers_size(std::integral_constant<size_t, 0>()));
+        write_layers(buffer.empty() ? 0 : &buffer[0], static_cast<uint32_t>(buffer.size()),
+                     std::integral_constant<size_t, 0>());
+        return buffer;
+    }
+
+    /**
+     * \brief Serializes this stack into the given buffer.
+     *
+     * If the buffer is not large enough, serialization_error is thrown.
+     *
+     * \param buffer The buffer to write to.
+     * \param capacity The size of the buffer.
+     * \return The number of bytes written.
+     * \sa PDU::serialize_into
+     */
+    size_t serialize_into(uint8_t* buffer, size_t capacity) {
+        chain_link link(*this);
+        const uint32_t total_sz = layers_size(std::integral_constant<size_t, 0>());
+        if (total_sz > capacity) {
+            throw serialization_error();
+        }
+        write_layers(buffer, total_sz, std::integral_constant<size_t, 0>());
+        return total_sz;
+    }
+
+    /**
+     * \brief Converts this stack into a PDU chain.
+     *
+     * Every layer is copied, every one but the first into a newly 
+     * allocated PDU.
+     *
+     * \return The first PDU in the chain.
+     */
+    first_layer_type to_pdu() const {
+        first_layer_type output(std::get<0>(layers_));
+        append_layers(output, std::integral_constant<size_t, 1>());
+        return output;
+    }
+private:
+    typedef std::integral_constant<size_t, layer_count - 1> last_index;
+    typedef std::integral_constant<size_t, layer_count> end_index;
+
+    struct owned_tag { };
+
+    // Links the layers into a PDU chain while it's alive. The layers are 
+    // only linked while computing sizes and serializing
+    class chain_link {
+    public:
+        chain_link(PDUStack& stack) 
+        : stack_(stack) {
+            stack_.link_layers(std::integral_constant<size_t, 0>());
+        }
+
+        ~chain_link() {
+            stack_.unlink_layers(std::integral_constant<size_t, 0>());
+        }
+    private:
+        chain_link(const chain_link&);
+        chain_link& operator=(const chain_link&);
+
+        PDUStack& stack_;
+    };
+
+    PDUStack(const serialization_type& buffer, owned_tag) 
+    : layers_(parse(buffer.empty() ? 0 : &buffer[0], static_cast<uint32_t>(buffer.size()), 
+                    typename Internals::make_stack_indexes<layer_count>::type())) {
+        // The parsed layers can't borrow from our temporary buffer
+        Internals::own_stack_layer(std::get<layer_count - 1>(layers_));
+    }
+
+    template <size_t... Indexes>
+    static layers_type parse(const uint8_t* buffer, uint32_t total_sz, 
+                             Internals::stack_indexes<Indexes...>) {
+        const uint8_t* starts[layer_count];
+        uint32_t sizes[layer_count];
+        find_layers(buffer, total_sz, starts, sizes, std::integral_constant<size_t, 0>());
+        return layers_type(Internals::make_stack_layer<Layers>(starts[Indexes], sizes[Indexes])...);
+    }
+
+    // Finds the bytes that each layer will be constructed from
+    template <size_t I>
+    static void find_layers(const uint8_t* buffer, uint32_t total_sz, const uint8_t** starts, 
+                            uint32_t* sizes, std::integral_constant<size_t, I>) {
+        typedef typename layer<I>::type current_type;
+        typedef typename layer<I + 1>::type next_type;
+        const PDU::metadata info = current_type::extract_metadata(buffer, total_sz);
+        if (TINS_UNLIKELY(info.header_size > total_sz)) {
+            throw malformed_packet();
+        }
+        // Fragments and unknown protocols can only be followed by a RawPDU
+        if (!std::is_same<next_type, RawPDU>::value && info.next_pdu_type != next_type::pdu_flag) {
+            throw pdu_not_found();
+        }
+        starts[I] = buffer;
+        sizes[I] = info.header_size;
+        const uint32_t payload_size = Internals::stack_payload_size(
+            static_cast<const current_type*>(0), 
+            buffer, 
+            info.header_size, 
+            total_sz
+        );
+        find_layers(buffer + info.header_size, payload_size, starts, sizes, 
+                    std::integral_constant<size_t, I + 1>());
+    }
+
+    static void find_layers(const uint8_t* buffer, uint32_t total_sz, const uint8_t** starts, 
+                            uint32_t* sizes, last_index) {
+        starts[layer_count - 1] = buffer;
+        sizes[layer_count - 1] = total_sz;
+    }
+
+    template <size_t I>
+    uint32_t layers_size(std::integral_constant<size_t, I>) const {
+        typedef typename layer<I>::type current_type;
+        const current_type& current = std::get<I>(layers_);
+        return current.current_type::header_size() + current.current_type::trailer_size() +
+               layers_size(std::integral_constant<size_t, I + 1>());
+    }
+
+    // The last layer's size includes its inner PDUs, if any
+    uint32_t layers_size(last_index) const {
+        return std::get<layer_count - 1>(layers_).size();
+    }
+
+    // Same as PDU::serialize: inner layers are written before outer ones
+    template <size_t I>
+    void write_layers(uint8_t* buffer, uint32_t total_sz, std::integral_constant<size_t, I>) {
+        typedef typename layer<I>::type current_type;
+        current_type& current = std::get<I>(layers_);
+        PDU& pdu = current;
+        const uint32_t header_size = current.current_type::header_size();
+        const uint32_t trailer_size = current.current_type::trailer_size();
+        pdu.prepare_for_serialize();
+        write_layers(buffer + header_size, total_sz - header_size - trailer_size, 
+                     std::integral_constant<size_t, I + 1>());
+        pdu.write_serialization(buffer, total_sz);
+    }
+
+    void write_layers(uint8_t* buffer, uint32_t total_sz, last_index) {
+        PDU& pdu = std::get<layer_count - 1>(layers_);
+        pdu.serialize(buffer, total_sz);
+    }
+
+    template <size_t I>
+    void link_layers(std::integral_constant<size_t, I>) {
+        std::get<I>(layers_).inner_pdu(&std::get<I + 1>(layers_));
+        link_layers(std::integral_constant<size_t, I + 1>());
+    }
+
+    void link_layers(last_index) {
+
+    }
+
+    template <size_t I>
+    void unlink_layers(std::integral_constant<size_t, I>) {
+        std::get<I>(layers_).release_inner_pdu();
+        unlink_layers(std::integral_constant<size_t, I + 1>());
+    }
+
+    void unlink_layers(last_index) {
+
+    }
+
+    template <size_t I>
+    void drop_inner_pdus(std::integral_constant<size_t, I>) {
+        delete std::get<I>(layers_).release_inner_pdu();
+        drop_inner_pdus(std::integral_constant<size_t, I + 1>());
+    }
+
+    void drop_inner_pdus(last_index) {
+
+    }
+
+    template <size_t I>
+    void append_layers(PDU& parent, std::integral_constant<size_t, I>) const {
+        typedef typename layer<I>::type current_type;
+        current_type* current = new current_type(std::get<I>(layers_));
+        parent.inner_pdu(current);
+        append_layers(*current, std::integral_constant<size_t, I + 1>());
+    }
+
+    void append_layers(PDU&, end_index) const {
+
+    }
+
+    layers_type layers_;
+};
+
+} // Tins
+
+#endif // TINS_IS_CXX11
+
+#endif // TINS_PDU_STACK_H
@@ -0,0 +1,332 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef TINS_PROBE_ENGINE_H
+#define TINS_PROBE_ENGINE_H
+
+#include <tins/config.h>
+
+#if defined(TINS_HAVE_PCAP) && defined(TINS_HAVE_CXX11)
+
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <exception>
+#include <stdint.h>
+#include <tins/macros.h>
+#include <tins/ip_address.h>
+#include <tins/timestamp.h>
+#include <tins/packet_template.h>
+#include <tins/network_interface.h>
+
+namespace Tins {
+
+class PDU;
+class PacketSender;
+class BaseSniffer;
+
+/**
+ * \class ProbeEngine
+ * \brief Sends TCP SYN probes at a fixed rate and matches their responses
+ * without keeping any per-probe state.
+ *
+ * PacketSender::send_recv waits for the response to each probe before 
+ * sending the next one. This class instead sends probes as fast as the 
+ * configured rate allows and matches responses on a separate thread, so 
+ * any amount of probes can be in flight at once.
+ *
+ * No state is kept for the probes that were sent. Instead, each probe's 
+ * sequence number is a cookie: a keyed hash (SipHash-2-4) of the target's 
+ * address and port along with the source address and port. A response is 
+ * matched by recomputing the cookie for the address and port it comes 
+ * from and comparing it with the acknowledgement number it carries, or 
+ * with the sequence number quoted by an ICMP destination unreachable 
+ * message. The key is chosen randomly when the engine is constructed, so 
+ * responses can't be forged without seeing the probes.
+ *
+ * Probes are built once using a PacketTemplate, so sending one only 
+ * patches its destination address, port and sequence number.
+ *
+ * \code
+ * PacketSender sender;
+ * SnifferConfiguration config;
+ * config.set_immediate_mode(true);
+ * // Make sure the capture wakes up every now and then so it can be stopped
+ * config.set_timeout(100);
+ * Sniffer sniffer("eth0", config);
+ *
+ * ProbeEngine engine(sender, "192.168.0.100", 
+ *     [](const ProbeEngine::probe_result& result) {
+ *         if (result.status == ProbeEngine::OPEN) {
+ *             std::cout << result.address << ":" << result.port << std::endl;
+ *         }
+ *     });
+ * engine.rate(100000);
+ * engine.start(sniffer);
+ * for (const auto& address : IPv4Range::from_mask("10.0.0.0", "255.255.0.0")) {
+ *     engine.probe(address, 80);
+ *     engine.probe(address, 443);
+ * }
+ * // Wait a couple of seconds for late responses
+ * engine.finish(std::chrono::seconds(2));
+ * \endcode
+ *
+ * Since responses aren't tied to any state, a host that retransmits its
+ * response is reported more than once. Note that the kernel is unaware 
+ * of these connection attempts and will answer SYN/ACKs with a RST, 
+ * unless a firewall rule drops them.
+ */
+class TINS_API ProbeEngine {
+public:
+    /**
+     * The source port used by default.
+     */
+    static const uint16_t DEFAULT_SOURCE_PORT;
+
+    /**
+     * \brief The status of a probed port.
+     */
+    enum probe_status {
+        OPEN,
+        CLOSED,
+        UNREACHABLE
+    };
+
+    /**
+     * \brief The result of a probe.
+     */
+    struct probe_result {
+        /**
+         * The address that was probed.
+         */
+        IPv4Address address;
+
+        /**
+         * The port that was probed.
+         */
+        uint16_t port;
+
+        /**
+         * The port's status.
+         */
+        probe_status status;
+
+        /**
+         * The TTL of the response.
+         */
+        uint8_t ttl;
+
+        /**
+         * \brief The time at which the response was captured.
+         *
+         * This is only set for responses read from a sniffer.
+         */
+        Timestamp timestamp;
+    };
+
+    /**
+     * \brief The statistics of a ProbeEngine.
+     */
+    struct statistics {
+        /**
+         * The amount of probes sent.
+         */
+        uint64_t sent;
+
+        /**
+         * The amount of responses that were matched to a probe.
+         */
+        uint64_t matched;
+
+        /**
+         * The amount of captured packets that didn't match any probe.
+         */
+        uint64_t unmatched;
+    };
+
+    /**
+     * The type of the callback that's executed for each matched response.
+     */
+    typedef std::function<void(const probe_result&)> result_callback_type;
+
+    /**
+     * \brief Constructs a ProbeEngine.
+     *
+     * \param sender The sender used to send probes. It has to outlive 
+     * this object.
+     * \param source_address The address probes are sent from.
+     * \param callback The callback executed for each matched response. 
+     * It's executed on the thread that captures responses.
+     */
+    ProbeEngine(PacketSender& sender, IPv4Address source_address, 
+                result_callback_type callback);
+
+    /**
+     * \brief Destructor.
+     *
+     * If responses are still being captured, this stops doing so 
+     * without waiting for late responses.
+     */
+    ~ProbeEngine();
+
+    /**
+     * \brief Sets the amount of probes sent per second.
+     *
+     * The rate is enforced by enabling pacing on the sender, using 
+     * PacketSender::enable_pacing with its default burst size, so it also
+     * applies to anything else sent through it. A rate of 0 disables 
+     * pacing on the sender, which sends probes as fast as possible. By 
+     * default the sender's pacing is left as is.
+     *
+     * \param probes_per_second The amount of probes to send each second.
+     */
+    void rate(uint32_t probes_per_second);
+
+    /**
+     * \brief Sets the source port of the probes.
+     *
+     * This can't be changed while responses are being captured.
+     *
+     * \param port The source port to use.
+     */
+    void source_port(uint16_t port);
+
+    /**
+     * \brief Sets the key used to compute the cookies.
+     *
+     * A random key is used by default. This can't be changed while 
+     * responses are being captured.
+     *
+     * \param k0 The first half of the key.
+     * \param k1 The second half of the key.
+     */
+    void key(uint64_t k0, uint64_t k1);
+
+    /**
+     * \brief Starts capturing responses on a background thread.
+     *
+     * If the sniffer is capturing live traffic, a filter for the responses
+     * is set on it. The sniffer should have a read timeout set, so it 
+     * notices when ProbeEngine::finish or ProbeEngine::stop is called even
+     * if no packets arrive. It has to outlive the capture.
+     *
+     * \param sniffer The sniffer from which to capture responses.
+     */
+    void start(BaseSniffer& sniffer);
+
+    /**
+     * \brief Sends a probe.
+     *
+     * If the sender is paced, this waits until the probe can be sent. 
+     * This must always be called from the same thread.
+     *
+     * \param address The address to probe.
+     * \param port The port to probe.
+     * \param iface The interface to send the probe through.
+     */
+    void probe(IPv4Address address, uint16_t port, 
+               const NetworkInterface& iface = NetworkInterface());
+
+    /**
+     * \brief Waits for late responses and stops capturing.
+     *
+     * If the result callback threw an exception, it's rethrown here.
+     *
+     * \param wait_time The time to keep capturing responses for.
+     */
+    template <typename Rep, typename Period>
+    void finish(const std::chrono::duration<Rep, Period>& wait_time) {
+        std::this_thread::sleep_for(wait_time);
+        finish();
+    }
+
+    /**
+     * \brief Stops capturing right away.
+     *
+     * If the result callback threw an exception, it's rethrown here.
+     */
+    void finish();
+
+    /**
+     * \brief Matches a packet against the probes this engine sends.
+     *
+     * The packet matches if it's a TCP segment sent to the source address 
+     * and port whose acknowledgement number matches the cookie for the 
+     * address and port it comes from, or an ICMP destination unreachable 
+     * message quoting a probe. This is what the capture thread uses, so
+     * it can also be used to process responses captured some other way.
+     *
+     * \param pdu The packet to be matched.
+     * \param result The result of the probe, set if the packet matches.
+     * \return true if the packet matches a probe.
+     */
+    bool match(const PDU& pdu, probe_result& result) const;
+
+    /**
+     * \brief Computes the cookie used as the sequence number of a probe.
+     *
+     * \param address The address being probed.
+     * \param port The port being probed.
+     */
+    uint32_t cookie(IPv4Address address, uint16_t port) const;
+
+    /**
+     * Retrieves this engine's statistics.
+     */
+    statistics stats() const;
+private:
+    ProbeEngine(const ProbeEngine&);
+    ProbeEngine& operator=(const ProbeEngine&);
+
+    void capture(BaseSniffer& sniffer);
+    bool process(const PDU& pdu, const Timestamp& timestamp);
+
+    PacketSender& sender_;
+    result_callback_type callback_;
+    PacketTemplate template_;
+    IPv4Address source_address_;
+    uint16_t source_port_;
+    uint64_t key_[2];
+    std::thread capture_thread_;
+    BaseSniffer* sniffer_;
+    std::exception_ptr error_;
+    std::mutex lock_;
+    std::atomic<bool> stopped_;
+    std::atomic<uint64_t> sent_;
+    std::atomic<uint64_t> matched_;
+    std::atomic<uint64_t> unmatched_;
+};
+
+} // Tins
+
+#endif // TINS_HAVE_PCAP && TINS_HAVE_CXX11
+
+#endif // TINS_PROBE_ENGINE_H
@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef TINS_RAW_PACKET_H
+#define TINS_RAW_PACKET_H
+
+#include <stdint.h>
+#include <tins/pdu.h>
+#include <tins/timestamp.h>
+#include <tins/packet_view.h>
+
+namespace Tins {
+
+/**
+ * \class RawPacket
+ * \brief Represents a captured frame which is not owned by this object.
+ *
+ * RawPackets are handed out by capture sources which are able to expose
+ * frames straight from the memory they were captured into, without copying
+ * or parsing them. They only hold a pointer to the frame, its captured and
+ * original lengths and its timestamp, so they're cheap to copy around.
+ *
+ * The memory pointed to by a RawPacket is owned by the object that produced
+ * it, which also defines for how long it stays valid. Use RawPacket::view
+ * to inspect the frame's headers in place, or construct a PDU out of it
+ * if it needs to outlive that.
+ */
+class RawPacket {
+public:
+    /**
+     * Default constructs a RawPacket which points to no data.
+     */
+    RawPacket()
+    : data_(0), size_(0), original_size_(0), interface_id_(0) {
+
+    }
+
+    /**
+     * \brief Constructs a RawPacket.
+     *
+     * \param data The pointer to the beginning of the frame.
+     * \param size The amount of bytes captured.
+     * \param original_size The size of the frame on the wire.
+     * \param ts The timestamp in which the frame was captured.
+     * \param interface_id The identifier of the interface the frame was 
+     * captured on.
+     */
+    RawPacket(const uint8_t* data, uint32_t size, uint32_t original_size,
+              const Timestamp& ts, uint32_t interface_id = 0)
+    : data_(data), size_(size), original_size_(original_size), ts_(ts),
+      interface_id_(interface_id) {
+
+    }
+
+    /**
+     * Retrieves a pointer to the beginning of the frame.
+     */
+    const uint8_t* data() const {
+        return data_;
+    }
+
+    /**
+     * Retrieves the amount of bytes captured.
+     */
+    uint32_t size() const {
+        return size_;
+    }
+
+    /**
+     * Retrieves the size this frame had on the wire.
+     */
+    uint32_t original_size() const {
+        return original_size_;
+    }
+
+    /**
+     * Indicates whether only part of the frame was captured.
+     */
+    bool is_truncated() const {
+        return size_ < original_size_;
+    }
+
+    /**
+     * Retrieves the timestamp in which this frame was captured.
+     */
+    const Timestamp& timestamp() const {
+        return ts_;
+    }
+
+    /**
+     * \brief Retrieves the identifier of the interface this frame was 
+     * captured on.
+     *
+     * \sa Packet::interface_id
+     */
+    uint32_t interface_id() const {
+        return interface_id_;
+    }
+
+    /**
+     * \brief Constructs a PacketView over this frame.
+     *
+     * \param first_layer The type of the first layer in the frame.
+     * \sa PacketView
+     */
+    PacketView view(PDU::PDUType first_layer = PDU::ETHERNET_II) const {
+        return PacketView(data_, size_, first_layer);
+    }
+private:
+    const uint8_t* data_;
+    uint32_t size_;
+    uint32_t original_size_;
+    Timestamp ts_;
+    uint32_t interface_id_;
+};
+
+} // Tins
+
+#endif // TINS_RAW_PACKET_H
@@ -32,9 +32,11 @@
 
 #include <vector>
 #include <string>
+#include <utility>
 #include <tins/pdu.h>
 #include <tins/macros.h>
 #include <tins/cxxstd.h>
+#include <tins/config.h>
 
 namespace Tins {
 
@@ -60,6 +62,41 @@ namespace Tins {
  * // don't look like DNS
  * DNS dns = raw.to<DNS>();
  * \endcode
+ *
+ * A RawPDU can also borrow its payload, referencing a buffer owned by 
+ * someone else rather than copying it. Payloads parsed while a 
+ * RawPDU::borrow_scope is alive on the current thread are borrowed from the
+ * buffer being parsed, which avoids copying every captured payload:
+ *
+ * \code
+ * RawPDU::borrow_scope scope;
+ * MappedFileSniffer sniffer("capture.pcap");
+ * sniffer.sniff_loop([&](PDU& pdu) {
+ *     const RawPDU& raw = pdu.rfind_pdu<RawPDU>();
+ *     // Points into the mapped file, nothing was copied
+ *     process(raw.payload_data(), raw.payload_size());
+ *     return true;
+ * });
+ * \endcode
+ *
+ * A borrowed payload is only valid as long as the buffer it references, so 
+ * only the sources whose buffer outlives the PDUs they hand out borrow:
+ *
+ * - MappedFileSniffer, whose payloads are valid as long as the sniffer is 
+ *   alive.
+ * - RingSniffer, whose payloads are valid until the sniffer reads the next
+ *   packet.
+ * - PDUs constructed by the user out of a buffer, whose payloads are valid
+ *   as long as that buffer.
+ *
+ * Sniffer, FileSniffer, PcapngReader, CapturePipeline and IndexedFileReader 
+ * reading pcapng files reuse their buffer
+ * for the next packet, so the PDUs they hand out always own their payload.
+ *
+ * Use RawPDU::own to copy a borrowed payload into the PDU before the buffer 
+ * goes away. Copies of a RawPDU, including the ones made by RawPDU::clone, 
+ * always own their payload. Using the payload_type based accessors also 
+ * makes the PDU own it.
  */
 class TINS_API RawPDU : public PDU {
 public:
@@ -73,6 +110,52 @@ public:
      */
     static const PDU::PDUType pdu_flag = PDU::RAW;
 
+    /**
+     * \brief Tag type used to construct a RawPDU which borrows its payload.
+     */
+    struct borrow_tag { };
+
+    #ifdef TINS_HAVE_CXX11
+    /**
+     * \brief Makes payloads parsed on the current thread be borrowed while
+     * it's alive.
+     *
+     * While a scope is alive, the RawPDUs created by protocol parsers (e.g. 
+     * the payload of a TCP or UDP segment parsed out of a captured frame) 
+     * reference the buffer being parsed instead of copying it. These PDUs
+     * have to be destroyed, or RawPDU::own has to be called on them, before
+     * that buffer is released. See the class' documentation for the 
+     * sources whose payloads are borrowed.
+     *
+     * Scopes can be nested. RawPDUs constructed explicitly are not affected.
+     */
+    class TINS_API borrow_scope {
+    public:
+        /**
+         * \brief Starts borrowing parsed payloads on the current thread.
+         */
+        borrow_scope();
+
+        /**
+         * \brief Restores the behavior used before this scope was created.
+         */
+        ~borrow_scope();
+    private:
+        borrow_scope(const borrow_scope&);
+        borrow_scope& operator=(const borrow_scope&);
+
+        bool previous_;
+    };
+    #endif // TINS_HAVE_CXX11
+
+    /**
+     * \brief Indicates whether payloads parsed on the current thread are 
+     * borrowed.
+     *
+     * This is true while a RawPDU::borrow_scope is alive on this thread.
+     */
+    static bool borrowing();
+
     /** 
      * \brief Creates an instance of RawPDU.
      *
@@ -82,6 +165,17 @@ public:
      * \param size The size of the payload.
      */
     RawPDU(const uint8_t* pload, uint32_t size);
+
+    /**
+     * \brief Creates an instance of RawPDU which borrows its payload.
+     *
+     * The payload is not copied, so the buffer must outlive this RawPDU
+     * or RawPDU::own must be called before it's released.
+     *
+     * \param pload The payload which the RawPDU will reference.
+     * \param size The size of the payload.
+     */
+    RawPDU(const uint8_t* pload, uint32_t size, borrow_tag);
     
     /**
      * \brief Constructs a RawPDU from an iterator range.
@@ -94,7 +188,7 @@ public:
      */
     template<typename ForwardIterator>
     RawPDU(ForwardIterator start, ForwardIterator end) 
-    : payload_(start, end) { }
+    : payload_(start, end), borrowed_payload_(0), borrowed_size_(0) { }
 
     /**
      * \brief Creates an instance of RawPDU from a payload_type.
@@ -104,7 +198,7 @@ public:
      * \param data The payload to use.
      */
     RawPDU(const payload_type & data)
-            : payload_(data) { }
+            : payload_(data), borrowed_payload_(0), borrowed_size_(0) { }
 
     #if TINS_IS_CXX11
         /** 
@@ -115,7 +209,7 @@ public:
          * \param data The payload to use.
          */
         RawPDU(payload_type&& data)
-        : payload_(move(data)) { }
+        : payload_(move(data)), borrowed_payload_(0), borrowed_size_(0) { }
     #endif // TINS_IS_CXX11
 
     /** 
@@ -125,6 +219,52 @@ public:
      */
     RawPDU(const std::string& data);
 
+    /**
+     * \brief Copy constructor.
+     *
+     * The new RawPDU always owns its payload, even if the one being copied
+     * borrows it.
+     */
+    RawPDU(const RawPDU& other);
+
+    /**
+     * \brief Copy assignment operator.
+     *
+     * This RawPDU will own its payload, even if the one being copied 
+     * borrows it.
+     */
+    RawPDU& operator=(const RawPDU& other);
+
+    #if TINS_IS_CXX11
+        /**
+         * \brief Move constructor.
+         *
+         * A borrowed payload is still borrowed after being moved.
+         */
+        RawPDU(RawPDU&& other) TINS_NOEXCEPT
+        : PDU(std::move(other)), payload_(std::move(other.payload_)), 
+          borrowed_payload_(other.borrowed_payload_), 
+          borrowed_size_(other.borrowed_size_) {
+            other.borrowed_payload_ = 0;
+            other.borrowed_size_ = 0;
+        }
+
+        /**
+         * \brief Move assignment operator.
+         *
+         * A borrowed payload is still borrowed after being moved.
+         */
+        RawPDU& operator=(RawPDU&& other) TINS_NOEXCEPT {
+            PDU::operator=(std::move(other));
+            payload_ = std::move(other.payload_);
+            borrowed_payload_ = other.borrowed_payload_;
+            borrowed_size_ = other.borrowed_size_;
+            other.borrowed_payload_ = 0;
+            other.borrowed_size_ = 0;
+            return *this;
+        }
+    #endif // TINS_IS_CXX11
+
     /**
      * \brief Setter for the payload field
      * \param pload The payload to be set.
@@ -139,23 +279,69 @@ public:
     template<typename ForwardIterator>
     void payload(ForwardIterator start, ForwardIterator end) {
         payload_.assign(start, end);
+        borrowed_payload_ = 0;
+        borrowed_size_ = 0;
     }
 
     /** 
      * \brief Const getter for the payload.
+     *
+     * If the payload is borrowed, it's copied into this RawPDU first. Use 
+     * RawPDU::payload_data to access it without copying.
+     *
      * \return The RawPDU's payload.
      */
     const payload_type& payload() const {
+        own_payload();
         return payload_;
     }
     
     /** 
      * \brief Non-const getter for the payload.
+     *
+     * If the payload is borrowed, it's copied into this RawPDU first.
+     *
      * \return The RawPDU's payload.
      */
     payload_type& payload() {
+        own_payload();
         return payload_;
     }
+
+    /**
+     * \brief Getter for a pointer to the payload.
+     *
+     * This never copies the payload, whether it's borrowed or not. The 
+     * pointer is valid for RawPDU::payload_size bytes.
+     *
+     * \return A pointer to the payload, or 0 if it's empty.
+     */
+    const uint8_t* payload_data() const {
+        if (borrowed_payload_) {
+            return borrowed_payload_;
+        }
+        return payload_.empty() ? 0 : &payload_[0];
+    }
+
+    /**
+     * \brief Indicates whether this RawPDU owns its payload.
+     *
+     * \return false iff the payload is borrowed from an external buffer.
+     */
+    bool owns_payload() const {
+        return borrowed_payload_ == 0;
+    }
+
+    /**
+     * \brief Copies a borrowed payload into this RawPDU.
+     *
+     * After this call, this RawPDU no longer references the buffer it
+     * borrowed its payload from. This does nothing if the payload is 
+     * already owned.
+     */
+    void own() {
+        own_payload();
+    }
     
     /** 
      * \brief Returns the header size.
@@ -172,6 +358,9 @@ public:
      * \return uint32_t containing the payload size.
      */
     uint32_t payload_size() const {
+        if (borrowed_payload_) {
+            return borrowed_size_;
+        }
         return static_cast<uint32_t>(payload_.size());
     }
 
@@ -201,7 +390,7 @@ public:
      */
     template<typename T>
     T to() const {
-        return T(&payload_[0], static_cast<uint32_t>(payload_.size()));
+        return T(payload_data(), payload_size());
     }
     
     /**
@@ -212,8 +401,13 @@ public:
     }
 private:
     void write_serialization(uint8_t* buffer, uint32_t total_sz);
+    void own_payload() const;
 
-    payload_type payload_;
+    // A borrowed payload is copied into payload_ the first time it's 
+    // accessed through payload(), even if through a const reference
+    mutable payload_type payload_;
+    mutable const uint8_t* borrowed_payload_;
+    mutable uint32_t borrowed_size_;
 };
 
 } // Tins
@@ -0,0 +1,345 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef TINS_RING_SNIFFER_H
+#define TINS_RING_SNIFFER_H
+
+#include <tins/config.h>
+
+#if defined(TINS_HAVE_PCAP) && defined(TINS_HAVE_PACKET_RING)
+
+#include <string>
+#include <atomic>
+#include <stdint.h>
+#include <tins/packet.h>
+#include <tins/raw_packet.h>
+#include <tins/sniffer.h>
+#include <tins/macros.h>
+#include <tins/exceptions.h>
+#include <tins/detail/type_traits.h>
+
+namespace Tins {
+
+/**
+ * \class RingSniffer
+ * \brief Sniffs packets from a network interface using a PACKET_MMAP ring.
+ *
+ * This sniffer captures packets on Linux through an AF_PACKET socket 
+ * which uses a TPACKET_V3 receive ring. The ring is a set of blocks that 
+ * are shared between the kernel and user space: the kernel fills a block 
+ * with frames and hands it over once it's full or once the ring's frame 
+ * timeout expires, so frames can be read straight from the ring without 
+ * any system call or copy per packet.
+ *
+ * The ring's layout is configured through SnifferConfiguration::set_ring_block_size, 
+ * SnifferConfiguration::set_ring_block_count and 
+ * SnifferConfiguration::set_ring_frame_timeout. The snapshot length, timeout, 
+ * filter, promiscuous mode and direction options are honored as well.
+ *
+ * Frames can be read without copying them through RingSniffer::next_frame 
+ * and RingSniffer::sniff_frames. The RawPackets handed out by these point 
+ * into the ring, so they're only valid until the block that contains them 
+ * is given back to the kernel. This happens when the sniffer moves past the 
+ * last frame in it, which means a RawPacket is valid at least until 
+ * the next call to RingSniffer::next_frame.
+ *
+ * RingSniffer::next_packet and RingSniffer::sniff_loop parse frames into 
+ * PDUs using the same link layer dispatching that BaseSniffer uses, so 
+ * they behave just like their BaseSniffer counterparts. Payloads parsed 
+ * while a RawPDU::borrow_scope is alive point into the ring, so they're 
+ * only valid until the sniffer reads the next packet.
+ *
+ * \code
+ * SnifferConfiguration config;
+ * config.set_ring_block_size(1 << 22);
+ * config.set_ring_block_count(32);
+ * config.set_filter("udp");
+ *
+ * RingSniffer sniffer("eth0", config);
+ * sniffer.sniff_frames([&](const RawPacket& frame) {
+ *     PacketView view = frame.view();
+ *     // ...
+ *     return true;
+ * });
+ * \endcode
+ *
+ * Note that VLAN tags which were stripped by the network card are not 
+ * inserted back into the frames.
+ */
+class TINS_API RingSniffer {
+public:
+    /**
+     * \brief The capture statistics of a RingSniffer.
+     */
+    struct statistics {
+        /**
+         * The amount of packets that were received.
+         */
+        uint32_t packets;
+
+        /**
+         * The amount of packets that were dropped because the ring was full.
+         */
+        uint32_t drops;
+
+        /**
+         * The amount of times the ring was frozen because no block was free.
+         */
+        uint32_t freezes;
+    };
+
+    /**
+     * \brief Constructs a RingSniffer.
+     *
+     * \param device The device from which to capture packets.
+     * \param configuration The configuration object to use to setup the sniffer.
+     */
+    RingSniffer(const std::string& device,
+                const SnifferConfiguration& configuration = SnifferConfiguration());
+
+    /**
+     * \brief Destructor.
+     *
+     * This unmaps the ring and closes the socket.
+     */
+    ~RingSniffer();
+
+    /**
+     * \brief Reads the next frame without copying it.
+     *
+     * The provided RawPacket will point to the next frame in the ring. 
+     * See the class' documentation for how long the frame stays valid.
+     *
+     * \param frame The object in which to store the frame.
+     * \return false if RingSniffer::stop_sniff was called or an error 
+     * occurred, true otherwise.
+     */
+    bool next_frame(RawPacket& frame);
+
+    /**
+     * \brief Captures one packet and parses it.
+     *
+     * This behaves just like BaseSniffer::next_packet.
+     *
+     * \return A captured packet. If an error occured, PtrPacket::pdu
+     * will return 0. Caller takes ownership of the PDU pointer stored in
+     * the PtrPacket.
+     */
+    PtrPacket next_packet();
+
+    /**
+     * \brief Starts a sniffing loop, using a callback functor for every
+     * sniffed packet.
+     *
+     * This behaves just like BaseSniffer::sniff_loop.
+     *
+     * \param function The callback handler object which should process packets.
+     * \param max_packets The maximum amount of packets to sniff. 0 == infinite.
+     */
+    template <typename Functor>
+    void sniff_loop(Functor function, uint32_t max_packets = 0);
+
+    /**
+     * \brief Starts a sniffing loop which hands out frames without copying 
+     * or parsing them.
+     *
+     * The functor must implement an operator with the following signature:
+     *
+     * \code
+     * bool(const RawPacket&);
+     * \endcode
+     *
+     * The RawPacket is only valid during the call to the functor. Sniffing 
+     * will stop when either max_packets are sniffed (if it is != 0), when 
+     * the functor returns false or when RingSniffer::stop_sniff is called.
+     * Both malformed_packet and pdu_not_found exceptions thrown by the 
+     * functor are caught.
+     *
+     * \param function The callback handler object which should process frames.
+     * \param max_packets The maximum amount of frames to sniff. 0 == infinite.
+     */
+    template <typename Functor>
+    void sniff_frames(Functor function, uint32_t max_packets = 0);
+
+    /**
+     * \brief Sets a filter on this sniffer.
+     *
+     * The filter is compiled using libpcap and attached to the socket.
+     *
+     * \param filter The filter to be set.
+     * \return True iif it was possible to apply the filter.
+     */
+    bool set_filter(const std::string& filter);
+
+    /**
+     * \brief Joins this sniffer's socket to a PACKET_FANOUT group.
+     *
+     * Every socket in a fanout group gets a share of the packets captured 
+     * on the device. FanoutSniffer takes care of this for you, this is 
+     * only useful when spreading packets among sniffers in different 
+     * processes.
+     *
+     * \param group_id The identifier of the group.
+     * \param mode The PACKET_FANOUT_* mode to use, optionally or'd with 
+     * PACKET_FANOUT_FLAG_* flags.
+     */
+    void join_fanout_group(uint16_t group_id, uint16_t mode);
+
+    /**
+     * \brief Creates a new PACKET_FANOUT group and joins this sniffer to it.
+     *
+     * The group's identifier is picked by the kernel so that it doesn't 
+     * clash with any existing group. On kernels which can't do this, 
+     * identifiers are tried until one that isn't in use with a different 
+     * mode is found. Other sockets can then use join_fanout_group with the 
+     * returned identifier.
+     *
+     * \param mode The PACKET_FANOUT_* mode to use, optionally or'd with 
+     * PACKET_FANOUT_FLAG_* flags.
+     * \return The identifier of the created group.
+     */
+    uint16_t create_fanout_group(uint16_t mode);
+
+    /**
+     * \brief Stops sniffing loops.
+     *
+     * Unlike BaseSniffer::stop_sniff, this can be called from any thread. 
+     * The sniffing loop will return after the current frame is processed 
+     * or, if it's waiting for packets, once the timeout expires. If the 
+     * timeout is 0, it will wait until the next block of packets arrives.
+     */
+    void stop_sniff();
+
+    /**
+     * \brief Retrieves the statistics of this sniffer.
+     *
+     * The kernel resets these counters every time they are retrieved, 
+     * so this returns the statistics since the last call.
+     */
+    statistics stats();
+
+    /**
+     * \brief Sets whether to extract RawPDUs or fully parsed packets.
+     *
+     * \sa BaseSniffer::set_extract_raw_pdus
+     * \param value Whether to extract RawPDUs or not.
+     */
+    void set_extract_raw_pdus(bool value);
+
+    /**
+     * \brief Gets the file descriptor associated with the sniffer.
+     */
+    int get_fd();
+
+    /**
+     * \brief Retrieves this sniffer's link type.
+     *
+     * This is one of the DLT_* constants defined by libpcap.
+     */
+    int link_type() const;
+private:
+    friend class SnifferConfiguration;
+
+    RingSniffer(const RingSniffer&);
+    RingSniffer& operator=(const RingSniffer&);
+
+    void init(const std::string& device, const SnifferConfiguration& configuration);
+    void cleanup();
+    void set_snap_len(unsigned snap_len);
+    void set_timeout(unsigned timeout);
+    void set_ring_layout(unsigned block_size, unsigned block_count, 
+                         unsigned frame_timeout);
+    void set_promisc_mode(bool promisc_enabled);
+    void set_direction(pcap_direction_t direction);
+    void setup_ring();
+    bool acquire_block();
+    void release_block();
+
+    int socket_;
+    int iface_index_;
+    int link_type_;
+    uint8_t* ring_;
+    uint32_t block_size_;
+    uint32_t block_count_;
+    uint32_t frame_timeout_;
+    uint32_t snap_len_;
+    int timeout_;
+    pcap_direction_t direction_;
+    uint32_t current_block_;
+    const uint8_t* current_frame_;
+    uint32_t frames_left_;
+    bool block_acquired_;
+    bool extract_raw_;
+    std::atomic<bool> stop_;
+};
+
+template <typename Functor>
+void RingSniffer::sniff_loop(Functor function, uint32_t max_packets) {
+    while (true) {
+        Packet packet(next_packet());
+        if (!packet) {
+            return;
+        }
+        try {
+            // If the functor returns false, we're done
+            if (!Tins::Internals::invoke_loop_cb(function, packet)) {
+                return;
+            }
+        }
+        catch(malformed_packet&) { }
+        catch(pdu_not_found&) { }
+        if (max_packets && --max_packets == 0) {
+            return;
+        }
+    }
+}
+
+template <typename Functor>
+void RingSniffer::sniff_frames(Functor function, uint32_t max_packets) {
+    RawPacket frame;
+    while (next_frame(frame)) {
+        try {
+            // If the functor returns false, we're done
+            if (!function(frame)) {
+                return;
+            }
+        }
+        catch(malformed_packet&) { }
+        catch(pdu_not_found&) { }
+        if (max_packets && --max_packets == 0) {
+            return;
+        }
+    }
+}
+
+} // Tins
+
+#endif // TINS_HAVE_PCAP && TINS_HAVE_PACKET_RING
+
+#endif // TINS_RING_SNIFFER_H
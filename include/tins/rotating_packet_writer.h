@@ -0,0 +1,338 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef TINS_ROTATING_PACKET_WRITER_H
+#define TINS_ROTATING_PACKET_WRITER_H
+
+#include <tins/config.h>
+
+#if defined(TINS_HAVE_PCAP) && defined(TINS_HAVE_CXX11)
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <stdint.h>
+#include <tins/macros.h>
+#include <tins/timestamp.h>
+#include <tins/data_link_type.h>
+#include <tins/packet_writer.h>
+#include <tins/utils/pdu_utils.h>
+
+namespace Tins {
+
+class PDU;
+class Packet;
+class RawPacket;
+
+/**
+ * \class RotatingPacketWriter
+ * \brief Writes packets to a sequence of pcap files from a background 
+ * thread.
+ *
+ * Packets handed to this class are copied into a bounded queue and 
+ * written to disk by a background thread using a PacketWriter, so the 
+ * thread that captures packets never waits on file I/O. 
+ *
+ * Once the current file reaches the configured size, amount of packets 
+ * or duration, it's closed and the next one is opened. Files are named 
+ * after a base name followed by their index, e.g. "capture_000000.pcap", 
+ * "capture_000001.pcap" and so on.
+ *
+ * If the disk can't keep up and the queue fills up, new packets are 
+ * dropped by default. Alternatively, the writer can block until there's 
+ * room in the queue. Either way, the amount of dropped packets, the 
+ * amount of times a write had to wait and the queue's usage are available
+ * through RotatingPacketWriter::stats.
+ *
+ * \code
+ * RotatingPacketWriter::rotation_policy policy;
+ * // Roll every 1 GB or every hour, whatever happens first
+ * policy.max_file_size = 1024 * 1024 * 1024;
+ * policy.max_duration = 3600;
+ *
+ * RotatingPacketWriter writer("/data/capture", DataLinkType<EthernetII>(), policy);
+ * RingSniffer sniffer("eth0");
+ * sniffer.sniff_frames([&](const RawPacket& frame) {
+ *     writer.write(frame);
+ *     return true;
+ * });
+ * \endcode
+ */
+class TINS_API RotatingPacketWriter {
+public:
+    /**
+     * \brief What to do when a packet doesn't fit in the queue.
+     */
+    enum overflow_policy {
+        DROP,
+        BLOCK
+    };
+
+    /**
+     * \brief The default size of the queue, in bytes.
+     */
+    static const size_t DEFAULT_QUEUE_SIZE;
+
+    /**
+     * \brief Indicates when to roll over to a new file.
+     *
+     * A value of 0 disables the corresponding limit. Files always contain 
+     * at least one packet, even if it's larger than max_file_size.
+     */
+    struct rotation_policy {
+        /**
+         * Default constructs a policy with no limits, which writes every
+         * packet into a single file.
+         */
+        rotation_policy();
+
+        /**
+         * The maximum size of a file, in bytes.
+         */
+        uint64_t max_file_size;
+
+        /**
+         * The maximum amount of packets in a file.
+         */
+        uint64_t max_packets;
+
+        /**
+         * \brief The maximum amount of seconds covered by a file.
+         *
+         * This is measured using the packets' timestamps, which follow the 
+         * wall clock on live captures.
+         */
+        uint32_t max_duration;
+    };
+
+    /**
+     * \brief The statistics of a RotatingPacketWriter.
+     */
+    struct statistics {
+        /**
+         * The amount of packets written to disk.
+         */
+        uint64_t written;
+
+        /**
+         * The amount of packets dropped because the queue was full.
+         */
+        uint64_t dropped;
+
+        /**
+         * The amount of writes that waited for room in the queue.
+         */
+        uint64_t blocked;
+
+        /**
+         * The amount of bytes currently waiting in the queue.
+         */
+        size_t queue_usage;
+
+        /**
+         * The largest amount of bytes that were ever waiting in the queue.
+         */
+        size_t peak_queue_usage;
+
+        /**
+         * The amount of files created so far.
+         */
+        uint32_t files;
+    };
+
+    /**
+     * The type of the functor called every time a file is completed.
+     */
+    typedef std::function<void(const std::string&)> rotation_callback_type;
+
+    /**
+     * \brief Constructs a RotatingPacketWriter.
+     *
+     * The first file is created by the background thread once the first
+     * packet is written.
+     *
+     * \param base_name The path used to build each file's name.
+     * \param lt A DataLinkType that represents the link layer protocol to use.
+     * \param policy Indicates when to roll over to a new file.
+     * \param queue_size The size of the queue, in bytes.
+     * \param overflow What to do when the queue is full.
+     */
+    template <typename T>
+    RotatingPacketWriter(const std::string& base_name, const DataLinkType<T>& lt,
+                         const rotation_policy& policy = rotation_policy(),
+                         size_t queue_size = DEFAULT_QUEUE_SIZE,
+                         overflow_policy overflow = DROP)
+    : base_name_(base_name), policy_(policy), queue_size_(queue_size), 
+      link_type_(lt.get_type()), overflow_(overflow) {
+        init();
+    }
+
+    /**
+     * \brief Destructor.
+     *
+     * This writes every queued packet and closes the current file. Errors 
+     * are ignored, so use RotatingPacketWriter::close to find out about 
+     * them.
+     */
+    ~RotatingPacketWriter();
+
+    /**
+     * \brief Queues a packet's bytes to be written.
+     *
+     * \param data The packet's data, starting with its link layer header.
+     * \param size The size of the packet's data.
+     * \param timestamp The packet's timestamp.
+     * \param original_size The packet's size on the wire.
+     * \return false if the packet was dropped, true otherwise.
+     */
+    bool write_raw(const uint8_t* data, uint32_t size, const Timestamp& timestamp, 
+                   uint32_t original_size);
+
+    /**
+     * \brief Queues a frame to be written.
+     *
+     * \param frame The frame to be written.
+     * \return false if the frame was dropped, true otherwise.
+     */
+    bool write(const RawPacket& frame);
+
+    /**
+     * \brief Queues a Packet to be written.
+     *
+     * The packet is serialized on the calling thread, straight into the 
+     * queue.
+     *
+     * \param packet The packet to be written.
+     * \return false if the packet was dropped, true otherwise.
+     */
+    bool write(Packet& packet);
+
+    /**
+     * \brief Queues a PDU to be written, using the current time as its 
+     * timestamp.
+     *
+     * \param pdu The PDU to be written.
+     * \return false if the PDU was dropped, true otherwise.
+     */
+    bool write(PDU& pdu);
+
+    /**
+     * \brief Queues a PDU to be written.
+     *
+     * The template parameter T must at some point yield a PDU& after
+     * applying operator* one or more than one time. This accepts both
+     * raw and smart pointers.
+     */
+    template <typename T>
+    bool write(T& pdu) {
+        return write(Utils::dereference_until_pdu(pdu));
+    }
+
+    /**
+     * \brief Writes every queued packet, closes the current file and 
+     * stops the background thread.
+     *
+     * Packets written after this call are dropped. If the background 
+     * thread failed to write to disk, the exception it ran into is 
+     * rethrown here.
+     */
+    void close();
+
+    /**
+     * \brief Retrieves this writer's statistics.
+     */
+    statistics stats() const;
+
+    /**
+     * \brief Builds the name of a file.
+     *
+     * \param index The file's index, starting from 0.
+     */
+    std::string file_name(uint32_t index) const;
+
+    /**
+     * \brief Sets a functor to be called every time a file is completed.
+     *
+     * The functor is called on the background thread with the file's 
+     * name, for example to compress it or move it elsewhere. This must 
+     * be set before the first packet is written.
+     *
+     * \param callback The functor to be called.
+     */
+    void set_rotation_callback(rotation_callback_type callback);
+private:
+    RotatingPacketWriter(const RotatingPacketWriter&);
+    RotatingPacketWriter& operator=(const RotatingPacketWriter&);
+
+    void init();
+    bool enqueue(const uint8_t* data, PDU* pdu, uint32_t size, const Timestamp& timestamp,
+                 uint32_t original_size);
+    void run();
+    void write_records(const std::vector<uint8_t>& records);
+    void open_file(uint64_t first_second);
+    void close_file();
+
+    std::string base_name_;
+    rotation_policy policy_;
+    rotation_callback_type rotation_callback_;
+    // Packets queued by the writing thread
+    std::vector<uint8_t> queue_;
+    mutable std::mutex lock_;
+    std::condition_variable queue_ready_;
+    std::condition_variable queue_drained_;
+    std::thread writer_thread_;
+    std::exception_ptr error_;
+    // Only used by the background thread
+    std::unique_ptr<PacketWriter> writer_;
+    uint64_t file_size_;
+    uint64_t file_packets_;
+    uint64_t file_first_second_;
+    // Protected by lock_
+    uint64_t written_;
+    uint64_t dropped_;
+    uint64_t blocked_;
+    size_t peak_queue_usage_;
+    uint32_t files_;
+    size_t queue_size_;
+    int link_type_;
+    overflow_policy overflow_;
+    bool stopping_;
+    bool closed_;
+};
+
+} // Tins
+
+#endif // TINS_HAVE_PCAP && TINS_HAVE_CXX11
+
+#endif // TINS_ROTATING_PACKET_WRITER_H
@@ -33,6 +33,7 @@
 
 #include <string>
 #include <memory>
+#include <vector>
 #include <iterator>
 #include <tins/pdu.h>
 #include <tins/packet.h>
@@ -49,6 +50,10 @@
 namespace Tins {
 class SnifferIterator;
 class SnifferConfiguration;
+class MappedFileSniffer;
+#ifdef TINS_HAVE_PACKET_RING
+class RingSniffer;
+#endif // TINS_HAVE_PACKET_RING
 
 /**
  * \class BaseSniffer
@@ -67,6 +72,16 @@ public:
      */
     typedef SnifferIterator iterator;
 
+    /**
+     * The type used to deliver packets in BaseSniffer::sniff_batch.
+     */
+    typedef std::vector<Packet> batch_type;
+
+    /**
+     * The default maximum amount of packets in each batch.
+     */
+    static const uint32_t DEFAULT_BATCH_SIZE;
+
     #if TINS_IS_CXX11
         /**
          * \brief Move constructor.
@@ -188,6 +203,63 @@ public:
     template <typename Functor>
     void sniff_loop(Functor function, uint32_t max_packets = 0);
 
+    /**
+     * \brief Starts a sniffing loop which delivers packets in batches.
+     *
+     * Rather than calling the functor once per packet, this method drains 
+     * up to batch_size packets on each pcap_dispatch call and hands all of 
+     * them to the functor at once. This amortizes the cost of going 
+     * through libpcap and the link layer type lookup on every packet.
+     *
+     * The functor must implement an operator with one of the following
+     * signatures:
+     *
+     * \code
+     * bool(BaseSniffer::batch_type&);
+     * bool(const BaseSniffer::batch_type&);
+     * \endcode
+     *
+     * The packets in the batch are owned by the sniffer and are destroyed 
+     * when the next batch is read, so they should be moved out of the 
+     * batch if they need to be kept around. The batch is never empty.
+     *
+     * Sniffing will stop when the functor returns false, when 
+     * BaseSniffer::stop_sniff is called or, if this sniffer is reading 
+     * a file, once the end of it is reached. Note that this always uses
+     * pcap_dispatch, regardless of the sniffing method that was set.
+     *
+     * Just like sniff_loop, both malformed_packet and pdu_not_found 
+     * exceptions thrown by the functor are caught.
+     *
+     * \code
+     * sniffer.sniff_batch([&](BaseSniffer::batch_type& packets) {
+     *     for (size_t i = 0; i < packets.size(); ++i) {
+     *         process(packets[i]);
+     *     }
+     *     return true;
+     * }, 128);
+     * \endcode
+     *
+     * \param function The callback handler object which should process 
+     * the batches.
+     * \param batch_size The maximum amount of packets in each batch.
+     */
+    template <typename Functor>
+    void sniff_batch(Functor function, uint32_t batch_size = DEFAULT_BATCH_SIZE);
+
+    /**
+     * \brief Reads the next batch of packets.
+     *
+     * This is the building block of BaseSniffer::sniff_batch. The provided
+     * container is cleared and then filled with up to batch_size packets,
+     * using a single pcap_dispatch call whenever possible.
+     *
+     * \param packets The container in which to store the packets.
+     * \param batch_size The maximum amount of packets to read.
+     * \return false if no more packets can be read, true otherwise.
+     */
+    bool next_batch(batch_type& packets, uint32_t batch_size = DEFAULT_BATCH_SIZE);
+
     /**
      * \brief Sets a filter on this sniffer.
      * \param filter The filter to be set.
@@ -311,6 +383,8 @@ private:
     BaseSniffer(const BaseSniffer&);
     BaseSniffer& operator=(const BaseSniffer&);
 
+    pcap_handler get_handler() const;
+
     pcap_t* handle_;
     bpf_u_int32 mask_;
     bool extract_raw_;
@@ -537,6 +611,9 @@ private:
  * - Snapshot length: 65535 bytes (64 KB).
  * - Timeout: 1000 milliseconds.
  * - Promiscuous mode: false.
+ * - Ring block size: 1048576 bytes (1 MB).
+ * - Ring block count: 64.
+ * - Ring frame timeout: 64 milliseconds.
  *
  * For any of the attributes not listed above, the associated
  * pcap function which is used to set them on a pcap handle
@@ -571,6 +648,27 @@ public:
      */
     static const unsigned DEFAULT_TIMEOUT;
 
+    /**
+     * \brief The default size of each block in a capture ring.
+     *
+     * This is 1048576 by default.
+     */
+    static const unsigned DEFAULT_RING_BLOCK_SIZE;
+
+    /**
+     * \brief The default amount of blocks in a capture ring.
+     *
+     * This is 64 by default.
+     */
+    static const unsigned DEFAULT_RING_BLOCK_COUNT;
+
+    /**
+     * \brief The default capture ring frame timeout.
+     *
+     * This is 64 by default.
+     */
+    static const unsigned DEFAULT_RING_FRAME_TIMEOUT;
+
     /**
      * Default constructs a SnifferConfiguration.
      */
@@ -635,9 +733,43 @@ public:
      * \param value The timestamp option value.
      */
     void set_timestamp_precision(int value);
+
+    /**
+     * \brief Sets the size of each block in the capture ring.
+     *
+     * This is only used by RingSniffer. The size is rounded up to 
+     * a multiple of the page size.
+     *
+     * \param block_size The block size to be set, in bytes.
+     */
+    void set_ring_block_size(unsigned block_size);
+
+    /**
+     * \brief Sets the amount of blocks in the capture ring.
+     *
+     * This is only used by RingSniffer.
+     *
+     * \param block_count The amount of blocks to be set.
+     */
+    void set_ring_block_count(unsigned block_count);
+
+    /**
+     * \brief Sets the capture ring frame timeout.
+     *
+     * This is the amount of time after which the kernel hands a block 
+     * over to user space even if it's not full yet. This is only used 
+     * by RingSniffer.
+     *
+     * \param timeout The timeout to be set, in milliseconds.
+     */
+    void set_ring_frame_timeout(unsigned timeout);
 protected:
     friend class Sniffer;
     friend class FileSniffer;
+    friend class MappedFileSniffer;
+    #ifdef TINS_HAVE_PACKET_RING
+    friend class RingSniffer;
+    #endif // TINS_HAVE_PACKET_RING
 
     enum Flags {
         BUFFER_SIZE = 1,
@@ -652,9 +784,15 @@ protected:
 
     void configure_sniffer_pre_activation(Sniffer& sniffer) const;
     void configure_sniffer_pre_activation(FileSniffer& sniffer) const;
+    void configure_sniffer_pre_activation(MappedFileSniffer& sniffer) const;
 
     void configure_sniffer_post_activation(Sniffer& sniffer) const;
 
+    #ifdef TINS_HAVE_PACKET_RING
+    void configure_sniffer_pre_activation(RingSniffer& sniffer) const;
+    void configure_sniffer_post_activation(RingSniffer& sniffer) const;
+    #endif // TINS_HAVE_PACKET_RING
+
     uint32_t flags_;
     unsigned snap_len_;
     unsigned buffer_size_;
@@ -666,6 +804,9 @@ protected:
     bool immediate_mode_;
     pcap_direction_t direction_;
     int timestamp_precision_;
+    unsigned ring_block_size_;
+    unsigned ring_block_count_;
+    unsigned ring_frame_timeout_;
 };
 
 template <typename Functor>
@@ -691,6 +832,22 @@ void Tins::BaseSniffer::sniff_loop(Functor function, uint32_t max_packets) {
     }
 }
 
+template <typename Functor>
+void Tins::BaseSniffer::sniff_batch(Functor function, uint32_t batch_size) {
+    batch_type packets;
+    packets.reserve(batch_size);
+    while (next_batch(packets, batch_size)) {
+        try {
+            // If the functor returns false, we're done
+            if (!function(packets)) {
+                return;
+            }
+        }
+        catch(malformed_packet&) { }
+        catch(pdu_not_found&) { }
+    }
+}
+
 } // Tins
 
 #endif // TINS_HAVE_PCAP
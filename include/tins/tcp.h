@@ -38,6 +38,7 @@
 #include <tins/endianness.h>
 #include <tins/small_uint.h>
 #include <tins/pdu_option.h>
+#include <tins/pdu_option_view.h>
 #include <tins/cxxstd.h>
 
 namespace Tins {
@@ -132,6 +133,11 @@ public:
      * The type used to store the options.
      */
     typedef std::vector<option> options_type;
+
+    /**
+     * The type returned by TCP::option_views.
+     */
+    typedef PDUOptionRange<option> option_views_type;
     
     /**
      * The type used to store the sack option.
@@ -249,9 +255,27 @@ public:
      * \return The options list.
      */
     const options_type& options() const {
+        materialize_options();
         return options_;
     }
 
+    /**
+     * \brief Getter for views over the stored options.
+     *
+     * Unlike TCP::options, this doesn't build the options of a lazily 
+     * parsed segment.
+     *
+     * \sa LazyOptions
+     * \return The range of option views.
+     */
+    option_views_type option_views() const {
+        if (raw_options_.pending()) {
+            return option_views_type(raw_options_.begin(), raw_options_.end(), 
+                                     &TCP::parse_option_view);
+        }
+        return option_views_type(options_);
+    }
+
     /**
      * \brief Gets the value of a flag.
      *
@@ -493,6 +517,7 @@ public:
          * \param option The option to be added.
          */
         void add_option(option &&opt) {
+            materialize_options();
             options_.push_back(std::move(opt));
         }
 
@@ -506,6 +531,7 @@ public:
          */
         template <typename... Args>
         void add_option(Args&&... args) {
+            materialize_options();
             options_.emplace_back(std::forward<Args>(args)...);
         }
     #endif
@@ -629,9 +655,17 @@ private:
     options_type::const_iterator search_option_iterator(OptionTypes type) const;
     options_type::iterator search_option_iterator(OptionTypes type);
     
-    void write_option(const option& opt, Memory::OutputMemoryStream& stream);
+    static void write_option(const PDUOptionView<option>& opt, 
+                             Memory::OutputMemoryStream& stream);
+    static const uint8_t* parse_option_view(const uint8_t* ptr, const uint8_t* end,
+                                            PDUOptionView<option>& view);
+
+    void materialize_options() const {
+        Internals::materialize_options(options_, raw_options_, &TCP::parse_option_view);
+    }
 
-    options_type options_;
+    mutable options_type options_;
+    mutable Internals::option_bytes raw_options_;
     tcp_header header_;
 };
 
@@ -87,6 +87,21 @@ public:
      */
     bool process_payload(uint32_t seq, payload_type payload);
 
+    /**
+     * \brief Processes the given payload
+     *
+     * This behaves exactly like the payload_type overload. Data that arrives in 
+     * order while nothing is buffered is appended straight to the payload 
+     * buffer, so it's copied only once. Otherwise, the data is copied and 
+     * buffered.
+     *
+     * \brief seq The payload's sequence number
+     * \brief data The payload to process
+     * \brief size The size of the payload
+     * \return true iff any data was added to the payload buffer
+     */
+    bool process_payload(uint32_t seq, const uint8_t* data, uint32_t size);
+
     /**
      * \brief Skip forward to a sequence number
      *
@@ -50,21 +50,39 @@
 #include <tins/mpls.h>
 #include <tins/packet_sender.h>
 #include <tins/packet_writer.h>
+#include <tins/packet_replayer.h>
+#include <tins/rotating_packet_writer.h>
 #include <tins/pdu.h>
+#include <tins/pdu_arena.h>
+#include <tins/pdu_option_view.h>
+#include <tins/pdu_stack.h>
 #include <tins/radiotap.h>
 #include <tins/rawpdu.h>
 #include <tins/snap.h>
 #include <tins/sniffer.h>
+#include <tins/mapped_file_sniffer.h>
+#include <tins/parallel_file_processor.h>
+#include <tins/pcapng_reader.h>
+#include <tins/pcapng_writer.h>
+#include <tins/capture_index.h>
+#include <tins/indexed_file_reader.h>
+#include <tins/ring_sniffer.h>
+#include <tins/fanout_sniffer.h>
+#include <tins/capture_pipeline.h>
 #include <tins/tcp.h>
 #include <tins/udp.h>
 #include <tins/utils.h>
 #include <tins/tcp_stream.h>
 #include <tins/crypto.h>
 #include <tins/pdu_cacher.h>
+#include <tins/packet_template.h>
+#include <tins/probe_engine.h>
 #include <tins/rsn_information.h>
 #include <tins/ipv6_address.h>
 #include <tins/ip_address.h>
 #include <tins/packet.h>
+#include <tins/packet_view.h>
+#include <tins/raw_packet.h>
 #include <tins/timestamp.h>
 #include <tins/sll.h>
 #include <tins/dhcpv6.h>
@@ -34,6 +34,7 @@
 #include <tins/constants.h>
 #include <tins/exceptions.h>
 #include <tins/memory_helpers.h>
+#include <tins/detail/pdu_helpers.h>
 
 using Tins::Memory::InputMemoryStream;
 using Tins::Memory::OutputMemoryStream;
@@ -66,7 +67,7 @@ ARP::ARP(const uint8_t* buffer, uint32_t total_sz) {
     InputMemoryStream stream(buffer, total_sz);
     stream.read(header_);
     if (stream) {
-        inner_pdu(new RawPDU(stream.pointer(), stream.size()));
+        inner_pdu(Internals::raw_pdu_from_buffer(stream.pointer(), stream.size()));
     }
 }
 
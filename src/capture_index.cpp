@@ -0,0 +1,323 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <tins/capture_index.h>
+
+#ifdef TINS_HAVE_PCAP
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <errno.h>
+#include <tins/exceptions.h>
+#include <tins/raw_packet.h>
+#include <tins/mapped_file_sniffer.h>
+#include <tins/pcapng_reader.h>
+#include <tins/memory_helpers.h>
+#include <tins/detail/pcapng_helpers.h>
+
+using std::string;
+using std::vector;
+using std::ifstream;
+using std::ofstream;
+using std::ios;
+
+using Tins::Memory::InputMemoryStream;
+using Tins::Memory::OutputMemoryStream;
+
+namespace Tins {
+
+const uint32_t CaptureIndex::DEFAULT_INTERVAL = 4096;
+
+// Identifies index files, followed by the format's version
+const uint8_t capture_index_magic[8] = { 'T', 'I', 'N', 'S', 'I', 'D', 'X', 0 };
+const uint32_t capture_index_version = 1;
+// Magic, version, format, file size, packet count, interval, section count
+const uint32_t capture_index_header_size = 8 + 4 + 4 + 8 + 8 + 4 + 4;
+// Timestamp, packet number, offset and section
+const uint32_t capture_index_checkpoint_size = 8 + 8 + 8 + 4;
+
+static uint64_t timestamp_to_microseconds(const Timestamp& timestamp) {
+    return static_cast<uint64_t>(timestamp.seconds()) * 1000000 + timestamp.microseconds();
+}
+
+static Timestamp timestamp_from_microseconds(uint64_t value) {
+    struct timeval tv;
+    tv.tv_sec = static_cast<long>(value / 1000000);
+    tv.tv_usec = static_cast<long>(value % 1000000);
+    return tv;
+}
+
+CaptureIndex::CaptureIndex()
+: file_size_(0), packet_count_(0), newest_timestamp_(0), interval_(DEFAULT_INTERVAL),
+  format_(PCAP) {
+
+}
+
+CaptureIndex::file_format CaptureIndex::detect_format(const string& file_name, 
+                                                      uint64_t& size) {
+    ifstream input(file_name.c_str(), ios::binary | ios::ate);
+    if (!input) {
+        throw pcap_error(file_name + ": " + strerror(errno));
+    }
+    size = static_cast<uint64_t>(input.tellg());
+    input.seekg(0);
+    uint32_t magic = 0;
+    input.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    // The section header's block type reads the same in both byte orders
+    return magic == Internals::Pcapng::SECTION_HEADER ? PCAPNG : PCAP;
+}
+
+CaptureIndex CaptureIndex::build(const string& file_name, uint32_t interval) {
+    if (interval == 0) {
+        throw std::runtime_error("Checkpoint interval must be greater than 0");
+    }
+    CaptureIndex index;
+    index.interval_ = interval;
+    index.format_ = detect_format(file_name, index.file_size_);
+    if (index.format_ == PCAPNG) {
+        index.build_pcapng(file_name);
+    }
+    else {
+        index.build_pcap(file_name);
+    }
+    return index;
+}
+
+void CaptureIndex::build_pcap(const string& file_name) {
+    MappedFileSniffer sniffer(file_name);
+    RawPacket frame;
+    uint64_t offset = sniffer.position();
+    while (sniffer.next_frame(frame)) {
+        add_packet(frame.timestamp(), offset, 0);
+        offset = sniffer.position();
+    }
+}
+
+void CaptureIndex::build_pcapng(const string& file_name) {
+    PcapngReader reader(file_name);
+    RawPacket frame;
+    while (reader.next_frame(frame)) {
+        if (sections_.empty() || sections_.back().offset != reader.section_offset_) {
+            section new_section;
+            new_section.offset = reader.section_offset_;
+            sections_.push_back(new_section);
+        }
+        // Interfaces can be described anywhere in a section, so keep the 
+        // ones seen up to this packet
+        vector<uint64_t>& interface_offsets = sections_.back().interface_offsets;
+        if (interface_offsets.size() != reader.interface_offsets_.size()) {
+            interface_offsets = reader.interface_offsets_;
+        }
+        add_packet(frame.timestamp(), reader.block_offset_, 
+                   static_cast<uint32_t>(sections_.size() - 1));
+    }
+}
+
+void CaptureIndex::add_packet(const Timestamp& timestamp, uint64_t offset, 
+                              uint32_t section) {
+    newest_timestamp_ = std::max(newest_timestamp_, timestamp_to_microseconds(timestamp));
+    if (packet_count_ % interval_ == 0) {
+        checkpoint point;
+        point.timestamp = timestamp_from_microseconds(newest_timestamp_);
+        point.packet_number = packet_count_;
+        point.offset = offset;
+        point.section = section;
+        checkpoints_.push_back(point);
+    }
+    ++packet_count_;
+}
+
+CaptureIndex CaptureIndex::load(const string& file_name) {
+    ifstream input(file_name.c_str(), ios::binary);
+    if (!input) {
+        throw pcap_error(file_name + ": " + strerror(errno));
+    }
+    vector<uint8_t> buffer;
+    buffer.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    if (buffer.size() < capture_index_header_size || 
+        memcmp(&buffer[0], capture_index_magic, sizeof(capture_index_magic)) != 0) {
+        throw pcap_error("invalid capture index file");
+    }
+    CaptureIndex index;
+    try {
+        InputMemoryStream stream(buffer);
+        stream.skip(sizeof(capture_index_magic));
+        if (stream.read_le<uint32_t>() != capture_index_version) {
+            throw pcap_error("unsupported capture index version");
+        }
+        const uint32_t format = stream.read_le<uint32_t>();
+        if (format != PCAP && format != PCAPNG) {
+            throw pcap_error("invalid capture index file");
+        }
+        index.format_ = static_cast<file_format>(format);
+        index.file_size_ = stream.read_le<uint64_t>();
+        index.packet_count_ = stream.read_le<uint64_t>();
+        index.interval_ = stream.read_le<uint32_t>();
+        if (index.interval_ == 0) {
+            throw malformed_packet();
+        }
+        const uint32_t section_count = stream.read_le<uint32_t>();
+        for (uint32_t i = 0; i < section_count; ++i) {
+            section current;
+            current.offset = stream.read_le<uint64_t>();
+            const uint32_t interface_count = stream.read_le<uint32_t>();
+            if (!stream.can_read(static_cast<uint64_t>(interface_count) * sizeof(uint64_t))) {
+                throw malformed_packet();
+            }
+            current.interface_offsets.resize(interface_count);
+            for (uint32_t j = 0; j < interface_count; ++j) {
+                current.interface_offsets[j] = stream.read_le<uint64_t>();
+            }
+            index.sections_.push_back(current);
+        }
+        const uint64_t checkpoint_count = stream.read_le<uint64_t>();
+        if (checkpoint_count != stream.size() / capture_index_checkpoint_size) {
+            throw malformed_packet();
+        }
+        index.checkpoints_.resize(static_cast<size_t>(checkpoint_count));
+        for (size_t i = 0; i < index.checkpoints_.size(); ++i) {
+            checkpoint& point = index.checkpoints_[i];
+            point.timestamp = timestamp_from_microseconds(stream.read_le<uint64_t>());
+            point.packet_number = stream.read_le<uint64_t>();
+            point.offset = stream.read_le<uint64_t>();
+            point.section = stream.read_le<uint32_t>();
+            if (index.format_ == PCAPNG && point.section >= index.sections_.size()) {
+                throw malformed_packet();
+            }
+        }
+    }
+    catch (malformed_packet&) {
+        throw pcap_error("invalid capture index file");
+    }
+    return index;
+}
+
+void CaptureIndex::save(const string& file_name) const {
+    size_t total_size = capture_index_header_size + sizeof(uint64_t) + 
+                        checkpoints_.size() * capture_index_checkpoint_size;
+    for (size_t i = 0; i < sections_.size(); ++i) {
+        total_size += sizeof(uint64_t) + sizeof(uint32_t) + 
+                      sections_[i].interface_offsets.size() * sizeof(uint64_t);
+    }
+    vector<uint8_t> buffer(total_size);
+    OutputMemoryStream stream(buffer);
+    stream.write(capture_index_magic, sizeof(capture_index_magic));
+    stream.write_le(capture_index_version);
+    stream.write_le(static_cast<uint32_t>(format_));
+    stream.write_le(file_size_);
+    stream.write_le(packet_count_);
+    stream.write_le(interval_);
+    stream.write_le(static_cast<uint32_t>(sections_.size()));
+    for (size_t i = 0; i < sections_.size(); ++i) {
+        const vector<uint64_t>& interface_offsets = sections_[i].interface_offsets;
+        stream.write_le(sections_[i].offset);
+        stream.write_le(static_cast<uint32_t>(interface_offsets.size()));
+        for (size_t j = 0; j < interface_offsets.size(); ++j) {
+            stream.write_le(interface_offsets[j]);
+        }
+    }
+    stream.write_le(static_cast<uint64_t>(checkpoints_.size()));
+    for (size_t i = 0; i < checkpoints_.size(); ++i) {
+        const checkpoint& point = checkpoints_[i];
+        stream.write_le(timestamp_to_microseconds(point.timestamp));
+        stream.write_le(point.packet_number);
+        stream.write_le(point.offset);
+        stream.write_le(point.section);
+    }
+
+    ofstream output(file_name.c_str(), ios::binary | ios::trunc);
+    if (!output) {
+        throw pcap_error(file_name + ": " + strerror(errno));
+    }
+    output.write(reinterpret_cast<const char*>(&buffer[0]), buffer.size());
+    output.close();
+    if (!output) {
+        throw pcap_error(file_name + ": failed to write capture index");
+    }
+}
+
+const CaptureIndex::checkpoint* CaptureIndex::find_timestamp(const Timestamp& timestamp) const {
+    if (checkpoints_.empty()) {
+        return 0;
+    }
+    // Checkpoint timestamps never decrease. Look for the last one that is 
+    // older than the timestamp: every packet before it is older as well
+    const uint64_t value = timestamp_to_microseconds(timestamp);
+    size_t low = 0;
+    size_t high = checkpoints_.size();
+    while (low < high) {
+        const size_t middle = low + (high - low) / 2;
+        if (timestamp_to_microseconds(checkpoints_[middle].timestamp) < value) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+    return &checkpoints_[low == 0 ? 0 : low - 1];
+}
+
+const CaptureIndex::checkpoint* CaptureIndex::find_packet(uint64_t packet_number) const {
+    if (checkpoints_.empty()) {
+        return 0;
+    }
+    size_t index = static_cast<size_t>(packet_number / interval_);
+    return &checkpoints_[std::min(index, checkpoints_.size() - 1)];
+}
+
+CaptureIndex::file_format CaptureIndex::format() const {
+    return format_;
+}
+
+uint64_t CaptureIndex::file_size() const {
+    return file_size_;
+}
+
+uint64_t CaptureIndex::packet_count() const {
+    return packet_count_;
+}
+
+uint32_t CaptureIndex::interval() const {
+    return interval_;
+}
+
+const CaptureIndex::checkpoints_type& CaptureIndex::checkpoints() const {
+    return checkpoints_;
+}
+
+const CaptureIndex::sections_type& CaptureIndex::sections() const {
+    return sections_;
+}
+
+} // Tins
+
+#endif // TINS_HAVE_PCAP
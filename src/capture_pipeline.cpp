@@ -0,0 +1,451 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <tins/capture_pipeline.h>
+
+#if defined(TINS_HAVE_PCAP) && defined(TINS_HAVE_CXX11)
+
+#include <thread>
+#include <chrono>
+#include <stdexcept>
+#include <tins/packet_view.h>
+#include <tins/pdu_arena.h>
+#include <tins/detail/sniffer_helpers.h>
+#include <tins/detail/pdu_helpers.h>
+
+using std::vector;
+using std::thread;
+using std::mutex;
+using std::lock_guard;
+using std::exception_ptr;
+using std::memory_order_relaxed;
+using std::memory_order_acquire;
+using std::memory_order_release;
+
+using Tins::Internals::read_be_field;
+
+namespace Tins {
+
+const uint32_t CapturePipeline::DEFAULT_QUEUE_SIZE = 4096;
+
+// A single producer, single consumer ring of frames
+struct CapturePipeline::worker {
+    struct slot {
+        vector<uint8_t> data;
+        uint32_t original_size;
+        struct timeval ts;
+    };
+
+    worker(uint32_t size)
+    : slots(size), mask(size - 1), head(0), cached_head(0), tail(0),
+      enqueued(0), dropped(0) {
+
+    }
+
+    uint32_t depth() const {
+        return static_cast<uint32_t>(tail.load(memory_order_relaxed) - 
+                                     head.load(memory_order_relaxed));
+    }
+
+    vector<slot> slots;
+    const uint32_t mask;
+    callback_type callback;
+    thread worker_thread;
+    // Keep the consumer and producer indexes on different cache lines
+    char padding0[64];
+    std::atomic<uint64_t> head;
+    char padding1[64];
+    uint64_t cached_head;
+    std::atomic<uint64_t> tail;
+    std::atomic<uint64_t> enqueued;
+    std::atomic<uint64_t> dropped;
+};
+
+static uint32_t round_up_power_of_2(uint32_t value) {
+    uint32_t output = 1;
+    while (output < value) {
+        output <<= 1;
+    }
+    return output;
+}
+
+// Idle workers yield for a while before they start sleeping
+static void wait_for_frames(unsigned& idle_iterations) {
+    if (++idle_iterations < 64) {
+        std::this_thread::yield();
+    }
+    else {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+}
+
+CapturePipeline::CapturePipeline(uint32_t worker_count, uint32_t queue_size)
+: stopped_(false), finishing_(false), queue_size_(round_up_power_of_2(queue_size)),
+  link_type_(0), running_(false), use_pdu_arena_(false) {
+    if (worker_count == 0) {
+        throw std::runtime_error("Worker count cannot be 0");
+    }
+    for (uint32_t i = 0; i < worker_count; ++i) {
+        workers_.emplace_back(new worker(queue_size_));
+    }
+}
+
+CapturePipeline::~CapturePipeline() {
+    if (running_) {
+        stop();
+        try {
+            finish();
+        }
+        catch (...) {
+
+        }
+    }
+}
+
+void CapturePipeline::start_workers(int link_type, vector<callback_type>& callbacks) {
+    if (running_) {
+        throw std::runtime_error("The pipeline is already running");
+    }
+    // Make sure we know how to parse these frames before starting
+    Internals::sniff_handler_from_link_type(link_type, false);
+    link_type_ = link_type;
+    stopped_ = false;
+    finishing_ = false;
+    error_ = exception_ptr();
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        worker& current = *workers_[i];
+        current.callback.swap(callbacks[i]);
+        current.head = 0;
+        current.cached_head = 0;
+        current.tail = 0;
+        current.worker_thread = thread(&CapturePipeline::run_worker, this, std::ref(current));
+    }
+    running_ = true;
+}
+
+void CapturePipeline::run_worker(worker& current) {
+    pcap_handler handler = Internals::sniff_handler_from_link_type(link_type_, false);
+    // If packets are released before the next one is parsed, the arena 
+    // keeps reusing the same memory
+    std::unique_ptr<PDUArena> arena;
+    std::unique_ptr<PDUArena::scope> use_arena;
+    if (use_pdu_arena_) {
+        arena.reset(new PDUArena());
+        use_arena.reset(new PDUArena::scope(*arena));
+    }
+    unsigned idle_iterations = 0;
+    while (true) {
+        const uint64_t head = current.head.load(memory_order_relaxed);
+        if (head == current.tail.load(memory_order_acquire)) {
+            // The producer is done once finishing_ is set, so check the
+            // queue once more after seeing it
+            if (finishing_.load(memory_order_acquire) && 
+                head == current.tail.load(memory_order_acquire)) {
+                return;
+            }
+            wait_for_frames(idle_iterations);
+            continue;
+        }
+        idle_iterations = 0;
+
+        worker::slot& frame = current.slots[head & current.mask];
+        pcap_pkthdr header;
+        header.ts = frame.ts;
+        header.caplen = static_cast<bpf_u_int32>(frame.data.size());
+        header.len = frame.original_size;
+        Internals::sniff_data data;
+        handler((u_char*)&data, &header, frame.data.data());
+        // The PDU holds its own copy of the data, so the slot can be reused
+        Internals::own_raw_payloads(data.pdu);
+        current.head.store(head + 1, memory_order_release);
+
+        // Skip malformed packets
+        if (!data.pdu) {
+            continue;
+        }
+        Packet packet(data.pdu, data.tv, Packet::own_pdu());
+        try {
+            if (!current.callback(packet)) {
+                stop();
+                return;
+            }
+        }
+        catch (malformed_packet&) { }
+        catch (pdu_not_found&) { }
+        catch (...) {
+            set_error(std::current_exception());
+            return;
+        }
+    }
+}
+
+bool CapturePipeline::push(const RawPacket& frame) {
+    return enqueue(frame, false);
+}
+
+bool CapturePipeline::enqueue(const RawPacket& frame, bool wait) {
+    const uint32_t hash = flow_hash(frame.data(), frame.size(), link_type_);
+    worker& current = *workers_[hash % workers_.size()];
+    const uint64_t tail = current.tail.load(memory_order_relaxed);
+    // Only look at the consumer's index when the queue looks full
+    unsigned idle_iterations = 0;
+    while (tail - current.cached_head >= current.slots.size()) {
+        current.cached_head = current.head.load(memory_order_acquire);
+        if (tail - current.cached_head < current.slots.size()) {
+            break;
+        }
+        if (!wait || stopped_.load(memory_order_relaxed)) {
+            current.dropped.store(current.dropped.load(memory_order_relaxed) + 1, 
+                                  memory_order_relaxed);
+            return false;
+        }
+        wait_for_frames(idle_iterations);
+    }
+    worker::slot& slot = current.slots[tail & current.mask];
+    slot.data.assign(frame.data(), frame.data() + frame.size());
+    slot.original_size = frame.original_size();
+    slot.ts.tv_sec = frame.timestamp().seconds();
+    slot.ts.tv_usec = frame.timestamp().microseconds();
+    current.tail.store(tail + 1, memory_order_release);
+    current.enqueued.store(current.enqueued.load(memory_order_relaxed) + 1, 
+                           memory_order_relaxed);
+    return true;
+}
+
+void CapturePipeline::finish() {
+    if (!running_) {
+        return;
+    }
+    finishing_.store(true, memory_order_release);
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        workers_[i]->worker_thread.join();
+        workers_[i]->callback = callback_type();
+    }
+    running_ = false;
+    if (error_) {
+        exception_ptr error = error_;
+        error_ = exception_ptr();
+        std::rethrow_exception(error);
+    }
+}
+
+void CapturePipeline::stop() {
+    stopped_ = true;
+    lock_guard<mutex> _(lock_);
+    if (capture_stopper_) {
+        capture_stopper_();
+    }
+}
+
+void CapturePipeline::set_capture_stopper(const std::function<void()>& stopper) {
+    lock_guard<mutex> _(lock_);
+    capture_stopper_ = stopper;
+}
+
+void CapturePipeline::set_error(exception_ptr error) {
+    {
+        lock_guard<mutex> _(lock_);
+        if (!error_) {
+            error_ = error;
+        }
+    }
+    stop();
+}
+
+struct pipeline_capture_data {
+    CapturePipeline* pipeline;
+    bool wait;
+};
+
+void CapturePipeline::capture_handler(u_char* user, const struct pcap_pkthdr* h, 
+                                      const u_char* bytes) {
+    pipeline_capture_data* data = (pipeline_capture_data*)user;
+    data->pipeline->enqueue(RawPacket(bytes, h->caplen, h->len, h->ts), data->wait);
+}
+
+void CapturePipeline::capture(BaseSniffer& sniffer) {
+    pcap_t* handle = sniffer.get_pcap_handle();
+    const bool offline = pcap_file(handle) != 0;
+    // Don't drop frames when reading files, there's no hurry
+    pipeline_capture_data data = { this, offline };
+    set_capture_stopper([&]() { sniffer.stop_sniff(); });
+    while (!stopped_) {
+        const int result = pcap_dispatch(handle, -1, &capture_handler, (u_char*)&data);
+        // Either an error occurred, stop_sniff was called or we're done 
+        // reading a file
+        if (result < 0 || (result == 0 && offline)) {
+            break;
+        }
+    }
+    set_capture_stopper(std::function<void()>());
+}
+
+#ifdef TINS_HAVE_PACKET_RING
+
+void CapturePipeline::capture(RingSniffer& sniffer) {
+    set_capture_stopper([&]() { sniffer.stop_sniff(); });
+    RawPacket frame;
+    while (!stopped_ && sniffer.next_frame(frame)) {
+        enqueue(frame, false);
+    }
+    set_capture_stopper(std::function<void()>());
+}
+
+#endif // TINS_HAVE_PACKET_RING
+
+CapturePipeline::statistics CapturePipeline::stats(uint32_t worker_index) const {
+    const worker& current = *workers_.at(worker_index);
+    statistics output;
+    output.enqueued = current.enqueued.load(memory_order_relaxed);
+    output.dropped = current.dropped.load(memory_order_relaxed);
+    output.queue_depth = current.depth();
+    return output;
+}
+
+uint32_t CapturePipeline::worker_count() const {
+    return static_cast<uint32_t>(workers_.size());
+}
+
+void CapturePipeline::set_use_pdu_arena(bool value) {
+    use_pdu_arena_ = value;
+}
+
+// FNV-1a over an address and a port
+static uint32_t hash_endpoint(const uint8_t* address, uint32_t size, uint16_t port) {
+    uint32_t output = 2166136261u;
+    for (uint32_t i = 0; i < size; ++i) {
+        output = (output ^ address[i]) * 16777619u;
+    }
+    output = (output ^ (port >> 8)) * 16777619u;
+    return (output ^ (port & 0xff)) * 16777619u;
+}
+
+static uint32_t finalize_hash(uint32_t value) {
+    value ^= value >> 16;
+    value *= 0x85ebca6b;
+    value ^= value >> 13;
+    value *= 0xc2b2ae35;
+    return value ^ (value >> 16);
+}
+
+uint32_t CapturePipeline::flow_hash(const uint8_t* data, uint32_t size, int link_type) {
+    uint32_t offset = 0;
+    uint16_t ether_type = 0;
+    switch (link_type) {
+        case DLT_EN10MB:
+            offset = 14;
+            if (size < offset) {
+                return 0;
+            }
+            ether_type = read_be_field<uint16_t>(data + 12);
+            // Skip any VLAN tags
+            while ((ether_type == 0x8100 || ether_type == 0x88a8) && size >= offset + 4) {
+                ether_type = read_be_field<uint16_t>(data + offset + 2);
+                offset += 4;
+            }
+            break;
+        case DLT_LINUX_SLL:
+            offset = 16;
+            if (size < offset) {
+                return 0;
+            }
+            ether_type = read_be_field<uint16_t>(data + 14);
+            break;
+        case DLT_NULL:
+        case DLT_LOOP:
+            offset = 4;
+            break;
+        case DLT_RAW:
+            break;
+        default:
+            return 0;
+    };
+    if (ether_type != 0 && ether_type != 0x0800 && ether_type != 0x86dd) {
+        return 0;
+    }
+    if (size <= offset) {
+        return 0;
+    }
+    const uint8_t* network = data + offset;
+    const uint32_t network_size = size - offset;
+    const uint8_t* src_addr = 0;
+    const uint8_t* dst_addr = 0;
+    const uint8_t* transport = 0;
+    uint32_t address_size = 0;
+    uint32_t transport_size = 0;
+    uint8_t protocol = 0;
+    switch (network[0] >> 4) {
+        case 4:
+            {
+                const uint32_t header_size = (network[0] & 0x0f) * 4;
+                if (network_size < 20) {
+                    return 0;
+                }
+                protocol = network[9];
+                src_addr = network + 12;
+                dst_addr = network + 16;
+                address_size = 4;
+                // Fragments don't carry ports, so ignore them on every 
+                // fragment of a datagram
+                const uint16_t fragment = read_be_field<uint16_t>(network + 6);
+                if ((fragment & 0x3fff) == 0 && network_size >= header_size) {
+                    transport = network + header_size;
+                    transport_size = network_size - header_size;
+                }
+            }
+            break;
+        case 6:
+            if (network_size < 40) {
+                return 0;
+            }
+            protocol = network[6];
+            src_addr = network + 8;
+            dst_addr = network + 24;
+            address_size = 16;
+            transport = network + 40;
+            transport_size = network_size - 40;
+            break;
+        default:
+            return 0;
+    };
+    uint16_t sport = 0;
+    uint16_t dport = 0;
+    // TCP, UDP and SCTP all start with the source and destination ports
+    if (transport_size >= 4 && (protocol == 6 || protocol == 17 || protocol == 132)) {
+        sport = read_be_field<uint16_t>(transport);
+        dport = read_be_field<uint16_t>(transport + 2);
+    }
+    // Adding both endpoints' hashes makes this symmetric
+    return finalize_hash(hash_endpoint(src_addr, address_size, sport) + 
+                         hash_endpoint(dst_addr, address_size, dport) + protocol);
+}
+
+} // Tins
+
+#endif // TINS_HAVE_PCAP && TINS_HAVE_CXX11
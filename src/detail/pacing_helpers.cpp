@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <tins/detail/pacing_helpers.h>
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <time.h>
+#endif // _WIN32
+
+namespace Tins {
+namespace Internals {
+
+// How long before the deadline to stop sleeping and start spinning, in 
+// nanoseconds. Sleeps overshoot by about this much
+#ifdef _WIN32
+static const uint64_t pacing_spin_time = 2000000;
+#else
+static const uint64_t pacing_spin_time = 100000;
+#endif // _WIN32
+
+uint64_t pacing_now() {
+    #ifdef _WIN32
+        LARGE_INTEGER counter;
+        LARGE_INTEGER frequency;
+        QueryPerformanceCounter(&counter);
+        QueryPerformanceFrequency(&frequency);
+        return static_cast<uint64_t>(counter.QuadPart / frequency.QuadPart * 1000000000ULL +
+            counter.QuadPart % frequency.QuadPart * 1000000000ULL / frequency.QuadPart);
+    #else
+        timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + now.tv_nsec;
+    #endif // _WIN32
+}
+
+void pacing_wait_until(uint64_t deadline) {
+    const uint64_t now = pacing_now();
+    if (deadline > now + pacing_spin_time) {
+        const uint64_t sleep_time = deadline - now - pacing_spin_time;
+        #ifdef _WIN32
+            Sleep(static_cast<DWORD>(sleep_time / 1000000));
+        #else
+            timespec duration;
+            duration.tv_sec = static_cast<time_t>(sleep_time / 1000000000ULL);
+            duration.tv_nsec = static_cast<long>(sleep_time % 1000000000ULL);
+            nanosleep(&duration, 0);
+        #endif // _WIN32
+    }
+    while (pacing_now() < deadline) {
+
+    }
+}
+
+} // Internals
+} // Tins
@@ -89,7 +89,7 @@ Tins::PDU* pdu_from_flag(Constants::Ethernet::e flag,
                     return pdu;
                 }
             }
-            return rawpdu_on_no_match ? new RawPDU(buffer, size) : 0;
+            return rawpdu_on_no_match ? raw_pdu_from_buffer(buffer, size) : 0;
     };
 }
 
@@ -118,7 +118,7 @@ Tins::PDU* pdu_from_flag(Constants::IP::e flag,
             break;
     }
     if (rawpdu_on_no_match) {
-        return new Tins::RawPDU(buffer, size);
+        return raw_pdu_from_buffer(buffer, size);
     }
     return 0;
 }
@@ -150,7 +150,7 @@ PDU* pdu_from_dlt_flag(int flag,
         case DLT_PPI:
             return new PPI(buffer, size);
         default:
-            return rawpdu_on_no_match ? new RawPDU(buffer, size) : 0;
+            return rawpdu_on_no_match ? raw_pdu_from_buffer(buffer, size) : 0;
     };
 }
 #endif // TINS_HAVE_PCAP
@@ -201,6 +201,24 @@ Tins::PDU* pdu_from_flag(PDU::PDUType type, const uint8_t* buffer, uint32_t size
     };
 }
 
+RawPDU* raw_pdu_from_buffer(const uint8_t* buffer, uint32_t size) {
+    if (RawPDU::borrowing()) {
+        return new RawPDU(buffer, size, RawPDU::borrow_tag());
+    }
+    return new RawPDU(buffer, size);
+}
+
+void own_raw_payloads(PDU* pdu) {
+    if (!RawPDU::borrowing()) {
+        return;
+    }
+    for (; pdu; pdu = pdu->inner_pdu()) {
+        if (pdu->pdu_type() == PDU::RAW) {
+            static_cast<RawPDU*>(pdu)->own();
+        }
+    }
+}
+
 Constants::Ethernet::e pdu_flag_to_ether_type(PDU::PDUType flag) {
     switch (flag) {
         case PDU::IP:
@@ -65,25 +65,35 @@ DHCP::DHCP(const uint8_t* buffer, uint32_t total_sz)
     if (magic_number != Endian::host_to_be<uint32_t>(0x63825363)) {
         throw malformed_packet();
     }
-    // While there's data left
-    while (stream) {
-        OptionTypes option_type;
-        uint8_t option_length = 0;
-        option_type = (OptionTypes)stream.read<uint8_t>();
-        // We should only read the length if it's not END nor PAD
-        if (option_type != END && option_type != PAD) {
-            option_length = stream.read<uint8_t>();
-        }
-        // Make sure we can read the payload size
-        if (!stream.can_read(option_length)) {
+    Internals::parse_options(stream.pointer(), stream.pointer() + stream.size(), options_,
+                             raw_options_, &DHCP::parse_option_view);
+    const option_views_type views = option_views();
+    for (option_views_type::iterator it = views.begin(); it != views.end(); ++it) {
+        size_ += static_cast<uint32_t>(it->data_size() + (sizeof(uint8_t) << 1));
+    }
+}
+
+const uint8_t* DHCP::parse_option_view(const uint8_t* ptr, const uint8_t* end,
+                                       PDUOptionView<option>& view) {
+    const uint8_t option_type = *ptr++;
+    uint8_t option_length = 0;
+    // We should only read the length if it's not END nor PAD
+    if (option_type != END && option_type != PAD) {
+        if (TINS_UNLIKELY(ptr == end)) {
             throw malformed_packet();
         }
-        add_option(option(option_type, option_length, stream.pointer()));
-        stream.skip(option_length);
+        option_length = *ptr++;
+    }
+    // Make sure we can read the payload size
+    if (TINS_UNLIKELY(end - ptr < option_length)) {
+        throw malformed_packet();
     }
+    view = PDUOptionView<option>(option_type, ptr, option_length, option_length);
+    return ptr + option_length;
 }
 
 void DHCP::add_option(const option& opt) {
+    materialize_options();
     internal_add_option(opt);
     options_.push_back(opt);
 }
@@ -109,10 +119,12 @@ const DHCP::option* DHCP::search_option(OptionTypes opt) const {
 }
 
 DHCP::options_type::const_iterator DHCP::search_option_iterator(OptionTypes opt) const {
+    materialize_options();
     return Internals::find_option_const<option>(options_, opt);
 }
 
 DHCP::options_type::iterator DHCP::search_option_iterator(OptionTypes opt) {
+    materialize_options();
     return Internals::find_option<option>(options_, opt);
 }
 
@@ -248,7 +260,8 @@ void DHCP::write_serialization(uint8_t* buffer, uint32_t total_sz) {
         OutputMemoryStream stream(&result[0], result.size());
         // Magic cookie
         stream.write(Endian::host_to_be<uint32_t>(0x63825363));
-        for (options_type::const_iterator it = options_.begin(); it != options_.end(); ++it) {
+        const option_views_type views = option_views();
+        for (option_views_type::iterator it = views.begin(); it != views.end(); ++it) {
             stream.write(it->option());
             stream.write<uint8_t>(it->length_field());
             stream.write(it->data_ptr(), it->data_size());
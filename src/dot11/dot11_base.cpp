@@ -81,19 +81,32 @@ void Dot11::write_fixed_parameters(Memory::OutputMemoryStream& /*stream*/) {
 
 void Dot11::parse_tagged_parameters(InputMemoryStream& stream) {
     if (stream) {
-        while (stream.size() >= 2) {
-            OptionTypes opcode = static_cast<OptionTypes>(stream.read<uint8_t>());
-            uint8_t length = stream.read<uint8_t>();
-            if (!stream.can_read(length)) {
-                throw malformed_packet();
-            }
-            add_tagged_option(opcode, length, stream.pointer());
-            stream.skip(length);
+        Internals::parse_options(stream.pointer(), stream.pointer() + stream.size(), options_,
+                                 raw_options_, &Dot11::parse_option_view);
+        const option_views_type views = option_views();
+        for (option_views_type::iterator it = views.begin(); it != views.end(); ++it) {
+            options_size_ += static_cast<uint32_t>(it->data_size() + sizeof(uint8_t) * 2);
         }
     }
 }
 
+const uint8_t* Dot11::parse_option_view(const uint8_t* ptr, const uint8_t* end,
+                                        PDUOptionView<option>& view) {
+    // Trailing bytes that can't hold an option are ignored
+    if (end - ptr < 2) {
+        return 0;
+    }
+    const uint8_t opcode = *ptr++;
+    const uint8_t length = *ptr++;
+    if (TINS_UNLIKELY(end - ptr < length)) {
+        throw malformed_packet();
+    }
+    view = PDUOptionView<option>(opcode, ptr, length, length);
+    return ptr + length;
+}
+
 void Dot11::add_tagged_option(OptionTypes opt, uint8_t len, const uint8_t* val) {
+    materialize_options();
     uint32_t opt_size = len + sizeof(uint8_t) * 2;
     options_.push_back(option((uint8_t)opt, val, val + len));
     options_size_ += opt_size;
@@ -114,6 +127,7 @@ bool Dot11::remove_option(OptionTypes type) {
 }
 
 void Dot11::add_option(const option& opt) {
+    materialize_options();
     internal_add_option(opt);
     options_.push_back(opt);
 }
@@ -125,10 +139,12 @@ const Dot11::option* Dot11::search_option(OptionTypes type) const {
 }
 
 Dot11::options_type::const_iterator Dot11::search_option_iterator(OptionTypes type) const {
+    materialize_options();
     return Internals::find_option_const<option>(options_, type);
 }
 
 Dot11::options_type::iterator Dot11::search_option_iterator(OptionTypes type) {
+    materialize_options();
     return Internals::find_option<option>(options_, type);
 }
 
@@ -216,7 +232,8 @@ void Dot11::write_serialization(uint8_t* buffer, uint32_t total_sz) {
     stream.write(header_);
     write_ext_header(stream);
     write_fixed_parameters(stream);
-    for (vector<option>::const_iterator it = options_.begin(); it != options_.end(); ++it) {
+    const option_views_type views = option_views();
+    for (option_views_type::iterator it = views.begin(); it != views.end(); ++it) {
         stream.write<uint8_t>(it->option());
         stream.write<uint8_t>(it->length_field());
         stream.write(it->data_ptr(), it->data_size());
@@ -34,6 +34,7 @@
 #include <tins/rawpdu.h>
 #include <tins/snap.h>
 #include <tins/memory_helpers.h>
+#include <tins/detail/pdu_helpers.h>
 
 using Tins::Memory::InputMemoryStream;
 using Tins::Memory::OutputMemoryStream;
@@ -50,7 +51,7 @@ Dot11Data::Dot11Data(const uint8_t* buffer, uint32_t total_sz)
     if (stream) {
         // If the wep bit is on, then just use a RawPDU
         if (wep()) {
-            inner_pdu(new Tins::RawPDU(stream.pointer(), stream.size()));
+            inner_pdu(Internals::raw_pdu_from_buffer(stream.pointer(), stream.size()));
         }
         else {
             inner_pdu(new Tins::SNAP(stream.pointer(), stream.size()));
@@ -139,7 +140,7 @@ Dot11QoSData::Dot11QoSData(const uint8_t* buffer, uint32_t total_sz)
     if (stream) {
         // If the wep bit is on, then just use a RawPDU
         if (wep()) {
-            inner_pdu(new Tins::RawPDU(stream.pointer(), stream.size()));
+            inner_pdu(Internals::raw_pdu_from_buffer(stream.pointer(), stream.size()));
         }
         else {
             inner_pdu(new Tins::SNAP(stream.pointer(), stream.size()));
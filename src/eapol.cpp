@@ -32,6 +32,7 @@
 #include <tins/exceptions.h>
 #include <tins/rawpdu.h>
 #include <tins/memory_helpers.h>
+#include <tins/detail/pdu_helpers.h>
 
 using std::memset;
 using std::memcpy;
@@ -123,7 +124,7 @@ RC4EAPOL::RC4EAPOL(const uint8_t* buffer, uint32_t total_sz)
     if (stream.size() >= key_length()) {
         stream.read(key_, key_length());
         if (stream) {
-            inner_pdu(new RawPDU(stream.pointer(), stream.size()));
+            inner_pdu(Internals::raw_pdu_from_buffer(stream.pointer(), stream.size()));
         }
     }
 }
@@ -184,7 +185,7 @@ RSNEAPOL::RSNEAPOL(const uint8_t* buffer, uint32_t total_sz)
     if (stream.size() >= wpa_length()) {
         stream.read(key_, wpa_length());
         if (stream) {
-            inner_pdu(new RawPDU(stream.pointer(), stream.size()));
+            inner_pdu(Internals::raw_pdu_from_buffer(stream.pointer(), stream.size()));
         }
     }
 }
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <tins/fanout_sniffer.h>
+
+#ifdef TINS_HAVE_PACKET_RING
+
+#include <atomic>
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+#include <mutex>
+#include <exception>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <linux/if_packet.h>
+
+using std::string;
+using std::vector;
+using std::thread;
+using std::mutex;
+using std::lock_guard;
+using std::exception_ptr;
+
+namespace Tins {
+
+static uint16_t fanout_mode_to_socket_option(FanoutSniffer::FanoutMode mode) {
+    switch (mode) {
+        case FanoutSniffer::HASH:
+            // Reassemble fragments so they're hashed along with their flow
+            return PACKET_FANOUT_HASH | PACKET_FANOUT_FLAG_DEFRAG;
+        case FanoutSniffer::ROUND_ROBIN:
+            return PACKET_FANOUT_LB;
+        case FanoutSniffer::CPU:
+            return PACKET_FANOUT_CPU;
+        default:
+            throw std::runtime_error("Invalid fanout mode");
+    };
+}
+
+static void pin_current_thread(unsigned cpu) {
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu, &cpu_set);
+    // This is best effort: we might not be allowed to run on that CPU
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+}
+
+FanoutSniffer::FanoutSniffer(const string& device, uint32_t worker_count,
+                             FanoutMode mode, 
+                             const SnifferConfiguration& configuration)
+: group_id_(0) {
+    if (worker_count == 0) {
+        throw std::runtime_error("Worker count cannot be 0");
+    }
+    const uint16_t fanout_option = fanout_mode_to_socket_option(mode);
+    for (uint32_t i = 0; i < worker_count; ++i) {
+        sniffers_.emplace_back(new RingSniffer(device, configuration));
+        // The first worker creates the group, so its id is not used elsewhere
+        if (i == 0) {
+            group_id_ = sniffers_.back()->create_fanout_group(fanout_option);
+        }
+        else {
+            sniffers_.back()->join_fanout_group(group_id_, fanout_option);
+        }
+    }
+    const unsigned cpu_count = std::max(thread::hardware_concurrency(), 1u);
+    for (unsigned i = 0; i < cpu_count; ++i) {
+        cpus_.push_back(i);
+    }
+}
+
+void FanoutSniffer::run_workers(const worker_function& function) {
+    vector<thread> threads;
+    mutex error_lock;
+    exception_ptr error;
+    try {
+        for (size_t i = 0; i < sniffers_.size(); ++i) {
+            RingSniffer* sniffer = sniffers_[i].get();
+            const bool pin = !cpus_.empty();
+            const unsigned cpu = pin ? cpus_[i % cpus_.size()] : 0;
+            threads.emplace_back([&, sniffer, pin, cpu]() {
+                if (pin) {
+                    pin_current_thread(cpu);
+                }
+                try {
+                    function(*sniffer);
+                }
+                catch (...) {
+                    {
+                        lock_guard<mutex> _(error_lock);
+                        if (!error) {
+                            error = std::current_exception();
+                        }
+                    }
+                    stop_sniff();
+                }
+            });
+        }
+    }
+    catch (...) {
+        // Destroying a joinable thread terminates the program
+        stop_sniff();
+        for (size_t i = 0; i < threads.size(); ++i) {
+            threads[i].join();
+        }
+        throw;
+    }
+    for (size_t i = 0; i < threads.size(); ++i) {
+        threads[i].join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void FanoutSniffer::stop_sniff() {
+    for (size_t i = 0; i < sniffers_.size(); ++i) {
+        sniffers_[i]->stop_sniff();
+    }
+}
+
+void FanoutSniffer::set_cpu_affinity(const vector<unsigned>& cpus) {
+    cpus_ = cpus;
+}
+
+uint32_t FanoutSniffer::worker_count() const {
+    return static_cast<uint32_t>(sniffers_.size());
+}
+
+RingSniffer& FanoutSniffer::worker(uint32_t index) {
+    return *sniffers_.at(index);
+}
+
+uint16_t FanoutSniffer::group_id() const {
+    return group_id_;
+}
+
+} // Tins
+
+#endif // TINS_HAVE_PACKET_RING
@@ -35,6 +35,7 @@
 #include <tins/exceptions.h>
 #include <tins/icmp.h>
 #include <tins/memory_helpers.h>
+#include <tins/detail/pdu_helpers.h>
 #include <tins/detail/icmp_extension_helpers.h>
 #include <tins/utils/checksum_utils.h>
 
@@ -73,7 +74,7 @@ ICMP::ICMP(const uint8_t* buffer, uint32_t total_sz)
     // Attempt to parse ICMP extensions
     try_parse_extensions(stream);
     if (stream) {
-        inner_pdu(new RawPDU(stream.pointer(), stream.size()));
+        inner_pdu(Internals::raw_pdu_from_buffer(stream.pointer(), stream.size()));
     }
 }
 
@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <tins/indexed_file_reader.h>
+
+#ifdef TINS_HAVE_PCAP
+
+#include <vector>
+#include <tins/mapped_file_sniffer.h>
+#include <tins/pcapng_reader.h>
+#include <tins/detail/sniffer_helpers.h>
+#include <tins/detail/pdu_helpers.h>
+
+using std::string;
+using std::vector;
+
+namespace Tins {
+
+IndexedFileReader::IndexedFileReader(const string& file_name, const CaptureIndex& index)
+: index_(index), pcap_reader_(0), pcapng_reader_(0), packet_number_(0), 
+  has_pending_frame_(false), extract_raw_(false) {
+    uint64_t file_size;
+    const CaptureIndex::file_format format = CaptureIndex::detect_format(file_name, file_size);
+    if (format != index_.format() || file_size != index_.file_size()) {
+        throw pcap_error("capture index doesn't match " + file_name);
+    }
+    if (format == CaptureIndex::PCAPNG) {
+        pcapng_reader_ = new PcapngReader(file_name);
+    }
+    else {
+        pcap_reader_ = new MappedFileSniffer(file_name);
+    }
+}
+
+IndexedFileReader::~IndexedFileReader() {
+    delete pcap_reader_;
+    delete pcapng_reader_;
+}
+
+void IndexedFileReader::restore(const CaptureIndex::checkpoint& point) {
+    if (pcapng_reader_) {
+        // Parse the section header and the interfaces described before the 
+        // checkpoint so packets are decoded just like on a sequential read
+        const CaptureIndex::section& section = index_.sections()[point.section];
+        vector<uint64_t> interface_offsets;
+        for (size_t i = 0; i < section.interface_offsets.size(); ++i) {
+            if (section.interface_offsets[i] < point.offset) {
+                interface_offsets.push_back(section.interface_offsets[i]);
+            }
+        }
+        pcapng_reader_->restore_section(section.offset, interface_offsets);
+        pcapng_reader_->seek(point.offset);
+    }
+    else {
+        pcap_reader_->seek(point.offset);
+    }
+    packet_number_ = point.packet_number;
+    has_pending_frame_ = false;
+}
+
+bool IndexedFileReader::read_frame(RawPacket& frame) {
+    if (pcapng_reader_) {
+        return pcapng_reader_->next_frame(frame);
+    }
+    return pcap_reader_->next_frame(frame);
+}
+
+int IndexedFileReader::link_type(const RawPacket& frame) const {
+    if (pcapng_reader_) {
+        return pcapng_reader_->interfaces()[frame.interface_id()].link_type;
+    }
+    return pcap_reader_->link_type();
+}
+
+bool IndexedFileReader::seek(const Timestamp& timestamp) {
+    const CaptureIndex::checkpoint* point = index_.find_timestamp(timestamp);
+    if (!point) {
+        return false;
+    }
+    restore(*point);
+    const Timestamp::seconds_type seconds = timestamp.seconds();
+    const Timestamp::microseconds_type microseconds = timestamp.microseconds();
+    RawPacket frame;
+    while (read_frame(frame)) {
+        const Timestamp::seconds_type frame_seconds = frame.timestamp().seconds();
+        if (frame_seconds > seconds || (frame_seconds == seconds && 
+            frame.timestamp().microseconds() >= microseconds)) {
+            pending_frame_ = frame;
+            has_pending_frame_ = true;
+            return true;
+        }
+        ++packet_number_;
+    }
+    return false;
+}
+
+bool IndexedFileReader::seek_packet(uint64_t packet_number) {
+    const CaptureIndex::checkpoint* point = index_.find_packet(packet_number);
+    if (!point) {
+        return false;
+    }
+    restore(*point);
+    RawPacket frame;
+    while (read_frame(frame)) {
+        if (packet_number_ == packet_number) {
+            pending_frame_ = frame;
+            has_pending_frame_ = true;
+            return true;
+        }
+        ++packet_number_;
+    }
+    return false;
+}
+
+void IndexedFileReader::rewind() {
+    if (!index_.checkpoints().empty()) {
+        restore(index_.checkpoints()[0]);
+    }
+}
+
+bool IndexedFileReader::next_frame(RawPacket& frame) {
+    if (has_pending_frame_) {
+        frame = pending_frame_;
+        has_pending_frame_ = false;
+    }
+    else if (!read_frame(frame)) {
+        return false;
+    }
+    ++packet_number_;
+    return true;
+}
+
+PtrPacket IndexedFileReader::next_packet() {
+    RawPacket frame;
+    while (next_frame(frame)) {
+        pcap_handler handler = Internals::sniff_handler_from_link_type(link_type(frame),
+                                                                       extract_raw_);
+        pcap_pkthdr header;
+        header.ts.tv_sec = frame.timestamp().seconds();
+        header.ts.tv_usec = frame.timestamp().microseconds();
+        header.caplen = frame.size();
+        header.len = frame.original_size();
+
+        Internals::sniff_data data;
+        handler((u_char*)&data, &header, frame.data());
+        // Skip malformed packets
+        if (data.pdu) {
+            // Mapped pcap files outlive the PDU, but the pcapng reader 
+            // reuses its buffer when the next frame is read
+            if (pcapng_reader_) {
+                Internals::own_raw_payloads(data.pdu);
+            }
+            return PtrPacket(data.pdu, data.tv, frame.interface_id());
+        }
+    }
+    return PtrPacket(0, Timestamp());
+}
+
+void IndexedFileReader::set_extract_raw_pdus(bool value) {
+    extract_raw_ = value;
+}
+
+uint64_t IndexedFileReader::packet_number() const {
+    return packet_number_;
+}
+
+const CaptureIndex& IndexedFileReader::index() const {
+    return index_;
+}
+
+} // Tins
+
+#endif // TINS_HAVE_PCAP
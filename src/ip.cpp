@@ -62,8 +62,12 @@ PDU::metadata IP::extract_metadata(const uint8_t *buffer, uint32_t total_sz) {
         throw malformed_packet();
     }
     const ip_header* header = (const ip_header*)buffer;
-    PDUType next_type = Internals::ip_type_to_pdu_flag(
-        static_cast<Constants::IP::e>(header->protocol));
+    PDUType next_type = PDU::UNKNOWN;
+    // Fragmented payloads are not parsed, same as when constructing an IP
+    if ((Endian::be_to_host(header->frag_off) & 0x3fff) == 0) {
+        next_type = Internals::ip_type_to_pdu_flag(
+            static_cast<Constants::IP::e>(header->protocol));
+    }
     return metadata(header->ihl * 4, pdu_flag, next_type);
 }
 
@@ -83,43 +87,9 @@ IP::IP(const uint8_t* buffer, uint32_t total_sz) {
         throw malformed_packet();
     }
     const uint8_t* options_end = buffer + head_len() * sizeof(uint32_t);
-    
-    // While the end of the options is not reached read an option
-    while (stream.pointer() < options_end) {
-        option_identifier opt_type = (option_identifier)stream.read<uint8_t>();
-        if (opt_type.number > NOOP) {
-            // Multibyte options with length as second byte
-            const uint32_t option_size = stream.read<uint8_t>();
-            if (TINS_UNLIKELY(option_size < (sizeof(uint8_t) << 1))) {
-                throw malformed_packet();
-            }
-            // The data size is the option size - the identifier and size fields
-            const uint32_t data_size = option_size - (sizeof(uint8_t) << 1);
-            if (data_size > 0) {
-                if (stream.pointer() + data_size > options_end) {
-                    throw malformed_packet();
-                }
-                options_.push_back(
-                    option(opt_type, stream.pointer(), stream.pointer() + data_size)
-                );
-                stream.skip(data_size);
-            }
-            else {
-                options_.push_back(option(opt_type));
-            }
-        }
-        else if (opt_type == END) {
-            // If the end option found, we're done
-            if (TINS_UNLIKELY(stream.pointer() != options_end)) {
-                // Make sure we found the END option at the end of the options list
-                throw malformed_packet();
-            }
-            break;
-        }
-        else {
-            options_.push_back(option(opt_type));
-        }
-    }
+    Internals::parse_options(stream.pointer(), options_end, options_, raw_options_,
+                             &IP::parse_option_view);
+    stream.skip(options_end - stream.pointer());
     if (stream) {
         // Don't avoid consuming more than we should if tot_len is 0,
         // since this is the case when using TCP segmentation offload
@@ -151,13 +121,13 @@ IP::IP(const uint8_t* buffer, uint32_t total_sz) {
                     )
                 );
                 if (!inner_pdu()) {
-                    inner_pdu(new RawPDU(stream.pointer(), total_sz));
+                    inner_pdu(Internals::raw_pdu_from_buffer(stream.pointer(), total_sz));
                 }
             }
         }
         else {
             // It's fragmented, just use RawPDU
-            inner_pdu(new RawPDU(stream.pointer(), total_sz));
+            inner_pdu(Internals::raw_pdu_from_buffer(stream.pointer(), total_sz));
         }
     }
 }
@@ -315,12 +285,14 @@ uint16_t IP::stream_identifier() const {
 }
 
 void IP::add_option(const option& opt) {
+    materialize_options();
     options_.push_back(opt);
 }
 
 uint32_t IP::calculate_options_size() const {
     uint32_t options_size = 0;
-    for (options_type::const_iterator iter = options_.begin(); iter != options_.end(); ++iter) {
+    const option_views_type views = option_views();
+    for (option_views_type::iterator iter = views.begin(); iter != views.end(); ++iter) {
         options_size += sizeof(uint8_t);
         const option_identifier option_id = iter->option();
         // Only add length field and data size for non [NOOP, EOL] options
@@ -331,6 +303,39 @@ uint32_t IP::calculate_options_size() const {
     return options_size;    
 }
 
+const uint8_t* IP::parse_option_view(const uint8_t* ptr, const uint8_t* end,
+                                      PDUOptionView<option>& view) {
+    const option_identifier opt_type = *ptr++;
+    if (opt_type.number > NOOP) {
+        // Multibyte options with length as second byte
+        if (TINS_UNLIKELY(ptr == end)) {
+            throw malformed_packet();
+        }
+        const uint32_t option_size = *ptr++;
+        if (TINS_UNLIKELY(option_size < (sizeof(uint8_t) << 1))) {
+            throw malformed_packet();
+        }
+        // The data size is the option size - the identifier and size fields
+        const uint32_t data_size = option_size - (sizeof(uint8_t) << 1);
+        if (TINS_UNLIKELY(static_cast<uint32_t>(end - ptr) < data_size)) {
+            throw malformed_packet();
+        }
+        view = PDUOptionView<option>(opt_type, ptr, static_cast<uint16_t>(data_size),
+                                     static_cast<uint16_t>(data_size));
+        return ptr + data_size;
+    }
+    else if (opt_type == END) {
+        // If the end option found, we're done. Make sure we found the END 
+        // option at the end of the options list
+        if (TINS_UNLIKELY(ptr != end)) {
+            throw malformed_packet();
+        }
+        return 0;
+    }
+    view = PDUOptionView<option>(opt_type, ptr, 0, 0);
+    return ptr;
+}
+
 uint32_t IP::pad_options_size(uint32_t size) const {
     uint8_t padding = size % 4;
     return padding ? (size - padding + 4) : size;
@@ -351,14 +356,16 @@ const IP::option* IP::search_option(option_identifier id) const {
 }
 
 IP::options_type::const_iterator IP::search_option_iterator(option_identifier id) const {
+    materialize_options();
     return Internals::find_option_const<option>(options_, id);
 }
 
 IP::options_type::iterator IP::search_option_iterator(option_identifier id) {
+    materialize_options();
     return Internals::find_option<option>(options_, id);
 }
 
-void IP::write_option(const option& opt, OutputMemoryStream& stream) {
+void IP::write_option(const PDUOptionView<option>& opt, OutputMemoryStream& stream) {
     stream.write(opt.option());
     // Check what we wrote. We'll do this for any option != [END, NOOP]
     if (*(stream.pointer() - 1) > NOOP) {
@@ -455,7 +462,8 @@ void IP::write_serialization(uint8_t* buffer, uint32_t total_sz) {
     // Restore the fragment offset field in case we flipped it
     header_.frag_off = original_frag_off;
 
-    for (options_type::const_iterator it = options_.begin(); it != options_.end(); ++it) {
+    const option_views_type views = option_views();
+    for (option_views_type::iterator it = views.begin(); it != views.end(); ++it) {
         write_option(*it, stream);
     }
     const uint32_t options_size = calculate_options_size();
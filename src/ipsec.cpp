@@ -115,7 +115,7 @@ IPSecESP::IPSecESP(const uint8_t* buffer, uint32_t total_sz) {
     InputMemoryStream stream(buffer, total_sz);
     stream.read(header_);
     if (stream) {
-        inner_pdu(new RawPDU(stream.pointer(), stream.size()));
+        inner_pdu(Internals::raw_pdu_from_buffer(stream.pointer(), stream.size()));
     }
 }
 
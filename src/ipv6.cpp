@@ -59,15 +59,25 @@ PDU::metadata IPv6::extract_metadata(const uint8_t *buffer, uint32_t total_sz) {
     const ipv6_header* header = (const ipv6_header*)buffer;
     uint32_t header_size = sizeof(ipv6_header);
     uint8_t current_header = header->next_header;
+    bool is_payload_fragmented = false;
     stream.skip(sizeof(ipv6_header));
-    while (is_extension_header(current_header)) {
+    while (is_extension_header(current_header) && current_header != NO_NEXT_HEADER) {
+        if (current_header == FRAGMENT) {
+            is_payload_fragmented = true;
+        }
         current_header = stream.read<uint8_t>();
         const uint32_t ext_size = (static_cast<uint32_t>(stream.read<uint8_t>()) + 1) * 8;
         const uint32_t payload_size = ext_size - sizeof(uint8_t) * 2;
         header_size += ext_size;
         stream.skip(payload_size);
     }
-    return metadata(header_size, pdu_flag, PDU::UNKNOWN);
+    PDUType next_type = PDU::UNKNOWN;
+    // Fragmented payloads are not parsed, same as when constructing an IPv6
+    if (!is_payload_fragmented && current_header != NO_NEXT_HEADER) {
+        next_type = Internals::ip_type_to_pdu_flag(
+            static_cast<Constants::IP::e>(current_header));
+    }
+    return metadata(header_size, pdu_flag, next_type);
 }
 
 IPv6::hop_by_hop_header IPv6::hop_by_hop_header::from_extension_header(const ext_header& hdr) {
@@ -126,6 +136,10 @@ IPv6::IPv6(const uint8_t* buffer, uint32_t total_sz) {
     uint8_t current_header = header_.next_header;
     uint32_t actual_payload_length = payload_length();
     bool is_payload_fragmented = false;
+    // Extension headers are kept as raw bytes if options are lazy
+    const bool lazy_headers = LazyOptions::enabled();
+    const uint8_t* headers_start = stream.pointer();
+    const uint8_t* headers_end = headers_start;
     while (stream) {
         if (is_extension_header(current_header)) {
             if (current_header == FRAGMENT) {
@@ -141,7 +155,9 @@ IPv6::IPv6(const uint8_t* buffer, uint32_t total_sz) {
             }
             // Add a header using the current header type (e.g. what we saw as the next
             // header type in the previous)
-            add_header(ext_header(current_header, payload_size, stream.pointer()));
+            if (!lazy_headers) {
+                add_header(ext_header(current_header, payload_size, stream.pointer()));
+            }
             if (actual_payload_length == 0u && current_header == HOP_BY_HOP) {
                 // could be a jumbogram, look for Jumbo Payload Option
                 InputMemoryStream options(stream.pointer(), payload_size);
@@ -164,13 +180,14 @@ IPv6::IPv6(const uint8_t* buffer, uint32_t total_sz) {
             current_header = ext_type;
             actual_payload_length -= ext_size;
             stream.skip(payload_size);
+            headers_end = stream.pointer();
         }
         else {
             if (!stream.can_read(actual_payload_length)) {
                 throw malformed_packet();
             }
             if (is_payload_fragmented) {
-                inner_pdu(new Tins::RawPDU(stream.pointer(), actual_payload_length));
+                inner_pdu(Internals::raw_pdu_from_buffer(stream.pointer(), actual_payload_length));
             }
             else {
                 inner_pdu(
@@ -190,7 +207,7 @@ IPv6::IPv6(const uint8_t* buffer, uint32_t total_sz) {
                         )
                     );
                     if (!inner_pdu()) {
-                        inner_pdu(new Tins::RawPDU(stream.pointer(), actual_payload_length));
+                        inner_pdu(Internals::raw_pdu_from_buffer(stream.pointer(), actual_payload_length));
                     }
                 }
             }
@@ -199,6 +216,9 @@ IPv6::IPv6(const uint8_t* buffer, uint32_t total_sz) {
         }
     }
     next_header_ = current_header;
+    if (lazy_headers && headers_end != headers_start) {
+        raw_headers_.assign(headers_start, headers_end);
+    }
 }
 
 bool IPv6::is_extension_header(uint8_t header_id) {
@@ -208,6 +228,23 @@ bool IPv6::is_extension_header(uint8_t header_id) {
         || header_id == MOBILITY || header_id == NO_NEXT_HEADER;
 }
 
+void IPv6::materialize_headers() const {
+    if (raw_headers_.pending()) {
+        // The first header's type is in the IPv6 header, then each one 
+        // contains the type of the one that follows it
+        uint8_t current_header = header_.next_header;
+        const uint8_t* ptr = raw_headers_.begin();
+        while (ptr != raw_headers_.end()) {
+            const uint32_t ext_size = (static_cast<uint32_t>(ptr[1]) + 1) * 8;
+            const uint32_t payload_size = ext_size - sizeof(uint8_t) * 2;
+            ext_headers_.push_back(ext_header(current_header, payload_size, ptr + 2));
+            current_header = ptr[0];
+            ptr += ext_size;
+        }
+        raw_headers_.clear();
+    }
+}
+
 uint32_t IPv6::get_padding_size(const ext_header& header) {
     const uint32_t padding = (header.data_size() + sizeof(uint8_t) * 2) % 8;
     return padding == 0 ? 0 : (8 - padding);
@@ -269,6 +306,7 @@ void IPv6::payload_length(uint16_t new_payload_length) {
 }
 
 void IPv6::next_header(uint8_t new_next_header) {
+    materialize_headers();
     next_header_ = header_.next_header = new_next_header;
 }
 
@@ -321,6 +359,7 @@ bool IPv6::matches_response(const uint8_t* ptr, uint32_t total_sz) const {
 
 void IPv6::write_serialization(uint8_t* buffer, uint32_t total_sz) {
     OutputMemoryStream stream(buffer, total_sz);
+    materialize_headers();
     vector<uint8_t> header_types;
     // Iterate the headers and store their current values. At the same time, update header X
     // so it has the option type of header X + 1
@@ -389,10 +428,12 @@ void IPv6::add_ext_header(const ext_header& header) {
 }
 
 void IPv6::add_header(const ext_header& header) {
+    materialize_headers();
     ext_headers_.push_back(header);
 }
 
 const IPv6::ext_header* IPv6::search_header(ExtensionHeader id) const {
+    materialize_headers();
     headers_type::const_iterator it = ext_headers_.begin();
     while (it != ext_headers_.end()) {
         if (it->option() == id) {
@@ -414,6 +455,10 @@ void IPv6::set_last_next_header(uint8_t value) {
 
 uint32_t IPv6::calculate_headers_size() const {
     typedef headers_type::const_iterator const_iterator;
+    // Parsed headers are always padded
+    if (raw_headers_.pending()) {
+        return raw_headers_.size();
+    }
     uint32_t output = 0;
     for (const_iterator iter = ext_headers_.begin(); iter != ext_headers_.end(); ++iter) {
         output += static_cast<uint32_t>(iter->data_size() + sizeof(uint8_t) * 2);
@@ -33,6 +33,7 @@
 #include <tins/rawpdu.h>
 #include <tins/exceptions.h>
 #include <tins/memory_helpers.h>
+#include <tins/detail/pdu_helpers.h>
 
 using Tins::Memory::InputMemoryStream;
 using Tins::Memory::OutputMemoryStream;
@@ -78,7 +79,7 @@ LLC::LLC(const uint8_t* buffer, uint32_t total_sz) {
             inner_pdu(new Tins::STP(stream.pointer(), stream.size()));
         }
         else {
-            inner_pdu(new Tins::RawPDU(stream.pointer(), stream.size()));
+            inner_pdu(Internals::raw_pdu_from_buffer(stream.pointer(), stream.size()));
         }
     }
 }
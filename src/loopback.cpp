@@ -46,6 +46,7 @@
 #include <tins/rawpdu.h>
 #include <tins/exceptions.h>
 #include <tins/memory_helpers.h>
+#include <tins/detail/pdu_helpers.h>
 
 #if !defined(PF_LLC)
     // compilation fix, nasty but at least works on BSD
@@ -78,7 +79,7 @@ Loopback::Loopback(const uint8_t* buffer, uint32_t total_sz) {
                 inner_pdu(new Tins::LLC(stream.pointer(), stream.size()));
                 break;
             default:
-                inner_pdu(new Tins::RawPDU(stream.pointer(), stream.size()));
+                inner_pdu(Internals::raw_pdu_from_buffer(stream.pointer(), stream.size()));
                 break;
         };
     }
@@ -0,0 +1,316 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <tins/mapped_file_sniffer.h>
+
+#ifdef TINS_HAVE_PCAP
+
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <errno.h>
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else // _WIN32
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif // _WIN32
+#include <tins/endianness.h>
+#include <tins/detail/sniffer_helpers.h>
+
+using std::string;
+using std::numeric_limits;
+
+namespace Tins {
+
+const uint32_t pcap_magic = 0xa1b2c3d4;
+const uint32_t pcap_nanosecond_magic = 0xa1b23c4d;
+const uint64_t pcap_file_header_size = 24;
+const uint64_t pcap_record_header_size = 16;
+// The largest snapshot length libpcap accepts
+const uint32_t max_snap_len = 262144;
+
+MappedFileSniffer::MappedFileSniffer(const string& file_name,
+                                     const SnifferConfiguration& configuration)
+: data_(0), size_(0), offset_(0), end_(0), link_type_(0), snap_len_(0), filter_(),
+  has_filter_(false), swap_bytes_(false), nanosecond_timestamps_(false),
+  extract_raw_(false) {
+    map_file(file_name);
+    try {
+        parse_file_header();
+        configuration.configure_sniffer_pre_activation(*this);
+    }
+    catch (...) {
+        clear_filter();
+        unmap_file();
+        throw;
+    }
+}
+
+MappedFileSniffer::~MappedFileSniffer() {
+    clear_filter();
+    unmap_file();
+}
+
+#ifdef _WIN32
+
+void MappedFileSniffer::map_file(const string& file_name) {
+    HANDLE file = CreateFileA(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, 0,
+                              OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw pcap_error(file_name + ": failed to open file");
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size)) {
+        CloseHandle(file);
+        throw pcap_error(file_name + ": failed to get the file's size");
+    }
+    size_ = static_cast<uint64_t>(file_size.QuadPart);
+    if (size_ > 0) {
+        HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+        void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : 0;
+        if (mapping) {
+            CloseHandle(mapping);
+        }
+        if (!view) {
+            CloseHandle(file);
+            throw pcap_error(file_name + ": failed to map file");
+        }
+        data_ = static_cast<const uint8_t*>(view);
+    }
+    CloseHandle(file);
+}
+
+void MappedFileSniffer::unmap_file() {
+    if (data_) {
+        UnmapViewOfFile(data_);
+        data_ = 0;
+    }
+}
+
+#else // _WIN32
+
+void MappedFileSniffer::map_file(const string& file_name) {
+    int fd = open(file_name.c_str(), O_RDONLY);
+    if (fd == -1) {
+        throw pcap_error(file_name + ": " + strerror(errno));
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == -1) {
+        const string error = strerror(errno);
+        close(fd);
+        throw pcap_error(file_name + ": " + error);
+    }
+    if (static_cast<uint64_t>(file_stat.st_size) > numeric_limits<size_t>::max()) {
+        close(fd);
+        throw pcap_error(file_name + ": file is too large to be mapped");
+    }
+    size_ = static_cast<uint64_t>(file_stat.st_size);
+    if (size_ > 0) {
+        void* ptr = mmap(0, static_cast<size_t>(size_), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (ptr == MAP_FAILED) {
+            const string error = strerror(errno);
+            close(fd);
+            throw pcap_error(file_name + ": " + error);
+        }
+        // Records are read front to back, so let the kernel read ahead
+        // aggressively and drop pages once we're past them
+        madvise(ptr, static_cast<size_t>(size_), MADV_SEQUENTIAL);
+        data_ = static_cast<const uint8_t*>(ptr);
+    }
+    close(fd);
+}
+
+void MappedFileSniffer::unmap_file() {
+    if (data_) {
+        munmap(const_cast<uint8_t*>(data_), static_cast<size_t>(size_));
+        data_ = 0;
+    }
+}
+
+#endif // _WIN32
+
+uint32_t MappedFileSniffer::read_field(uint64_t offset) const {
+    uint32_t value;
+    memcpy(&value, data_ + offset, sizeof(value));
+    return swap_bytes_ ? Endian::do_change_endian(value) : value;
+}
+
+void MappedFileSniffer::parse_file_header() {
+    if (size_ < pcap_file_header_size) {
+        throw pcap_error("truncated pcap file header");
+    }
+    uint32_t magic;
+    memcpy(&magic, data_, sizeof(magic));
+    if (magic == pcap_magic || magic == pcap_nanosecond_magic) {
+        swap_bytes_ = false;
+    }
+    else if (Endian::do_change_endian(magic) == pcap_magic ||
+             Endian::do_change_endian(magic) == pcap_nanosecond_magic) {
+        swap_bytes_ = true;
+        magic = Endian::do_change_endian(magic);
+    }
+    else {
+        throw pcap_error("unknown file format");
+    }
+    nanosecond_timestamps_ = magic == pcap_nanosecond_magic;
+    snap_len_ = read_field(16);
+    link_type_ = Internals::link_type_from_file(read_field(20));
+    offset_ = pcap_file_header_size;
+    end_ = size_;
+}
+
+bool MappedFileSniffer::next_frame(RawPacket& frame) {
+    while (end_ - offset_ >= pcap_record_header_size) {
+        const uint32_t seconds = read_field(offset_);
+        const uint32_t fraction = read_field(offset_ + 4);
+        const uint32_t captured = read_field(offset_ + 8);
+        const uint32_t original = read_field(offset_ + 12);
+        const uint64_t data_offset = offset_ + pcap_record_header_size;
+        if (captured > end_ - data_offset) {
+            // Truncated record, consider the file to end here
+            offset_ = end_;
+            return false;
+        }
+        offset_ = data_offset + captured;
+
+        struct timeval tv;
+        tv.tv_sec = seconds;
+        tv.tv_usec = nanosecond_timestamps_ ? fraction / 1000 : fraction;
+        const uint8_t* data = data_ + data_offset;
+        if (has_filter_) {
+            pcap_pkthdr header;
+            header.ts = tv;
+            header.caplen = captured;
+            header.len = original;
+            if (pcap_offline_filter(&filter_, &header, data) == 0) {
+                continue;
+            }
+        }
+        frame = RawPacket(data, captured, original, tv);
+        return true;
+    }
+    return false;
+}
+
+PtrPacket MappedFileSniffer::next_packet() {
+    pcap_handler handler = Internals::sniff_handler_from_link_type(link_type_, extract_raw_);
+    RawPacket frame;
+    while (next_frame(frame)) {
+        pcap_pkthdr header;
+        header.ts.tv_sec = frame.timestamp().seconds();
+        header.ts.tv_usec = frame.timestamp().microseconds();
+        header.caplen = frame.size();
+        header.len = frame.original_size();
+
+        Internals::sniff_data data;
+        handler((u_char*)&data, &header, frame.data());
+        // Skip malformed packets
+        if (data.pdu) {
+            return PtrPacket(data.pdu, data.tv);
+        }
+    }
+    return PtrPacket(0, Timestamp());
+}
+
+bool MappedFileSniffer::set_filter(const string& filter) {
+    const uint32_t snap_len = snap_len_ > 0 && snap_len_ <= max_snap_len ? snap_len_ : max_snap_len;
+    pcap_t* handle = pcap_open_dead(link_type_, static_cast<int>(snap_len));
+    if (!handle) {
+        return false;
+    }
+    bpf_program program;
+    if (pcap_compile(handle, &program, filter.c_str(), 1, PCAP_NETMASK_UNKNOWN) == -1) {
+        pcap_close(handle);
+        return false;
+    }
+    pcap_close(handle);
+    clear_filter();
+    filter_ = program;
+    has_filter_ = true;
+    return true;
+}
+
+void MappedFileSniffer::clear_filter() {
+    if (has_filter_) {
+        pcap_freecode(&filter_);
+        has_filter_ = false;
+    }
+}
+
+void MappedFileSniffer::set_extract_raw_pdus(bool value) {
+    extract_raw_ = value;
+}
+
+void MappedFileSniffer::rewind() {
+    offset_ = pcap_file_header_size;
+    end_ = size_;
+}
+
+uint64_t MappedFileSniffer::position() const {
+    return offset_;
+}
+
+void MappedFileSniffer::seek(uint64_t offset) {
+    if (offset < pcap_file_header_size || offset > size_) {
+        throw std::runtime_error("Offset is outside of the file");
+    }
+    offset_ = offset;
+}
+
+void MappedFileSniffer::set_read_range(uint64_t begin, uint64_t end) {
+    if (begin < pcap_file_header_size || begin > end || end > size_) {
+        throw std::runtime_error("Read range is outside of the file");
+    }
+    offset_ = begin;
+    end_ = end;
+}
+
+uint64_t MappedFileSniffer::file_size() const {
+    return size_;
+}
+
+int MappedFileSniffer::link_type() const {
+    return link_type_;
+}
+
+uint32_t MappedFileSniffer::snap_len() const {
+    return snap_len_;
+}
+
+bool MappedFileSniffer::has_nanosecond_timestamps() const {
+    return nanosecond_timestamps_;
+}
+
+} // Tins
+
+#endif // TINS_HAVE_PCAP
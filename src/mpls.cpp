@@ -32,6 +32,7 @@
 #include <tins/ipv6.h>
 #include <tins/rawpdu.h>
 #include <tins/memory_helpers.h>
+#include <tins/detail/pdu_helpers.h>
 #include <tins/icmp_extension.h>
 
 using Tins::Memory::InputMemoryStream;
@@ -62,7 +63,7 @@ MPLS::MPLS(const uint8_t* buffer, uint32_t total_sz) {
                 inner_pdu(new Tins::IPv6(stream.pointer(), stream.size()));
             }
             else {
-                inner_pdu(new Tins::RawPDU(stream.pointer(), stream.size()));
+                inner_pdu(Internals::raw_pdu_from_buffer(stream.pointer(), stream.size()));
             }
         }
         else {
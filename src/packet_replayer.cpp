@@ -0,0 +1,355 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <tins/packet_replayer.h>
+
+#if defined(TINS_HAVE_PCAP) && defined(TINS_HAVE_CXX11)
+
+#include <thread>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#if !defined(_WIN32) && !defined(BSD) && !defined(__FreeBSD_kernel__)
+    #include <sys/socket.h>
+    #include <linux/if_ether.h>
+    #include <linux/if_packet.h>
+#endif
+#include <tins/packet_sender.h>
+#include <tins/ethernetII.h>
+#include <tins/ip.h>
+#include <tins/endianness.h>
+#include <tins/exceptions.h>
+#include <tins/detail/pacing_helpers.h>
+
+using std::string;
+using std::vector;
+using std::thread;
+using std::mutex;
+using std::unique_lock;
+using std::lock_guard;
+using std::exception_ptr;
+using std::runtime_error;
+
+using Tins::Internals::pacing_now;
+using Tins::Internals::pacing_wait_until;
+
+namespace Tins {
+
+const uint32_t PacketReplayer::DEFAULT_PREFETCH_SIZE = 4096;
+
+const uint32_t replayer_ethernet_header_size = 14;
+
+static int64_t replayer_timestamp_ns(const Timestamp& timestamp) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        static_cast<std::chrono::microseconds>(timestamp)
+    ).count();
+}
+
+PacketReplayer::PacketReplayer(const string& file_name, 
+                               const SnifferConfiguration& configuration)
+: reader_(file_name, configuration), speed_(1.0), max_rate_(0), loop_count_(1),
+  prefetch_size_(DEFAULT_PREFETCH_SIZE), rewrite_src_hw_addr_(false), 
+  rewrite_dst_hw_addr_(false), queue_head_(0), queue_count_(0), prefetch_done_(false),
+  loops_(0), stopped_(false) {
+    if (reader_.link_type() != DLT_EN10MB) {
+        throw runtime_error("Only Ethernet captures can be replayed");
+    }
+}
+
+void PacketReplayer::speed(double multiplier) {
+    if (multiplier < 0) {
+        throw runtime_error("Invalid replay speed");
+    }
+    speed_ = multiplier;
+}
+
+void PacketReplayer::max_rate(uint64_t packets_per_second) {
+    max_rate_ = packets_per_second;
+}
+
+void PacketReplayer::loop_count(uint32_t count) {
+    loop_count_ = count;
+}
+
+void PacketReplayer::prefetch_size(uint32_t size) {
+    if (size == 0) {
+        throw runtime_error("Invalid prefetch size");
+    }
+    prefetch_size_ = size;
+}
+
+void PacketReplayer::src_hw_addr(const HWAddress<6>& address) {
+    src_hw_addr_ = address;
+    rewrite_src_hw_addr_ = true;
+}
+
+void PacketReplayer::dst_hw_addr(const HWAddress<6>& address) {
+    dst_hw_addr_ = address;
+    rewrite_dst_hw_addr_ = true;
+}
+
+void PacketReplayer::rewrite_address(IPv4Address from, IPv4Address to) {
+    address_map_[from] = to;
+}
+
+PacketReplayer::statistics PacketReplayer::replay(PacketSender& sender, 
+                                                  const NetworkInterface& iface) {
+    if (!iface) {
+        throw invalid_interface();
+    }
+    send_callback_type callback;
+    #if defined(TINS_HAVE_PACKET_SENDER_PCAP_SENDPACKET) || defined(BSD) || defined(__FreeBSD_kernel__)
+        callback = [&](const RawPacket& frame) {
+            sender.send_l2(frame.data(), frame.size(), 0, 0, iface);
+        };
+    #elif defined(_WIN32)
+        throw feature_disabled();
+    #else
+        struct sockaddr_ll addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sll_family = Endian::host_to_be<uint16_t>(PF_PACKET);
+        addr.sll_protocol = Endian::host_to_be<uint16_t>(ETH_P_ALL);
+        addr.sll_halen = HWAddress<6>::address_size;
+        addr.sll_ifindex = iface.id();
+        callback = [&](const RawPacket& frame) {
+            // Ethernet frames start with the destination address
+            memcpy(addr.sll_addr, frame.data(), HWAddress<6>::address_size);
+            sender.send_l2(frame.data(), frame.size(), (struct sockaddr*)&addr, 
+                           (uint32_t)sizeof(addr), iface);
+        };
+    #endif
+    // The sender holds frames back when they're due faster than the maximum
+    // rate. Bursts of a single frame keep every frame spaced out
+    const bool was_pacing = sender.pacing_enabled();
+    if (max_rate_ > 0) {
+        sender.enable_pacing(max_rate_, 0, 1);
+    }
+    statistics output;
+    try {
+        output = replay(callback);
+    }
+    catch (...) {
+        if (max_rate_ > 0 && !was_pacing) {
+            sender.disable_pacing();
+        }
+        throw;
+    }
+    if (max_rate_ > 0 && !was_pacing) {
+        sender.disable_pacing();
+    }
+    return output;
+}
+
+PacketReplayer::statistics PacketReplayer::replay(send_callback_type callback) {
+    // The queued frames keep their buffers from one replay to the next
+    queue_.resize(prefetch_size_);
+    queue_head_ = 0;
+    queue_count_ = 0;
+    prefetch_done_ = false;
+    loops_ = 0;
+    error_ = exception_ptr();
+    stopped_ = false;
+    reader_.rewind();
+    thread prefetch_thread(&PacketReplayer::prefetch, this);
+
+    statistics output;
+    memset(&output, 0, sizeof(output));
+    uint64_t max_delay = 0;
+    uint32_t last_loop = 0;
+    bool finished = false;
+    const uint64_t start = pacing_now();
+    try {
+        while (true) {
+            queued_frame* frame = 0;
+            {
+                unique_lock<mutex> lock(lock_);
+                queue_cond_.wait(lock, [&]() {
+                    return queue_count_ > 0 || prefetch_done_ || stopped_;
+                });
+                if (stopped_) {
+                    break;
+                }
+                if (queue_count_ == 0) {
+                    finished = true;
+                    break;
+                }
+                frame = &queue_[queue_head_];
+            }
+            const uint64_t due = start + frame->due;
+            pacing_wait_until(due);
+            max_delay = std::max(max_delay, pacing_now() - due);
+            callback(RawPacket(&frame->data[0], static_cast<uint32_t>(frame->data.size()),
+                               frame->original_size, frame->timestamp));
+            output.packets++;
+            output.bytes += frame->data.size();
+            last_loop = frame->loop;
+            {
+                lock_guard<mutex> _(lock_);
+                queue_head_ = (queue_head_ + 1) % queue_.size();
+                queue_count_--;
+            }
+            queue_cond_.notify_all();
+        }
+    }
+    catch (...) {
+        stop();
+        prefetch_thread.join();
+        throw;
+    }
+    stop();
+    prefetch_thread.join();
+    output.loops = finished ? loops_ : last_loop;
+    output.elapsed = (pacing_now() - start) / 1e9;
+    output.max_delay = max_delay / 1e9;
+    if (error_) {
+        std::rethrow_exception(error_);
+    }
+    return output;
+}
+
+void PacketReplayer::stop() {
+    {
+        lock_guard<mutex> _(lock_);
+        stopped_ = true;
+    }
+    queue_cond_.notify_all();
+}
+
+void PacketReplayer::prefetch() {
+    try {
+        RawPacket frame;
+        uint64_t due = 0;
+        int64_t previous_timestamp = 0;
+        uint32_t loop = 0;
+        uint64_t loop_frames = 0;
+        while (!stopped_) {
+            if (!reader_.next_frame(frame)) {
+                ++loop;
+                {
+                    lock_guard<mutex> _(lock_);
+                    loops_ = loop;
+                }
+                // Don't spin forever over a file without any frames
+                if (loop == loop_count_ || loop_frames == 0) {
+                    break;
+                }
+                reader_.rewind();
+                loop_frames = 0;
+                continue;
+            }
+            queued_frame* slot = 0;
+            {
+                unique_lock<mutex> lock(lock_);
+                queue_cond_.wait(lock, [&]() {
+                    return queue_count_ < queue_.size() || stopped_;
+                });
+                if (stopped_) {
+                    break;
+                }
+                // The consumer won't touch this slot until it's queued
+                slot = &queue_[(queue_head_ + queue_count_) % queue_.size()];
+            }
+            if (!prepare_frame(frame, slot->data)) {
+                continue;
+            }
+            // Frames are spaced out according to their original timestamps.
+            // The first frame of each pass over the file follows the last 
+            // one right away
+            const int64_t timestamp = replayer_timestamp_ns(frame.timestamp());
+            if (loop_frames > 0 && speed_ > 0 && timestamp > previous_timestamp) {
+                due += static_cast<uint64_t>((timestamp - previous_timestamp) / speed_);
+            }
+            previous_timestamp = timestamp;
+            loop_frames++;
+            slot->timestamp = frame.timestamp();
+            slot->original_size = frame.original_size();
+            slot->due = due;
+            slot->loop = loop;
+            {
+                lock_guard<mutex> _(lock_);
+                queue_count_++;
+            }
+            queue_cond_.notify_all();
+        }
+    }
+    catch (...) {
+        lock_guard<mutex> _(lock_);
+        error_ = std::current_exception();
+    }
+    {
+        lock_guard<mutex> _(lock_);
+        prefetch_done_ = true;
+    }
+    queue_cond_.notify_all();
+}
+
+bool PacketReplayer::prepare_frame(const RawPacket& frame, vector<uint8_t>& buffer) {
+    if (frame.size() < replayer_ethernet_header_size) {
+        return false;
+    }
+    bool serialized = false;
+    if (!address_map_.empty()) {
+        try {
+            EthernetII packet(frame.data(), frame.size());
+            for (PDU* pdu = &packet; pdu; pdu = pdu->inner_pdu()) {
+                if (pdu->pdu_type() != PDU::IP) {
+                    continue;
+                }
+                IP* ip = static_cast<IP*>(pdu);
+                std::map<IPv4Address, IPv4Address>::const_iterator it;
+                if ((it = address_map_.find(ip->src_addr())) != address_map_.end()) {
+                    ip->src_addr(it->second);
+                }
+                if ((it = address_map_.find(ip->dst_addr())) != address_map_.end()) {
+                    ip->dst_addr(it->second);
+                }
+            }
+            packet.serialize_into(buffer);
+            serialized = true;
+        }
+        catch (malformed_packet&) {
+            // Send truncated or malformed frames as they are
+        }
+    }
+    if (!serialized) {
+        buffer.assign(frame.data(), frame.data() + frame.size());
+    }
+    if (rewrite_dst_hw_addr_) {
+        dst_hw_addr_.copy(&buffer[0]);
+    }
+    if (rewrite_src_hw_addr_) {
+        src_hw_addr_.copy(&buffer[HWAddress<6>::address_size]);
+    }
+    return true;
+}
+
+} // Tins
+
+#endif // TINS_HAVE_PCAP && TINS_HAVE_CXX11
@@ -54,6 +54,7 @@
 #endif
 #include <cstring>
 #include <ctime>
+#include <algorithm>
 #include <sstream>
 #include <tins/pdu.h>
 #include <tins/macros.h>
@@ -65,9 +66,15 @@
 #include <tins/ieee802_3.h>
 #include <tins/cxxstd.h>
 #include <tins/detail/pdu_helpers.h>
+#include <tins/detail/pacing_helpers.h>
 #if TINS_IS_CXX11
     #include <chrono>
 #endif // TINS_IS_CXX11
+#ifdef TINS_HAVE_PACKET_SENDER_TX_RING
+    #include <atomic>
+    #include <poll.h>
+    #include <sys/mman.h>
+#endif // TINS_HAVE_PACKET_SENDER_TX_RING
 
 using std::string;
 using std::ostringstream;
@@ -75,10 +82,28 @@ using std::make_pair;
 using std::vector;
 using std::runtime_error;
 
+using Tins::Internals::pacing_now;
+using Tins::Internals::pacing_wait_until;
+
 namespace Tins {
 
 const int PacketSender::INVALID_RAW_SOCKET = -1;
 const uint32_t PacketSender::DEFAULT_TIMEOUT = 2;
+const uint32_t PacketSender::DEFAULT_PACING_BURST = 32;
+
+// The maximum amount of PDUs sent at once by send_batch. This matches 
+// the limit on the amount of messages sendmmsg accepts
+const size_t batch_max_packets = 1024;
+
+#ifdef TINS_HAVE_PACKET_SENDER_TX_RING
+const uint32_t PacketSender::DEFAULT_TX_FRAME_SIZE = 2048;
+const uint32_t PacketSender::DEFAULT_TX_FRAME_COUNT = 4096;
+
+// Where the packet starts within a TPACKET_V2 transmit ring frame
+const uint32_t tx_ring_data_offset = TPACKET2_HDRLEN - sizeof(struct sockaddr_ll);
+// The timeout used while waiting for the kernel to give a frame back, in milliseconds
+const int tx_ring_poll_timeout = 100;
+#endif // TINS_HAVE_PACKET_SENDER_TX_RING
 
 #ifndef _WIN32
     typedef int socket_type;
@@ -102,13 +127,31 @@ PacketSender::PacketSender(const NetworkInterface& iface,
 #if !defined(BSD) && !defined(_WIN32) && !defined(__FreeBSD_kernel__)
   ether_socket_(INVALID_RAW_SOCKET),
 #endif
-  _timeout(recv_timeout), timeout_usec_(usec), default_iface_(iface) {
+  _timeout(recv_timeout), timeout_usec_(usec), default_iface_(iface),
+  batch_socket_(INVALID_RAW_SOCKET), 
+#ifdef TINS_HAVE_PACKET_SENDER_PCAP_SENDPACKET
+  batch_handle_(0),
+#endif // TINS_HAVE_PACKET_SENDER_PCAP_SENDPACKET
+  batching_(false) {
+    memset(&pacer_, 0, sizeof(pacer_));
     types_[IP_TCP_SOCKET] = IPPROTO_TCP;
     types_[IP_UDP_SOCKET] = IPPROTO_UDP;
     types_[IP_RAW_SOCKET] = IPPROTO_RAW;
     types_[IPV6_SOCKET] = IPPROTO_RAW;
     types_[ICMP_SOCKET] = IPPROTO_ICMP;
     types_[ICMPV6_SOCKET] = IPPROTO_ICMPV6;
+    #ifdef TINS_HAVE_PACKET_SENDER_TX_RING
+        tx_ring_.buffer = 0;
+        tx_ring_.frame_size = DEFAULT_TX_FRAME_SIZE;
+        tx_ring_.frame_count = DEFAULT_TX_FRAME_COUNT;
+        tx_ring_.frames_per_block = 0;
+        tx_ring_.block_size = 0;
+        tx_ring_.current_frame = 0;
+        tx_ring_.pending_frames = 0;
+        tx_ring_.pending_bytes = 0;
+        tx_ring_.mode = BLOCKING_FLUSH;
+        tx_ring_.enabled = false;
+    #endif // TINS_HAVE_PACKET_SENDER_TX_RING
 }
 
 PacketSender::~PacketSender() {
@@ -128,6 +171,9 @@ PacketSender::~PacketSender() {
         }
     #elif !defined(_WIN32)
         if (ether_socket_ != INVALID_RAW_SOCKET) {
+            #ifdef TINS_HAVE_PACKET_SENDER_TX_RING
+                unmap_tx_ring();
+            #endif // TINS_HAVE_PACKET_SENDER_TX_RING
             ::close(ether_socket_);
         }
     #endif
@@ -148,6 +194,44 @@ const NetworkInterface& PacketSender::default_interface() const {
     return default_iface_;
 }
 
+void PacketSender::enable_pacing(uint64_t packets_per_second, uint64_t bits_per_second,
+                                 uint32_t burst_size) {
+    if (packets_per_second == 0 && bits_per_second == 0) {
+        throw runtime_error("Invalid pacing rate");
+    }
+    if (burst_size == 0) {
+        throw runtime_error("Invalid pacing burst size");
+    }
+    pacer_.packets_per_second = packets_per_second;
+    pacer_.bits_per_second = bits_per_second;
+    pacer_.burst_size = burst_size;
+    pacer_.start = pacing_now();
+    pacer_.next_send = pacer_.start;
+    pacer_.packets = 0;
+    pacer_.bytes = 0;
+    pacer_.enabled = true;
+}
+
+void PacketSender::disable_pacing() {
+    pacer_.enabled = false;
+}
+
+bool PacketSender::pacing_enabled() const {
+    return pacer_.enabled;
+}
+
+PacketSender::pacing_statistics PacketSender::pacing_stats() const {
+    pacing_statistics output;
+    output.packets = pacer_.packets;
+    output.bytes = pacer_.bytes;
+    output.elapsed = pacer_.enabled ? (pacing_now() - pacer_.start) / 1e9 : 0;
+    output.target_packets_per_second = static_cast<double>(pacer_.packets_per_second);
+    output.target_bits_per_second = static_cast<double>(pacer_.bits_per_second);
+    output.packets_per_second = output.elapsed > 0 ? output.packets / output.elapsed : 0;
+    output.bits_per_second = output.elapsed > 0 ? output.bytes * 8 / output.elapsed : 0;
+    return output;
+}
+
 #if !defined(_WIN32) || defined(TINS_HAVE_PACKET_SENDER_PCAP_SENDPACKET)
 
 #ifndef _WIN32
@@ -241,6 +325,18 @@ void PacketSender::open_l2_socket(const NetworkInterface& iface) {
         if (ether_socket_ == -1) {
             throw socket_open_error(make_error_string());
         }
+        #ifdef TINS_HAVE_PACKET_SENDER_TX_RING
+            if (tx_ring_.enabled) {
+                try {
+                    setup_tx_ring();
+                }
+                catch (...) {
+                    ::close(ether_socket_);
+                    ether_socket_ = INVALID_RAW_SOCKET;
+                    throw;
+                }
+            }
+        #endif // TINS_HAVE_PACKET_SENDER_TX_RING
     }
     #endif
 }
@@ -290,6 +386,9 @@ void PacketSender::close_socket(SocketType type, const NetworkInterface& iface)
         if (ether_socket_ == INVALID_RAW_SOCKET) {
             throw invalid_socket_type();
         }
+        #ifdef TINS_HAVE_PACKET_SENDER_TX_RING
+            unmap_tx_ring();
+        #endif // TINS_HAVE_PACKET_SENDER_TX_RING
         if (::close(ether_socket_) == -1) {
             throw socket_close_error(make_error_string());
         }
@@ -350,31 +449,103 @@ PDU* PacketSender::send_recv(PDU& pdu, const NetworkInterface& iface) {
     return pdu.recv_response(*this, iface);
 }
 
+PacketSender::outgoing_packet::outgoing_packet(PDU& pdu)
+: pdu(&pdu), data(0), data_size(0) {
+
+}
+
+PacketSender::outgoing_packet::outgoing_packet(const uint8_t* data, uint32_t size)
+: pdu(0), data(data), data_size(size) {
+
+}
+
+uint32_t PacketSender::outgoing_packet::size() const {
+    return pdu ? pdu->size() : data_size;
+}
+
+void PacketSender::outgoing_packet::write(uint8_t* buffer, uint32_t size) const {
+    if (pdu) {
+        pdu->serialize_into(buffer, size);
+    }
+    else {
+        memcpy(buffer, data, size);
+    }
+}
+
+const uint8_t* PacketSender::serialize_packet(const outgoing_packet& packet, uint32_t& size) {
+    if (!packet.pdu) {
+        size = packet.data_size;
+        return packet.data;
+    }
+    size = static_cast<uint32_t>(packet.pdu->serialize_into(buffer_));
+    return buffer_.empty() ? 0 : &buffer_[0];
+}
+
 #if !defined(_WIN32) || defined(TINS_HAVE_PACKET_SENDER_PCAP_SENDPACKET)
 void PacketSender::send_l2(PDU& pdu,
                            struct sockaddr* link_addr, 
                            uint32_t len_addr,
                            const NetworkInterface& iface) {
-    PDU::serialization_type buffer = pdu.serialize();
+    send_l2_packet(outgoing_packet(pdu), link_addr, len_addr, iface);
+}
+
+void PacketSender::send_l2(const uint8_t* buffer,
+                           uint32_t size,
+                           struct sockaddr* link_addr, 
+                           uint32_t len_addr,
+                           const NetworkInterface& iface) {
+    send_l2_packet(outgoing_packet(buffer, size), link_addr, len_addr, iface);
+}
 
+void PacketSender::send_l2_packet(const outgoing_packet& packet,
+                                  struct sockaddr* link_addr, 
+                                  uint32_t len_addr,
+                                  const NetworkInterface& iface) {
     #ifdef TINS_HAVE_PACKET_SENDER_PCAP_SENDPACKET
         Internals::unused(len_addr);
         Internals::unused(link_addr);
         open_l2_socket(iface);
         pcap_t* handle = pcap_handles_[iface];
-        const int buf_size = static_cast<int>(buffer.size());
-        if (pcap_sendpacket(handle, (u_char*)&buffer[0], buf_size) != 0) {
+        if (batching_) {
+            queue_batch(packet, handle);
+            return;
+        }
+        uint32_t buf_size = 0;
+        const uint8_t* buffer = serialize_packet(packet, buf_size);
+        wait_pacing(1, buf_size);
+        if (pcap_sendpacket(handle, (u_char*)buffer, static_cast<int>(buf_size)) != 0) {
             throw pcap_error("Failed to send packet: " + string(pcap_geterr(handle)));
         }
     #else // TINS_HAVE_PACKET_SENDER_PCAP_SENDPACKET
         int sock = get_ether_socket(iface);
-        if (!buffer.empty()) {
+        #ifdef TINS_HAVE_PACKET_SENDER_TX_RING
+            if (tx_ring_.buffer) {
+                if (batching_) {
+                    // Keep the batch's PDUs in order
+                    flush_batch();
+                    queue_tx_ring(packet, link_addr, len_addr);
+                }
+                else {
+                    queue_tx_ring(packet, link_addr, len_addr);
+                    flush_tx_ring();
+                }
+                return;
+            }
+        #endif // TINS_HAVE_PACKET_SENDER_TX_RING
+        if (batching_) {
+            queue_batch(packet, sock, link_addr, len_addr);
+            return;
+        }
+        uint32_t buf_size = 0;
+        const uint8_t* buffer = serialize_packet(packet, buf_size);
+        if (buf_size > 0) {
+            wait_pacing(1, buf_size);
             #if defined(BSD) || defined(__FreeBSD_kernel__)
             Internals::unused(len_addr);
             Internals::unused(link_addr);
-            if (::write(sock, &buffer[0], buffer.size()) == -1) {
+            if (::write(sock, buffer, buf_size) == -1) {
             #else
-            if (::sendto(sock, &buffer[0], buffer.size(), 0, link_addr, len_addr) == -1) {
+            if (::sendto(sock, buffer, buf_size, 0, link_addr, len_addr) == -1) {
             #endif
                 throw socket_write_error(make_error_string());
             }
@@ -415,15 +586,425 @@ void PacketSender::send_l3(PDU& pdu,
                            struct sockaddr* link_addr,
                            uint32_t len_addr,
                            SocketType type) {
+    send_l3_packet(outgoing_packet(pdu), link_addr, len_addr, type);
+}
+
+void PacketSender::send_l3(const uint8_t* buffer,
+                           uint32_t size,
+                           struct sockaddr* link_addr,
+                           uint32_t len_addr,
+                           SocketType type) {
+    send_l3_packet(outgoing_packet(buffer, size), link_addr, len_addr, type);
+}
+
+void PacketSender::send_l3_packet(const outgoing_packet& packet,
+                                  struct sockaddr* link_addr,
+                                  uint32_t len_addr,
+                                  SocketType type) {
     open_l3_socket(type);
     int sock = sockets_[type];
-    PDU::serialization_type buffer = pdu.serialize();
-    const int buf_size = static_cast<int>(buffer.size());
-    if (sendto(sock, (const char*)&buffer[0], buf_size, 0, link_addr, len_addr) == -1) {
+    if (batching_) {
+        queue_batch(packet, sock, link_addr, len_addr);
+        return;
+    }
+    uint32_t buf_size = 0;
+    const uint8_t* buffer = serialize_packet(packet, buf_size);
+    wait_pacing(1, buf_size);
+    if (sendto(sock, (const char*)buffer, static_cast<int>(buf_size), 0, 
+               link_addr, len_addr) == -1) {
         throw socket_write_error(make_error_string());
     }
 }
 
+void PacketSender::wait_pacing(uint32_t packets, uint64_t bytes) {
+    if (!pacer_.enabled) {
+        return;
+    }
+    // The time these packets take up at each rate, the slowest one wins
+    uint64_t cost = 0;
+    if (pacer_.packets_per_second > 0) {
+        cost = packets * 1000000000ULL / pacer_.packets_per_second;
+    }
+    if (pacer_.bits_per_second > 0) {
+        cost = std::max<uint64_t>(cost, bytes * 8 * 1000000000ULL / pacer_.bits_per_second);
+    }
+    // The bucket holds up to burst_size packets worth of time
+    const uint64_t depth = cost / packets * pacer_.burst_size;
+    const uint64_t now = pacing_now();
+    if (pacer_.next_send < now) {
+        pacer_.next_send = now;
+    }
+    pacer_.next_send += cost;
+    if (pacer_.next_send > now + depth) {
+        pacing_wait_until(pacer_.next_send - depth);
+    }
+    pacer_.packets += packets;
+    pacer_.bytes += bytes;
+}
+
+void PacketSender::begin_batch() {
+    batching_ = true;
+}
+
+void PacketSender::end_batch(bool flush) {
+    batching_ = false;
+    try {
+        if (flush) {
+            flush_batch();
+            #ifdef TINS_HAVE_PACKET_SENDER_TX_RING
+                flush_tx_ring();
+            #endif // TINS_HAVE_PACKET_SENDER_TX_RING
+        }
+    }
+    catch (...) {
+        clear_batch();
+        throw;
+    }
+    clear_batch();
+}
+
+void PacketSender::clear_batch() {
+    batch_buffer_.clear();
+    batch_addresses_.clear();
+    batch_entries_.clear();
+    batch_socket_ = INVALID_RAW_SOCKET;
+    #ifdef TINS_HAVE_PACKET_SENDER_PCAP_SENDPACKET
+    batch_handle_ = 0;
+    #endif // TINS_HAVE_PACKET_SENDER_PCAP_SENDPACKET
+    #ifdef TINS_HAVE_PACKET_SENDER_TX_RING
+    discard_tx_ring();
+    #endif // TINS_HAVE_PACKET_SENDER_TX_RING
+}
+
+void PacketSender::add_batch_entry(const outgoing_packet& packet, struct sockaddr* link_addr, 
+                                   uint32_t len_addr) {
+    const uint32_t size = packet.size();
+    if (size == 0) {
+        return;
+    }
+    // The batch's buffers keep their capacity from one batch to the next, 
+    // so the packet is written right after the previous one
+    batch_entry entry;
+    entry.data_offset = static_cast<uint32_t>(batch_buffer_.size());
+    entry.data_size = size;
+    batch_buffer_.resize(entry.data_offset + size);
+    packet.write(&batch_buffer_[entry.data_offset], size);
+    entry.address_offset = static_cast<uint32_t>(batch_addresses_.size());
+    entry.address_size = link_addr ? len_addr : 0;
+    if (link_addr) {
+        const uint8_t* address_ptr = reinterpret_cast<const uint8_t*>(link_addr);
+        batch_addresses_.insert(batch_addresses_.end(), address_ptr, address_ptr + len_addr);
+    }
+    batch_entries_.push_back(entry);
+}
+
+void PacketSender::queue_batch(const outgoing_packet& packet, int sock, 
+                               struct sockaddr* link_addr, uint32_t len_addr) {
+    #ifdef TINS_HAVE_PACKET_SENDER_TX_RING
+    // Keep the batch's PDUs in order
+    flush_tx_ring();
+    #endif // TINS_HAVE_PACKET_SENDER_TX_RING
+    #ifdef TINS_HAVE_PACKET_SENDER_PCAP_SENDPACKET
+    const bool same_target = batch_handle_ == 0 && batch_socket_ == sock;
+    #else
+    const bool same_target = batch_socket_ == sock;
+    #endif // TINS_HAVE_PACKET_SENDER_PCAP_SENDPACKET
+    if (!same_target || batch_entries_.size() == batch_max_packets) {
+        flush_batch();
+    }
+    batch_socket_ = sock;
+    add_batch_entry(packet, link_addr, len_addr);
+}
+
+#ifdef TINS_HAVE_PACKET_SENDER_PCAP_SENDPACKET
+void PacketSender::queue_batch(const outgoing_packet& packet, pcap_t* handle) {
+    if (batch_handle_ != handle || batch_entries_.size() == batch_max_packets) {
+        flush_batch();
+    }
+    batch_handle_ = handle;
+    add_batch_entry(packet, 0, 0);
+}
+#endif // TINS_HAVE_PACKET_SENDER_PCAP_SENDPACKET
+
+void PacketSender::flush_batch() {
+    const size_t count = batch_entries_.size();
+    if (count == 0) {
+        return;
+    }
+    // When pacing, the batch is handed over a burst at a time
+    const size_t burst_size = pacer_.enabled ? pacer_.burst_size : count;
+    for (size_t first = 0; first < count; first += burst_size) {
+        const size_t last = std::min(count, first + burst_size);
+        if (pacer_.enabled) {
+            uint64_t bytes = 0;
+            for (size_t i = first; i < last; ++i) {
+                bytes += batch_entries_[i].data_size;
+            }
+            wait_pacing(static_cast<uint32_t>(last - first), bytes);
+        }
+        send_batch_entries(first, last);
+    }
+    clear_batch();
+}
+
+void PacketSender::send_batch_entries(size_t first, size_t last) {
+    #ifdef TINS_HAVE_PACKET_SENDER_PCAP_SENDPACKET
+    if (batch_handle_) {
+        pcap_t* handle = batch_handle_;
+        for (size_t i = first; i < last; ++i) {
+            const batch_entry& entry = batch_entries_[i];
+            if (pcap_sendpacket(handle, &batch_buffer_[entry.data_offset], 
+                                static_cast<int>(entry.data_size)) != 0) {
+                throw pcap_error("Failed to send packet: " + string(pcap_geterr(handle)));
+            }
+        }
+        return;
+    }
+    #endif // TINS_HAVE_PACKET_SENDER_PCAP_SENDPACKET
+    const int sock = batch_socket_;
+    #if defined(BSD) || defined(__FreeBSD_kernel__)
+    // Layer 2 PDUs are written to a bpf device, which is not a socket and 
+    // takes no address
+    if (batch_entries_[first].address_size == 0) {
+        for (size_t i = first; i < last; ++i) {
+            const batch_entry& entry = batch_entries_[i];
+            if (::write(sock, &batch_buffer_[entry.data_offset], entry.data_size) == -1) {
+                throw socket_write_error(make_error_string());
+            }
+        }
+        return;
+    }
+    #endif // BSD
+    #ifdef TINS_HAVE_SENDMMSG
+        const size_t count = last - first;
+        vector<struct mmsghdr> messages(count);
+        vector<struct iovec> vectors(count);
+        for (size_t i = 0; i < count; ++i) {
+            const batch_entry& entry = batch_entries_[first + i];
+            vectors[i].iov_base = &batch_buffer_[entry.data_offset];
+            vectors[i].iov_len = entry.data_size;
+            memset(&messages[i], 0, sizeof(messages[i]));
+            messages[i].msg_hdr.msg_iov = &vectors[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+            if (entry.address_size > 0) {
+                messages[i].msg_hdr.msg_name = &batch_addresses_[entry.address_offset];
+                messages[i].msg_hdr.msg_namelen = entry.address_size;
+            }
+        }
+        size_t sent = 0;
+        while (sent < count) {
+            const int result = sendmmsg(sock, &messages[sent], 
+                                        static_cast<unsigned>(count - sent), 0);
+            if (result == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw socket_write_error(make_error_string());
+            }
+            sent += static_cast<size_t>(result);
+        }
+    #else
+        for (size_t i = first; i < last; ++i) {
+            const batch_entry& entry = batch_entries_[i];
+            const char* data = (const char*)&batch_buffer_[entry.data_offset];
+            struct sockaddr* address = entry.address_size == 0 ? 0 : 
+                (struct sockaddr*)&batch_addresses_[entry.address_offset];
+            const bool sent = sendto(sock, data, static_cast<int>(entry.data_size), 0,
+                                     address, entry.address_size) != -1;
+            if (!sent) {
+                throw socket_write_error(make_error_string());
+            }
+        }
+    #endif // TINS_HAVE_SENDMMSG
+}
+
+#ifdef TINS_HAVE_PACKET_SENDER_TX_RING
+
+void PacketSender::enable_tx_ring(uint32_t frame_size, uint32_t frame_count, 
+                                  TxFlushMode mode) {
+    if (frame_size <= tx_ring_data_offset || frame_size % TPACKET_ALIGNMENT != 0) {
+        throw runtime_error("Invalid transmit ring frame size");
+    }
+    if (frame_count == 0) {
+        throw runtime_error("Invalid transmit ring frame count");
+    }
+    // The ring is set up when the socket is opened
+    if (ether_socket_ != INVALID_RAW_SOCKET) {
+        close_socket(ETHER_SOCKET);
+    }
+    tx_ring_.frame_size = frame_size;
+    tx_ring_.frame_count = frame_count;
+    tx_ring_.mode = mode;
+    tx_ring_.enabled = true;
+}
+
+void PacketSender::disable_tx_ring() {
+    if (tx_ring_.buffer) {
+        close_socket(ETHER_SOCKET);
+    }
+    tx_ring_.enabled = false;
+}
+
+bool PacketSender::tx_ring_enabled() const {
+    return tx_ring_.enabled;
+}
+
+void PacketSender::setup_tx_ring() {
+    int version = TPACKET_V2;
+    if (setsockopt(ether_socket_, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) == -1) {
+        throw socket_open_error(make_error_string());
+    }
+    // Make the kernel skip malformed frames rather than stopping at them
+    int loss = 1;
+    if (setsockopt(ether_socket_, SOL_PACKET, PACKET_LOSS, &loss, sizeof(loss)) == -1) {
+        throw socket_open_error(make_error_string());
+    }
+
+    // Blocks have to be a multiple of the page size and hold whole frames
+    const uint32_t page_size = static_cast<uint32_t>(sysconf(_SC_PAGESIZE));
+    const uint32_t block_size = (tx_ring_.frame_size + page_size - 1) / page_size * page_size;
+    const uint32_t frames_per_block = block_size / tx_ring_.frame_size;
+    const uint32_t block_count = (tx_ring_.frame_count + frames_per_block - 1) / frames_per_block;
+
+    tpacket_req request;
+    memset(&request, 0, sizeof(request));
+    request.tp_block_size = block_size;
+    request.tp_block_nr = block_count;
+    request.tp_frame_size = tx_ring_.frame_size;
+    request.tp_frame_nr = frames_per_block * block_count;
+    if (setsockopt(ether_socket_, SOL_PACKET, PACKET_TX_RING, &request, sizeof(request)) == -1) {
+        throw socket_open_error(make_error_string());
+    }
+
+    const size_t ring_size = static_cast<size_t>(block_size) * block_count;
+    void* ring = mmap(0, ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_LOCKED, 
+                      ether_socket_, 0);
+    if (ring == MAP_FAILED) {
+        // MAP_LOCKED fails if we're over RLIMIT_MEMLOCK, try without it
+        ring = mmap(0, ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, ether_socket_, 0);
+        if (ring == MAP_FAILED) {
+            throw socket_open_error(make_error_string());
+        }
+    }
+    tx_ring_.buffer = (uint8_t*)ring;
+    tx_ring_.block_size = block_size;
+    tx_ring_.frames_per_block = frames_per_block;
+    tx_ring_.frame_count = frames_per_block * block_count;
+    tx_ring_.current_frame = 0;
+    tx_ring_.pending_frames = 0;
+    tx_ring_.pending_bytes = 0;
+}
+
+void PacketSender::unmap_tx_ring() {
+    if (tx_ring_.buffer) {
+        const uint32_t block_count = tx_ring_.frame_count / tx_ring_.frames_per_block;
+        munmap(tx_ring_.buffer, static_cast<size_t>(tx_ring_.block_size) * block_count);
+        tx_ring_.buffer = 0;
+        tx_ring_.current_frame = 0;
+        tx_ring_.pending_frames = 0;
+        tx_ring_.pending_bytes = 0;
+        tx_ring_address_.clear();
+    }
+}
+
+uint8_t* PacketSender::tx_ring_frame(uint32_t index) const {
+    const uint32_t block = index / tx_ring_.frames_per_block;
+    const uint32_t frame = index % tx_ring_.frames_per_block;
+    return tx_ring_.buffer + static_cast<size_t>(block) * tx_ring_.block_size + 
+           frame * tx_ring_.frame_size;
+}
+
+void PacketSender::wait_tx_ring_frame(const uint8_t* frame) {
+    const volatile uint32_t* status = &((const tpacket2_hdr*)frame)->tp_status;
+    while (*status != TP_STATUS_AVAILABLE) {
+        pollfd descriptor;
+        descriptor.fd = ether_socket_;
+        descriptor.events = POLLOUT;
+        descriptor.revents = 0;
+        if (poll(&descriptor, 1, tx_ring_poll_timeout) == -1 && errno != EINTR) {
+            throw socket_write_error(make_error_string());
+        }
+    }
+}
+
+void PacketSender::queue_tx_ring(const outgoing_packet& packet, struct sockaddr* link_addr,
+                                 uint32_t len_addr) {
+    const uint32_t size = packet.size();
+    if (size == 0) {
+        return;
+    }
+    if (size > tx_ring_.frame_size - tx_ring_data_offset) {
+        throw socket_write_error("Packet is too large for the transmit ring's frames");
+    }
+    // Every frame handed over at once is sent through the same interface
+    if (tx_ring_.pending_frames > 0) {
+        const struct sockaddr_ll* address = (const struct sockaddr_ll*)link_addr;
+        const struct sockaddr_ll* pending_address = 
+            (const struct sockaddr_ll*)&tx_ring_address_[0];
+        if (address->sll_ifindex != pending_address->sll_ifindex ||
+            address->sll_protocol != pending_address->sll_protocol) {
+            flush_tx_ring();
+        }
+    }
+    uint8_t* frame = tx_ring_frame(tx_ring_.current_frame);
+    tpacket2_hdr* header = (tpacket2_hdr*)frame;
+    if (((volatile tpacket2_hdr*)header)->tp_status != TP_STATUS_AVAILABLE) {
+        // The ring is full, hand over what's pending and wait for the kernel
+        flush_tx_ring();
+        wait_tx_ring_frame(frame);
+    }
+    // Don't write into the frame before the kernel is done with it
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (tx_ring_.pending_frames == 0) {
+        const uint8_t* address_ptr = (const uint8_t*)link_addr;
+        tx_ring_address_.assign(address_ptr, address_ptr + len_addr);
+    }
+    packet.write(frame + tx_ring_data_offset, size);
+    header->tp_len = size;
+    header->tp_snaplen = header->tp_len;
+    // The frame has to be complete before the kernel can see it
+    std::atomic_thread_fence(std::memory_order_release);
+    header->tp_status = TP_STATUS_SEND_REQUEST;
+    tx_ring_.current_frame = (tx_ring_.current_frame + 1) % tx_ring_.frame_count;
+    tx_ring_.pending_frames++;
+    tx_ring_.pending_bytes += size;
+    // When pacing, frames are handed over a burst at a time
+    if (pacer_.enabled && tx_ring_.pending_frames >= pacer_.burst_size) {
+        flush_tx_ring();
+    }
+}
+
+void PacketSender::flush_tx_ring() {
+    if (tx_ring_.pending_frames == 0) {
+        return;
+    }
+    wait_pacing(tx_ring_.pending_frames, tx_ring_.pending_bytes);
+    // Whatever happens, these frames now belong to the kernel
+    tx_ring_.pending_frames = 0;
+    tx_ring_.pending_bytes = 0;
+    const int flags = (tx_ring_.mode == NON_BLOCKING_FLUSH) ? MSG_DONTWAIT : 0;
+    while (::sendto(ether_socket_, 0, 0, flags, (const struct sockaddr*)&tx_ring_address_[0],
+                    static_cast<socklen_t>(tx_ring_address_.size())) == -1) {
+        if (errno != EINTR) {
+            throw socket_write_error(make_error_string());
+        }
+    }
+}
+
+void PacketSender::discard_tx_ring() {
+    // Give back the frames that were never handed over to the kernel
+    while (tx_ring_.pending_frames > 0) {
+        tx_ring_.current_frame = (tx_ring_.current_frame + tx_ring_.frame_count - 1) % 
+                                 tx_ring_.frame_count;
+        tpacket2_hdr* header = (tpacket2_hdr*)tx_ring_frame(tx_ring_.current_frame);
+        header->tp_status = TP_STATUS_AVAILABLE;
+        tx_ring_.pending_frames--;
+    }
+    tx_ring_.pending_bytes = 0;
+}
+
+#endif // TINS_HAVE_PACKET_SENDER_TX_RING
+
 PDU* PacketSender::recv_match_loop(const vector<int>& sockets, 
                                    PDU& pdu,
                                    struct sockaddr* link_addr,
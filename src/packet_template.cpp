@@ -0,0 +1,319 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <cstring>
+#ifndef _WIN32
+    #if !defined(BSD) && !defined(__FreeBSD_kernel__)
+        #include <netpacket/packet.h>
+        #include <net/ethernet.h>
+    #endif
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+#else
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+#endif
+#include <tins/packet_template.h>
+#include <tins/pdu.h>
+#include <tins/packet_sender.h>
+#include <tins/endianness.h>
+#include <tins/exceptions.h>
+
+namespace Tins {
+
+static uint16_t template_read_word(const uint8_t* ptr) {
+    return static_cast<uint16_t>((ptr[0] << 8) | ptr[1]);
+}
+
+static void template_write_word(uint8_t* ptr, uint16_t value) {
+    ptr[0] = static_cast<uint8_t>(value >> 8);
+    ptr[1] = static_cast<uint8_t>(value);
+}
+
+// Applies the difference between two one's complement sums to a checksum
+// stored at the given position, using RFC 1624's HC' = ~(~HC + ~m + m')
+static void template_update_checksum(uint8_t* ptr, uint32_t difference) {
+    uint32_t sum = static_cast<uint16_t>(~template_read_word(ptr)) + difference;
+    while (sum >> 16) {
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+    template_write_word(ptr, static_cast<uint16_t>(~sum));
+}
+
+PacketTemplate::PacketTemplate(PDU& pdu)
+: network_offset_(0), transport_offset_(0), network_type_(NO_LAYER), 
+  transport_type_(NO_LAYER), outer_type_(NO_LAYER) {
+    pdu.serialize_into(buffer_);
+    if (pdu.pdu_type() == PDU::IP) {
+        outer_type_ = IPV4_LAYER;
+    }
+    else if (pdu.pdu_type() == PDU::IPv6) {
+        outer_type_ = IPV6_LAYER;
+    }
+    // Headers are serialized one after the other, so each PDU starts 
+    // where the previous one's header ends
+    uint32_t offset = 0;
+    for (const PDU* current = &pdu; current; current = current->inner_pdu()) {
+        const PDU::PDUType type = current->pdu_type();
+        if (type == PDU::IP || type == PDU::IPv6) {
+            network_type_ = (type == PDU::IP) ? IPV4_LAYER : IPV6_LAYER;
+            network_offset_ = offset;
+        }
+        else if (type == PDU::TCP || type == PDU::UDP) {
+            // A transport layer only makes sense on top of a network layer
+            if (network_type_ != NO_LAYER) {
+                transport_type_ = (type == PDU::TCP) ? TCP_LAYER : UDP_LAYER;
+                transport_offset_ = offset;
+            }
+            break;
+        }
+        offset += current->header_size();
+    }
+}
+
+bool PacketTemplate::has_field(field_type field) const {
+    uint32_t offset, size;
+    return find_field(field, offset, size);
+}
+
+uint32_t PacketTemplate::field_offset(field_type field) const {
+    uint32_t offset, size;
+    if (!find_field(field, offset, size)) {
+        throw field_not_present();
+    }
+    return offset;
+}
+
+uint32_t PacketTemplate::field_size(field_type field) const {
+    uint32_t offset, size;
+    if (!find_field(field, offset, size)) {
+        throw field_not_present();
+    }
+    return size;
+}
+
+void PacketTemplate::id(uint16_t new_id) {
+    const uint16_t value = Endian::host_to_be(new_id);
+    write_field(IP_ID, (const uint8_t*)&value, sizeof(value));
+}
+
+void PacketTemplate::ttl(uint8_t new_ttl) {
+    write_field(TTL, &new_ttl, sizeof(new_ttl));
+}
+
+void PacketTemplate::src_addr(IPv4Address new_src_addr) {
+    const uint32_t value = new_src_addr;
+    write_field(SRC_ADDR, (const uint8_t*)&value, sizeof(value));
+}
+
+void PacketTemplate::dst_addr(IPv4Address new_dst_addr) {
+    const uint32_t value = new_dst_addr;
+    write_field(DST_ADDR, (const uint8_t*)&value, sizeof(value));
+}
+
+void PacketTemplate::src_addr(const IPv6Address& new_src_addr) {
+    write_field(SRC_ADDR, new_src_addr.begin(), IPv6Address::address_size);
+}
+
+void PacketTemplate::dst_addr(const IPv6Address& new_dst_addr) {
+    write_field(DST_ADDR, new_dst_addr.begin(), IPv6Address::address_size);
+}
+
+void PacketTemplate::sport(uint16_t new_sport) {
+    const uint16_t value = Endian::host_to_be(new_sport);
+    write_field(SPORT, (const uint8_t*)&value, sizeof(value));
+}
+
+void PacketTemplate::dport(uint16_t new_dport) {
+    const uint16_t value = Endian::host_to_be(new_dport);
+    write_field(DPORT, (const uint8_t*)&value, sizeof(value));
+}
+
+void PacketTemplate::seq(uint32_t new_seq) {
+    const uint32_t value = Endian::host_to_be(new_seq);
+    write_field(SEQ, (const uint8_t*)&value, sizeof(value));
+}
+
+void PacketTemplate::ack_seq(uint32_t new_ack_seq) {
+    const uint32_t value = Endian::host_to_be(new_ack_seq);
+    write_field(ACK_SEQ, (const uint8_t*)&value, sizeof(value));
+}
+
+void PacketTemplate::patch(field_type field, const uint8_t* value) {
+    write_field(field, value, field_size(field));
+}
+
+const uint8_t* PacketTemplate::data() const {
+    return buffer_.empty() ? 0 : &buffer_[0];
+}
+
+uint32_t PacketTemplate::size() const {
+    return static_cast<uint32_t>(buffer_.size());
+}
+
+void PacketTemplate::send(PacketSender& sender, const NetworkInterface& iface) {
+    uint8_t* buffer = buffer_.empty() ? 0 : &buffer_[0];
+    if (outer_type_ == NO_LAYER) {
+        if (!iface) {
+            throw invalid_interface();
+        }
+        #if defined(TINS_HAVE_PACKET_SENDER_PCAP_SENDPACKET) || defined(BSD) || defined(__FreeBSD_kernel__)
+            sender.send_l2(buffer, size(), 0, 0, iface);
+        #elif defined(_WIN32)
+            throw feature_disabled();
+        #else
+            struct sockaddr_ll addr;
+            memset(&addr, 0, sizeof(addr));
+            addr.sll_family = Endian::host_to_be<uint16_t>(PF_PACKET);
+            addr.sll_protocol = Endian::host_to_be<uint16_t>(ETH_P_ALL);
+            addr.sll_ifindex = iface.id();
+            // Ethernet frames start with the destination address
+            if (buffer_.size() >= 6) {
+                addr.sll_halen = 6;
+                memcpy(addr.sll_addr, buffer, 6);
+            }
+            sender.send_l2(buffer, size(), (struct sockaddr*)&addr, 
+                           (uint32_t)sizeof(addr), iface);
+        #endif
+    }
+    else {
+        // The destination is read from the packet, as it may have been modified
+        if (outer_type_ == IPV4_LAYER) {
+            sockaddr_in link_addr;
+            memset(&link_addr, 0, sizeof(link_addr));
+            link_addr.sin_family = AF_INET;
+            memcpy(&link_addr.sin_addr, buffer + 16, 4);
+            PacketSender::SocketType type = PacketSender::IP_RAW_SOCKET;
+            if (network_offset_ == 0 && transport_type_ == TCP_LAYER) {
+                type = PacketSender::IP_TCP_SOCKET;
+            }
+            else if (network_offset_ == 0 && transport_type_ == UDP_LAYER) {
+                type = PacketSender::IP_UDP_SOCKET;
+            }
+            sender.send_l3(buffer, size(), (struct sockaddr*)&link_addr, 
+                           sizeof(link_addr), type);
+        }
+        else {
+            sockaddr_in6 link_addr;
+            memset(&link_addr, 0, sizeof(link_addr));
+            link_addr.sin6_family = AF_INET6;
+            memcpy(&link_addr.sin6_addr, buffer + 24, IPv6Address::address_size);
+            sender.send_l3(buffer, size(), (struct sockaddr*)&link_addr, 
+                           sizeof(link_addr), PacketSender::IPV6_SOCKET);
+        }
+    }
+}
+
+bool PacketTemplate::find_field(field_type field, uint32_t& offset, uint32_t& size) const {
+    const bool is_ipv4 = network_type_ == IPV4_LAYER;
+    switch (field) {
+        case IP_ID:
+            offset = network_offset_ + 4;
+            size = 2;
+            return is_ipv4;
+        case TTL:
+            offset = network_offset_ + (is_ipv4 ? 8 : 7);
+            size = 1;
+            return network_type_ != NO_LAYER;
+        case SRC_ADDR:
+            offset = network_offset_ + (is_ipv4 ? 12 : 8);
+            size = is_ipv4 ? 4 : IPv6Address::address_size;
+            return network_type_ != NO_LAYER;
+        case DST_ADDR:
+            offset = network_offset_ + (is_ipv4 ? 16 : 24);
+            size = is_ipv4 ? 4 : IPv6Address::address_size;
+            return network_type_ != NO_LAYER;
+        case SPORT:
+            offset = transport_offset_;
+            size = 2;
+            return transport_type_ != NO_LAYER;
+        case DPORT:
+            offset = transport_offset_ + 2;
+            size = 2;
+            return transport_type_ != NO_LAYER;
+        case SEQ:
+            offset = transport_offset_ + 4;
+            size = 4;
+            return transport_type_ == TCP_LAYER;
+        case ACK_SEQ:
+            offset = transport_offset_ + 8;
+            size = 4;
+            return transport_type_ == TCP_LAYER;
+    }
+    return false;
+}
+
+void PacketTemplate::write_field(field_type field, const uint8_t* value, uint32_t value_size) {
+    uint32_t offset, size;
+    if (!find_field(field, offset, size) || size != value_size) {
+        throw field_not_present();
+    }
+    // The checksums are sums of 16 bit words that are aligned to the 
+    // start of the header that contains the field
+    const bool network_field = field == IP_ID || field == TTL || 
+                               field == SRC_ADDR || field == DST_ADDR;
+    const uint32_t header_offset = network_field ? network_offset_ : transport_offset_;
+    const uint32_t first = header_offset + ((offset - header_offset) & ~1u);
+    const uint32_t last = header_offset + ((offset + size - header_offset + 1) & ~1u);
+    if (last > buffer_.size()) {
+        throw field_not_present();
+    }
+    uint8_t* buffer = &buffer_[0];
+    uint32_t difference = 0;
+    for (uint32_t i = first; i < last; i += 2) {
+        difference += static_cast<uint16_t>(~template_read_word(buffer + i));
+    }
+    memcpy(buffer + offset, value, size);
+    for (uint32_t i = first; i < last; i += 2) {
+        difference += template_read_word(buffer + i);
+    }
+
+    // IPv4's header checksum doesn't cover anything beyond the header
+    if (network_field && network_type_ == IPV4_LAYER) {
+        template_update_checksum(buffer + network_offset_ + 10, difference);
+    }
+    // The transport layer checksums cover the addresses through the 
+    // pseudo header, but not the other network layer fields
+    const bool covered = !network_field || field == SRC_ADDR || field == DST_ADDR;
+    if (covered && transport_type_ == TCP_LAYER) {
+        template_update_checksum(buffer + transport_offset_ + 16, difference);
+    }
+    else if (covered && transport_type_ == UDP_LAYER) {
+        uint8_t* checksum = buffer + transport_offset_ + 6;
+        // A zero UDP checksum over IPv4 means there's no checksum at all
+        if (network_type_ == IPV6_LAYER || template_read_word(checksum) != 0) {
+            template_update_checksum(checksum, difference);
+            if (template_read_word(checksum) == 0) {
+                template_write_word(checksum, 0xffff);
+            }
+        }
+    }
+}
+
+} // Tins
@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <tins/packet_view.h>
+#include <tins/ethernetII.h>
+#include <tins/dot1q.h>
+#include <tins/ip.h>
+#include <tins/ipv6.h>
+#include <tins/arp.h>
+#include <tins/tcp.h>
+#include <tins/udp.h>
+#include <tins/icmp.h>
+#include <tins/detail/pdu_helpers.h>
+
+namespace Tins {
+
+PacketView::PacketView()
+: buffer_(0), size_(0), payload_offset_(0), payload_size_(0), layer_count_(0) {
+
+}
+
+PacketView::PacketView(const uint8_t* buffer, uint32_t total_sz, PDU::PDUType first_layer)
+: buffer_(buffer), size_(total_sz), payload_offset_(0), payload_size_(0),
+  layer_count_(0) {
+    parse(first_layer);
+}
+
+const PacketView::layer* PacketView::find_layer(PDU::PDUType type) const {
+    for (size_t i = 0; i < layer_count_; ++i) {
+        if (layers_[i].type == type) {
+            return &layers_[i];
+        }
+    }
+    return 0;
+}
+
+const PacketView::layer& PacketView::rfind_layer(PDU::PDUType type) const {
+    const layer* output = find_layer(type);
+    if (!output) {
+        throw pdu_not_found();
+    }
+    return *output;
+}
+
+void PacketView::add_layer(PDU::PDUType type, uint32_t offset, uint32_t header_size) {
+    layer& lyr = layers_[layer_count_++];
+    lyr.type = type;
+    lyr.offset = offset;
+    lyr.header_size = header_size;
+}
+
+void PacketView::parse(PDU::PDUType type) {
+    // The fixed part of the IPv6 header, which is not covered by its payload length
+    const uint32_t IPV6_HEADER_SIZE = 40;
+    uint32_t offset = 0;
+    // The end of the data that belongs to the current layers. This is
+    // moved backwards by network layers that advertise their own length
+    uint32_t end = size_;
+    // Leave one slot for the payload
+    while (offset < end && layer_count_ < MAX_LAYERS - 1) {
+        const uint8_t* ptr = buffer_ + offset;
+        const uint32_t remaining = end - offset;
+        PDU::metadata meta;
+        switch (type) {
+            case PDU::ETHERNET_II:
+                // 802.3 frames can't be told apart from EthernetII ones
+                // until the payload type is seen. These are left as payload
+                if (Internals::is_dot3(ptr, remaining)) {
+                    type = PDU::UNKNOWN;
+                }
+                else {
+                    meta = EthernetII::extract_metadata(ptr, remaining);
+                }
+                break;
+            case PDU::DOT1Q:
+            case PDU::DOT1AD:
+                meta = Dot1Q::extract_metadata(ptr, remaining);
+                break;
+            case PDU::IP:
+                meta = IP::extract_metadata(ptr, remaining);
+                {
+                    // Don't include link layer padding
+                    const uint16_t tot_len = header_view<IP>(ptr).tot_len();
+                    if (tot_len != 0 && tot_len < remaining) {
+                        end = offset + tot_len;
+                    }
+                }
+                break;
+            case PDU::IPv6:
+                meta = IPv6::extract_metadata(ptr, remaining);
+                {
+                    // A 0 payload length is used by jumbograms
+                    const uint16_t payload_length = header_view<IPv6>(ptr).payload_length();
+                    if (payload_length != 0 && IPV6_HEADER_SIZE + payload_length < remaining) {
+                        end = offset + IPV6_HEADER_SIZE + payload_length;
+                    }
+                }
+                break;
+            case PDU::ARP:
+                meta = ARP::extract_metadata(ptr, remaining);
+                break;
+            case PDU::TCP:
+                meta = TCP::extract_metadata(ptr, remaining);
+                break;
+            case PDU::UDP:
+                meta = UDP::extract_metadata(ptr, remaining);
+                break;
+            case PDU::ICMP:
+                meta = ICMP::extract_metadata(ptr, remaining);
+                break;
+            default:
+                type = PDU::UNKNOWN;
+                break;
+        }
+        if (type == PDU::UNKNOWN) {
+            break;
+        }
+        // The end may have been moved by a length field shorter than the header
+        if (TINS_UNLIKELY(meta.header_size == 0 || meta.header_size > end - offset)) {
+            throw malformed_packet();
+        }
+        add_layer(type, offset, meta.header_size);
+        offset += meta.header_size;
+        type = meta.next_pdu_type;
+    }
+    payload_offset_ = offset;
+    payload_size_ = end - offset;
+    if (payload_size_ > 0) {
+        add_layer(PDU::RAW, payload_offset_, payload_size_);
+    }
+}
+
+} // Tins
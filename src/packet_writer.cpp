@@ -30,9 +30,12 @@
 #ifndef _WIN32
     #include <sys/time.h>
 #endif
+#include <stdio.h>
 #include <string.h>
+#include <errno.h>
 #include <tins/packet_writer.h>
 #include <tins/packet.h>
+#include <tins/raw_packet.h>
 #include <tins/pdu.h>
 #include <tins/exceptions.h>
 
@@ -40,8 +43,10 @@ using std::string;
 
 namespace Tins {
 
-PacketWriter::PacketWriter(const string& file_name, LinkType lt) {
-    init(file_name, lt);
+const size_t PacketWriter::DEFAULT_BUFFER_SIZE = 1024 * 1024;
+
+PacketWriter::PacketWriter(const string& file_name, LinkType lt, size_t buffer_size) {
+    init(file_name, lt, buffer_size);
 }
 
 PacketWriter::~PacketWriter() {
@@ -74,17 +79,62 @@ void PacketWriter::write(PDU& pdu, const struct timeval& tv) {
     memset(&header, 0, sizeof(header));
     header.ts = tv;
     header.len = static_cast<bpf_u_int32>(pdu.advertised_size());
-    PDU::serialization_type buffer = pdu.serialize();
-    header.caplen = static_cast<bpf_u_int32>(buffer.size());
-    pcap_dump((u_char*)dumper_, &header, &buffer[0]);
+    header.caplen = static_cast<bpf_u_int32>(pdu.serialize_into(buffer_));
+    pcap_dump((u_char*)dumper_, &header, buffer_.empty() ? 0 : &buffer_[0]);
+}
+
+void PacketWriter::write_raw(const uint8_t* data, uint32_t size, const Timestamp& timestamp,
+                             uint32_t original_size) {
+    struct pcap_pkthdr header;
+    memset(&header, 0, sizeof(header));
+    header.ts.tv_sec = timestamp.seconds();
+    header.ts.tv_usec = timestamp.microseconds();
+    header.caplen = size;
+    header.len = original_size;
+    pcap_dump((u_char*)dumper_, &header, data);
+}
+
+void PacketWriter::write_raw(const RawPacket& frame) {
+    write_raw(frame.data(), frame.size(), frame.timestamp(), frame.original_size());
+}
+
+void PacketWriter::flush() {
+    if (pcap_dump_flush(dumper_) == -1) {
+        throw pcap_error("failed to flush the pcap file");
+    }
 }
 
-void PacketWriter::init(const string& file_name, int link_type) {
+void PacketWriter::init(const string& file_name, int link_type, size_t buffer_size) {
     handle_ = pcap_open_dead(link_type, 65535);
     if (!handle_) {
         throw pcap_open_failed();
     }
-    dumper_ = pcap_dump_open(handle_, file_name.c_str());
+    #ifdef _WIN32
+        // libpcap may use a different C runtime, so let it open the file
+        (void)buffer_size;
+        dumper_ = pcap_dump_open(handle_, file_name.c_str());
+    #else
+        if (file_name == "-") {
+            // libpcap writes to the standard output
+            dumper_ = pcap_dump_open(handle_, file_name.c_str());
+        }
+        else {
+            // Open the file ourselves so its buffer can be resized before 
+            // libpcap writes the file header
+            FILE* file = fopen(file_name.c_str(), "wb");
+            if (!file) {
+                pcap_close(handle_);
+                throw pcap_error(file_name + ": " + strerror(errno));
+            }
+            if (buffer_size > 0) {
+                setvbuf(file, 0, _IOFBF, buffer_size);
+            }
+            dumper_ = pcap_dump_fopen(handle_, file);
+            if (!dumper_) {
+                fclose(file);
+            }
+        }
+    #endif
     if (!dumper_) {
         string error(pcap_geterr(handle_));
         pcap_close(handle_);
@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <tins/parallel_file_processor.h>
+
+#if defined(TINS_HAVE_PCAP) && defined(TINS_HAVE_CXX11)
+
+#include <deque>
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <tins/raw_packet.h>
+#include <tins/pdu_arena.h>
+
+using std::string;
+using std::vector;
+using std::deque;
+using std::pair;
+using std::thread;
+using std::mutex;
+using std::unique_lock;
+using std::lock_guard;
+using std::unique_ptr;
+using std::exception_ptr;
+using std::condition_variable;
+
+namespace Tins {
+
+// The chunks found so far, shared between the thread that walks through
+// the file and the workers
+class chunk_queue {
+public:
+    typedef pair<uint64_t, uint64_t> chunk_type;
+
+    chunk_queue() : finished_(false) {
+
+    }
+
+    void push(uint64_t begin, uint64_t end) {
+        {
+            lock_guard<mutex> _(lock_);
+            if (finished_) {
+                return;
+            }
+            chunks_.push_back(chunk_type(begin, end));
+        }
+        condition_.notify_one();
+    }
+
+    bool pop(chunk_type& chunk) {
+        unique_lock<mutex> lock(lock_);
+        while (chunks_.empty() && !finished_) {
+            condition_.wait(lock);
+        }
+        if (chunks_.empty()) {
+            return false;
+        }
+        chunk = chunks_.front();
+        chunks_.pop_front();
+        return true;
+    }
+
+    // Wakes up every worker once the queue is drained. If discard is set,
+    // queued chunks are dropped as well
+    void finish(bool discard) {
+        {
+            lock_guard<mutex> _(lock_);
+            finished_ = true;
+            if (discard) {
+                chunks_.clear();
+            }
+        }
+        condition_.notify_all();
+    }
+
+    bool finished() {
+        lock_guard<mutex> _(lock_);
+        return finished_;
+    }
+private:
+    mutex lock_;
+    condition_variable condition_;
+    deque<chunk_type> chunks_;
+    bool finished_;
+};
+
+const uint64_t ParallelFileProcessor::DEFAULT_CHUNK_SIZE = 8 * 1024 * 1024;
+
+ParallelFileProcessor::ParallelFileProcessor(const string& file_name, 
+                                             uint32_t worker_count,
+                                             const SnifferConfiguration& configuration)
+: file_name_(file_name), configuration_(configuration), worker_count_(worker_count),
+  chunk_size_(DEFAULT_CHUNK_SIZE), extract_raw_(false), use_pdu_arena_(false) {
+    if (worker_count_ == 0) {
+        worker_count_ = std::max(1U, thread::hardware_concurrency());
+    }
+}
+
+void ParallelFileProcessor::run_workers(const worker_function& function) {
+    // Open every sniffer here so that errors are reported right away
+    MappedFileSniffer scanner(file_name_);
+    vector<unique_ptr<MappedFileSniffer> > sniffers;
+    for (uint32_t i = 0; i < worker_count_; ++i) {
+        sniffers.emplace_back(new MappedFileSniffer(file_name_, configuration_));
+        sniffers.back()->set_extract_raw_pdus(extract_raw_);
+    }
+
+    chunk_queue chunks;
+    mutex error_lock;
+    exception_ptr error;
+    vector<thread> threads;
+    try {
+        for (uint32_t i = 0; i < worker_count_; ++i) {
+            MappedFileSniffer* sniffer = sniffers[i].get();
+            threads.emplace_back([&, i, sniffer]() {
+                unique_ptr<PDUArena> arena;
+                unique_ptr<PDUArena::scope> use_arena;
+                if (use_pdu_arena_) {
+                    arena.reset(new PDUArena());
+                    use_arena.reset(new PDUArena::scope(*arena));
+                }
+                try {
+                    chunk_queue::chunk_type chunk;
+                    while (chunks.pop(chunk)) {
+                        sniffer->set_read_range(chunk.first, chunk.second);
+                        function(i, *sniffer);
+                    }
+                }
+                catch (...) {
+                    {
+                        lock_guard<mutex> _(error_lock);
+                        if (!error) {
+                            error = std::current_exception();
+                        }
+                    }
+                    chunks.finish(true);
+                }
+            });
+        }
+
+        // Walk through the record headers, cutting a chunk every chunk_size_ bytes
+        RawPacket frame;
+        uint64_t chunk_begin = scanner.position();
+        while (scanner.next_frame(frame)) {
+            const uint64_t position = scanner.position();
+            if (position - chunk_begin >= chunk_size_) {
+                if (chunks.finished()) {
+                    break;
+                }
+                chunks.push(chunk_begin, position);
+                chunk_begin = position;
+            }
+        }
+        if (scanner.position() > chunk_begin) {
+            chunks.push(chunk_begin, scanner.position());
+        }
+        chunks.finish(false);
+    }
+    catch (...) {
+        // Destroying a joinable thread terminates the program
+        chunks.finish(true);
+        for (size_t i = 0; i < threads.size(); ++i) {
+            threads[i].join();
+        }
+        throw;
+    }
+
+    for (size_t i = 0; i < threads.size(); ++i) {
+        threads[i].join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void ParallelFileProcessor::set_chunk_size(uint64_t size) {
+    chunk_size_ = size;
+}
+
+void ParallelFileProcessor::set_extract_raw_pdus(bool value) {
+    extract_raw_ = value;
+}
+
+void ParallelFileProcessor::set_use_pdu_arena(bool value) {
+    use_pdu_arena_ = value;
+}
+
+uint32_t ParallelFileProcessor::worker_count() const {
+    return worker_count_;
+}
+
+uint64_t ParallelFileProcessor::chunk_size() const {
+    return chunk_size_;
+}
+
+} // Tins
+
+#endif // TINS_HAVE_PCAP && TINS_HAVE_CXX11
@@ -0,0 +1,369 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <tins/pcapng_reader.h>
+
+#ifdef TINS_HAVE_PCAP
+
+#include <cstring>
+#include <algorithm>
+#include <errno.h>
+#include <tins/endianness.h>
+#include <tins/detail/sniffer_helpers.h>
+#include <tins/detail/pdu_helpers.h>
+#include <tins/detail/pcapng_helpers.h>
+
+using std::string;
+using std::vector;
+using std::min;
+
+using namespace Tins::Internals::Pcapng;
+
+namespace Tins {
+
+// Blocks larger than this are considered corrupt rather than allocated
+const uint32_t pcapng_max_block_size = 16 * 1024 * 1024;
+const uint32_t pcapng_read_buffer_size = 1024 * 1024;
+const uint64_t default_timestamp_units = 1000000;
+
+PcapngReader::PcapngReader(const string& file_name)
+: file_(fopen(file_name.c_str(), "rb")), offset_(0), block_offset_(0), 
+  section_offset_(0), block_type_(0), swap_bytes_(false), extract_raw_(false) {
+    if (!file_) {
+        throw pcap_error(file_name + ": " + strerror(errno));
+    }
+    setvbuf(file_, 0, _IOFBF, pcapng_read_buffer_size);
+    try {
+        if (!read_block() || block_type_ != SECTION_HEADER) {
+            throw pcap_error("unknown file format");
+        }
+        parse_section_header();
+    }
+    catch (...) {
+        fclose(file_);
+        throw;
+    }
+}
+
+PcapngReader::~PcapngReader() {
+    fclose(file_);
+}
+
+uint16_t PcapngReader::read_uint16(uint32_t offset) const {
+    uint16_t value;
+    memcpy(&value, &block_[offset], sizeof(value));
+    return swap_bytes_ ? Endian::do_change_endian(value) : value;
+}
+
+uint32_t PcapngReader::read_uint32(uint32_t offset) const {
+    uint32_t value;
+    memcpy(&value, &block_[offset], sizeof(value));
+    return swap_bytes_ ? Endian::do_change_endian(value) : value;
+}
+
+uint64_t PcapngReader::read_uint64(uint32_t offset) const {
+    uint64_t value;
+    memcpy(&value, &block_[offset], sizeof(value));
+    return swap_bytes_ ? Endian::do_change_endian(value) : value;
+}
+
+void PcapngReader::seek(uint64_t offset) {
+    #ifdef _WIN32
+        const int result = _fseeki64(file_, static_cast<__int64>(offset), SEEK_SET);
+    #else
+        const int result = fseeko(file_, static_cast<off_t>(offset), SEEK_SET);
+    #endif
+    if (result != 0) {
+        throw pcap_error(strerror(errno));
+    }
+    offset_ = offset;
+}
+
+void PcapngReader::restore_section(uint64_t section_offset, 
+                                   const vector<uint64_t>& interface_offsets) {
+    seek(section_offset);
+    if (!read_block() || block_type_ != SECTION_HEADER) {
+        throw pcap_error("invalid pcapng section offset");
+    }
+    parse_section_header();
+    for (size_t i = 0; i < interface_offsets.size(); ++i) {
+        seek(interface_offsets[i]);
+        if (!read_block() || block_type_ != INTERFACE_DESCRIPTION) {
+            throw pcap_error("invalid pcapng interface description offset");
+        }
+        parse_interface_description();
+    }
+}
+
+bool PcapngReader::read_block() {
+    uint8_t header[BLOCK_HEADER_SIZE + sizeof(uint32_t)];
+    uint32_t header_size = BLOCK_HEADER_SIZE;
+    block_offset_ = offset_;
+    if (fread(header, 1, BLOCK_HEADER_SIZE, file_) != BLOCK_HEADER_SIZE) {
+        return false;
+    }
+    uint32_t type;
+    uint32_t length;
+    memcpy(&type, header, sizeof(type));
+    memcpy(&length, header + sizeof(type), sizeof(length));
+    // The section header's type reads the same in both byte orders. Its 
+    // byte order magic defines the byte order used in the whole section
+    if (type == SECTION_HEADER) {
+        if (fread(header + header_size, 1, sizeof(uint32_t), file_) != sizeof(uint32_t)) {
+            return false;
+        }
+        uint32_t magic;
+        memcpy(&magic, header + header_size, sizeof(magic));
+        header_size += sizeof(uint32_t);
+        if (magic == BYTE_ORDER_MAGIC) {
+            swap_bytes_ = false;
+        }
+        else if (Endian::do_change_endian(magic) == BYTE_ORDER_MAGIC) {
+            swap_bytes_ = true;
+        }
+        else {
+            throw pcap_error("invalid pcapng section header");
+        }
+    }
+    if (swap_bytes_) {
+        type = Endian::do_change_endian(type);
+        length = Endian::do_change_endian(length);
+    }
+    if (length < header_size + BLOCK_TRAILER_SIZE || length % 4 != 0 ||
+        length > pcapng_max_block_size) {
+        throw pcap_error("invalid pcapng block length");
+    }
+    block_.resize(length);
+    memcpy(&block_[0], header, header_size);
+    const size_t remaining = length - header_size;
+    if (fread(&block_[header_size], 1, remaining, file_) != remaining) {
+        // Truncated block, consider the file to end here
+        return false;
+    }
+    offset_ += length;
+    block_type_ = type;
+    return true;
+}
+
+void PcapngReader::parse_section_header() {
+    // Block header, byte order magic and both version numbers
+    if (block_.size() < 28 || read_uint16(12) != MAJOR_VERSION) {
+        throw pcap_error("unsupported pcapng version");
+    }
+    interfaces_.clear();
+    interface_offsets_.clear();
+    section_offset_ = block_offset_;
+}
+
+void PcapngReader::parse_interface_description() {
+    // Block header, link type, reserved field and snapshot length
+    if (block_.size() < 20) {
+        return;
+    }
+    interface_description iface;
+    iface.link_type = Internals::link_type_from_file(read_uint16(8));
+    iface.snap_len = read_uint32(12);
+    iface.timestamp_units = default_timestamp_units;
+    iface.timestamp_offset = 0;
+
+    const uint32_t options_end = static_cast<uint32_t>(block_.size()) - BLOCK_TRAILER_SIZE;
+    uint32_t offset = 16;
+    while (options_end - offset >= 4) {
+        const uint16_t code = read_uint16(offset);
+        const uint16_t length = read_uint16(offset + 2);
+        offset += 4;
+        if (code == END_OF_OPTIONS || length > options_end - offset) {
+            break;
+        }
+        switch (code) {
+            case IF_NAME:
+                iface.name.assign(block_.begin() + offset, block_.begin() + offset + length);
+                // The name may be null terminated
+                iface.name = iface.name.c_str();
+                break;
+            case IF_TSRESOL:
+                if (length >= 1) {
+                    const uint8_t value = block_[offset];
+                    const uint8_t exponent = value & 0x7f;
+                    // The most significant bit indicates a power of 2 
+                    // rather than a power of 10
+                    if (value & 0x80) {
+                        if (exponent < 64) {
+                            iface.timestamp_units = static_cast<uint64_t>(1) << exponent;
+                        }
+                    }
+                    else if (exponent < 20) {
+                        iface.timestamp_units = 1;
+                        for (uint8_t i = 0; i < exponent; ++i) {
+                            iface.timestamp_units *= 10;
+                        }
+                    }
+                }
+                break;
+            case IF_TSOFFSET:
+                if (length >= 8) {
+                    iface.timestamp_offset = static_cast<int64_t>(read_uint64(offset));
+                }
+                break;
+        }
+        offset += min(pad_length(length), options_end - offset);
+    }
+    interfaces_.push_back(iface);
+    interface_offsets_.push_back(block_offset_);
+}
+
+Timestamp PcapngReader::make_timestamp(const interface_description& iface, 
+                                       uint64_t value) const {
+    const uint64_t units = iface.timestamp_units;
+    const uint64_t fraction = value % units;
+    uint64_t microseconds;
+    if (units % 1000000 == 0) {
+        microseconds = fraction / (units / 1000000);
+    }
+    else {
+        microseconds = static_cast<uint64_t>(static_cast<double>(fraction) * 1000000.0 / units);
+    }
+    struct timeval tv;
+    tv.tv_sec = static_cast<long>(value / units + iface.timestamp_offset);
+    tv.tv_usec = static_cast<long>(microseconds);
+    return tv;
+}
+
+bool PcapngReader::parse_packet(RawPacket& frame) {
+    const uint32_t data_end = static_cast<uint32_t>(block_.size()) - BLOCK_TRAILER_SIZE;
+    uint32_t interface_id;
+    uint64_t timestamp = 0;
+    uint32_t captured;
+    uint32_t original;
+    uint32_t data_offset;
+    if (block_type_ == SIMPLE_PACKET) {
+        if (block_.size() < 16) {
+            return false;
+        }
+        // Simple packet blocks always belong to the first interface and 
+        // only store the original length
+        interface_id = 0;
+        original = read_uint32(8);
+        data_offset = 12;
+        captured = min(original, data_end - data_offset);
+        if (!interfaces_.empty() && interfaces_[0].snap_len > 0) {
+            captured = min(captured, interfaces_[0].snap_len);
+        }
+    }
+    else {
+        if (block_.size() < 32) {
+            return false;
+        }
+        // Both enhanced and obsolete packet blocks share the same layout,
+        // except for the width of the interface identifier
+        if (block_type_ == ENHANCED_PACKET) {
+            interface_id = read_uint32(8);
+        }
+        else {
+            interface_id = read_uint16(8);
+        }
+        timestamp = (static_cast<uint64_t>(read_uint32(12)) << 32) | read_uint32(16);
+        captured = read_uint32(20);
+        original = read_uint32(24);
+        data_offset = 28;
+        if (captured > data_end - data_offset) {
+            return false;
+        }
+    }
+    // Skip packets that belong to interfaces that were never described
+    if (interface_id >= interfaces_.size()) {
+        return false;
+    }
+    frame = RawPacket(
+        &block_[data_offset], 
+        captured, 
+        original, 
+        make_timestamp(interfaces_[interface_id], timestamp),
+        interface_id
+    );
+    return true;
+}
+
+bool PcapngReader::next_frame(RawPacket& frame) {
+    while (read_block()) {
+        switch (block_type_) {
+            case SECTION_HEADER:
+                parse_section_header();
+                break;
+            case INTERFACE_DESCRIPTION:
+                parse_interface_description();
+                break;
+            case ENHANCED_PACKET:
+            case SIMPLE_PACKET:
+            case PACKET:
+                if (parse_packet(frame)) {
+                    return true;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    return false;
+}
+
+PtrPacket PcapngReader::next_packet() {
+    RawPacket frame;
+    while (next_frame(frame)) {
+        const int link_type = interfaces_[frame.interface_id()].link_type;
+        pcap_handler handler = Internals::sniff_handler_from_link_type(link_type, extract_raw_);
+        pcap_pkthdr header;
+        header.ts.tv_sec = frame.timestamp().seconds();
+        header.ts.tv_usec = frame.timestamp().microseconds();
+        header.caplen = frame.size();
+        header.len = frame.original_size();
+
+        Internals::sniff_data data;
+        handler((u_char*)&data, &header, frame.data());
+        // Skip malformed packets
+        if (data.pdu) {
+            // The frame's buffer is reused when the next one is read
+            Internals::own_raw_payloads(data.pdu);
+            return PtrPacket(data.pdu, data.tv, frame.interface_id());
+        }
+    }
+    return PtrPacket(0, Timestamp());
+}
+
+void PcapngReader::set_extract_raw_pdus(bool value) {
+    extract_raw_ = value;
+}
+
+const PcapngReader::interfaces_type& PcapngReader::interfaces() const {
+    return interfaces_;
+}
+
+} // Tins
+
+#endif // TINS_HAVE_PCAP
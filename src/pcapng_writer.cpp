@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <tins/pcapng_writer.h>
+
+#ifdef TINS_HAVE_PCAP
+
+#include <cstring>
+#include <stdexcept>
+#include <errno.h>
+#include <tins/pdu.h>
+#include <tins/packet.h>
+#include <tins/raw_packet.h>
+#include <tins/timestamp.h>
+#include <tins/exceptions.h>
+#include <tins/detail/sniffer_helpers.h>
+#include <tins/detail/pcapng_helpers.h>
+
+using std::string;
+
+using namespace Tins::Internals::Pcapng;
+
+namespace Tins {
+
+const size_t PcapngWriter::DEFAULT_BUFFER_SIZE = 1024 * 1024;
+
+PcapngWriter::PcapngWriter(const string& file_name, size_t buffer_size)
+: file_(fopen(file_name.c_str(), "wb")), buffer_size_(buffer_size), 
+  interface_count_(0) {
+    if (!file_) {
+        throw pcap_error(file_name + ": " + strerror(errno));
+    }
+    buffer_.reserve(buffer_size_);
+    // Block header, byte order magic, versions, section length and trailer
+    const uint32_t length = 28;
+    // The section's length is unknown
+    const uint64_t section_length = static_cast<uint64_t>(-1);
+    begin_block(SECTION_HEADER, length);
+    append_uint32(BYTE_ORDER_MAGIC);
+    append_uint16(MAJOR_VERSION);
+    append_uint16(MINOR_VERSION);
+    append(&section_length, sizeof(section_length));
+    append_uint32(length);
+}
+
+PcapngWriter::~PcapngWriter() {
+    try {
+        write_buffer();
+    }
+    catch (...) {
+
+    }
+    fclose(file_);
+}
+
+uint32_t PcapngWriter::add_interface(int link_type, const string& name, uint32_t snap_len) {
+    uint32_t options_length = 0;
+    if (!name.empty()) {
+        // The name option and the end of options marker
+        options_length = 4 + pad_length(static_cast<uint32_t>(name.size())) + 4;
+    }
+    const uint32_t length = BLOCK_HEADER_SIZE + 8 + options_length + BLOCK_TRAILER_SIZE;
+    begin_block(INTERFACE_DESCRIPTION, length);
+    append_uint16(static_cast<uint16_t>(Internals::link_type_to_file(link_type)));
+    append_uint16(0);
+    append_uint32(snap_len);
+    if (!name.empty()) {
+        append_uint16(IF_NAME);
+        append_uint16(static_cast<uint16_t>(name.size()));
+        append(name.data(), name.size());
+        append_padding(pad_length(static_cast<uint32_t>(name.size())) - 
+                       static_cast<uint32_t>(name.size()));
+        append_uint16(END_OF_OPTIONS);
+        append_uint16(0);
+    }
+    append_uint32(length);
+    return interface_count_++;
+}
+
+void PcapngWriter::write(PDU& pdu, uint32_t interface_id) {
+    write_packet(pdu, Timestamp::current_time(), interface_id);
+}
+
+void PcapngWriter::write(Packet& packet) {
+    write_packet(*packet.pdu(), packet.timestamp(), packet.interface_id());
+}
+
+void PcapngWriter::write(const RawPacket& frame) {
+    write_packet(frame.data(), frame.size(), frame.original_size(), frame.timestamp(),
+                 frame.interface_id());
+}
+
+void PcapngWriter::write_packet(const uint8_t* data, uint32_t size, uint32_t original_size,
+                                const Timestamp& ts, uint32_t interface_id) {
+    begin_packet(size, original_size, ts, interface_id);
+    append(data, size);
+    end_packet(size);
+}
+
+void PcapngWriter::write_packet(PDU& pdu, const Timestamp& ts, uint32_t interface_id) {
+    const uint32_t size = pdu.size();
+    begin_packet(size, pdu.advertised_size(), ts, interface_id);
+    // The PDU is serialized straight into the block
+    const size_t data_offset = buffer_.size();
+    buffer_.resize(data_offset + size);
+    if (size > 0) {
+        try {
+            pdu.serialize_into(&buffer_[data_offset], size);
+        }
+        catch (...) {
+            // Drop the incomplete block
+            buffer_.resize(data_offset - BLOCK_HEADER_SIZE - 20);
+            throw;
+        }
+    }
+    end_packet(size);
+}
+
+void PcapngWriter::begin_packet(uint32_t size, uint32_t original_size, const Timestamp& ts,
+                                uint32_t interface_id) {
+    if (interface_id >= interface_count_) {
+        throw std::runtime_error("Unknown interface id");
+    }
+    const uint64_t timestamp = static_cast<uint64_t>(ts.seconds()) * 1000000 + 
+                               ts.microseconds();
+    // Block header, interface id, timestamp, both lengths, data and trailer
+    const uint32_t length = BLOCK_HEADER_SIZE + 20 + pad_length(size) + BLOCK_TRAILER_SIZE;
+    if (!buffer_.empty() && buffer_.size() + length > buffer_size_) {
+        write_buffer();
+    }
+    begin_block(ENHANCED_PACKET, length);
+    append_uint32(interface_id);
+    append_uint32(static_cast<uint32_t>(timestamp >> 32));
+    append_uint32(static_cast<uint32_t>(timestamp));
+    append_uint32(size);
+    append_uint32(original_size);
+}
+
+void PcapngWriter::end_packet(uint32_t size) {
+    const uint32_t padded_size = pad_length(size);
+    append_padding(padded_size - size);
+    append_uint32(BLOCK_HEADER_SIZE + 20 + padded_size + BLOCK_TRAILER_SIZE);
+}
+
+void PcapngWriter::flush() {
+    write_buffer();
+    fflush(file_);
+}
+
+uint32_t PcapngWriter::interface_count() const {
+    return interface_count_;
+}
+
+void PcapngWriter::begin_block(uint32_t type, uint32_t length) {
+    append_uint32(type);
+    append_uint32(length);
+}
+
+void PcapngWriter::append(const void* data, size_t size) {
+    const uint8_t* ptr = static_cast<const uint8_t*>(data);
+    buffer_.insert(buffer_.end(), ptr, ptr + size);
+}
+
+void PcapngWriter::append_uint16(uint16_t value) {
+    append(&value, sizeof(value));
+}
+
+void PcapngWriter::append_uint32(uint32_t value) {
+    append(&value, sizeof(value));
+}
+
+void PcapngWriter::append_padding(uint32_t size) {
+    buffer_.insert(buffer_.end(), size, 0);
+}
+
+void PcapngWriter::write_buffer() {
+    if (buffer_.empty()) {
+        return;
+    }
+    const size_t size = buffer_.size();
+    const size_t written = fwrite(&buffer_[0], 1, size, file_);
+    buffer_.clear();
+    if (written != size) {
+        throw pcap_error(string("failed to write to file: ") + strerror(errno));
+    }
+}
+
+} // Tins
+
+#endif // TINS_HAVE_PCAP
@@ -29,9 +29,9 @@
  
 #include <tins/pdu.h>
 #include <tins/packet_sender.h>
+#include <tins/pdu_arena.h>
 
 using std::swap;
-using std::vector;
 
 namespace Tins {
 
@@ -48,22 +48,45 @@ PDU::metadata::metadata(uint32_t header_size, PDUType current_type, PDUType next
 // PDU
 
 PDU::PDU()
-: inner_pdu_(), parent_pdu_() {
+: inner_pdu_(), parent_pdu_(), layer_index_() {
 
 }
 
 PDU::PDU(const PDU& other) 
-: inner_pdu_(), parent_pdu_() {
+: inner_pdu_(), parent_pdu_(), layer_index_() {
     copy_inner_pdu(other);
 }
 
 PDU& PDU::operator=(const PDU& other) {
     copy_inner_pdu(other);
+    invalidate_layer_index();
     return* this;
 }
 
 PDU::~PDU() {
     delete inner_pdu_;
+    free_layer_index();
+}
+
+void* PDU::operator new(size_t size) {
+    return Internals::allocate_pdu(size);
+}
+
+void* PDU::operator new(size_t size, const std::nothrow_t&) TINS_NOEXCEPT {
+    try {
+        return Internals::allocate_pdu(size);
+    }
+    catch (const std::bad_alloc&) {
+        return 0;
+    }
+}
+
+void PDU::operator delete(void* ptr) {
+    Internals::deallocate_pdu(ptr);
+}
+
+void PDU::operator delete(void* ptr, const std::nothrow_t&) TINS_NOEXCEPT {
+    Internals::deallocate_pdu(ptr);
 }
 
 void PDU::copy_inner_pdu(const PDU& pdu) {
@@ -111,6 +134,7 @@ void PDU::inner_pdu(PDU* next_pdu) {
     if (inner_pdu_) {
         inner_pdu_->parent_pdu(this);
     }
+    invalidate_layer_index();
 }
 
 void PDU::inner_pdu(const PDU& next_pdu) {
@@ -123,15 +147,36 @@ PDU* PDU::release_inner_pdu() {
     if (result) {
         result->parent_pdu(0);
     }
+    invalidate_layer_index();
     return result;
 }
 
 PDU::serialization_type PDU::serialize() {
-    vector<uint8_t> buffer(size());
-    serialize(&buffer[0], static_cast<uint32_t>(buffer.size()));
+    serialization_type buffer;
+    serialize_into(buffer);
     return buffer;
 }
 
+size_t PDU::serialize_into(uint8_t* buffer, size_t capacity) {
+    const uint32_t total_sz = size();
+    if (total_sz > capacity) {
+        throw serialization_error();
+    }
+    if (total_sz > 0) {
+        serialize(buffer, total_sz);
+    }
+    return total_sz;
+}
+
+size_t PDU::serialize_into(serialization_type& buffer) {
+    const uint32_t total_sz = size();
+    buffer.resize(total_sz);
+    if (total_sz > 0) {
+        serialize(&buffer[0], total_sz);
+    }
+    return total_sz;
+}
+
 void PDU::serialize(uint8_t* buffer, uint32_t total_sz) {
     uint32_t sz = header_size() + trailer_size();
     // Must not happen...
@@ -147,6 +192,71 @@ void PDU::serialize(uint8_t* buffer, uint32_t total_sz) {
 
 void PDU::parent_pdu(PDU* parent) {
     parent_pdu_ = parent;
+    // Only the outermost PDU in a chain keeps an index
+    if (parent) {
+        free_layer_index();
+    }
+}
+
+PDU* PDU::search_layer(PDUType type) const {
+    const PDU* pdu = this;
+    while (pdu) {
+        if (pdu->matches_flag(type)) {
+            return const_cast<PDU*>(pdu);
+        }
+        pdu = pdu->inner_pdu();
+    }
+    return 0;
+}
+
+void PDU::build_layer_index() {
+    if (parent_pdu_) {
+        return;
+    }
+    free_layer_index();
+    // Indexes are allocated along with the PDUs, out of the current arena
+    layer_index* index = new (Internals::allocate_pdu(sizeof(layer_index))) layer_index();
+    index->types = 0;
+    index->complete = true;
+    uint32_t count = 0;
+    for (PDU* pdu = this; pdu; pdu = pdu->inner_pdu_) {
+        const PDUType type = pdu->pdu_type();
+        if (type >= 64) {
+            index->complete = false;
+            break;
+        }
+        const uint64_t bit = 1ULL << type;
+        if ((index->types & bit) == 0) {
+            if (count == layer_index::capacity) {
+                index->complete = false;
+                break;
+            }
+            // Keep the layers sorted by their type's bit
+            const uint32_t slot = layer_index::count_bits(index->types & (bit - 1));
+            for (uint32_t i = count; i > slot; --i) {
+                index->layers[i] = index->layers[i - 1];
+            }
+            index->layers[slot] = pdu;
+            index->types |= bit;
+            ++count;
+        }
+    }
+    layer_index_ = index;
+}
+
+void PDU::invalidate_layer_index() {
+    PDU* root = this;
+    while (root->parent_pdu_) {
+        root = root->parent_pdu_;
+    }
+    root->free_layer_index();
+}
+
+void PDU::free_layer_index() {
+    if (layer_index_) {
+        Internals::deallocate_pdu(layer_index_);
+        layer_index_ = 0;
+    }
 }
 
 } // Tins
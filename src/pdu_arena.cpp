@@ -0,0 +1,381 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#include <tins/pdu_arena.h>
+#include <new>
+#include <vector>
+#ifdef TINS_HAVE_CXX11
+    #include <atomic>
+    #include <mutex>
+#endif // TINS_HAVE_CXX11
+
+using std::vector;
+
+namespace Tins {
+
+#ifdef TINS_HAVE_CXX11
+
+// Allocations are rounded up to this, which keeps them aligned as 
+// operator new's would be
+static const size_t arena_alignment = 16;
+
+// Blocks are made out of whole pages, so every page is either entirely 
+// inside a block or has nothing to do with arenas
+static const size_t arena_page_bits = 12;
+static const size_t arena_page_size = size_t(1) << arena_page_bits;
+
+namespace Internals {
+
+struct pdu_arena_state;
+
+// Every block starts with this header, followed by its allocations
+struct pdu_arena_block {
+    pdu_arena_block(pdu_arena_state* owner, uint8_t* allocation, size_t size) 
+    : references(1), owner(owner), allocation(allocation), size(size), offset(0) {
+
+    }
+
+    // One for each live allocation, plus one while it's the current block
+    std::atomic<size_t> references;
+    pdu_arena_state* owner;
+    // What operator new returned, which is not page aligned
+    uint8_t* allocation;
+    // The size of the pages used by this block, including this header
+    size_t size;
+    // Only used by the thread that owns the arena
+    size_t offset;
+};
+
+struct pdu_arena_state {
+    pdu_arena_state(size_t block_size) 
+    : references(1), block_size(block_size), current(0), closed(false) {
+
+    }
+
+    // One for the arena object plus one for each block that is in use, 
+    // meaning it's the current block or it holds live allocations
+    std::atomic<size_t> references;
+    size_t block_size;
+    // Every block allocated by this arena. Only used by its owner
+    vector<pdu_arena_block*> blocks;
+    pdu_arena_block* current;
+    // Blocks which are not in use. These are pushed by whichever thread 
+    // deletes the last PDU in them
+    std::mutex free_blocks_lock;
+    vector<pdu_arena_block*> free_blocks;
+    // Set once the arena object is destroyed, after which blocks are 
+    // freed rather than reused
+    bool closed;
+};
+
+} // Internals
+
+using Internals::pdu_arena_block;
+using Internals::pdu_arena_state;
+
+static const size_t arena_block_header_size = 
+    (sizeof(pdu_arena_block) + arena_alignment - 1) & ~(arena_alignment - 1);
+
+// A three level radix tree that maps each page of an arena block to the
+// block, the same way a page table would. This covers 48 bit addresses. 
+// Nodes are never freed, so lookups don't need any locking.
+static const size_t arena_registry_bits = 12;
+static const size_t arena_registry_size = size_t(1) << arena_registry_bits;
+static const size_t arena_registry_mask = arena_registry_size - 1;
+
+struct arena_registry_leaf {
+    std::atomic<pdu_arena_block*> blocks[arena_registry_size];
+};
+
+struct arena_registry_node {
+    std::atomic<arena_registry_leaf*> leaves[arena_registry_size];
+};
+
+static std::atomic<arena_registry_node*> arena_registry[arena_registry_size];
+static std::mutex arena_registry_lock;
+// The amount of blocks in the registry. Programs that don't use arenas 
+// only check that this is 0 when deleting a PDU
+static std::atomic<size_t> arena_registered_blocks(0);
+// The amount of arena scopes alive on every thread. Same as the above, 
+// this avoids looking up the thread's arena when no scope exists
+static std::atomic<size_t> arena_active_scopes(0);
+
+static bool arena_registry_indexes(const void* ptr, size_t& root, size_t& node, 
+                                   size_t& leaf) {
+    const uint64_t page = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(ptr)) >> 
+                          arena_page_bits;
+    if (page >> (arena_registry_bits * 3)) {
+        return false;
+    }
+    root = static_cast<size_t>(page >> (arena_registry_bits * 2));
+    node = static_cast<size_t>(page >> arena_registry_bits) & arena_registry_mask;
+    leaf = static_cast<size_t>(page) & arena_registry_mask;
+    return true;
+}
+
+// Maps every page in [start, start + size) to the given block, or to 
+// null when unregistering it. Returns false, without changing anything, 
+// if the range lies outside of the addresses the registry covers
+static bool arena_registry_set(const uint8_t* start, size_t size, pdu_arena_block* value) {
+    size_t root, node, leaf;
+    // Pages are visited in increasing order, so the last one is the highest
+    if (size == 0 || !arena_registry_indexes(start + size - 1, root, node, leaf)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> _(arena_registry_lock);
+    for (size_t i = 0; i < size; i += arena_page_size) {
+        if (!arena_registry_indexes(start + i, root, node, leaf)) {
+            return false;
+        }
+        arena_registry_node* current_node = arena_registry[root].load(std::memory_order_relaxed);
+        if (!current_node) {
+            current_node = new arena_registry_node();
+            arena_registry[root].store(current_node, std::memory_order_release);
+        }
+        arena_registry_leaf* current_leaf = current_node->leaves[node].load(std::memory_order_relaxed);
+        if (!current_leaf) {
+            current_leaf = new arena_registry_leaf();
+            current_node->leaves[node].store(current_leaf, std::memory_order_release);
+        }
+        current_leaf->blocks[leaf].store(value, std::memory_order_release);
+    }
+    return true;
+}
+
+static void arena_free_block(pdu_arena_block* arena_block) {
+    arena_registry_set(reinterpret_cast<uint8_t*>(arena_block), arena_block->size, 0);
+    arena_registered_blocks.fetch_sub(1, std::memory_order_relaxed);
+    uint8_t* allocation = arena_block->allocation;
+    arena_block->~pdu_arena_block();
+    ::operator delete(allocation);
+}
+
+static void arena_release_state(pdu_arena_state* arena_state) {
+    if (arena_state->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete arena_state;
+    }
+}
+
+static void arena_release_block(pdu_arena_block* arena_block) {
+    if (arena_block->references.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+        return;
+    }
+    // This was the last reference, so the block is no longer in use
+    pdu_arena_state* owner = arena_block->owner;
+    bool closed;
+    {
+        std::lock_guard<std::mutex> _(owner->free_blocks_lock);
+        closed = owner->closed;
+        if (!closed) {
+            owner->free_blocks.push_back(arena_block);
+        }
+    }
+    if (closed) {
+        arena_free_block(arena_block);
+    }
+    arena_release_state(owner);
+}
+
+static pdu_arena_block* arena_find_block(const void* ptr) {
+    size_t root, node, leaf;
+    if (!arena_registry_indexes(ptr, root, node, leaf)) {
+        return 0;
+    }
+    arena_registry_node* current_node = arena_registry[root].load(std::memory_order_acquire);
+    if (!current_node) {
+        return 0;
+    }
+    arena_registry_leaf* current_leaf = current_node->leaves[node].load(std::memory_order_acquire);
+    if (!current_leaf) {
+        return 0;
+    }
+    return current_leaf->blocks[leaf].load(std::memory_order_acquire);
+}
+
+static pdu_arena_block* arena_next_block(pdu_arena_state* arena_state) {
+    pdu_arena_block* previous = arena_state->current;
+    if (previous) {
+        // If every PDU in the current block was deleted, keep using it. 
+        // Otherwise, the last one to be deleted puts it in the free list
+        if (previous->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            previous->references.store(1, std::memory_order_relaxed);
+            previous->offset = 0;
+            return previous;
+        }
+        arena_state->current = 0;
+    }
+    pdu_arena_block* arena_block = 0;
+    {
+        std::lock_guard<std::mutex> _(arena_state->free_blocks_lock);
+        if (!arena_state->free_blocks.empty()) {
+            arena_block = arena_state->free_blocks.back();
+            arena_state->free_blocks.pop_back();
+        }
+    }
+    if (arena_block) {
+        arena_block->references.store(1, std::memory_order_relaxed);
+        arena_block->offset = 0;
+    }
+    else {
+        // Use whole pages, starting at a page boundary
+        const size_t used_size = arena_block_header_size + arena_state->block_size;
+        const size_t size = (used_size + arena_page_size - 1) & ~(arena_page_size - 1);
+        uint8_t* allocation = static_cast<uint8_t*>(::operator new(size + arena_page_size));
+        uint8_t* start = reinterpret_cast<uint8_t*>(
+            (reinterpret_cast<uintptr_t>(allocation) + arena_page_size - 1) & 
+            ~(arena_page_size - 1)
+        );
+        arena_block = new (start) pdu_arena_block(arena_state, allocation, size);
+        if (!arena_registry_set(start, size, arena_block)) {
+            // Addresses beyond 48 bits can't be registered, so this 
+            // allocation is served from the heap instead
+            arena_block->~pdu_arena_block();
+            ::operator delete(allocation);
+            return 0;
+        }
+        arena_registered_blocks.fetch_add(1, std::memory_order_relaxed);
+        arena_state->blocks.push_back(arena_block);
+    }
+    arena_state->references.fetch_add(1, std::memory_order_relaxed);
+    arena_state->current = arena_block;
+    return arena_block;
+}
+
+static thread_local PDUArena* current_arena = 0;
+
+const size_t PDUArena::DEFAULT_BLOCK_SIZE = 65536;
+
+// PDUArena::scope
+
+PDUArena::scope::scope(PDUArena& arena) 
+: previous_(current_arena) {
+    current_arena = &arena;
+    arena_active_scopes.fetch_add(1, std::memory_order_relaxed);
+}
+
+PDUArena::scope::~scope() {
+    current_arena = previous_;
+    arena_active_scopes.fetch_sub(1, std::memory_order_relaxed);
+}
+
+// PDUArena
+
+PDUArena::PDUArena(size_t block_size)
+: state_(new pdu_arena_state(block_size)) {
+
+}
+
+PDUArena::~PDUArena() {
+    {
+        std::lock_guard<std::mutex> _(state_->free_blocks_lock);
+        state_->closed = true;
+        for (size_t i = 0; i < state_->free_blocks.size(); ++i) {
+            arena_free_block(state_->free_blocks[i]);
+        }
+        state_->free_blocks.clear();
+    }
+    if (state_->current) {
+        arena_release_block(state_->current);
+    }
+    arena_release_state(state_);
+}
+
+size_t PDUArena::live_allocations() const {
+    size_t output = 0;
+    for (size_t i = 0; i < state_->blocks.size(); ++i) {
+        output += state_->blocks[i]->references.load(std::memory_order_acquire);
+    }
+    // Don't count the current block's own reference
+    return state_->current ? output - 1 : output;
+}
+
+size_t PDUArena::capacity() const {
+    return state_->blocks.size() * state_->block_size;
+}
+
+PDUArena* PDUArena::current() {
+    return current_arena;
+}
+
+void* PDUArena::allocate(size_t size) {
+    const size_t total_size = (size + arena_alignment - 1) & ~(arena_alignment - 1);
+    if (total_size > state_->block_size) {
+        return 0;
+    }
+    pdu_arena_block* arena_block = state_->current;
+    // If the current block only holds its own reference, nobody else can 
+    // touch its memory anymore so it can be reused from the start
+    if (arena_block && arena_block->references.load(std::memory_order_acquire) == 1) {
+        arena_block->offset = 0;
+    }
+    if (!arena_block || arena_block->offset + total_size > state_->block_size) {
+        arena_block = arena_next_block(state_);
+        if (!arena_block) {
+            return 0;
+        }
+    }
+    uint8_t* ptr = reinterpret_cast<uint8_t*>(arena_block) + arena_block_header_size + 
+                   arena_block->offset;
+    arena_block->offset += total_size;
+    arena_block->references.fetch_add(1, std::memory_order_relaxed);
+    return ptr;
+}
+
+#endif // TINS_HAVE_CXX11
+
+namespace Internals {
+
+void* allocate_pdu(size_t size) {
+    #ifdef TINS_HAVE_CXX11
+        if (arena_active_scopes.load(std::memory_order_relaxed) != 0 && current_arena) {
+            void* ptr = current_arena->allocate(size);
+            if (ptr) {
+                return ptr;
+            }
+        }
+    #endif // TINS_HAVE_CXX11
+    return ::operator new(size);
+}
+
+void deallocate_pdu(void* ptr) {
+    #ifdef TINS_HAVE_CXX11
+        if (ptr && arena_registered_blocks.load(std::memory_order_relaxed) != 0) {
+            pdu_arena_block* arena_block = arena_find_block(ptr);
+            if (arena_block) {
+                arena_release_block(arena_block);
+                return;
+            }
+        }
+    #endif // TINS_HAVE_CXX11
+    ::operator delete(ptr);
+}
+
+} // Internals
+} // Tins
@@ -32,6 +32,7 @@
 #include <tins/rawpdu.h>
 #include <tins/exceptions.h>
 #include <tins/memory_helpers.h>
+#include <tins/detail/pdu_helpers.h>
 
 using std::string;
 using std::vector;
@@ -60,7 +61,7 @@ PPPoE::PPPoE(const uint8_t* buffer, uint32_t total_sz)
     if (code() == 0) {
         if (stream) {
             inner_pdu(
-                new RawPDU(stream.pointer(), stream.size())
+                Internals::raw_pdu_from_buffer(stream.pointer(), stream.size())
             );
         }
     }
@@ -0,0 +1,311 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <tins/probe_engine.h>
+
+#if defined(TINS_HAVE_PCAP) && defined(TINS_HAVE_CXX11)
+
+#include <random>
+#include <cstring>
+#include <stdexcept>
+#include <sstream>
+#include <tins/packet_sender.h>
+#include <tins/sniffer.h>
+#include <tins/packet.h>
+#include <tins/ip.h>
+#include <tins/tcp.h>
+#include <tins/icmp.h>
+#include <tins/rawpdu.h>
+#include <tins/constants.h>
+#include <tins/memory_helpers.h>
+
+using std::lock_guard;
+using std::mutex;
+using std::thread;
+using std::exception_ptr;
+using std::ostringstream;
+
+using Tins::Memory::InputMemoryStream;
+
+namespace Tins {
+
+const uint16_t ProbeEngine::DEFAULT_SOURCE_PORT = 61000;
+
+static uint64_t probe_engine_rotl(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static void probe_engine_sipround(uint64_t* v) {
+    v[0] += v[1]; v[1] = probe_engine_rotl(v[1], 13); v[1] ^= v[0];
+    v[0] = probe_engine_rotl(v[0], 32);
+    v[2] += v[3]; v[3] = probe_engine_rotl(v[3], 16); v[3] ^= v[2];
+    v[0] += v[3]; v[3] = probe_engine_rotl(v[3], 21); v[3] ^= v[0];
+    v[2] += v[1]; v[1] = probe_engine_rotl(v[1], 17); v[1] ^= v[2];
+    v[2] = probe_engine_rotl(v[2], 32);
+}
+
+// SipHash-2-4
+static uint64_t probe_engine_siphash(const uint8_t* data, size_t size, const uint64_t* key) {
+    uint64_t v[4] = {
+        key[0] ^ 0x736f6d6570736575ULL,
+        key[1] ^ 0x646f72616e646f6dULL,
+        key[0] ^ 0x6c7967656e657261ULL,
+        key[1] ^ 0x7465646279746573ULL
+    };
+    const size_t full_blocks = size / 8;
+    for (size_t i = 0; i < full_blocks; ++i) {
+        uint64_t block = 0;
+        for (int j = 7; j >= 0; --j) {
+            block = (block << 8) | data[i * 8 + j];
+        }
+        v[3] ^= block;
+        probe_engine_sipround(v);
+        probe_engine_sipround(v);
+        v[0] ^= block;
+    }
+    uint64_t last = static_cast<uint64_t>(size) << 56;
+    for (size_t i = full_blocks * 8; i < size; ++i) {
+        last |= static_cast<uint64_t>(data[i]) << (8 * (i - full_blocks * 8));
+    }
+    v[3] ^= last;
+    probe_engine_sipround(v);
+    probe_engine_sipround(v);
+    v[0] ^= last;
+    v[2] ^= 0xff;
+    for (int i = 0; i < 4; ++i) {
+        probe_engine_sipround(v);
+    }
+    return v[0] ^ v[1] ^ v[2] ^ v[3];
+}
+
+static PacketTemplate probe_engine_make_template(IPv4Address source_address, uint16_t source_port) {
+    TCP tcp(0, source_port);
+    tcp.set_flag(TCP::SYN, 1);
+    tcp.window(1024);
+    IP packet = IP(IPv4Address(), source_address) / tcp;
+    return PacketTemplate(packet);
+}
+
+ProbeEngine::ProbeEngine(PacketSender& sender, IPv4Address source_address, 
+                         result_callback_type callback)
+: sender_(sender), callback_(callback), 
+  template_(probe_engine_make_template(source_address, DEFAULT_SOURCE_PORT)),
+  source_address_(source_address), source_port_(DEFAULT_SOURCE_PORT), sniffer_(0),
+  stopped_(false), sent_(0), matched_(0), unmatched_(0) {
+    std::random_device device;
+    for (int i = 0; i < 2; ++i) {
+        key_[i] = (static_cast<uint64_t>(device()) << 32) | device();
+    }
+}
+
+ProbeEngine::~ProbeEngine() {
+    if (sniffer_) {
+        stopped_ = true;
+        sniffer_->stop_sniff();
+        capture_thread_.join();
+    }
+}
+
+void ProbeEngine::rate(uint32_t probes_per_second) {
+    if (probes_per_second == 0) {
+        sender_.disable_pacing();
+    }
+    else {
+        sender_.enable_pacing(probes_per_second);
+    }
+}
+
+void ProbeEngine::source_port(uint16_t port) {
+    if (sniffer_) {
+        throw std::runtime_error("The source port can't be changed while capturing");
+    }
+    template_.sport(port);
+    source_port_ = port;
+}
+
+void ProbeEngine::key(uint64_t k0, uint64_t k1) {
+    if (sniffer_) {
+        throw std::runtime_error("The key can't be changed while capturing");
+    }
+    key_[0] = k0;
+    key_[1] = k1;
+}
+
+void ProbeEngine::start(BaseSniffer& sniffer) {
+    if (sniffer_) {
+        throw std::runtime_error("The engine is already capturing");
+    }
+    // Only responses to our source port and ICMP destination unreachable
+    // messages are of interest. The filter is just an optimization, as 
+    // every packet is matched anyway
+    ostringstream filter;
+    filter << "dst host " << source_address_ << " and ((tcp and dst port " 
+           << source_port_ << ") or (icmp and icmp[0] == 3))";
+    sniffer.set_filter(filter.str());
+    stopped_ = false;
+    error_ = exception_ptr();
+    sniffer_ = &sniffer;
+    capture_thread_ = thread(&ProbeEngine::capture, this, std::ref(sniffer));
+}
+
+void ProbeEngine::probe(IPv4Address address, uint16_t port, const NetworkInterface& iface) {
+    template_.dst_addr(address);
+    template_.dport(port);
+    template_.seq(cookie(address, port));
+    template_.send(sender_, iface);
+    ++sent_;
+}
+
+void ProbeEngine::finish() {
+    if (sniffer_) {
+        stopped_ = true;
+        sniffer_->stop_sniff();
+        capture_thread_.join();
+        sniffer_ = 0;
+    }
+    exception_ptr error;
+    {
+        lock_guard<mutex> _(lock_);
+        error = error_;
+        error_ = exception_ptr();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+bool ProbeEngine::match(const PDU& pdu, probe_result& result) const {
+    const IP* ip = pdu.find_pdu<IP>();
+    if (!ip || ip->dst_addr() != source_address_) {
+        return false;
+    }
+    if (const TCP* tcp = ip->find_pdu<TCP>()) {
+        if (tcp->dport() != source_port_ || !tcp->get_flag(TCP::ACK) ||
+            tcp->ack_seq() != cookie(ip->src_addr(), tcp->sport()) + 1) {
+            return false;
+        }
+        if (tcp->get_flag(TCP::RST)) {
+            result.status = CLOSED;
+        }
+        else if (tcp->get_flag(TCP::SYN)) {
+            result.status = OPEN;
+        }
+        else {
+            return false;
+        }
+        result.address = ip->src_addr();
+        result.port = tcp->sport();
+        result.ttl = ip->ttl();
+        return true;
+    }
+    const ICMP* icmp = ip->find_pdu<ICMP>();
+    const RawPDU* quoted = icmp ? icmp->find_pdu<RawPDU>() : 0;
+    if (!quoted || icmp->type() != ICMP::DEST_UNREACHABLE) {
+        return false;
+    }
+    // The message quotes the probe's IP header and the first 8 bytes of 
+    // its TCP header, which include the ports and the sequence number
+    const RawPDU::payload_type& payload = quoted->payload();
+    if (payload.size() < 20) {
+        return false;
+    }
+    const uint32_t header_size = (payload[0] & 0x0f) * sizeof(uint32_t);
+    if (header_size < 20 || payload.size() < header_size + 8 || 
+        payload[9] != Constants::IP::PROTO_TCP) {
+        return false;
+    }
+    InputMemoryStream stream(&payload[12], payload.size() - 12);
+    IPv4Address probe_source;
+    IPv4Address probe_destination;
+    stream.read(probe_source);
+    stream.read(probe_destination);
+    stream.skip(header_size - 20);
+    const uint16_t probe_sport = stream.read_be<uint16_t>();
+    const uint16_t probe_dport = stream.read_be<uint16_t>();
+    const uint32_t probe_seq = stream.read_be<uint32_t>();
+    if (probe_source != source_address_ || probe_sport != source_port_ ||
+        probe_seq != cookie(probe_destination, probe_dport)) {
+        return false;
+    }
+    result.address = probe_destination;
+    result.port = probe_dport;
+    result.status = UNREACHABLE;
+    result.ttl = ip->ttl();
+    return true;
+}
+
+uint32_t ProbeEngine::cookie(IPv4Address address, uint16_t port) const {
+    uint8_t buffer[12];
+    const uint32_t address_value = address;
+    const uint32_t source_value = source_address_;
+    std::memcpy(buffer, &address_value, sizeof(address_value));
+    buffer[4] = port >> 8;
+    buffer[5] = port & 0xff;
+    std::memcpy(buffer + 6, &source_value, sizeof(source_value));
+    buffer[10] = source_port_ >> 8;
+    buffer[11] = source_port_ & 0xff;
+    return static_cast<uint32_t>(probe_engine_siphash(buffer, sizeof(buffer), key_));
+}
+
+ProbeEngine::statistics ProbeEngine::stats() const {
+    statistics output;
+    output.sent = sent_;
+    output.matched = matched_;
+    output.unmatched = unmatched_;
+    return output;
+}
+
+void ProbeEngine::capture(BaseSniffer& sniffer) {
+    try {
+        sniffer.sniff_loop([&](Packet& packet) {
+            process(*packet.pdu(), packet.timestamp());
+            return !stopped_;
+        });
+    }
+    catch (...) {
+        lock_guard<mutex> _(lock_);
+        error_ = std::current_exception();
+    }
+}
+
+bool ProbeEngine::process(const PDU& pdu, const Timestamp& timestamp) {
+    probe_result result;
+    if (!match(pdu, result)) {
+        ++unmatched_;
+        return false;
+    }
+    ++matched_;
+    result.timestamp = timestamp;
+    callback_(result);
+    return true;
+}
+
+} // Tins
+
+#endif // TINS_HAVE_PCAP && TINS_HAVE_CXX11
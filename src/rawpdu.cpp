@@ -33,27 +33,83 @@
 using Tins::Memory::OutputMemoryStream;
 
 namespace Tins {
+
+#ifdef TINS_HAVE_CXX11
+
+// Whether payloads parsed on this thread are borrowed
+static thread_local bool borrowing_payloads = false;
+
+RawPDU::borrow_scope::borrow_scope()
+: previous_(borrowing_payloads) {
+    borrowing_payloads = true;
+}
+
+RawPDU::borrow_scope::~borrow_scope() {
+    borrowing_payloads = previous_;
+}
+
+#endif // TINS_HAVE_CXX11
+
+bool RawPDU::borrowing() {
+    #ifdef TINS_HAVE_CXX11
+        return borrowing_payloads;
+    #else
+        return false;
+    #endif // TINS_HAVE_CXX11
+}
+
 RawPDU::RawPDU(const uint8_t* pload, uint32_t size) 
-: payload_(pload, pload + size) {
+: payload_(pload, pload + size), borrowed_payload_(0), borrowed_size_(0) {
     
 }
 
+RawPDU::RawPDU(const uint8_t* pload, uint32_t size, borrow_tag)
+: borrowed_payload_(pload), borrowed_size_(size) {
+
+}
+
 RawPDU::RawPDU(const std::string& data) 
-: payload_(data.begin(), data.end()) {
+: payload_(data.begin(), data.end()), borrowed_payload_(0), borrowed_size_(0) {
     
 }
 
+RawPDU::RawPDU(const RawPDU& other)
+: PDU(other), payload_(other.payload_data(), other.payload_data() + other.payload_size()),
+  borrowed_payload_(0), borrowed_size_(0) {
+
+}
+
+RawPDU& RawPDU::operator=(const RawPDU& other) {
+    if (this != &other) {
+        PDU::operator=(other);
+        payload_.assign(other.payload_data(), other.payload_data() + other.payload_size());
+        borrowed_payload_ = 0;
+        borrowed_size_ = 0;
+    }
+    return *this;
+}
+
 uint32_t RawPDU::header_size() const {
-    return static_cast<uint32_t>(payload_.size());
+    return payload_size();
 }
 
 void RawPDU::write_serialization(uint8_t* buffer, uint32_t total_sz) {
     OutputMemoryStream stream(buffer, total_sz);
-    stream.write(payload_.begin(), payload_.end());
+    stream.write(payload_data(), payload_size());
+}
+
+void RawPDU::own_payload() const {
+    if (borrowed_payload_) {
+        payload_.assign(borrowed_payload_, borrowed_payload_ + borrowed_size_);
+        borrowed_payload_ = 0;
+        borrowed_size_ = 0;
+    }
 }
 
 void RawPDU::payload(const payload_type& pload) {
     payload_ = pload;
+    borrowed_payload_ = 0;
+    borrowed_size_ = 0;
 }
 
 bool RawPDU::matches_response(const uint8_t* /*ptr*/, uint32_t /*total_sz*/) const {
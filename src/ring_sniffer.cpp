@@ -0,0 +1,398 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <tins/ring_sniffer.h>
+
+#ifdef TINS_HAVE_PACKET_RING
+
+#include <cstring>
+#include <algorithm>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <net/if.h>
+#include <net/if_arp.h>
+#include <netinet/in.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <linux/filter.h>
+#include <tins/network_interface.h>
+#include <tins/detail/sniffer_helpers.h>
+
+using std::string;
+using std::min;
+
+namespace Tins {
+
+// The frame size is irrelevant for TPACKET_V3 rings, as frames are packed
+// into blocks. The kernel still validates it, so use any aligned value.
+static const uint32_t ring_frame_size = TPACKET_ALIGNMENT << 7;
+
+static tpacket_block_desc* ring_block(uint8_t* ring, uint32_t block_size, uint32_t index) {
+    return (tpacket_block_desc*)(ring + static_cast<size_t>(index) * block_size);
+}
+
+static int link_type_from_arp_type(unsigned short arp_type) {
+    switch (arp_type) {
+        case ARPHRD_ETHER:
+        case ARPHRD_LOOPBACK:
+            return DLT_EN10MB;
+        case ARPHRD_IEEE80211_RADIOTAP:
+            return DLT_IEEE802_11_RADIO;
+        case ARPHRD_IEEE80211:
+            return DLT_IEEE802_11;
+        case ARPHRD_NONE:
+        case ARPHRD_PPP:
+        case ARPHRD_TUNNEL:
+        case ARPHRD_TUNNEL6:
+            return DLT_RAW;
+        default:
+            throw unknown_link_type();
+    };
+}
+
+RingSniffer::RingSniffer(const string& device, const SnifferConfiguration& configuration)
+: socket_(-1), iface_index_(0), link_type_(0), ring_(0),
+  block_size_(SnifferConfiguration::DEFAULT_RING_BLOCK_SIZE),
+  block_count_(SnifferConfiguration::DEFAULT_RING_BLOCK_COUNT),
+  frame_timeout_(SnifferConfiguration::DEFAULT_RING_FRAME_TIMEOUT),
+  snap_len_(SnifferConfiguration::DEFAULT_SNAP_LEN),
+  timeout_(SnifferConfiguration::DEFAULT_TIMEOUT), direction_(PCAP_D_INOUT),
+  current_block_(0), current_frame_(0), frames_left_(0), block_acquired_(false),
+  extract_raw_(false), stop_(false) {
+    try {
+        init(device, configuration);
+    }
+    catch (...) {
+        cleanup();
+        throw;
+    }
+}
+
+RingSniffer::~RingSniffer() {
+    cleanup();
+}
+
+void RingSniffer::cleanup() {
+    if (ring_) {
+        munmap(ring_, static_cast<size_t>(block_size_) * block_count_);
+        ring_ = 0;
+    }
+    if (socket_ != -1) {
+        close(socket_);
+        socket_ = -1;
+    }
+}
+
+void RingSniffer::init(const string& device, const SnifferConfiguration& configuration) {
+    iface_index_ = NetworkInterface(device).id();
+    // Don't use ETH_P_ALL until the socket is bound, otherwise we'd
+    // be getting packets from every interface in the meantime
+    socket_ = socket(AF_PACKET, SOCK_RAW, 0);
+    if (socket_ == -1) {
+        throw socket_open_error(strerror(errno));
+    }
+
+    ifreq request;
+    memset(&request, 0, sizeof(request));
+    strncpy(request.ifr_name, device.c_str(), sizeof(request.ifr_name) - 1);
+    if (ioctl(socket_, SIOCGIFHWADDR, &request) == -1) {
+        throw socket_open_error(strerror(errno));
+    }
+    link_type_ = link_type_from_arp_type(request.ifr_hwaddr.sa_family);
+
+    // Configure the sniffer's attributes prior to creating the ring.
+    configuration.configure_sniffer_pre_activation(*this);
+
+    setup_ring();
+
+    // Configure the sniffer's attributes after creating the ring.
+    configuration.configure_sniffer_post_activation(*this);
+
+    sockaddr_ll address;
+    memset(&address, 0, sizeof(address));
+    address.sll_family = AF_PACKET;
+    address.sll_protocol = htons(ETH_P_ALL);
+    address.sll_ifindex = iface_index_;
+    if (bind(socket_, (const sockaddr*)&address, sizeof(address)) == -1) {
+        throw socket_open_error(strerror(errno));
+    }
+}
+
+void RingSniffer::setup_ring() {
+    int version = TPACKET_V3;
+    if (setsockopt(socket_, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) == -1) {
+        throw socket_open_error(strerror(errno));
+    }
+
+    tpacket_req3 request;
+    memset(&request, 0, sizeof(request));
+    request.tp_block_size = block_size_;
+    request.tp_block_nr = block_count_;
+    request.tp_frame_size = ring_frame_size;
+    request.tp_frame_nr = (block_size_ / ring_frame_size) * block_count_;
+    request.tp_retire_blk_tov = frame_timeout_;
+    if (setsockopt(socket_, SOL_PACKET, PACKET_RX_RING, &request, sizeof(request)) == -1) {
+        throw socket_open_error(strerror(errno));
+    }
+
+    void* ring = mmap(0, static_cast<size_t>(block_size_) * block_count_, 
+                      PROT_READ | PROT_WRITE, MAP_SHARED | MAP_LOCKED, socket_, 0);
+    if (ring == MAP_FAILED) {
+        // MAP_LOCKED fails if we're over RLIMIT_MEMLOCK, try without it
+        ring = mmap(0, static_cast<size_t>(block_size_) * block_count_, 
+                    PROT_READ | PROT_WRITE, MAP_SHARED, socket_, 0);
+        if (ring == MAP_FAILED) {
+            throw socket_open_error(strerror(errno));
+        }
+    }
+    ring_ = (uint8_t*)ring;
+}
+
+bool RingSniffer::acquire_block() {
+    tpacket_block_desc* block = ring_block(ring_, block_size_, current_block_);
+    volatile uint32_t* status = &block->hdr.bh1.block_status;
+    while ((*status & TP_STATUS_USER) == 0) {
+        if (stop_.exchange(false)) {
+            return false;
+        }
+        pollfd descriptor;
+        descriptor.fd = socket_;
+        descriptor.events = POLLIN | POLLERR;
+        descriptor.revents = 0;
+        if (poll(&descriptor, 1, timeout_) == -1 && errno != EINTR) {
+            return false;
+        }
+    }
+    // Make sure we don't read the block's contents before its status
+    std::atomic_thread_fence(std::memory_order_acquire);
+    current_frame_ = (const uint8_t*)block + block->hdr.bh1.offset_to_first_pkt;
+    frames_left_ = block->hdr.bh1.num_pkts;
+    block_acquired_ = true;
+    return true;
+}
+
+void RingSniffer::release_block() {
+    tpacket_block_desc* block = ring_block(ring_, block_size_, current_block_);
+    // We're done reading the block before handing it back to the kernel
+    std::atomic_thread_fence(std::memory_order_release);
+    block->hdr.bh1.block_status = TP_STATUS_KERNEL;
+    current_block_ = (current_block_ + 1) % block_count_;
+    block_acquired_ = false;
+}
+
+bool RingSniffer::next_frame(RawPacket& frame) {
+    while (true) {
+        if (frames_left_ == 0) {
+            if (block_acquired_) {
+                release_block();
+            }
+            if (!acquire_block()) {
+                return false;
+            }
+            continue;
+        }
+        if (stop_.load(std::memory_order_relaxed) && stop_.exchange(false)) {
+            return false;
+        }
+        const tpacket3_hdr* header = (const tpacket3_hdr*)current_frame_;
+        current_frame_ += header->tp_next_offset;
+        frames_left_--;
+
+        if (direction_ != PCAP_D_INOUT) {
+            const sockaddr_ll* address = (const sockaddr_ll*)(
+                (const uint8_t*)header + TPACKET_ALIGN(sizeof(tpacket3_hdr))
+            );
+            const bool outgoing = address->sll_pkttype == PACKET_OUTGOING;
+            if (outgoing != (direction_ == PCAP_D_OUT)) {
+                continue;
+            }
+        }
+
+        struct timeval tv;
+        tv.tv_sec = header->tp_sec;
+        tv.tv_usec = header->tp_nsec / 1000;
+        frame = RawPacket(
+            (const uint8_t*)header + header->tp_mac,
+            min(header->tp_snaplen, snap_len_),
+            header->tp_len,
+            tv
+        );
+        return true;
+    }
+}
+
+PtrPacket RingSniffer::next_packet() {
+    pcap_handler handler = Internals::sniff_handler_from_link_type(link_type_, extract_raw_);
+    RawPacket frame;
+    while (next_frame(frame)) {
+        pcap_pkthdr header;
+        header.ts.tv_sec = frame.timestamp().seconds();
+        header.ts.tv_usec = frame.timestamp().microseconds();
+        header.caplen = frame.size();
+        header.len = frame.original_size();
+
+        Internals::sniff_data data;
+        handler((u_char*)&data, &header, frame.data());
+        // Skip malformed packets
+        if (data.pdu) {
+            return PtrPacket(data.pdu, data.tv);
+        }
+    }
+    return PtrPacket(0, Timestamp());
+}
+
+bool RingSniffer::set_filter(const string& filter) {
+    pcap_t* handle = pcap_open_dead(link_type_, static_cast<int>(snap_len_));
+    if (!handle) {
+        return false;
+    }
+    bpf_program program;
+    if (pcap_compile(handle, &program, filter.c_str(), 1, PCAP_NETMASK_UNKNOWN) == -1) {
+        pcap_close(handle);
+        return false;
+    }
+    sock_fprog socket_program;
+    socket_program.len = static_cast<unsigned short>(program.bf_len);
+    socket_program.filter = (sock_filter*)program.bf_insns;
+    const bool result = setsockopt(socket_, SOL_SOCKET, SO_ATTACH_FILTER,
+                                   &socket_program, sizeof(socket_program)) != -1;
+    pcap_freecode(&program);
+    pcap_close(handle);
+    return result;
+}
+
+void RingSniffer::join_fanout_group(uint16_t group_id, uint16_t mode) {
+    const uint32_t argument = group_id | (static_cast<uint32_t>(mode) << 16);
+    if (setsockopt(socket_, SOL_PACKET, PACKET_FANOUT, &argument, sizeof(argument)) == -1) {
+        throw socket_open_error(strerror(errno));
+    }
+}
+
+uint16_t RingSniffer::create_fanout_group(uint16_t mode) {
+    uint32_t argument = static_cast<uint32_t>(mode | PACKET_FANOUT_FLAG_UNIQUEID) << 16;
+    if (setsockopt(socket_, SOL_PACKET, PACKET_FANOUT, &argument, sizeof(argument)) == 0) {
+        socklen_t length = sizeof(argument);
+        if (getsockopt(socket_, SOL_PACKET, PACKET_FANOUT, &argument, &length) == -1) {
+            throw socket_open_error(strerror(errno));
+        }
+        return static_cast<uint16_t>(argument & 0xffff);
+    }
+    if (errno != EINVAL) {
+        throw socket_open_error(strerror(errno));
+    }
+    // Kernels older than 4.3 can't pick the identifier. A group in use 
+    // with another mode fails with EINVAL and a full one with EADDRINUSE
+    static std::atomic<uint16_t> next_group(0);
+    const int max_attempts = 64;
+    for (int i = 0; i < max_attempts; ++i) {
+        const uint16_t group_id = static_cast<uint16_t>(getpid() * 31 + next_group++);
+        argument = group_id | (static_cast<uint32_t>(mode) << 16);
+        if (setsockopt(socket_, SOL_PACKET, PACKET_FANOUT, &argument, sizeof(argument)) == 0) {
+            return group_id;
+        }
+        if (errno != EINVAL && errno != EADDRINUSE) {
+            break;
+        }
+    }
+    throw socket_open_error(strerror(errno));
+}
+
+void RingSniffer::stop_sniff() {
+    stop_ = true;
+}
+
+RingSniffer::statistics RingSniffer::stats() {
+    tpacket_stats_v3 kernel_stats;
+    socklen_t length = sizeof(kernel_stats);
+    memset(&kernel_stats, 0, sizeof(kernel_stats));
+    if (getsockopt(socket_, SOL_PACKET, PACKET_STATISTICS, &kernel_stats, &length) == -1) {
+        throw socket_open_error(strerror(errno));
+    }
+    statistics output;
+    output.packets = kernel_stats.tp_packets;
+    output.drops = kernel_stats.tp_drops;
+    output.freezes = kernel_stats.tp_freeze_q_cnt;
+    return output;
+}
+
+void RingSniffer::set_extract_raw_pdus(bool value) {
+    extract_raw_ = value;
+}
+
+int RingSniffer::get_fd() {
+    return socket_;
+}
+
+int RingSniffer::link_type() const {
+    return link_type_;
+}
+
+void RingSniffer::set_snap_len(unsigned snap_len) {
+    snap_len_ = snap_len;
+}
+
+void RingSniffer::set_timeout(unsigned timeout) {
+    // Same as pcap, a 0 timeout means waiting for packets indefinitely
+    timeout_ = timeout == 0 ? -1 : static_cast<int>(timeout);
+}
+
+void RingSniffer::set_ring_layout(unsigned block_size, unsigned block_count,
+                                  unsigned frame_timeout) {
+    // Blocks have to be a multiple of the page size
+    const unsigned page_size = static_cast<unsigned>(sysconf(_SC_PAGESIZE));
+    block_size_ = ((block_size + page_size - 1) / page_size) * page_size;
+    block_count_ = block_count;
+    frame_timeout_ = frame_timeout;
+}
+
+void RingSniffer::set_promisc_mode(bool promisc_enabled) {
+    packet_mreq request;
+    memset(&request, 0, sizeof(request));
+    request.mr_ifindex = iface_index_;
+    request.mr_type = PACKET_MR_PROMISC;
+    const int option = promisc_enabled ? PACKET_ADD_MEMBERSHIP : PACKET_DROP_MEMBERSHIP;
+    if (setsockopt(socket_, SOL_PACKET, option, &request, sizeof(request)) == -1) {
+        // Dropping a membership we never added is fine
+        if (promisc_enabled) {
+            throw socket_open_error(strerror(errno));
+        }
+    }
+}
+
+void RingSniffer::set_direction(pcap_direction_t direction) {
+    direction_ = direction;
+}
+
+} // Tins
+
+#endif // TINS_HAVE_PACKET_RING
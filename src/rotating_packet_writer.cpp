@@ -0,0 +1,306 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <tins/rotating_packet_writer.h>
+
+#if defined(TINS_HAVE_PCAP) && defined(TINS_HAVE_CXX11)
+
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#ifndef _WIN32
+    #include <sys/time.h>
+#endif
+#include <tins/packet_writer.h>
+#include <tins/packet.h>
+#include <tins/raw_packet.h>
+#include <tins/pdu.h>
+
+using std::string;
+using std::vector;
+using std::mutex;
+using std::unique_lock;
+using std::lock_guard;
+using std::exception_ptr;
+using std::ostringstream;
+
+namespace Tins {
+
+const size_t RotatingPacketWriter::DEFAULT_QUEUE_SIZE = 64 * 1024 * 1024;
+
+// The pcap file and record header sizes, used to track each file's size
+const uint64_t rotating_file_header_size = 24;
+const uint64_t rotating_record_header_size = 16;
+
+// The header stored in front of each packet in the queue
+struct rotating_queued_record {
+    int64_t seconds;
+    int64_t microseconds;
+    uint32_t size;
+    uint32_t original_size;
+};
+
+RotatingPacketWriter::rotation_policy::rotation_policy()
+: max_file_size(0), max_packets(0), max_duration(0) {
+
+}
+
+void RotatingPacketWriter::init() {
+    file_size_ = 0;
+    file_packets_ = 0;
+    file_first_second_ = 0;
+    written_ = 0;
+    dropped_ = 0;
+    blocked_ = 0;
+    peak_queue_usage_ = 0;
+    files_ = 0;
+    stopping_ = false;
+    closed_ = false;
+    writer_thread_ = std::thread(&RotatingPacketWriter::run, this);
+}
+
+RotatingPacketWriter::~RotatingPacketWriter() {
+    try {
+        close();
+    }
+    catch (...) {
+
+    }
+}
+
+bool RotatingPacketWriter::write_raw(const uint8_t* data, uint32_t size, 
+                                     const Timestamp& timestamp, uint32_t original_size) {
+    return enqueue(data, 0, size, timestamp, original_size);
+}
+
+bool RotatingPacketWriter::write(const RawPacket& frame) {
+    return write_raw(frame.data(), frame.size(), frame.timestamp(), frame.original_size());
+}
+
+bool RotatingPacketWriter::write(Packet& packet) {
+    PDU& pdu = *packet.pdu();
+    return enqueue(0, &pdu, pdu.size(), packet.timestamp(), pdu.advertised_size());
+}
+
+bool RotatingPacketWriter::write(PDU& pdu) {
+    return enqueue(0, &pdu, pdu.size(), Timestamp::current_time(), pdu.advertised_size());
+}
+
+// Queues either the given data or, if a PDU is provided, its serialization
+bool RotatingPacketWriter::enqueue(const uint8_t* data, PDU* pdu, uint32_t size,
+                                   const Timestamp& timestamp, uint32_t original_size) {
+    const size_t record_size = sizeof(rotating_queued_record) + size;
+    unique_lock<mutex> guard(lock_);
+    // A packet larger than the whole queue is still accepted once it's empty
+    if (!stopping_ && !queue_.empty() && queue_.size() + record_size > queue_size_) {
+        if (overflow_ == DROP) {
+            ++dropped_;
+            return false;
+        }
+        ++blocked_;
+        while (!stopping_ && !queue_.empty() && queue_.size() + record_size > queue_size_) {
+            queue_drained_.wait(guard);
+        }
+    }
+    if (stopping_) {
+        ++dropped_;
+        return false;
+    }
+    rotating_queued_record record;
+    record.seconds = timestamp.seconds();
+    record.microseconds = timestamp.microseconds();
+    record.size = size;
+    record.original_size = original_size;
+    const bool was_empty = queue_.empty();
+    const uint8_t* record_ptr = reinterpret_cast<const uint8_t*>(&record);
+    queue_.insert(queue_.end(), record_ptr, record_ptr + sizeof(record));
+    if (pdu) {
+        // Serialize the PDU straight into the queue
+        const size_t data_offset = queue_.size();
+        queue_.resize(data_offset + size);
+        if (size > 0) {
+            try {
+                pdu->serialize_into(&queue_[data_offset], size);
+            }
+            catch (...) {
+                queue_.resize(data_offset - sizeof(record));
+                throw;
+            }
+        }
+    }
+    else {
+        queue_.insert(queue_.end(), data, data + size);
+    }
+    peak_queue_usage_ = std::max(peak_queue_usage_, queue_.size());
+    guard.unlock();
+    if (was_empty) {
+        queue_ready_.notify_one();
+    }
+    return true;
+}
+
+void RotatingPacketWriter::run() {
+    vector<uint8_t> records;
+    while (true) {
+        {
+            unique_lock<mutex> guard(lock_);
+            while (queue_.empty() && !stopping_) {
+                queue_ready_.wait(guard);
+            }
+            // Once stopping, keep going until the queue is drained
+            if (queue_.empty()) {
+                break;
+            }
+            records.clear();
+            records.swap(queue_);
+        }
+        queue_drained_.notify_all();
+        try {
+            write_records(records);
+        }
+        catch (...) {
+            lock_guard<mutex> _(lock_);
+            error_ = std::current_exception();
+            stopping_ = true;
+            queue_.clear();
+            break;
+        }
+    }
+    queue_drained_.notify_all();
+    try {
+        close_file();
+    }
+    catch (...) {
+        lock_guard<mutex> _(lock_);
+        if (!error_) {
+            error_ = std::current_exception();
+        }
+    }
+}
+
+void RotatingPacketWriter::write_records(const vector<uint8_t>& records) {
+    size_t offset = 0;
+    uint64_t written = 0;
+    while (offset < records.size()) {
+        rotating_queued_record record;
+        memcpy(&record, &records[offset], sizeof(record));
+        const uint8_t* data = &records[offset] + sizeof(record);
+        offset += sizeof(record) + record.size;
+
+        const uint64_t second = static_cast<uint64_t>(record.seconds);
+        const uint64_t record_size = rotating_record_header_size + record.size;
+        if (writer_ && file_packets_ > 0) {
+            const bool rotate = 
+                (policy_.max_file_size && file_size_ + record_size > policy_.max_file_size) ||
+                (policy_.max_packets && file_packets_ >= policy_.max_packets) ||
+                (policy_.max_duration && second >= file_first_second_ + policy_.max_duration);
+            if (rotate) {
+                close_file();
+            }
+        }
+        if (!writer_) {
+            open_file(second);
+        }
+        struct timeval tv;
+        tv.tv_sec = static_cast<long>(record.seconds);
+        tv.tv_usec = static_cast<long>(record.microseconds);
+        writer_->write_raw(data, record.size, tv, record.original_size);
+        file_size_ += record_size;
+        ++file_packets_;
+        ++written;
+    }
+    lock_guard<mutex> _(lock_);
+    written_ += written;
+}
+
+void RotatingPacketWriter::open_file(uint64_t first_second) {
+    writer_.reset(new PacketWriter(file_name(files_), 
+                                   static_cast<PacketWriter::LinkType>(link_type_)));
+    file_size_ = rotating_file_header_size;
+    file_packets_ = 0;
+    file_first_second_ = first_second;
+    lock_guard<mutex> _(lock_);
+    ++files_;
+}
+
+void RotatingPacketWriter::close_file() {
+    if (!writer_) {
+        return;
+    }
+    writer_.reset();
+    if (rotation_callback_) {
+        rotation_callback_(file_name(files_ - 1));
+    }
+}
+
+void RotatingPacketWriter::close() {
+    {
+        lock_guard<mutex> _(lock_);
+        if (closed_) {
+            return;
+        }
+        closed_ = true;
+        stopping_ = true;
+    }
+    queue_ready_.notify_one();
+    queue_drained_.notify_all();
+    writer_thread_.join();
+    if (error_) {
+        exception_ptr error = error_;
+        error_ = exception_ptr();
+        std::rethrow_exception(error);
+    }
+}
+
+RotatingPacketWriter::statistics RotatingPacketWriter::stats() const {
+    lock_guard<mutex> _(lock_);
+    statistics output;
+    output.written = written_;
+    output.dropped = dropped_;
+    output.blocked = blocked_;
+    output.queue_usage = queue_.size();
+    output.peak_queue_usage = peak_queue_usage_;
+    output.files = files_;
+    return output;
+}
+
+string RotatingPacketWriter::file_name(uint32_t index) const {
+    ostringstream output;
+    output << base_name_ << "_" << std::setw(6) << std::setfill('0') << index << ".pcap";
+    return output.str();
+}
+
+void RotatingPacketWriter::set_rotation_callback(rotation_callback_type callback) {
+    rotation_callback_ = callback;
+}
+
+} // Tins
+
+#endif // TINS_HAVE_PCAP && TINS_HAVE_CXX11
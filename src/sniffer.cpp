@@ -46,11 +46,20 @@
 #include <tins/ip.h>
 #include <tins/ipv6.h>
 #include <tins/detail/pdu_helpers.h>
+#include <tins/detail/sniffer_helpers.h>
+#include <tins/mapped_file_sniffer.h>
+#ifdef TINS_HAVE_PACKET_RING
+    #include <tins/ring_sniffer.h>
+#endif // TINS_HAVE_PACKET_RING
 
 using std::string;
 
+using Tins::Internals::sniff_data;
+
 namespace Tins {
 
+const uint32_t BaseSniffer::DEFAULT_BATCH_SIZE = 64;
+
 BaseSniffer::BaseSniffer() 
 : handle_(0), mask_(0), extract_raw_(false) {
     
@@ -82,14 +91,6 @@ bpf_u_int32 BaseSniffer::get_if_mask() const {
     return mask_;
 }
 
-struct sniff_data {
-    struct timeval tv;
-    PDU* pdu;
-    bool packet_processed;
-
-sniff_data() : tv(), pdu(0), packet_processed(true) { }
-};
-
 template<typename T>
 T* safe_alloc(const u_char* bytes, bpf_u_int32 len) {
     try {
@@ -100,12 +101,21 @@ T* safe_alloc(const u_char* bytes, bpf_u_int32 len) {
     }
 }
 
+// Indexes the layers of a parsed packet, so lookups on it take constant 
+// time. A single layer is found right away anyway
+static void index_layers(PDU* pdu) {
+    if (pdu && pdu->inner_pdu()) {
+        pdu->build_layer_index();
+    }
+}
+
 template<typename T>
 void sniff_loop_handler(u_char* user, const struct pcap_pkthdr* h, const u_char* bytes) {
     sniff_data* data = (sniff_data*)user;
     data->packet_processed = true;
     data->tv = h->ts;
     data->pdu = safe_alloc<T>(bytes, h->caplen);
+    index_layers(data->pdu);
 }
 
 void sniff_loop_eth_handler(u_char* user, const struct pcap_pkthdr* h, const u_char* bytes) {
@@ -118,6 +128,7 @@ void sniff_loop_eth_handler(u_char* user, const struct pcap_pkthdr* h, const u_c
     else {
         data->pdu = safe_alloc<EthernetII>((const uint8_t*)bytes, h->caplen);
     }
+    index_layers(data->pdu);
 }
 
 void sniff_loop_raw_handler(u_char* user, const struct pcap_pkthdr* h, const u_char* bytes) {
@@ -144,6 +155,7 @@ void sniff_loop_raw_handler(u_char* user, const struct pcap_pkthdr* h, const u_c
             data->pdu = safe_alloc<IPv6>((const uint8_t*)bytes, h->caplen);
             break;
     };
+    index_layers(data->pdu);
 }
 
 #ifdef TINS_HAVE_DOT11
@@ -157,58 +169,83 @@ void sniff_loop_dot11_handler(u_char* user, const struct pcap_pkthdr* h, const u
     catch(malformed_packet&) {
         
     }
+    index_layers(data->pdu);
 }
 #endif
 
-PtrPacket BaseSniffer::next_packet() {
-    sniff_data data;
-    const int iface_type = pcap_datalink(handle_);
-    pcap_handler handler = 0;
-    if (extract_raw_) {
-        handler = &sniff_loop_handler<RawPDU>;
+struct sniff_batch_data {
+    sniff_batch_data(pcap_handler handler, BaseSniffer::batch_type& packets)
+    : handler(handler), packets(&packets) { }
+
+    pcap_handler handler;
+    BaseSniffer::batch_type* packets;
+};
+
+static void sniff_batch_handler(u_char* user, const struct pcap_pkthdr* h, const u_char* bytes) {
+    sniff_batch_data* data = (sniff_batch_data*)user;
+    sniff_data packet_data;
+    data->handler((u_char*)&packet_data, h, bytes);
+    // Malformed packets are silently dropped
+    if (packet_data.pdu) {
+        // libpcap reuses its buffer while the rest of the batch is read
+        Internals::own_raw_payloads(packet_data.pdu);
+        #if TINS_IS_CXX11
+        data->packets->emplace_back(packet_data.pdu, packet_data.tv, Packet::own_pdu());
+        #else
+        data->packets->push_back(Packet(packet_data.pdu, packet_data.tv, Packet::own_pdu()));
+        #endif
     }
-    else {
-        switch (iface_type) {
-            case DLT_EN10MB:
-                handler = &sniff_loop_eth_handler;
-                break;
-            case DLT_NULL:
-                handler = &sniff_loop_handler<Tins::Loopback>;
-                break;
-            case DLT_LINUX_SLL:
-                handler = &sniff_loop_handler<SLL>;
-                break; 
-            case DLT_PPI:
-                handler = &sniff_loop_handler<PPI>;
-                break;
-            case DLT_RAW:
-                handler = &sniff_loop_raw_handler;
-                break;
-
-            // Dot11 related protocols
-            #ifdef TINS_HAVE_DOT11
-            case DLT_IEEE802_11_RADIO:
-                handler = &sniff_loop_handler<RadioTap>;
-                break;
-            case DLT_IEEE802_11:
-                handler = &sniff_loop_dot11_handler;
-                break;
-            #else
-            case DLT_IEEE802_11_RADIO:
-            case DLT_IEEE802_11:
-                throw protocol_disabled();
-            #endif // TINS_HAVE_DOT11
-
-            #ifdef DLT_PKTAP
-            case DLT_PKTAP:
-                handler = &sniff_loop_handler<PKTAP>;
-                break;
-            #endif // DLT_PKTAP
-
-            default:
-                throw unknown_link_type();
-        }
+}
+
+namespace Internals {
+
+pcap_handler sniff_handler_from_link_type(int link_type, bool extract_raw) {
+    if (extract_raw) {
+        return &sniff_loop_handler<RawPDU>;
+    }
+    switch (link_type) {
+        case DLT_EN10MB:
+            return &sniff_loop_eth_handler;
+        case DLT_NULL:
+            return &sniff_loop_handler<Tins::Loopback>;
+        case DLT_LINUX_SLL:
+            return &sniff_loop_handler<SLL>;
+        case DLT_PPI:
+            return &sniff_loop_handler<PPI>;
+        case DLT_RAW:
+            return &sniff_loop_raw_handler;
+
+        // Dot11 related protocols
+        #ifdef TINS_HAVE_DOT11
+        case DLT_IEEE802_11_RADIO:
+            return &sniff_loop_handler<RadioTap>;
+        case DLT_IEEE802_11:
+            return &sniff_loop_dot11_handler;
+        #else
+        case DLT_IEEE802_11_RADIO:
+        case DLT_IEEE802_11:
+            throw protocol_disabled();
+        #endif // TINS_HAVE_DOT11
+
+        #ifdef DLT_PKTAP
+        case DLT_PKTAP:
+            return &sniff_loop_handler<PKTAP>;
+        #endif // DLT_PKTAP
+
+        default:
+            throw unknown_link_type();
     }
+}
+
+} // Internals
+
+pcap_handler BaseSniffer::get_handler() const {
+    return Internals::sniff_handler_from_link_type(pcap_datalink(handle_), extract_raw_);
+}
+
+PtrPacket BaseSniffer::next_packet() {
+    sniff_data data;
+    pcap_handler handler = get_handler();
     // keep calling pcap_loop until a well-formed packet is found.
     while (data.pdu == 0 && data.packet_processed) {
         data.packet_processed = false;
@@ -216,9 +253,35 @@ PtrPacket BaseSniffer::next_packet() {
             return PtrPacket(0, Timestamp());
         }
     }
+    // libpcap's buffer is only valid until the next packet is read
+    Internals::own_raw_payloads(data.pdu);
     return PtrPacket(data.pdu, data.tv);
 }
 
+bool BaseSniffer::next_batch(batch_type& packets, uint32_t batch_size) {
+    packets.clear();
+    sniff_batch_data data(get_handler(), packets);
+    // keep calling pcap_dispatch until at least one well-formed packet is found.
+    while (packets.empty()) {
+        const int result = pcap_dispatch(
+            handle_,
+            static_cast<int>(batch_size),
+            &sniff_batch_handler,
+            (u_char*)&data
+        );
+        // Either an error occurred or BaseSniffer::stop_sniff was called
+        if (result < 0) {
+            return false;
+        }
+        // Offline captures return 0 when there's nothing else to read. Live
+        // ones return 0 when the read timeout expires, so keep going
+        if (result == 0 && pcap_file(handle_) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
 void BaseSniffer::set_extract_raw_pdus(bool value) {
     extract_raw_ = value;
 }
@@ -424,12 +487,17 @@ FileSniffer::FileSniffer(const string& file_name, const string& filter) {
 
 const unsigned SnifferConfiguration::DEFAULT_SNAP_LEN = 65535;
 const unsigned SnifferConfiguration::DEFAULT_TIMEOUT = 1000;
+const unsigned SnifferConfiguration::DEFAULT_RING_BLOCK_SIZE = 1 << 20;
+const unsigned SnifferConfiguration::DEFAULT_RING_BLOCK_COUNT = 64;
+const unsigned SnifferConfiguration::DEFAULT_RING_FRAME_TIMEOUT = 64;
 
 SnifferConfiguration::SnifferConfiguration()
 : flags_(0), snap_len_(DEFAULT_SNAP_LEN), buffer_size_(0),
   pcap_sniffing_method_(pcap_loop), timeout_(DEFAULT_TIMEOUT), promisc_(false),
   rfmon_(false), immediate_mode_(false), direction_(PCAP_D_INOUT),
-  timestamp_precision_(0) {
+  timestamp_precision_(0), ring_block_size_(DEFAULT_RING_BLOCK_SIZE),
+  ring_block_count_(DEFAULT_RING_BLOCK_COUNT),
+  ring_frame_timeout_(DEFAULT_RING_FRAME_TIMEOUT) {
 
 }
 
@@ -463,6 +531,14 @@ void SnifferConfiguration::configure_sniffer_pre_activation(FileSniffer& sniffer
     sniffer.set_pcap_sniffing_method(pcap_sniffing_method_);
 }
 
+void SnifferConfiguration::configure_sniffer_pre_activation(MappedFileSniffer& sniffer) const {
+    if ((flags_ & PACKET_FILTER) != 0) {
+        if (!sniffer.set_filter(filter_)) {
+            throw invalid_pcap_filter(filter_.c_str());
+        }
+    }
+}
+
 void SnifferConfiguration::configure_sniffer_post_activation(Sniffer& sniffer) const {
     if ((flags_ & PACKET_FILTER) != 0) {
         if (!sniffer.set_filter(filter_)) {
@@ -479,6 +555,30 @@ void SnifferConfiguration::configure_sniffer_post_activation(Sniffer& sniffer) c
     #endif // _WIN32
 }
 
+#ifdef TINS_HAVE_PACKET_RING
+
+void SnifferConfiguration::configure_sniffer_pre_activation(RingSniffer& sniffer) const {
+    sniffer.set_snap_len(snap_len_);
+    sniffer.set_timeout(timeout_);
+    sniffer.set_ring_layout(ring_block_size_, ring_block_count_, ring_frame_timeout_);
+}
+
+void SnifferConfiguration::configure_sniffer_post_activation(RingSniffer& sniffer) const {
+    if ((flags_ & PACKET_FILTER) != 0) {
+        if (!sniffer.set_filter(filter_)) {
+            throw invalid_pcap_filter(filter_.c_str());
+        }
+    }
+    if ((flags_ & PROMISCUOUS) != 0) {
+        sniffer.set_promisc_mode(promisc_);
+    }
+    if ((flags_ & DIRECTION) != 0) {
+        sniffer.set_direction(direction_);
+    }
+}
+
+#endif // TINS_HAVE_PACKET_RING
+
 void SnifferConfiguration::set_snap_len(unsigned snap_len) {
     snap_len_ = snap_len;
 }
@@ -527,4 +627,16 @@ void SnifferConfiguration::set_direction(pcap_direction_t direction) {
     flags_ |= DIRECTION;
 }
 
+void SnifferConfiguration::set_ring_block_size(unsigned block_size) {
+    ring_block_size_ = block_size;
+}
+
+void SnifferConfiguration::set_ring_block_count(unsigned block_count) {
+    ring_block_count_ = block_count;
+}
+
+void SnifferConfiguration::set_ring_frame_timeout(unsigned timeout) {
+    ring_frame_timeout_ = timeout;
+}
+
 } // Tins
@@ -35,6 +35,7 @@
 #include <tins/rawpdu.h>
 #include <tins/exceptions.h>
 #include <tins/memory_helpers.h>
+#include <tins/detail/pdu_helpers.h>
 #include <tins/utils/checksum_utils.h>
 
 using std::vector;
@@ -73,52 +74,17 @@ TCP::TCP(const uint8_t* buffer, uint32_t total_sz) {
     }
     const uint8_t* header_end = buffer + (data_offset() * sizeof(uint32_t));
 
-    if (stream.pointer() < header_end) {
+    if (stream.pointer() < header_end && !LazyOptions::enabled()) {
         // Estimate about 4 bytes per option and reserver that so we avoid doing 
         // multiple reallocations on the vector
         options_.reserve((header_end - stream.pointer()) / sizeof(uint32_t));
     }
-
-    while (stream.pointer() < header_end) {
-        const OptionTypes option_type = (OptionTypes)stream.read<uint8_t>();
-        if (option_type == EOL) {
-            stream.skip(header_end - stream.pointer());
-            break;
-        }
-        else if (option_type == NOP) {
-            #if TINS_IS_CXX11
-            add_option(option_type, 0);
-            #else
-            add_option(option(option_type, 0));
-            #endif // TINS_IS_CXX11
-        }
-        else {
-            // Extract the length
-            uint32_t len = stream.read<uint8_t>();
-            const uint8_t* data_start = stream.pointer();
-
-            // We need to subtract the option type and length from the size
-            if (TINS_UNLIKELY(len < sizeof(uint8_t) << 1)) {
-                throw malformed_packet();
-            }
-            len -= (sizeof(uint8_t) << 1);
-            // Make sure we have enough bytes for the advertised option payload length
-            if (TINS_UNLIKELY(data_start + len > header_end)) {
-                throw malformed_packet(); 
-            }
-            // If we're using C++11, use the variadic template overload
-            #if TINS_IS_CXX11
-            add_option(option_type, data_start, data_start + len);
-            #else
-            add_option(option(option_type, data_start, data_start + len));
-            #endif // TINS_IS_CXX11
-            // Skip the option's payload
-            stream.skip(len);
-        }
-    }
+    Internals::parse_options(stream.pointer(), header_end, options_, raw_options_,
+                             &TCP::parse_option_view);
+    stream.skip(header_end - stream.pointer());
     // If we still have any bytes left
     if (stream) {
-        inner_pdu(new RawPDU(stream.pointer(), stream.size()));
+        inner_pdu(Internals::raw_pdu_from_buffer(stream.pointer(), stream.size()));
     }
 }
 
@@ -296,6 +262,7 @@ void TCP::flags(small_uint<12> value) {
 }
 
 void TCP::add_option(const option& opt) {
+    materialize_options();
     options_.push_back(opt);
 }
 
@@ -311,7 +278,8 @@ void TCP::write_serialization(uint8_t* buffer, uint32_t total_sz) {
     checksum(0);
     header_.doff = (sizeof(tcp_header) + total_options_size) / sizeof(uint32_t);
     stream.write(header_);
-    for (options_type::const_iterator it = options_.begin(); it != options_.end(); ++it) {
+    const option_views_type views = option_views();
+    for (option_views_type::iterator it = views.begin(); it != views.end(); ++it) {
         write_option(*it, stream);
     }
 
@@ -356,16 +324,18 @@ const TCP::option* TCP::search_option(OptionTypes type) const {
 }
 
 TCP::options_type::const_iterator TCP::search_option_iterator(OptionTypes type) const {
+    materialize_options();
     return Internals::find_option_const<option>(options_, type);
 }
 
 TCP::options_type::iterator TCP::search_option_iterator(OptionTypes type) {
+    materialize_options();
     return Internals::find_option<option>(options_, type);
 }
 
 /* options */
 
-void TCP::write_option(const option& opt, OutputMemoryStream& stream) {
+void TCP::write_option(const PDUOptionView<option>& opt, OutputMemoryStream& stream) {
     stream.write<uint8_t>(opt.option());
     // Only do this for non EOL nor NOP options 
     if (opt.option() > 1) {
@@ -382,8 +352,9 @@ void TCP::write_option(const option& opt, OutputMemoryStream& stream) {
 
 uint32_t TCP::calculate_options_size() const {
     uint32_t options_size = 0;
-    for (options_type::const_iterator iter = options_.begin(); iter != options_.end(); ++iter) {
-        const option& opt = *iter;
+    const option_views_type views = option_views();
+    for (option_views_type::iterator iter = views.begin(); iter != views.end(); ++iter) {
+        const PDUOptionView<option>& opt = *iter;
         options_size += sizeof(uint8_t);
         // SACK_OK contains length but not data
         if (opt.data_size() || opt.option() == SACK_OK) {
@@ -394,6 +365,35 @@ uint32_t TCP::calculate_options_size() const {
     return options_size;    
 }
 
+const uint8_t* TCP::parse_option_view(const uint8_t* ptr, const uint8_t* end,
+                                       PDUOptionView<option>& view) {
+    const uint8_t option_type = *ptr++;
+    if (option_type == EOL) {
+        return 0;
+    }
+    else if (option_type == NOP) {
+        view = PDUOptionView<option>(option_type, ptr, 0, 0);
+        return ptr;
+    }
+    // Extract the length
+    if (TINS_UNLIKELY(ptr == end)) {
+        throw malformed_packet();
+    }
+    uint32_t len = *ptr++;
+    // We need to subtract the option type and length from the size
+    if (TINS_UNLIKELY(len < sizeof(uint8_t) << 1)) {
+        throw malformed_packet();
+    }
+    len -= (sizeof(uint8_t) << 1);
+    // Make sure we have enough bytes for the advertised option payload length
+    if (TINS_UNLIKELY(static_cast<uint32_t>(end - ptr) < len)) {
+        throw malformed_packet(); 
+    }
+    view = PDUOptionView<option>(option_type, ptr, static_cast<uint16_t>(len),
+                                 static_cast<uint16_t>(len));
+    return ptr + len;
+}
+
 uint32_t TCP::pad_options_size(uint32_t size) const {
     uint8_t padding = size & 3;
     return padding ? (size - padding + 4) : size;
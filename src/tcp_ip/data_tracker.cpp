@@ -108,6 +108,21 @@ bool DataTracker::process_payload(uint32_t seq, payload_type payload) {
     return added_some;
 }
 
+bool DataTracker::process_payload(uint32_t seq, const uint8_t* data, uint32_t size) {
+    // If there's nothing buffered and this chunk doesn't start after our
+    // sequence number, the unseen part of it can be appended right away
+    if (buffered_payload_.empty() && seq_compare(seq, seq_number_) <= 0) {
+        const uint32_t chunk_end = seq + size;
+        if (seq_compare(chunk_end, seq_number_) < 0) {
+            return false;
+        }
+        payload_.insert(payload_.end(), data + (seq_number_ - seq), data + size);
+        seq_number_ = chunk_end;
+        return true;
+    }
+    return process_payload(seq, payload_type(data, data + size));
+}
+
 void DataTracker::advance_sequence(uint32_t seq) {
     if (seq_compare(seq, seq_number_) <= 0) {
         return;
@@ -114,8 +114,13 @@ void Flow::process_packet(PDU& pdu) {
         }
     }
 
-    // can process either way, since it will abort immediately if not needed
-    if (data_tracker_.process_payload(tcp->seq(), move(raw->payload()))) {
+    // can process either way, since it will abort immediately if not needed.
+    // Owned payloads are moved into the tracker, borrowed ones are copied 
+    // straight out of the buffer they reference
+    const bool added_data = raw->owns_payload() ?
+        data_tracker_.process_payload(tcp->seq(), move(raw->payload())) :
+        data_tracker_.process_payload(tcp->seq(), raw->payload_data(), raw->payload_size());
+    if (added_data) {
         if (on_data_callback_) {
             on_data_callback_(*this);
         }
@@ -166,6 +166,8 @@ bool TCPStream::generic_process(uint32_t& my_seq,
     }
     RawPDU* raw = static_cast<RawPDU*>(tcp->release_inner_pdu()); 
     if (raw) {
+        // This may be kept around after the packet's buffer is gone
+        raw->own();
         const uint32_t chunk_end = add_sequence_numbers(tcp->seq(), raw->payload_size());
         // If the end of the chunk ends after our current sequence number, process it.
         if (compare_seq_numbers(chunk_end, my_seq) >= 0) {
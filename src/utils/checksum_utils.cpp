@@ -29,11 +29,27 @@
 
 #include <tins/utils/checksum_utils.h>
 #include <cstring>
+#include <algorithm>
+#include <tins/config.h>
 #include <tins/ip_address.h>
 #include <tins/ipv6_address.h>
 #include <tins/endianness.h>
 #include <tins/memory_helpers.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define TINS_CHECKSUM_SSE2
+    #include <emmintrin.h>
+#endif // SSE2
+
+#if (defined(__ARM_NEON) || defined(__ARM_NEON__)) && !defined(__ARM_BIG_ENDIAN)
+    #define TINS_CHECKSUM_NEON
+    #include <arm_neon.h>
+#endif // NEON
+
+#ifdef TINS_HAVE_CPU_DISPATCH
+    #include <immintrin.h>
+#endif // TINS_HAVE_CPU_DISPATCH
+
 using std::memcpy;
 
 using Tins::Memory::InputMemoryStream;
@@ -42,33 +58,329 @@ using Tins::Memory::OutputMemoryStream;
 namespace Tins {
 namespace Utils {
 
-uint32_t do_checksum(const uint8_t* start, const uint8_t* end) {
-    return Endian::host_to_be<uint32_t>(sum_range(start, end));
+// Word summing routines. Each of them adds up size / 2 16 bit words (size
+// must be even) and returns the unfolded sum, which is wide enough to never
+// overflow for buffers smaller than 2^48 bytes. Since the internet checksum is
+// a ones' complement sum, adding the words in any grouping or order yields the
+// same folded result, so all of these are interchangeable.
+typedef uint64_t (*checksum_sum_function)(const uint8_t* data, size_t size);
+
+// Each 32 bit SIMD lane grows by at most 2 * 0xffff per block, so lanes are
+// flushed into the 64 bit sum after this many blocks
+static const size_t CHECKSUM_MAX_LANE_BLOCKS = 0x8000;
+
+uint64_t checksum_sum_words(const uint8_t* data, size_t size) {
+    uint64_t sum = 0;
+    uint32_t buffer;
+    while (size >= sizeof(uint32_t) * 2) {
+        memcpy(&buffer, data, sizeof(uint32_t));
+        sum += buffer;
+        memcpy(&buffer, data + sizeof(uint32_t), sizeof(uint32_t));
+        sum += buffer;
+        data += sizeof(uint32_t) * 2;
+        size -= sizeof(uint32_t) * 2;
+    }
+    if (size >= sizeof(uint32_t)) {
+        memcpy(&buffer, data, sizeof(uint32_t));
+        sum += buffer;
+        data += sizeof(uint32_t);
+        size -= sizeof(uint32_t);
+    }
+    if (size >= sizeof(uint16_t)) {
+        uint16_t word;
+        memcpy(&word, data, sizeof(uint16_t));
+        sum += word;
+    }
+    return sum;
 }
 
-uint16_t sum_range(const uint8_t* start, const uint8_t* end) {
-    uint32_t checksum(0);
-    const uint8_t* last = end;
-    uint16_t buffer = 0;
-    uint16_t padding = 0;
-    const uint8_t* ptr = start;
-
-    if (((end - start) & 1) == 1) {
-        last = end - 1;
-        padding = Endian::host_to_le<uint16_t>(*(end - 1));
+#ifdef TINS_CHECKSUM_SSE2
+
+uint64_t checksum_sum_words_sse2(const uint8_t* data, size_t size) {
+    const __m128i zero = _mm_setzero_si128();
+    uint64_t sum = 0;
+    size_t blocks = size / 32;
+    while (blocks > 0) {
+        const size_t count = std::min(blocks, CHECKSUM_MAX_LANE_BLOCKS / 2);
+        __m128i acc0 = zero;
+        __m128i acc1 = zero;
+        for (size_t i = 0; i < count; ++i) {
+            const __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+            const __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16));
+            acc0 = _mm_add_epi32(acc0, _mm_unpacklo_epi16(v0, zero));
+            acc1 = _mm_add_epi32(acc1, _mm_unpackhi_epi16(v0, zero));
+            acc0 = _mm_add_epi32(acc0, _mm_unpacklo_epi16(v1, zero));
+            acc1 = _mm_add_epi32(acc1, _mm_unpackhi_epi16(v1, zero));
+            data += 32;
+        }
+        uint32_t lanes[8];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), acc0);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes + 4), acc1);
+        for (size_t i = 0; i < 8; ++i) {
+            sum += lanes[i];
+        }
+        blocks -= count;
+    }
+    return sum + checksum_sum_words(data, size % 32);
+}
+
+#endif // TINS_CHECKSUM_SSE2
+
+#ifdef TINS_HAVE_CPU_DISPATCH
+
+__attribute__((target("avx2")))
+uint64_t checksum_sum_words_avx2(const uint8_t* data, size_t size) {
+    const __m256i zero = _mm256_setzero_si256();
+    uint64_t sum = 0;
+    size_t blocks = size / 64;
+    while (blocks > 0) {
+        const size_t count = std::min(blocks, CHECKSUM_MAX_LANE_BLOCKS / 2);
+        __m256i acc0 = zero;
+        __m256i acc1 = zero;
+        for (size_t i = 0; i < count; ++i) {
+            const __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+            const __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + 32));
+            acc0 = _mm256_add_epi32(acc0, _mm256_unpacklo_epi16(v0, zero));
+            acc1 = _mm256_add_epi32(acc1, _mm256_unpackhi_epi16(v0, zero));
+            acc0 = _mm256_add_epi32(acc0, _mm256_unpacklo_epi16(v1, zero));
+            acc1 = _mm256_add_epi32(acc1, _mm256_unpackhi_epi16(v1, zero));
+            data += 64;
+        }
+        uint32_t lanes[16];
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), acc0);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes + 8), acc1);
+        for (size_t i = 0; i < 16; ++i) {
+            sum += lanes[i];
+        }
+        blocks -= count;
+    }
+    return sum + checksum_sum_words(data, size % 64);
+}
+
+#endif // TINS_HAVE_CPU_DISPATCH
+
+#ifdef TINS_CHECKSUM_NEON
+
+uint64_t checksum_sum_words_neon(const uint8_t* data, size_t size) {
+    uint64_t sum = 0;
+    size_t blocks = size / 32;
+    while (blocks > 0) {
+        const size_t count = std::min(blocks, CHECKSUM_MAX_LANE_BLOCKS / 2);
+        uint32x4_t acc0 = vdupq_n_u32(0);
+        uint32x4_t acc1 = vdupq_n_u32(0);
+        for (size_t i = 0; i < count; ++i) {
+            acc0 = vpadalq_u16(acc0, vreinterpretq_u16_u8(vld1q_u8(data)));
+            acc1 = vpadalq_u16(acc1, vreinterpretq_u16_u8(vld1q_u8(data + 16)));
+            data += 32;
+        }
+        const uint64x2_t total = vaddq_u64(vpaddlq_u32(acc0), vpaddlq_u32(acc1));
+        sum += vgetq_lane_u64(total, 0) + vgetq_lane_u64(total, 1);
+        blocks -= count;
+    }
+    return sum + checksum_sum_words(data, size % 32);
+}
+
+#endif // TINS_CHECKSUM_NEON
+
+checksum_sum_function checksum_select_sum_function() {
+    #ifdef TINS_HAVE_CPU_DISPATCH
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return &checksum_sum_words_avx2;
+        }
+    #endif // TINS_HAVE_CPU_DISPATCH
+    #if defined(TINS_CHECKSUM_SSE2)
+        return &checksum_sum_words_sse2;
+    #elif defined(TINS_CHECKSUM_NEON)
+        return &checksum_sum_words_neon;
+    #else
+        return &checksum_sum_words;
+    #endif
+}
+
+// Picks the best implementation for this CPU on first use. Being a local
+// static, it's initialized safely even if several threads compute their first
+// checksum at once, or if checksums are computed during static initialization.
+static checksum_sum_function checksum_sum_words_impl() {
+    static const checksum_sum_function function = checksum_select_sum_function();
+    return function;
+}
+
+// Buffers smaller than this (e.g. IP headers) are summed using the scalar
+// loop, as the vector setup and the indirect call cost more than they save
+static const size_t CHECKSUM_VECTOR_THRESHOLD = 64;
+
+// CRC32 routines. These operate on the inverted CRC register, so the initial
+// value is 0xffffffff and the result has to be inverted once done.
+typedef uint32_t (*crc32_update_function)(uint32_t crc, const uint8_t* data, size_t size);
+
+// Lookup tables for the slicing-by-8 algorithm: tables[0] is the usual byte
+// wise table and tables[k][i] is the CRC of byte i followed by k zero bytes
+struct crc32_tables {
+    crc32_tables() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+            }
+            table[0][i] = crc;
+        }
+        for (uint32_t i = 0; i < 256; ++i) {
+            for (size_t k = 1; k < 8; ++k) {
+                table[k][i] = (table[k - 1][i] >> 8) ^ table[0][table[k - 1][i] & 0xff];
+            }
+        }
+    }
+
+    uint32_t table[8][256];
+};
+
+const crc32_tables& crc32_get_tables() {
+    static const crc32_tables tables;
+    return tables;
+}
+
+uint32_t crc32_update_slicing_by_8(uint32_t crc, const uint8_t* data, size_t size) {
+    const uint32_t (*table)[256] = crc32_get_tables().table;
+    while (size >= 8) {
+        // Bytes are assembled by hand so this works regardless of endianness
+        const uint32_t low = crc ^ (data[0] | (data[1] << 8) |
+                                    (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24));
+        const uint32_t high = data[4] | (data[5] << 8) |
+                              (data[6] << 16) | (static_cast<uint32_t>(data[7]) << 24);
+        crc = table[7][low & 0xff] ^ table[6][(low >> 8) & 0xff] ^
+              table[5][(low >> 16) & 0xff] ^ table[4][low >> 24] ^
+              table[3][high & 0xff] ^ table[2][(high >> 8) & 0xff] ^
+              table[1][(high >> 16) & 0xff] ^ table[0][high >> 24];
+        data += 8;
+        size -= 8;
+    }
+    while (size > 0) {
+        crc = (crc >> 8) ^ table[0][(crc ^ *data) & 0xff];
+        ++data;
+        --size;
     }
+    return crc;
+}
 
-    while (ptr < last) {
-        memcpy(&buffer, ptr, sizeof(uint16_t));
-        checksum += buffer;
-        ptr += sizeof(uint16_t);
+#ifdef TINS_HAVE_CPU_DISPATCH
+
+// Folds 64 bytes at a time using carry-less multiplications, then reduces the
+// remainder using a Barrett reduction. See Intel's "Fast CRC Computation for
+// Generic Polynomials Using PCLMULQDQ Instruction". The constants are
+// x^(4*128+32) mod P, x^(4*128-32) mod P, x^(128+32) mod P, x^(128-32) mod P,
+// x^64 mod P and floor(x^64 / P) and P itself, bit reflected.
+__attribute__((target("pclmul,sse4.1")))
+uint32_t crc32_update_pclmul(uint32_t crc, const uint8_t* data, size_t size) {
+    // Folding needs at least 4 blocks of 16 bytes
+    if (size < 64) {
+        return crc32_update_slicing_by_8(crc, data, size);
     }
+    const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596LL, 0x0154442bd4LL);
+    const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009eLL, 0x01751997d0LL);
+    const __m128i k5 = _mm_set_epi64x(0, 0x0163cd6124LL);
+    const __m128i polynomial = _mm_set_epi64x(0x01f7011641LL, 0x01db710641LL);
+    const __m128i mask = _mm_setr_epi32(~0, 0, ~0, 0);
+
+    __m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    __m128i x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16));
+    __m128i x3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 32));
+    __m128i x4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 48));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(static_cast<int>(crc)));
+    data += 64;
+    size -= 64;
 
-    checksum += padding;
+    while (size >= 64) {
+        const __m128i x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+        const __m128i x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+        const __m128i x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+        const __m128i x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(data)));
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16)));
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 32)));
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 48)));
+        data += 64;
+        size -= 64;
+    }
+
+    // Fold the 4 accumulators into a single one
+    __m128i x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x2), x5);
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x3), x5);
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11), x4), x5);
+
+    // Then fold in any remaining 16 byte blocks
+    while (size >= 16) {
+        x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+        x1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x1, k3k4, 0x11),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(data))), x5);
+        data += 16;
+        size -= 16;
+    }
+
+    // Reduce 128 bits to 64
+    x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, mask);
+    x1 = _mm_xor_si128(_mm_clmulepi64_si128(x1, k5, 0x00), x2);
+
+    // Barrett reduction down to 32 bits
+    x2 = _mm_and_si128(x1, mask);
+    x2 = _mm_clmulepi64_si128(x2, polynomial, 0x10);
+    x2 = _mm_and_si128(x2, mask);
+    x2 = _mm_clmulepi64_si128(x2, polynomial, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+    crc = static_cast<uint32_t>(_mm_extract_epi32(x1, 1));
+
+    return crc32_update_slicing_by_8(crc, data, size);
+}
+
+#endif // TINS_HAVE_CPU_DISPATCH
+
+crc32_update_function crc32_select_update_function() {
+    #ifdef TINS_HAVE_CPU_DISPATCH
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1")) {
+            return &crc32_update_pclmul;
+        }
+    #endif // TINS_HAVE_CPU_DISPATCH
+    return &crc32_update_slicing_by_8;
+}
+
+// Same lazy selection as checksum_sum_words_impl
+static crc32_update_function crc32_update_impl() {
+    static const crc32_update_function function = crc32_select_update_function();
+    return function;
+}
+
+uint32_t do_checksum(const uint8_t* start, const uint8_t* end) {
+    return Endian::host_to_be<uint32_t>(sum_range(start, end));
+}
+
+uint16_t sum_range(const uint8_t* start, const uint8_t* end) {
+    const size_t size = end - start;
+    const size_t words_size = size & ~static_cast<size_t>(1);
+    uint64_t checksum = (size < CHECKSUM_VECTOR_THRESHOLD) ?
+                        checksum_sum_words(start, words_size) :
+                        checksum_sum_words_impl()(start, words_size);
+    if ((size & 1) == 1) {
+        checksum += Endian::host_to_le<uint16_t>(*(end - 1));
+    }
     while (checksum >> 16) {
         checksum = (checksum & 0xffff) + (checksum >> 16);
     }
-    return checksum;  
+    return static_cast<uint16_t>(checksum);
 }
 
 template <size_t buffer_size, typename AddressType>
@@ -110,22 +422,8 @@ uint32_t pseudoheader_checksum(IPv6Address source_ip,
 }
 
 uint32_t crc32(const uint8_t* data, uint32_t data_size) {
-    uint32_t i, crc = 0;
-    static uint32_t crc_table[] = {
-        0x4DBDF21C, 0x500AE278, 0x76D3D2D4, 0x6B64C2B0,
-        0x3B61B38C, 0x26D6A3E8, 0x000F9344, 0x1DB88320,
-        0xA005713C, 0xBDB26158, 0x9B6B51F4, 0x86DC4190,
-        0xD6D930AC, 0xCB6E20C8, 0xEDB71064, 0xF0000000
-    };
-
-    for (i = 0; i < data_size; ++i) {
-        crc = (crc >> 4) ^ crc_table[(crc ^ data[i]) & 0x0F];
-        crc = (crc >> 4) ^ crc_table[(crc ^ (data[i] >> 4)) & 0x0F];
-    }
-
-    return crc;
+    return ~crc32_update_impl()(0xffffffff, data, data_size);
 }
 
-
 } // Utils
 } // Tins
@@ -0,0 +1,57 @@
+#ifndef TINS_CAPTURE_FILE_TEST
+#define TINS_CAPTURE_FILE_TEST
+
+#include <cstdio>
+#include <stdint.h>
+#include <tins/timestamp.h>
+#include <tins/packet_writer.h>
+#include <tins/ethernetII.h>
+#include <tins/ip.h>
+#include <tins/tcp.h>
+#include <tins/udp.h>
+#include <tins/rawpdu.h>
+
+// Base fixture for the tests that write a capture file, which is removed 
+// once each test finishes
+class CaptureFileTest : public testing::Test {
+public:
+    explicit CaptureFileTest(const char* file_name)
+    : file_name(file_name) {
+
+    }
+
+    void TearDown() {
+        remove(file_name);
+    }
+
+    const char* file_name;
+};
+
+inline Tins::Timestamp make_timestamp(long seconds, long microseconds = 0) {
+    timeval tv;
+    tv.tv_sec = seconds;
+    tv.tv_usec = microseconds;
+    return tv;
+}
+
+// An Ethernet/IP/UDP frame sent to port 53
+inline Tins::PDU::serialization_type make_udp_frame(uint16_t sport) {
+    using namespace Tins;
+    EthernetII eth = EthernetII() / IP("1.2.3.4", "4.3.2.1") / UDP(53, sport);
+    return eth.serialize();
+}
+
+// An Ethernet/IP/TCP frame from port 80 to port 22 carrying "foo"
+inline Tins::PDU::serialization_type make_tcp_frame() {
+    using namespace Tins;
+    EthernetII eth = EthernetII() / IP("1.2.3.4", "4.3.2.1") / TCP(22, 80) / RawPDU("foo");
+    return eth.serialize();
+}
+
+inline void write_frame(Tins::PacketWriter& writer, const Tins::PDU::serialization_type& data,
+                        const Tins::Timestamp& timestamp) {
+    const uint32_t size = static_cast<uint32_t>(data.size());
+    writer.write_raw(&data[0], size, timestamp, size);
+}
+
+#endif // TINS_CAPTURE_FILE_TEST
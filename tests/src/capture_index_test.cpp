@@ -0,0 +1,265 @@
+#include <tins/config.h>
+#include <gtest/gtest.h>
+
+#ifdef TINS_HAVE_PCAP
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iterator>
+#include <stdint.h>
+#include <tins/capture_index.h>
+#include <tins/indexed_file_reader.h>
+#include <tins/pcapng_writer.h>
+#include <tins/packet_writer.h>
+#include <tins/ethernetII.h>
+#include <tins/ip.h>
+#include <tins/udp.h>
+#include <tins/packet.h>
+#include <tins/exceptions.h>
+#include "tests/capture_file.h"
+
+using std::string;
+using std::vector;
+
+using namespace Tins;
+
+class CaptureIndexTest : public CaptureFileTest {
+public:
+    static const char* index_file_name;
+
+    CaptureIndexTest()
+    : CaptureFileTest("capture_index_test.cap") {
+
+    }
+
+    void TearDown() {
+        CaptureFileTest::TearDown();
+        remove(index_file_name);
+    }
+
+    // Every packet's source port is its packet number
+    static void write_packet(PacketWriter& writer, uint16_t packet_number, long seconds) {
+        write_frame(writer, make_udp_frame(packet_number), make_timestamp(seconds));
+    }
+
+    // Writes a pcap file in which each packet is captured one second 
+    // after the previous one
+    void write_pcap_file(uint32_t packet_count, long first_second = 1000) {
+        PacketWriter writer(file_name, DataLinkType<EthernetII>());
+        for (uint32_t i = 0; i < packet_count; ++i) {
+            write_packet(writer, static_cast<uint16_t>(i), first_second + i);
+        }
+    }
+
+    static void write_file(const char* name, const vector<uint8_t>& buffer) {
+        std::ofstream output(name, std::ios::binary);
+        output.write((const char*)&buffer[0], buffer.size());
+    }
+
+    static vector<uint8_t> read_file(const char* name) {
+        std::ifstream input(name, std::ios::binary);
+        return vector<uint8_t>(std::istreambuf_iterator<char>(input),
+                               std::istreambuf_iterator<char>());
+    }
+
+    static uint16_t source_port(const Packet& packet) {
+        return packet.pdu()->rfind_pdu<UDP>().sport();
+    }
+};
+
+const char* CaptureIndexTest::index_file_name = "capture_index_test.idx";
+
+TEST_F(CaptureIndexTest, BuildPcapIndex) {
+    write_pcap_file(95);
+    CaptureIndex index = CaptureIndex::build(file_name, 10);
+    EXPECT_EQ(CaptureIndex::PCAP, index.format());
+    EXPECT_EQ(95U, index.packet_count());
+    EXPECT_EQ(10U, index.interval());
+    EXPECT_EQ(read_file(file_name).size(), index.file_size());
+    EXPECT_TRUE(index.sections().empty());
+    ASSERT_EQ(10U, index.checkpoints().size());
+
+    const uint64_t record_size = 16 + make_udp_frame(0).size();
+    for (size_t i = 0; i < index.checkpoints().size(); ++i) {
+        const CaptureIndex::checkpoint& point = index.checkpoints()[i];
+        EXPECT_EQ(i * 10, point.packet_number);
+        EXPECT_EQ(1000 + i * 10, static_cast<uint64_t>(point.timestamp.seconds()));
+        EXPECT_EQ(24 + i * 10 * record_size, point.offset);
+    }
+    EXPECT_EQ(30U, index.find_packet(35)->packet_number);
+    EXPECT_EQ(90U, index.find_packet(1000)->packet_number);
+    EXPECT_EQ(30U, index.find_timestamp(make_timestamp(1035))->packet_number);
+    EXPECT_EQ(20U, index.find_timestamp(make_timestamp(1030))->packet_number);
+    EXPECT_EQ(0U, index.find_timestamp(make_timestamp(0))->packet_number);
+}
+
+TEST_F(CaptureIndexTest, SaveAndLoad) {
+    write_pcap_file(50);
+    CaptureIndex index = CaptureIndex::build(file_name, 7);
+    index.save(index_file_name);
+    CaptureIndex loaded = CaptureIndex::load(index_file_name);
+    EXPECT_EQ(index.format(), loaded.format());
+    EXPECT_EQ(index.file_size(), loaded.file_size());
+    EXPECT_EQ(index.packet_count(), loaded.packet_count());
+    EXPECT_EQ(index.interval(), loaded.interval());
+    ASSERT_EQ(index.checkpoints().size(), loaded.checkpoints().size());
+    for (size_t i = 0; i < index.checkpoints().size(); ++i) {
+        const CaptureIndex::checkpoint& expected = index.checkpoints()[i];
+        const CaptureIndex::checkpoint& point = loaded.checkpoints()[i];
+        EXPECT_EQ(expected.timestamp.seconds(), point.timestamp.seconds());
+        EXPECT_EQ(expected.timestamp.microseconds(), point.timestamp.microseconds());
+        EXPECT_EQ(expected.packet_number, point.packet_number);
+        EXPECT_EQ(expected.offset, point.offset);
+        EXPECT_EQ(expected.section, point.section);
+    }
+}
+
+TEST_F(CaptureIndexTest, LoadInvalidIndex) {
+    EXPECT_THROW(CaptureIndex::load("/this/file/does/not/exist"), pcap_error);
+
+    write_pcap_file(20);
+    CaptureIndex::build(file_name, 4).save(index_file_name);
+    vector<uint8_t> buffer = read_file(index_file_name);
+    buffer.resize(buffer.size() - 1);
+    write_file(index_file_name, buffer);
+    EXPECT_THROW(CaptureIndex::load(index_file_name), pcap_error);
+
+    buffer[0] = 'X';
+    write_file(index_file_name, buffer);
+    EXPECT_THROW(CaptureIndex::load(index_file_name), pcap_error);
+}
+
+TEST_F(CaptureIndexTest, SeekPcap) {
+    write_pcap_file(100);
+    IndexedFileReader reader(file_name, CaptureIndex::build(file_name, 16));
+
+    ASSERT_TRUE(reader.seek(make_timestamp(1055)));
+    EXPECT_EQ(55U, reader.packet_number());
+    Packet packet(reader.next_packet());
+    ASSERT_TRUE(packet);
+    EXPECT_EQ(1055, packet.timestamp().seconds());
+    EXPECT_EQ(55, source_port(packet));
+    EXPECT_EQ(56U, reader.packet_number());
+
+    ASSERT_TRUE(reader.seek(make_timestamp(1070, 1)));
+    RawPacket frame;
+    ASSERT_TRUE(reader.next_frame(frame));
+    EXPECT_EQ(1071, frame.timestamp().seconds());
+
+    ASSERT_TRUE(reader.seek_packet(99));
+    packet = reader.next_packet();
+    ASSERT_TRUE(packet);
+    EXPECT_EQ(99, source_port(packet));
+    EXPECT_FALSE(reader.next_packet());
+
+    ASSERT_TRUE(reader.seek_packet(33));
+    packet = reader.next_packet();
+    ASSERT_TRUE(packet);
+    EXPECT_EQ(33, source_port(packet));
+
+    EXPECT_FALSE(reader.seek_packet(100));
+    EXPECT_FALSE(reader.seek(make_timestamp(1100)));
+
+    reader.rewind();
+    uint32_t count = 0;
+    reader.sniff_frames([&](const RawPacket&) {
+        ++count;
+        return true;
+    });
+    EXPECT_EQ(100U, count);
+}
+
+TEST_F(CaptureIndexTest, SeekOutOfOrderTimestamps) {
+    {
+        PacketWriter writer(file_name, DataLinkType<EthernetII>());
+        // Packet 5 is newer than every packet up to packet 20
+        for (uint16_t i = 0; i < 30; ++i) {
+            write_packet(writer, i, i == 5 ? 1025 : 1000 + i);
+        }
+    }
+
+    IndexedFileReader reader(file_name, CaptureIndex::build(file_name, 4));
+    ASSERT_TRUE(reader.seek(make_timestamp(1022)));
+    EXPECT_EQ(5U, reader.packet_number());
+    ASSERT_TRUE(reader.seek(make_timestamp(1026)));
+    EXPECT_EQ(26U, reader.packet_number());
+}
+
+TEST_F(CaptureIndexTest, SeekPcapng) {
+    // Two sections, where the second one describes its second interface
+    // after some of its packets were written
+    {
+        PcapngWriter writer(file_name);
+        writer.add_interface(DataLinkType<EthernetII>(), "eth0");
+        for (uint16_t i = 0; i < 10; ++i) {
+            EthernetII eth = EthernetII() / IP("1.2.3.4", "4.3.2.1") / UDP(53, i);
+            Packet packet(eth, make_timestamp(1000 + i));
+            writer.write(packet);
+        }
+    }
+    vector<uint8_t> buffer = read_file(file_name);
+    {
+        PcapngWriter writer(file_name);
+        writer.add_interface(DataLinkType<EthernetII>(), "eth1");
+        for (uint16_t i = 10; i < 30; ++i) {
+            if (i == 20) {
+                writer.add_interface(DataLinkType<IP>(), "tun0");
+            }
+            Packet packet;
+            if (i < 20) {
+                packet = Packet(EthernetII() / IP("1.2.3.4", "4.3.2.1") / UDP(53, i),
+                                make_timestamp(1000 + i));
+            }
+            else {
+                packet = Packet(IP("1.2.3.4", "4.3.2.1") / UDP(53, i),
+                                make_timestamp(1000 + i));
+                packet.interface_id(1);
+            }
+            writer.write(packet);
+        }
+    }
+    vector<uint8_t> second = read_file(file_name);
+    buffer.insert(buffer.end(), second.begin(), second.end());
+    write_file(file_name, buffer);
+
+    CaptureIndex index = CaptureIndex::build(file_name, 3);
+    EXPECT_EQ(CaptureIndex::PCAPNG, index.format());
+    EXPECT_EQ(30U, index.packet_count());
+    ASSERT_EQ(2U, index.sections().size());
+    EXPECT_EQ(0U, index.sections()[0].offset);
+    EXPECT_EQ(1U, index.sections()[0].interface_offsets.size());
+    EXPECT_EQ(buffer.size() - second.size(), index.sections()[1].offset);
+    EXPECT_EQ(2U, index.sections()[1].interface_offsets.size());
+    index.save(index_file_name);
+
+    IndexedFileReader reader(file_name, CaptureIndex::load(index_file_name));
+    ASSERT_TRUE(reader.seek_packet(25));
+    Packet packet(reader.next_packet());
+    ASSERT_TRUE(packet);
+    EXPECT_EQ(1U, packet.interface_id());
+    EXPECT_EQ(PDU::IP, packet.pdu()->pdu_type());
+    EXPECT_EQ(25, source_port(packet));
+
+    ASSERT_TRUE(reader.seek(make_timestamp(1014)));
+    packet = reader.next_packet();
+    ASSERT_TRUE(packet);
+    EXPECT_EQ(0U, packet.interface_id());
+    EXPECT_EQ(PDU::ETHERNET_II, packet.pdu()->pdu_type());
+    EXPECT_EQ(14, source_port(packet));
+
+    ASSERT_TRUE(reader.seek_packet(7));
+    packet = reader.next_packet();
+    ASSERT_TRUE(packet);
+    EXPECT_EQ(7, source_port(packet));
+}
+
+TEST_F(CaptureIndexTest, MismatchedIndex) {
+    write_pcap_file(10);
+    CaptureIndex index = CaptureIndex::build(file_name);
+    write_pcap_file(11);
+    EXPECT_THROW(IndexedFileReader(file_name, index), pcap_error);
+}
+
+#endif // TINS_HAVE_PCAP
@@ -0,0 +1,218 @@
+#include <gtest/gtest.h>
+#include <map>
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <future>
+#include <tins/capture_pipeline.h>
+#include <tins/pdu_arena.h>
+#include <tins/ethernetII.h>
+#include <tins/dot1q.h>
+#include <tins/arp.h>
+#include <tins/ip.h>
+#include <tins/ipv6.h>
+#include <tins/tcp.h>
+#include <tins/udp.h>
+#include <tins/rawpdu.h>
+
+#if defined(TINS_HAVE_PCAP) && defined(TINS_HAVE_CXX11)
+
+using std::map;
+using std::mutex;
+using std::lock_guard;
+using std::pair;
+using std::make_pair;
+
+using namespace Tins;
+
+class CapturePipelineTest : public testing::Test {
+public:
+    typedef PDU::serialization_type buffer_type;
+
+    static uint32_t hash(PDU& pdu, int link_type = DLT_EN10MB) {
+        buffer_type buffer = pdu.serialize();
+        return CapturePipeline::flow_hash(&buffer[0], buffer.size(), link_type);
+    }
+
+    static buffer_type make_frame(const IPv4Address& src, const IPv4Address& dst,
+                                  uint16_t sport, uint16_t dport, uint32_t seq) {
+        EthernetII eth = EthernetII() / IP(dst, src) / TCP(dport, sport);
+        eth.rfind_pdu<TCP>().seq(seq);
+        return eth.serialize();
+    }
+};
+
+TEST_F(CapturePipelineTest, FlowHashIsSymmetric) {
+    EthernetII forward = EthernetII() / IP("1.2.3.4", "5.6.7.8") / TCP(80, 1234);
+    EthernetII backward = EthernetII() / IP("5.6.7.8", "1.2.3.4") / TCP(1234, 80);
+    EthernetII other = EthernetII() / IP("1.2.3.4", "5.6.7.8") / TCP(80, 1235);
+    EXPECT_EQ(hash(forward), hash(backward));
+    EXPECT_NE(hash(forward), hash(other));
+    EXPECT_NE(0U, hash(forward));
+}
+
+TEST_F(CapturePipelineTest, FlowHashUsesProtocol) {
+    EthernetII tcp = EthernetII() / IP("1.2.3.4", "5.6.7.8") / TCP(80, 1234);
+    EthernetII udp = EthernetII() / IP("1.2.3.4", "5.6.7.8") / UDP(80, 1234);
+    EXPECT_NE(hash(tcp), hash(udp));
+}
+
+TEST_F(CapturePipelineTest, FlowHashSkipsVLANTags) {
+    EthernetII plain = EthernetII() / IP("1.2.3.4", "5.6.7.8") / UDP(53, 1234);
+    EthernetII tagged = EthernetII() / Dot1Q(10) / IP("5.6.7.8", "1.2.3.4") / UDP(1234, 53);
+    EXPECT_EQ(hash(plain), hash(tagged));
+}
+
+TEST_F(CapturePipelineTest, FlowHashIPv6) {
+    EthernetII forward = EthernetII() / IPv6("::1", "f::1") / TCP(22, 4000);
+    EthernetII backward = EthernetII() / IPv6("f::1", "::1") / TCP(4000, 22);
+    EXPECT_EQ(hash(forward), hash(backward));
+    EXPECT_NE(0U, hash(forward));
+}
+
+TEST_F(CapturePipelineTest, FlowHashRawIP) {
+    EthernetII eth = EthernetII() / IP("1.2.3.4", "5.6.7.8") / UDP(53, 1234);
+    IP ip = IP("1.2.3.4", "5.6.7.8") / UDP(53, 1234);
+    EXPECT_EQ(hash(eth), hash(ip, DLT_RAW));
+}
+
+TEST_F(CapturePipelineTest, FlowHashIgnoresPortsOnFragments) {
+    IP first = IP("1.2.3.4", "5.6.7.8") / UDP(53, 1234) / RawPDU("abcdefgh");
+    first.flags(IP::MORE_FRAGMENTS);
+    IP second = IP("1.2.3.4", "5.6.7.8") / RawPDU("ijklmnop");
+    second.protocol(17);
+    second.fragment_offset(2);
+    EXPECT_EQ(hash(first, DLT_RAW), hash(second, DLT_RAW));
+}
+
+TEST_F(CapturePipelineTest, FlowHashNonIP) {
+    EthernetII arp = EthernetII() / ARP("1.2.3.4", "5.6.7.8");
+    EXPECT_EQ(0U, hash(arp));
+    EXPECT_EQ(0U, CapturePipeline::flow_hash(0, 0, DLT_EN10MB));
+}
+
+TEST_F(CapturePipelineTest, FlowsStayOnOneWorker) {
+    typedef pair<IPv4Address, IPv4Address> flow_type;
+    mutex lock;
+    map<flow_type, std::thread::id> workers;
+    map<flow_type, uint32_t> last_seq;
+    bool affinity_broken = false;
+    bool order_broken = false;
+    size_t processed = 0;
+
+    CapturePipeline pipeline(4);
+    pipeline.start(DLT_EN10MB, [&](Packet& packet) {
+        const IP& ip = packet.pdu()->rfind_pdu<IP>();
+        const TCP& tcp = packet.pdu()->rfind_pdu<TCP>();
+        // Use the same key for both directions
+        flow_type flow = std::minmax(ip.src_addr(), ip.dst_addr());
+        lock_guard<mutex> _(lock);
+        if (workers.count(flow) && workers[flow] != std::this_thread::get_id()) {
+            affinity_broken = true;
+        }
+        workers[flow] = std::this_thread::get_id();
+        if (last_seq.count(flow) && last_seq[flow] >= tcp.seq()) {
+            order_broken = true;
+        }
+        last_seq[flow] = tcp.seq();
+        processed++;
+        return true;
+    });
+    const uint32_t packet_count = 400;
+    for (uint32_t i = 0; i < packet_count; ++i) {
+        IPv4Address client(0x0a000000 + (i % 20));
+        IPv4Address server("192.168.0.1");
+        buffer_type buffer = (i % 2 == 0) 
+                             ? make_frame(client, server, 1000, 80, i)
+                             : make_frame(server, client, 80, 1000, i);
+        ASSERT_TRUE(pipeline.push(RawPacket(&buffer[0], buffer.size(), buffer.size(), 
+                                            Timestamp())));
+    }
+    pipeline.finish();
+
+    EXPECT_EQ(packet_count, processed);
+    EXPECT_EQ(20U, workers.size());
+    EXPECT_FALSE(affinity_broken);
+    EXPECT_FALSE(order_broken);
+    uint64_t enqueued = 0;
+    for (uint32_t i = 0; i < pipeline.worker_count(); ++i) {
+        CapturePipeline::statistics stats = pipeline.stats(i);
+        enqueued += stats.enqueued;
+        EXPECT_EQ(0U, stats.dropped);
+        EXPECT_EQ(0U, stats.queue_depth);
+    }
+    EXPECT_EQ(packet_count, enqueued);
+}
+
+TEST_F(CapturePipelineTest, DropsWhenQueueIsFull) {
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    CapturePipeline pipeline(1, 2);
+    pipeline.start(DLT_EN10MB, [released](Packet&) {
+        released.wait();
+        return true;
+    });
+    buffer_type buffer = make_frame("1.2.3.4", "5.6.7.8", 1, 2, 0);
+    size_t pushed = 0;
+    for (size_t i = 0; i < 10; ++i) {
+        if (pipeline.push(RawPacket(&buffer[0], buffer.size(), buffer.size(), Timestamp()))) {
+            pushed++;
+        }
+    }
+    CapturePipeline::statistics stats = pipeline.stats(0);
+    release.set_value();
+    pipeline.finish();
+
+    EXPECT_EQ(pushed, stats.enqueued);
+    EXPECT_EQ(10U, stats.enqueued + stats.dropped);
+    EXPECT_GE(stats.dropped, 7U);
+    EXPECT_LE(stats.queue_depth, 2U);
+}
+
+TEST_F(CapturePipelineTest, StopsWhenCallbackReturnsFalse) {
+    CapturePipeline pipeline(1);
+    size_t processed = 0;
+    pipeline.start(DLT_EN10MB, [&](Packet&) {
+        return ++processed < 3;
+    });
+    buffer_type buffer = make_frame("1.2.3.4", "5.6.7.8", 1, 2, 0);
+    for (size_t i = 0; i < 10; ++i) {
+        pipeline.push(RawPacket(&buffer[0], buffer.size(), buffer.size(), Timestamp()));
+    }
+    pipeline.finish();
+    EXPECT_EQ(3U, processed);
+}
+
+TEST_F(CapturePipelineTest, PDUArenaIsOptIn) {
+    buffer_type buffer = make_frame("1.2.3.4", "5.6.7.8", 1, 2, 0);
+    for (int i = 0; i < 2; ++i) {
+        const bool use_arena = i == 1;
+        bool arena_used = !use_arena;
+        CapturePipeline pipeline(1);
+        pipeline.set_use_pdu_arena(use_arena);
+        pipeline.start(DLT_EN10MB, [&](Packet&) {
+            arena_used = PDUArena::current() != 0;
+            return true;
+        });
+        pipeline.push(RawPacket(&buffer[0], buffer.size(), buffer.size(), Timestamp()));
+        pipeline.finish();
+        EXPECT_EQ(use_arena, arena_used);
+    }
+}
+
+TEST_F(CapturePipelineTest, RethrowsCallbackExceptions) {
+    CapturePipeline pipeline(2);
+    pipeline.start(DLT_EN10MB, [](Packet&) -> bool {
+        throw std::logic_error("failed");
+    });
+    buffer_type buffer = make_frame("1.2.3.4", "5.6.7.8", 1, 2, 0);
+    pipeline.push(RawPacket(&buffer[0], buffer.size(), buffer.size(), Timestamp()));
+    EXPECT_THROW(pipeline.finish(), std::logic_error);
+}
+
+TEST_F(CapturePipelineTest, UnknownLinkType) {
+    CapturePipeline pipeline(1);
+    EXPECT_THROW(pipeline.start(-1, [](Packet&) { return true; }), unknown_link_type);
+}
+
+#endif // TINS_HAVE_PCAP && TINS_HAVE_CXX11
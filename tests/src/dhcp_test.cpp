@@ -317,3 +317,33 @@ TEST_F(DHCPTest, RemoveOption) {
     PDU::serialization_type new_buffer = dhcp.serialize();
     EXPECT_EQ(old_buffer, new_buffer);
 }
+
+#ifdef TINS_HAVE_CXX11
+
+TEST_F(DHCPTest, LazyOptions) {
+    DHCP eager(expected_packet, sizeof(expected_packet));
+    const DHCP::options_type options = eager.options();
+    LazyOptions::scope lazy;
+    DHCP dhcp(expected_packet, sizeof(expected_packet));
+    EXPECT_EQ(eager.header_size(), dhcp.header_size());
+
+    const DHCP::option_views_type views = dhcp.option_views();
+    DHCP::options_type::const_iterator opt = options.begin();
+    for (DHCP::option_views_type::iterator it = views.begin(); it != views.end(); ++it, ++opt) {
+        ASSERT_TRUE(opt != options.end());
+        EXPECT_EQ(opt->option(), it->option());
+        ASSERT_EQ(opt->data_size(), it->data_size());
+        EXPECT_TRUE(std::equal(it->data_ptr(), it->data_ptr() + it->data_size(), 
+                               opt->data_ptr()));
+    }
+    EXPECT_TRUE(opt == options.end());
+
+    PDU::serialization_type buffer = dhcp.serialize();
+    ASSERT_EQ(buffer.size(), sizeof(expected_packet));
+    EXPECT_TRUE(std::equal(buffer.begin(), buffer.end(), expected_packet));
+
+    EXPECT_EQ(IPv4Address("192.168.4.2"), dhcp.server_identifier());
+    test_equals(eager, dhcp);
+}
+
+#endif // TINS_HAVE_CXX11
@@ -479,4 +479,41 @@ TEST_F(Dot11BeaconTest, RemoveOption) {
     EXPECT_EQ(old_buffer, new_buffer);
 }
 
+#ifdef TINS_HAVE_CXX11
+
+TEST_F(Dot11BeaconTest, LazyOptions) {
+    const uint8_t buffer[] = {
+        128, 0, 0, 0, 255, 255, 255, 255, 255, 255, 244, 236, 56, 254, 77, 
+        146, 244, 236, 56, 254, 77, 146, 224, 234, 128, 209, 212, 206, 44, 
+        0, 0, 0, 100, 0, 49, 4, 0, 7, 83, 101, 103, 117, 110, 100, 111, 1, 
+        8, 130, 132, 139, 150, 12, 18, 24, 36, 3, 1, 1, 5, 4, 0, 1, 0, 0, 7, 
+        6, 85, 83, 32, 1, 13, 20, 42, 1, 0, 48, 20, 1, 0, 0, 15, 172, 4, 1, 
+        0, 0, 15, 172, 4, 1, 0, 0, 15, 172, 2, 0, 0, 50, 4, 48, 72, 96, 108, 
+        221, 24, 0, 80, 242, 2, 1, 1, 3, 0, 3, 164, 0, 0, 39, 164, 0, 0, 66, 
+        67, 94, 0, 98, 50, 47, 0, 221, 9, 0, 3, 127, 1, 1, 0, 0, 255, 127
+    };
+    Dot11Beacon eager(buffer, sizeof(buffer));
+    LazyOptions::scope lazy;
+    Dot11Beacon dot11(buffer, sizeof(buffer));
+    EXPECT_EQ(eager.size(), dot11.size());
+
+    const Dot11::option_views_type views = dot11.option_views();
+    ASSERT_FALSE(views.empty());
+    EXPECT_EQ(Dot11::SSID, views.begin()->option());
+    EXPECT_EQ("Segundo", string(views.begin()->data_ptr(), 
+                                views.begin()->data_ptr() + views.begin()->data_size()));
+    EXPECT_EQ(eager.options().size(), 
+              static_cast<size_t>(std::distance(views.begin(), views.end())));
+
+    PDU::serialization_type serialized = dot11.serialize();
+    ASSERT_EQ(sizeof(buffer), serialized.size());
+    EXPECT_TRUE(std::equal(serialized.begin(), serialized.end(), buffer));
+
+    EXPECT_EQ("Segundo", dot11.ssid());
+    EXPECT_EQ(1, dot11.ds_parameter_set());
+    EXPECT_EQ(eager.options().size(), dot11.options().size());
+}
+
+#endif // TINS_HAVE_CXX11
+
 #endif // TINS_HAVE_DOT11
@@ -10,6 +10,7 @@
 #include <tins/rawpdu.h>
 #include <tins/ip_address.h>
 #include <tins/ethernetII.h>
+#include <tins/exceptions.h>
 
 using namespace std;
 using namespace Tins;
@@ -883,3 +884,55 @@ TEST_F(IPTest, ParseSerializeOptions) {
     const vector<uint8_t> buffer(options_packet, options_packet + sizeof(options_packet));
     EXPECT_EQ(buffer, serialized);
 }
+
+TEST_F(IPTest, OptionViews) {
+    IP ip(expected_packet, sizeof(expected_packet));
+    const IP::options_type& options = ip.options();
+    const IP::option_views_type views = ip.option_views();
+    IP::options_type::const_iterator opt = options.begin();
+    for (IP::option_views_type::iterator it = views.begin(); it != views.end(); ++it, ++opt) {
+        ASSERT_TRUE(opt != options.end());
+        EXPECT_EQ(opt->option(), it->option());
+        EXPECT_EQ(opt->data_ptr(), it->data_ptr());
+        EXPECT_EQ(opt->data_size(), it->data_size());
+    }
+    EXPECT_TRUE(opt == options.end());
+}
+
+#ifdef TINS_HAVE_CXX11
+
+TEST_F(IPTest, LazyOptions) {
+    EthernetII eager(options_packet, sizeof(options_packet));
+    const IP::options_type& options = eager.rfind_pdu<IP>().options();
+    LazyOptions::scope lazy;
+    EthernetII packet(options_packet, sizeof(options_packet));
+    const IP& ip = packet.rfind_pdu<IP>();
+
+    const IP::option_views_type views = ip.option_views();
+    IP::options_type::const_iterator opt = options.begin();
+    for (IP::option_views_type::iterator it = views.begin(); it != views.end(); ++it, ++opt) {
+        ASSERT_TRUE(opt != options.end());
+        EXPECT_EQ(opt->option(), it->option());
+        ASSERT_EQ(opt->data_size(), it->data_size());
+        EXPECT_TRUE(std::equal(it->data_ptr(), it->data_ptr() + it->data_size(), 
+                               opt->data_ptr()));
+    }
+    EXPECT_TRUE(opt == options.end());
+
+    const vector<uint8_t> buffer(options_packet, options_packet + sizeof(options_packet));
+    EXPECT_EQ(buffer, packet.serialize());
+    EXPECT_EQ(options.size(), ip.options().size());
+    EXPECT_EQ(buffer, packet.serialize());
+}
+
+TEST_F(IPTest, LazyOptionsMalformed) {
+    LazyOptions::scope lazy;
+    // An END option followed by more options
+    const uint8_t packet[] = {
+        70, 0, 0, 24, 0, 1, 0, 0, 64, 17, 0, 0, 192, 168, 0, 1, 192, 168, 
+        0, 2, 0, 1, 1, 1
+    };
+    EXPECT_THROW(IP(packet, sizeof(packet)), malformed_packet);
+}
+
+#endif // TINS_HAVE_CXX11
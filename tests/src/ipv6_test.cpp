@@ -420,3 +420,31 @@ TEST_F(IPv6Test, FragmentExtensionHeader) {
     EXPECT_TRUE(header.more_fragments);
     EXPECT_EQ(42UL, header.identification);
 }
+
+#ifdef TINS_HAVE_CXX11
+
+TEST_F(IPv6Test, LazyExtensionHeaders) {
+    LazyOptions::scope lazy;
+    EthernetII pkt(routing_header, sizeof(routing_header));
+    IPv6& ipv6 = pkt.rfind_pdu<IPv6>();
+    EXPECT_EQ(
+        PDU::serialization_type(routing_header, routing_header + sizeof(routing_header)),
+        pkt.serialize()
+    );
+
+    EthernetII hop_by_hop(hop_by_hop_options, sizeof(hop_by_hop_options));
+    const IPv6& hop_by_hop_ipv6 = hop_by_hop.rfind_pdu<IPv6>();
+    const IPv6::ext_header* ext_header = hop_by_hop_ipv6.search_header(IPv6::HOP_BY_HOP);
+    ASSERT_TRUE(ext_header != NULL);
+    const IPv6::hop_by_hop_header hbh_header = IPv6::hop_by_hop_header::from_extension_header(*ext_header);
+    EXPECT_EQ(1UL, hbh_header.options.size());
+    EXPECT_EQ(5, hbh_header.options[0].first);
+
+    ipv6.add_header(IPv6::ext_header(IPv6::AUTHENTICATION));
+    const IPv6::headers_type& headers = ipv6.headers();
+    ASSERT_EQ(2UL, headers.size());
+    EXPECT_EQ(IPv6::ROUTING, headers[0].option());
+    EXPECT_EQ(IPv6::AUTHENTICATION, headers[1].option());
+}
+
+#endif // TINS_HAVE_CXX11
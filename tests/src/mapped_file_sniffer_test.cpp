@@ -0,0 +1,265 @@
+#include <tins/config.h>
+#include <gtest/gtest.h>
+
+#ifdef TINS_HAVE_PCAP
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iterator>
+#include <stdint.h>
+#include <tins/mapped_file_sniffer.h>
+#include <tins/packet_writer.h>
+#include <tins/ethernetII.h>
+#include <tins/ip.h>
+#include <tins/tcp.h>
+#include <tins/udp.h>
+#include <tins/rawpdu.h>
+#include <tins/exceptions.h>
+#include "tests/capture_file.h"
+
+using std::string;
+using std::vector;
+
+using namespace Tins;
+
+class MappedFileSnifferTest : public CaptureFileTest {
+public:
+    static const uint32_t link_type_ethernet = 1;
+
+    MappedFileSnifferTest()
+    : CaptureFileTest("mapped_file_sniffer_test.pcap") {
+
+    }
+
+    // Builds files byte by byte, for the formats PacketWriter doesn't produce
+    static void write_field(vector<uint8_t>& buffer, uint32_t value, bool big_endian) {
+        for (int i = 0; i < 4; ++i) {
+            const int shift = big_endian ? (3 - i) * 8 : i * 8;
+            buffer.push_back(static_cast<uint8_t>(value >> shift));
+        }
+    }
+
+    static vector<uint8_t> file_header(uint32_t magic, uint32_t link_type, 
+                                       bool big_endian = false) {
+        vector<uint8_t> buffer;
+        write_field(buffer, magic, big_endian);
+        // Major and minor versions, 2.4
+        const uint8_t big_endian_version[] = { 0, 2, 0, 4 };
+        const uint8_t little_endian_version[] = { 2, 0, 4, 0 };
+        const uint8_t* ptr = big_endian ? big_endian_version : little_endian_version;
+        buffer.insert(buffer.end(), ptr, ptr + 4);
+        write_field(buffer, 0, big_endian);
+        write_field(buffer, 0, big_endian);
+        write_field(buffer, 65535, big_endian);
+        write_field(buffer, link_type, big_endian);
+        return buffer;
+    }
+
+    static void add_record(vector<uint8_t>& buffer, uint32_t seconds, uint32_t fraction,
+                           const PDU::serialization_type& data, bool big_endian = false) {
+        write_field(buffer, seconds, big_endian);
+        write_field(buffer, fraction, big_endian);
+        write_field(buffer, static_cast<uint32_t>(data.size()), big_endian);
+        write_field(buffer, static_cast<uint32_t>(data.size()), big_endian);
+        buffer.insert(buffer.end(), data.begin(), data.end());
+    }
+
+    void write_file(const vector<uint8_t>& buffer) {
+        std::ofstream output(file_name, std::ios::binary);
+        output.write((const char*)&buffer[0], buffer.size());
+    }
+
+    vector<uint8_t> read_file() {
+        std::ifstream input(file_name, std::ios::binary);
+        return vector<uint8_t>(std::istreambuf_iterator<char>(input),
+                               std::istreambuf_iterator<char>());
+    }
+};
+
+TEST_F(MappedFileSnifferTest, ReadFrames) {
+    {
+        PacketWriter writer(file_name, DataLinkType<EthernetII>());
+        write_frame(writer, make_tcp_frame(), make_timestamp(100, 250));
+        write_frame(writer, make_udp_frame(1024), make_timestamp(101, 999999));
+    }
+    const vector<uint8_t> buffer = read_file();
+
+    MappedFileSniffer sniffer(file_name);
+    EXPECT_EQ(DLT_EN10MB, sniffer.link_type());
+    EXPECT_EQ(65535U, sniffer.snap_len());
+    EXPECT_FALSE(sniffer.has_nanosecond_timestamps());
+    EXPECT_EQ(buffer.size(), sniffer.file_size());
+
+    RawPacket frame;
+    ASSERT_TRUE(sniffer.next_frame(frame));
+    EXPECT_EQ(make_tcp_frame(), PDU::serialization_type(frame.data(), frame.data() + frame.size()));
+    EXPECT_EQ(frame.size(), frame.original_size());
+    EXPECT_EQ(100, frame.timestamp().seconds());
+    EXPECT_EQ(250, frame.timestamp().microseconds());
+    EXPECT_EQ(22, frame.view().header<TCP>().dport());
+
+    ASSERT_TRUE(sniffer.next_frame(frame));
+    EXPECT_EQ(make_udp_frame(1024), PDU::serialization_type(frame.data(), frame.data() + frame.size()));
+    EXPECT_EQ(101, frame.timestamp().seconds());
+    EXPECT_EQ(999999, frame.timestamp().microseconds());
+    EXPECT_FALSE(sniffer.next_frame(frame));
+    EXPECT_EQ(buffer.size(), sniffer.position());
+}
+
+TEST_F(MappedFileSnifferTest, NanosecondTimestamps) {
+    vector<uint8_t> buffer = file_header(0xa1b23c4d, link_type_ethernet);
+    add_record(buffer, 100, 123456789, make_tcp_frame());
+    write_file(buffer);
+
+    MappedFileSniffer sniffer(file_name);
+    EXPECT_TRUE(sniffer.has_nanosecond_timestamps());
+    RawPacket frame;
+    ASSERT_TRUE(sniffer.next_frame(frame));
+    EXPECT_EQ(100, frame.timestamp().seconds());
+    EXPECT_EQ(123456, frame.timestamp().microseconds());
+}
+
+TEST_F(MappedFileSnifferTest, BigEndianFile) {
+    vector<uint8_t> buffer = file_header(0xa1b2c3d4, link_type_ethernet, true);
+    add_record(buffer, 100, 250, make_tcp_frame(), true);
+    write_file(buffer);
+
+    MappedFileSniffer sniffer(file_name);
+    EXPECT_EQ(DLT_EN10MB, sniffer.link_type());
+    EXPECT_EQ(65535U, sniffer.snap_len());
+    RawPacket frame;
+    ASSERT_TRUE(sniffer.next_frame(frame));
+    EXPECT_EQ(make_tcp_frame().size(), frame.size());
+    EXPECT_EQ(100, frame.timestamp().seconds());
+    EXPECT_EQ(250, frame.timestamp().microseconds());
+}
+
+TEST_F(MappedFileSnifferTest, NextPacket) {
+    {
+        PacketWriter writer(file_name, DataLinkType<EthernetII>());
+        write_frame(writer, make_tcp_frame(), make_timestamp(100, 250));
+        write_frame(writer, make_udp_frame(1024), make_timestamp(101));
+    }
+
+    MappedFileSniffer sniffer(file_name);
+    Packet packet(sniffer.next_packet());
+    ASSERT_TRUE(packet);
+    EXPECT_EQ(100, packet.timestamp().seconds());
+    ASSERT_TRUE(packet.pdu()->find_pdu<TCP>() != 0);
+    EXPECT_EQ(22, packet.pdu()->rfind_pdu<TCP>().dport());
+    EXPECT_EQ("foo", string(packet.pdu()->rfind_pdu<RawPDU>().payload().begin(),
+                            packet.pdu()->rfind_pdu<RawPDU>().payload().end()));
+
+    packet = sniffer.next_packet();
+    ASSERT_TRUE(packet);
+    EXPECT_TRUE(packet.pdu()->find_pdu<UDP>() != 0);
+    EXPECT_FALSE(sniffer.next_packet());
+}
+
+TEST_F(MappedFileSnifferTest, NextPacketBorrowsPayloads) {
+    {
+        PacketWriter writer(file_name, DataLinkType<EthernetII>());
+        write_frame(writer, make_tcp_frame(), make_timestamp(100, 250));
+    }
+
+    MappedFileSniffer sniffer(file_name);
+    RawPDU::borrow_scope scope;
+    Packet packet(sniffer.next_packet());
+    ASSERT_TRUE(packet);
+    const RawPDU& raw = packet.pdu()->rfind_pdu<RawPDU>();
+    EXPECT_FALSE(raw.owns_payload());
+    EXPECT_EQ("foo", string(raw.payload_data(), raw.payload_data() + raw.payload_size()));
+}
+
+TEST_F(MappedFileSnifferTest, SniffLoop) {
+    {
+        PacketWriter writer(file_name, DataLinkType<EthernetII>());
+        for (long i = 0; i < 10; ++i) {
+            write_frame(writer, make_tcp_frame(), make_timestamp(i));
+        }
+    }
+
+    MappedFileSniffer sniffer(file_name);
+    size_t count = 0;
+    sniffer.sniff_loop([&](Packet& packet) {
+        EXPECT_EQ(static_cast<long>(count), packet.timestamp().seconds());
+        count++;
+        return true;
+    });
+    EXPECT_EQ(10U, count);
+
+    sniffer.rewind();
+    count = 0;
+    sniffer.sniff_frames([&](const RawPacket&) {
+        count++;
+        return true;
+    }, 4);
+    EXPECT_EQ(4U, count);
+}
+
+TEST_F(MappedFileSnifferTest, Seek) {
+    {
+        PacketWriter writer(file_name, DataLinkType<EthernetII>());
+        write_frame(writer, make_tcp_frame(), make_timestamp(1));
+        write_frame(writer, make_udp_frame(1024), make_timestamp(2));
+    }
+
+    MappedFileSniffer sniffer(file_name);
+    RawPacket frame;
+    ASSERT_TRUE(sniffer.next_frame(frame));
+    const uint64_t second_record = sniffer.position();
+    ASSERT_TRUE(sniffer.next_frame(frame));
+    EXPECT_EQ(2, frame.timestamp().seconds());
+
+    sniffer.seek(second_record);
+    ASSERT_TRUE(sniffer.next_frame(frame));
+    EXPECT_EQ(2, frame.timestamp().seconds());
+
+    sniffer.rewind();
+    ASSERT_TRUE(sniffer.next_frame(frame));
+    EXPECT_EQ(1, frame.timestamp().seconds());
+    EXPECT_THROW(sniffer.seek(sniffer.file_size() + 1), std::runtime_error);
+}
+
+TEST_F(MappedFileSnifferTest, TruncatedRecord) {
+    {
+        PacketWriter writer(file_name, DataLinkType<EthernetII>());
+        write_frame(writer, make_tcp_frame(), make_timestamp(1));
+        write_frame(writer, make_udp_frame(1024), make_timestamp(2));
+    }
+    vector<uint8_t> buffer = read_file();
+    buffer.resize(buffer.size() - 5);
+    write_file(buffer);
+
+    MappedFileSniffer sniffer(file_name);
+    RawPacket frame;
+    EXPECT_TRUE(sniffer.next_frame(frame));
+    EXPECT_FALSE(sniffer.next_frame(frame));
+    EXPECT_FALSE(sniffer.next_frame(frame));
+}
+
+TEST_F(MappedFileSnifferTest, EmptyFile) {
+    {
+        PacketWriter writer(file_name, DataLinkType<EthernetII>());
+    }
+    MappedFileSniffer sniffer(file_name);
+    RawPacket frame;
+    EXPECT_FALSE(sniffer.next_frame(frame));
+    EXPECT_FALSE(sniffer.next_packet());
+}
+
+TEST_F(MappedFileSnifferTest, InvalidFiles) {
+    EXPECT_THROW(MappedFileSniffer("/this/file/does/not/exist.pcap"), pcap_error);
+
+    vector<uint8_t> buffer = file_header(0x0a0d0d0a, link_type_ethernet);
+    write_file(buffer);
+    EXPECT_THROW(MappedFileSniffer sniffer(file_name), pcap_error);
+
+    buffer.resize(10);
+    write_file(buffer);
+    EXPECT_THROW(MappedFileSniffer sniffer(file_name), pcap_error);
+}
+
+#endif // TINS_HAVE_PCAP
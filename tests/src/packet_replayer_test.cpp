@@ -0,0 +1,218 @@
+#include <tins/config.h>
+#include <gtest/gtest.h>
+
+#if defined(TINS_HAVE_PCAP) && defined(TINS_HAVE_CXX11)
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <stdexcept>
+#include <stdint.h>
+#include <tins/packet_replayer.h>
+#include <tins/packet_writer.h>
+#include <tins/ethernetII.h>
+#include <tins/ip.h>
+#include <tins/tcp.h>
+#include <tins/udp.h>
+#include <tins/rawpdu.h>
+#include "tests/capture_file.h"
+
+using std::string;
+using std::vector;
+
+using namespace Tins;
+
+class PacketReplayerTest : public CaptureFileTest {
+public:
+    typedef std::chrono::steady_clock clock_type;
+
+    PacketReplayerTest()
+    : CaptureFileTest("packet_replayer_test.pcap") {
+
+    }
+
+    // Writes a pcap file containing the given frames, captured at the
+    // given amount of microseconds after the first one
+    template <typename T>
+    void write_file(const vector<PDU::serialization_type>& frames, 
+                    const vector<uint32_t>& offsets, const DataLinkType<T>& link_type) {
+        PacketWriter writer(file_name, link_type);
+        for (size_t i = 0; i < frames.size(); ++i) {
+            const uint32_t timestamp = 1000000 + offsets[i];
+            write_frame(writer, frames[i], make_timestamp(timestamp / 1000000, 
+                                                          timestamp % 1000000));
+        }
+    }
+
+    void write_file(const vector<PDU::serialization_type>& frames, 
+                    const vector<uint32_t>& offsets) {
+        write_file(frames, offsets, DataLinkType<EthernetII>());
+    }
+
+    static PDU::serialization_type make_frame(uint16_t port) {
+        EthernetII eth = EthernetII("00:01:02:03:04:05", "06:07:08:09:0a:0b") / 
+                         IP("4.3.2.1", "1.2.3.4") / TCP(80, port) / RawPDU("foo");
+        return eth.serialize();
+    }
+
+    // Writes 3 frames, captured 20ms apart
+    vector<PDU::serialization_type> write_default_file() {
+        vector<PDU::serialization_type> frames;
+        vector<uint32_t> offsets;
+        for (uint16_t i = 0; i < 3; ++i) {
+            frames.push_back(make_frame(1000 + i));
+            offsets.push_back(i * 20000);
+        }
+        write_file(frames, offsets);
+        return frames;
+    }
+
+    struct Recorder {
+        void operator()(const RawPacket& frame) {
+            frames.push_back(PDU::serialization_type(frame.data(), frame.data() + frame.size()));
+            times.push_back(clock_type::now());
+        }
+
+        double offset(size_t index) const {
+            return std::chrono::duration<double>(times[index] - times[0]).count();
+        }
+
+        vector<PDU::serialization_type> frames;
+        vector<clock_type::time_point> times;
+    };
+};
+
+TEST_F(PacketReplayerTest, ReplayAsFastAsPossible) {
+    vector<PDU::serialization_type> frames = write_default_file();
+    PacketReplayer replayer(file_name);
+    replayer.speed(0);
+    Recorder recorder;
+    PacketReplayer::statistics stats = replayer.replay(std::ref(recorder));
+    EXPECT_EQ(frames, recorder.frames);
+    EXPECT_EQ(3U, stats.packets);
+    EXPECT_EQ(frames.size() * frames[0].size(), stats.bytes);
+    EXPECT_EQ(1U, stats.loops);
+    EXPECT_LT(recorder.offset(2), 0.02);
+}
+
+TEST_F(PacketReplayerTest, OriginalTiming) {
+    write_default_file();
+    PacketReplayer replayer(file_name);
+    Recorder recorder;
+    PacketReplayer::statistics stats = replayer.replay(std::ref(recorder));
+    ASSERT_EQ(3U, recorder.frames.size());
+    EXPECT_GE(recorder.offset(1), 0.0195);
+    EXPECT_GE(recorder.offset(2), 0.0395);
+    EXPECT_GE(stats.elapsed, 0.0395);
+}
+
+TEST_F(PacketReplayerTest, SpeedMultiplier) {
+    write_default_file();
+    PacketReplayer replayer(file_name);
+    replayer.speed(4);
+    Recorder recorder;
+    replayer.replay(std::ref(recorder));
+    ASSERT_EQ(3U, recorder.frames.size());
+    EXPECT_GE(recorder.offset(1), 0.0045);
+    EXPECT_GE(recorder.offset(2), 0.0095);
+    EXPECT_LT(recorder.offset(2), 0.04);
+}
+
+TEST_F(PacketReplayerTest, MaxRateOnlyPacesSenders) {
+    vector<PDU::serialization_type> frames(5, make_frame(1000));
+    write_file(frames, vector<uint32_t>(5, 0));
+    PacketReplayer replayer(file_name);
+    replayer.max_rate(1);
+    Recorder recorder;
+    replayer.replay(std::ref(recorder));
+    ASSERT_EQ(5U, recorder.frames.size());
+    EXPECT_LT(recorder.offset(4), 0.5);
+}
+
+TEST_F(PacketReplayerTest, Loops) {
+    vector<PDU::serialization_type> frames = write_default_file();
+    PacketReplayer replayer(file_name);
+    replayer.speed(0);
+    replayer.loop_count(3);
+    Recorder recorder;
+    PacketReplayer::statistics stats = replayer.replay(std::ref(recorder));
+    ASSERT_EQ(9U, recorder.frames.size());
+    for (size_t i = 0; i < recorder.frames.size(); ++i) {
+        EXPECT_EQ(frames[i % 3], recorder.frames[i]);
+    }
+    EXPECT_EQ(9U, stats.packets);
+    EXPECT_EQ(3U, stats.loops);
+
+    // Replaying again starts from the beginning
+    stats = replayer.replay(std::ref(recorder));
+    EXPECT_EQ(9U, stats.packets);
+    EXPECT_EQ(18U, recorder.frames.size());
+}
+
+TEST_F(PacketReplayerTest, Stop) {
+    write_default_file();
+    PacketReplayer replayer(file_name);
+    replayer.speed(0);
+    replayer.loop_count(0);
+    replayer.prefetch_size(2);
+    uint32_t count = 0;
+    PacketReplayer::statistics stats = replayer.replay([&](const RawPacket&) {
+        if (++count == 10) {
+            replayer.stop();
+        }
+    });
+    EXPECT_EQ(10U, count);
+    EXPECT_EQ(10U, stats.packets);
+    EXPECT_EQ(3U, stats.loops);
+}
+
+TEST_F(PacketReplayerTest, RewriteAddresses) {
+    write_default_file();
+    PacketReplayer replayer(file_name);
+    replayer.speed(0);
+    replayer.dst_hw_addr("aa:bb:cc:dd:ee:ff");
+    replayer.src_hw_addr("11:22:33:44:55:66");
+    replayer.rewrite_address("1.2.3.4", "10.0.0.1");
+    replayer.rewrite_address("4.3.2.1", "10.0.0.2");
+    Recorder recorder;
+    replayer.replay(std::ref(recorder));
+    ASSERT_EQ(3U, recorder.frames.size());
+    for (uint16_t i = 0; i < 3; ++i) {
+        EthernetII expected = EthernetII("aa:bb:cc:dd:ee:ff", "11:22:33:44:55:66") / 
+                              IP("10.0.0.2", "10.0.0.1") / TCP(80, 1000 + i) / RawPDU("foo");
+        EXPECT_EQ(expected.serialize(), recorder.frames[i]);
+    }
+}
+
+TEST_F(PacketReplayerTest, RewriteHardwareAddressOnly) {
+    vector<PDU::serialization_type> frames = write_default_file();
+    PacketReplayer replayer(file_name);
+    replayer.speed(0);
+    replayer.dst_hw_addr("aa:bb:cc:dd:ee:ff");
+    Recorder recorder;
+    replayer.replay(std::ref(recorder));
+    ASSERT_EQ(3U, recorder.frames.size());
+    const uint8_t address[] = { 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff };
+    std::copy(address, address + 6, frames[0].begin());
+    EXPECT_EQ(frames[0], recorder.frames[0]);
+}
+
+TEST_F(PacketReplayerTest, CallbackException) {
+    write_default_file();
+    PacketReplayer replayer(file_name);
+    replayer.speed(0);
+    replayer.loop_count(0);
+    EXPECT_THROW(
+        replayer.replay([](const RawPacket&) { throw std::logic_error("failed"); }),
+        std::logic_error
+    );
+}
+
+TEST_F(PacketReplayerTest, NonEthernetFile) {
+    vector<PDU::serialization_type> frames(1, (IP("1.2.3.4") / UDP(1, 2)).serialize());
+    write_file(frames, vector<uint32_t>(1, 0), DataLinkType<IP>());
+    EXPECT_THROW(PacketReplayer replayer(file_name), std::runtime_error);
+}
+
+#endif // TINS_HAVE_PCAP && TINS_HAVE_CXX11
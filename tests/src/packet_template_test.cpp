@@ -0,0 +1,174 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <tins/packet_template.h>
+#include <tins/ethernetII.h>
+#include <tins/ieee802_3.h>
+#include <tins/llc.h>
+#include <tins/ip.h>
+#include <tins/ipv6.h>
+#include <tins/tcp.h>
+#include <tins/udp.h>
+#include <tins/rawpdu.h>
+#include <tins/exceptions.h>
+
+using std::string;
+using std::vector;
+
+using namespace Tins;
+
+class PacketTemplateTest : public testing::Test {
+public:
+    static EthernetII make_tcp(IPv4Address src, IPv4Address dst, uint16_t sport,
+                               uint16_t dport, uint32_t seq, uint32_t ack_seq,
+                               uint16_t id, uint8_t ttl) {
+        IP ip(dst, src);
+        ip.id(id);
+        ip.ttl(ttl);
+        TCP tcp(dport, sport);
+        tcp.seq(seq);
+        tcp.ack_seq(ack_seq);
+        tcp.set_flag(TCP::SYN, 1);
+        return EthernetII("00:01:02:03:04:05", "06:07:08:09:0a:0b") / ip / tcp / 
+               RawPDU("some payload");
+    }
+
+    static void check_equals(const PDU::serialization_type& expected, 
+                             const PacketTemplate& packet) {
+        ASSERT_EQ(expected.size(), packet.size());
+        EXPECT_EQ(expected, vector<uint8_t>(packet.data(), packet.data() + packet.size()));
+    }
+};
+
+TEST_F(PacketTemplateTest, FieldOffsets) {
+    EthernetII packet = make_tcp("1.2.3.4", "5.6.7.8", 1, 2, 3, 4, 5, 6);
+    PacketTemplate probe(packet);
+    EXPECT_EQ(packet.size(), probe.size());
+    EXPECT_EQ(18U, probe.field_offset(PacketTemplate::IP_ID));
+    EXPECT_EQ(22U, probe.field_offset(PacketTemplate::TTL));
+    EXPECT_EQ(26U, probe.field_offset(PacketTemplate::SRC_ADDR));
+    EXPECT_EQ(30U, probe.field_offset(PacketTemplate::DST_ADDR));
+    EXPECT_EQ(34U, probe.field_offset(PacketTemplate::SPORT));
+    EXPECT_EQ(36U, probe.field_offset(PacketTemplate::DPORT));
+    EXPECT_EQ(38U, probe.field_offset(PacketTemplate::SEQ));
+    EXPECT_EQ(42U, probe.field_offset(PacketTemplate::ACK_SEQ));
+    EXPECT_EQ(4U, probe.field_size(PacketTemplate::DST_ADDR));
+    EXPECT_EQ(1U, probe.field_size(PacketTemplate::TTL));
+}
+
+TEST_F(PacketTemplateTest, MissingFields) {
+    EthernetII raw = EthernetII() / RawPDU("payload");
+    PacketTemplate raw_template(raw);
+    EXPECT_FALSE(raw_template.has_field(PacketTemplate::DST_ADDR));
+    EXPECT_FALSE(raw_template.has_field(PacketTemplate::DPORT));
+    EXPECT_THROW(raw_template.dst_addr(IPv4Address("1.2.3.4")), field_not_present);
+    EXPECT_THROW(raw_template.field_offset(PacketTemplate::DPORT), field_not_present);
+
+    IP udp = IP("1.2.3.4", "5.6.7.8") / UDP(53, 1234);
+    PacketTemplate udp_template(udp);
+    EXPECT_TRUE(udp_template.has_field(PacketTemplate::DPORT));
+    EXPECT_FALSE(udp_template.has_field(PacketTemplate::SEQ));
+    EXPECT_THROW(udp_template.seq(1), field_not_present);
+    // IPv6 addresses don't fit in an IPv4 header
+    EXPECT_THROW(udp_template.dst_addr(IPv6Address("::1")), field_not_present);
+}
+
+TEST_F(PacketTemplateTest, PatchTCP) {
+    EthernetII packet = make_tcp("1.2.3.4", "5.6.7.8", 1000, 80, 1, 0, 1, 64);
+    PacketTemplate probe(packet);
+    probe.dst_addr(IPv4Address("192.168.0.254"));
+    probe.dport(443);
+    probe.seq(0xdeadbeef);
+    check_equals(
+        make_tcp("1.2.3.4", "192.168.0.254", 1000, 443, 0xdeadbeef, 0, 1, 64).serialize(), 
+        probe
+    );
+    probe.src_addr(IPv4Address("10.0.0.1"));
+    probe.sport(65535);
+    probe.ack_seq(0x12345678);
+    probe.id(0xabcd);
+    probe.ttl(3);
+    check_equals(
+        make_tcp("10.0.0.1", "192.168.0.254", 65535, 443, 0xdeadbeef, 0x12345678, 
+                 0xabcd, 3).serialize(), 
+        probe
+    );
+}
+
+TEST_F(PacketTemplateTest, PatchManyTimes) {
+    EthernetII packet = make_tcp("1.2.3.4", "5.6.7.8", 1000, 80, 1, 0, 1, 64);
+    PacketTemplate probe(packet);
+    for (uint32_t i = 0; i < 2000; ++i) {
+        probe.dst_addr(IPv4Address(i * 2654435761U));
+        probe.dport(static_cast<uint16_t>(i * 7));
+        probe.seq(i * 40503U);
+    }
+    const uint32_t last = 1999;
+    check_equals(
+        make_tcp("1.2.3.4", IPv4Address(last * 2654435761U), 1000, 
+                 static_cast<uint16_t>(last * 7), last * 40503U, 0, 1, 64).serialize(),
+        probe
+    );
+}
+
+TEST_F(PacketTemplateTest, PatchUDP) {
+    IP packet = IP("5.6.7.8", "1.2.3.4") / UDP(53, 1234) / RawPDU("query");
+    PacketTemplate probe(packet);
+    probe.dst_addr(IPv4Address("8.8.8.8"));
+    probe.sport(4321);
+    IP expected = IP("8.8.8.8", "1.2.3.4") / UDP(53, 4321) / RawPDU("query");
+    check_equals(expected.serialize(), probe);
+}
+
+TEST_F(PacketTemplateTest, PatchIPv6) {
+    IPv6 packet = IPv6("::1", "fe80::1") / TCP(80, 1000) / RawPDU("data");
+    PacketTemplate probe(packet);
+    EXPECT_FALSE(probe.has_field(PacketTemplate::IP_ID));
+    EXPECT_EQ(24U, probe.field_offset(PacketTemplate::DST_ADDR));
+    EXPECT_EQ(16U, probe.field_size(PacketTemplate::DST_ADDR));
+    probe.dst_addr(IPv6Address("2001:db8::42"));
+    probe.src_addr(IPv6Address("2001:db8::1"));
+    probe.dport(443);
+    probe.ttl(10);
+    IPv6 expected = IPv6("2001:db8::42", "2001:db8::1") / TCP(443, 1000) / RawPDU("data");
+    expected.hop_limit(10);
+    check_equals(expected.serialize(), probe);
+}
+
+TEST_F(PacketTemplateTest, PatchIPv6UDP) {
+    IPv6 packet = IPv6("::1", "fe80::1") / UDP(53, 1000) / RawPDU("data");
+    PacketTemplate probe(packet);
+    probe.dst_addr(IPv6Address("2001:db8::42"));
+    probe.dport(5353);
+    IPv6 expected = IPv6("2001:db8::42", "fe80::1") / UDP(5353, 1000) / RawPDU("data");
+    check_equals(expected.serialize(), probe);
+}
+
+TEST_F(PacketTemplateTest, PatchAtOddOffset) {
+    // The network layer starts at an odd offset after an 802.3 + LLC header
+    LLC llc(0xaa, 0xaa);
+    llc.type(LLC::UNNUMBERED);
+    IEEE802_3 packet = IEEE802_3() / llc / IP("1.2.3.4", "5.6.7.8") / 
+                       TCP(80, 1000) / RawPDU("data");
+    PacketTemplate probe(packet);
+    EXPECT_EQ(1U, probe.field_offset(PacketTemplate::DST_ADDR) % 2);
+    probe.dst_addr(IPv4Address("9.9.9.9"));
+    probe.ttl(1);
+    probe.seq(12345);
+    IP ip("9.9.9.9", "5.6.7.8");
+    ip.ttl(1);
+    TCP tcp(80, 1000);
+    tcp.seq(12345);
+    IEEE802_3 expected = IEEE802_3() / llc / ip / tcp / RawPDU("data");
+    check_equals(expected.serialize(), probe);
+}
+
+TEST_F(PacketTemplateTest, Patch) {
+    IP packet = IP("5.6.7.8", "1.2.3.4") / UDP(53, 1234);
+    PacketTemplate probe(packet);
+    const uint8_t port[] = { 0x01, 0x02 };
+    probe.patch(PacketTemplate::DPORT, port);
+    IP expected = IP("5.6.7.8", "1.2.3.4") / UDP(0x0102, 1234);
+    check_equals(expected.serialize(), probe);
+}
@@ -0,0 +1,177 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <tins/packet_view.h>
+#include <tins/ethernetII.h>
+#include <tins/dot1q.h>
+#include <tins/ip.h>
+#include <tins/ipv6.h>
+#include <tins/tcp.h>
+#include <tins/udp.h>
+#include <tins/icmp.h>
+#include <tins/rawpdu.h>
+
+using std::string;
+
+using namespace Tins;
+
+class PacketViewTest : public testing::Test {
+public:
+    static const uint8_t tcp_packet[], small_ip_packet[];
+};
+
+// Ethernet + IP + TCP (with options)
+const uint8_t PacketViewTest::tcp_packet[] = {
+    10, 128, 57, 251, 101, 187, 76, 128, 147, 141, 144, 65, 8, 0, 69, 0, 0,
+    60, 152, 189, 64, 0, 64, 6, 0, 19, 10, 0, 0, 54, 198, 41, 209, 140, 180,
+    207, 1, 187, 114, 130, 185, 186, 0, 0, 0, 0, 160, 2, 114, 16, 44, 228, 0,
+    0, 2, 4, 5, 180, 4, 2, 8, 10, 3, 81, 33, 7, 0, 0, 0, 0, 1, 3, 3, 7
+};
+
+// Ethernet + IP + padding
+const uint8_t PacketViewTest::small_ip_packet[] = {
+    64, 97, 134, 43, 174, 25, 0, 36, 1, 254, 210, 68, 8, 0, 69, 0, 0, 32, 0, 0,
+    64, 0, 64, 17, 105, 97, 192, 168, 1, 120, 192, 168, 1, 254, 4, 210, 0, 53,
+    0, 12, 154, 128, 1, 2, 3, 4, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+TEST_F(PacketViewTest, DefaultConstructor) {
+    PacketView view;
+    EXPECT_EQ(0U, view.layer_count());
+    EXPECT_EQ(0U, view.payload_size());
+    EXPECT_FALSE(view.has_layer(PDU::ETHERNET_II));
+}
+
+TEST_F(PacketViewTest, EthernetIPTCP) {
+    PacketView view(tcp_packet, sizeof(tcp_packet));
+    EthernetII eth(tcp_packet, sizeof(tcp_packet));
+    const IP& ip = eth.rfind_pdu<IP>();
+    const TCP& tcp = eth.rfind_pdu<TCP>();
+
+    ASSERT_EQ(3U, view.layer_count());
+    EXPECT_EQ(PDU::ETHERNET_II, view.layer_at(0).type);
+    EXPECT_EQ(0U, view.layer_at(0).offset);
+    EXPECT_EQ(eth.header_size(), view.layer_at(0).header_size);
+    EXPECT_EQ(PDU::IP, view.layer_at(1).type);
+    EXPECT_EQ(eth.header_size(), view.layer_at(1).offset);
+    EXPECT_EQ(ip.header_size(), view.layer_at(1).header_size);
+    EXPECT_EQ(PDU::TCP, view.layer_at(2).type);
+    EXPECT_EQ(eth.header_size() + ip.header_size(), view.layer_at(2).offset);
+    EXPECT_EQ(tcp.header_size(), view.layer_at(2).header_size);
+    EXPECT_EQ(0U, view.payload_size());
+    EXPECT_FALSE(view.has_layer(PDU::RAW));
+
+    EXPECT_EQ(eth.dst_addr(), view.header<EthernetII>().dst_addr());
+    EXPECT_EQ(eth.src_addr(), view.header<EthernetII>().src_addr());
+    EXPECT_EQ(eth.payload_type(), view.header<EthernetII>().payload_type());
+
+    EXPECT_EQ(ip.version(), view.header<IP>().version());
+    EXPECT_EQ(ip.head_len(), view.header<IP>().head_len());
+    EXPECT_EQ(ip.tot_len(), view.header<IP>().tot_len());
+    EXPECT_EQ(ip.id(), view.header<IP>().id());
+    EXPECT_EQ(ip.flags(), view.header<IP>().flags());
+    EXPECT_EQ(ip.ttl(), view.header<IP>().ttl());
+    EXPECT_EQ(ip.protocol(), view.header<IP>().protocol());
+    EXPECT_EQ(ip.checksum(), view.header<IP>().checksum());
+    EXPECT_EQ(ip.src_addr(), view.header<IP>().src_addr());
+    EXPECT_EQ(ip.dst_addr(), view.header<IP>().dst_addr());
+    EXPECT_FALSE(view.header<IP>().is_fragmented());
+
+    EXPECT_EQ(tcp.sport(), view.header<TCP>().sport());
+    EXPECT_EQ(tcp.dport(), view.header<TCP>().dport());
+    EXPECT_EQ(tcp.seq(), view.header<TCP>().seq());
+    EXPECT_EQ(tcp.ack_seq(), view.header<TCP>().ack_seq());
+    EXPECT_EQ(tcp.data_offset(), view.header<TCP>().data_offset());
+    EXPECT_EQ(tcp.flags(), view.header<TCP>().flags());
+    EXPECT_EQ(tcp.window(), view.header<TCP>().window());
+    EXPECT_EQ(tcp.checksum(), view.header<TCP>().checksum());
+    EXPECT_EQ(tcp.urg_ptr(), view.header<TCP>().urg_ptr());
+}
+
+TEST_F(PacketViewTest, Payload) {
+    EthernetII eth = EthernetII() / IP("1.2.3.4", "4.3.2.1") / TCP(22, 23) / RawPDU("hello");
+    PDU::serialization_type buffer = eth.serialize();
+    PacketView view(&buffer[0], static_cast<uint32_t>(buffer.size()));
+
+    ASSERT_EQ(4U, view.layer_count());
+    EXPECT_EQ(PDU::RAW, view.layer_at(3).type);
+    ASSERT_EQ(5U, view.payload_size());
+    EXPECT_EQ("hello", string(view.payload(), view.payload() + view.payload_size()));
+    EXPECT_EQ(view.payload(), view.layer_data(view.rfind_layer(PDU::RAW)));
+}
+
+TEST_F(PacketViewTest, PaddingIsNotPayload) {
+    PacketView view(small_ip_packet, sizeof(small_ip_packet));
+    ASSERT_TRUE(view.has_layer(PDU::UDP));
+    EXPECT_EQ(4U, view.payload_size());
+    EXPECT_EQ(1234, view.header<UDP>().sport());
+    EXPECT_EQ(53, view.header<UDP>().dport());
+    EXPECT_EQ(12, view.header<UDP>().length());
+}
+
+TEST_F(PacketViewTest, Dot1QIPv6UDP) {
+    EthernetII eth = EthernetII() / Dot1Q(10) / IPv6("::1", "f::1") / UDP(53, 1024) / RawPDU("abc");
+    PDU::serialization_type buffer = eth.serialize();
+    PacketView view(&buffer[0], static_cast<uint32_t>(buffer.size()));
+
+    ASSERT_EQ(5U, view.layer_count());
+    EXPECT_EQ(PDU::DOT1Q, view.layer_at(1).type);
+    EXPECT_EQ(PDU::IPv6, view.layer_at(2).type);
+    EXPECT_EQ(PDU::UDP, view.layer_at(3).type);
+    EXPECT_EQ(10, view.header<Dot1Q>().id());
+    EXPECT_EQ(IPv6Address("::1"), view.header<IPv6>().dst_addr());
+    EXPECT_EQ(IPv6Address("f::1"), view.header<IPv6>().src_addr());
+    EXPECT_EQ(53, view.header<UDP>().dport());
+    EXPECT_EQ(1024, view.header<UDP>().sport());
+    EXPECT_EQ(3U, view.payload_size());
+}
+
+TEST_F(PacketViewTest, FragmentedIPIsPayload) {
+    IP ip = IP("1.2.3.4", "4.3.2.1") / TCP(22, 23);
+    ip.fragment_offset(10);
+    PDU::serialization_type buffer = ip.serialize();
+    PacketView view(&buffer[0], static_cast<uint32_t>(buffer.size()), PDU::IP);
+
+    ASSERT_EQ(2U, view.layer_count());
+    EXPECT_TRUE(view.header<IP>().is_fragmented());
+    EXPECT_FALSE(view.has_layer(PDU::TCP));
+    EXPECT_EQ(PDU::RAW, view.layer_at(1).type);
+}
+
+TEST_F(PacketViewTest, ICMP) {
+    IP ip = IP("1.2.3.4", "4.3.2.1") / ICMP(ICMP::ECHO_REQUEST);
+    PDU::serialization_type buffer = ip.serialize();
+    PacketView view(&buffer[0], static_cast<uint32_t>(buffer.size()), PDU::IP);
+
+    ASSERT_TRUE(view.has_layer(PDU::ICMP));
+    EXPECT_EQ(ICMP::ECHO_REQUEST, view.header<ICMP>().type());
+    EXPECT_EQ(0, view.header<ICMP>().code());
+}
+
+TEST_F(PacketViewTest, MissingLayer) {
+    PacketView view(tcp_packet, sizeof(tcp_packet));
+    EXPECT_TRUE(view.find_layer(PDU::UDP) == 0);
+    EXPECT_THROW(view.rfind_layer(PDU::UDP), pdu_not_found);
+    EXPECT_THROW(view.header<UDP>(), pdu_not_found);
+}
+
+TEST_F(PacketViewTest, TruncatedHeader) {
+    // Cut the TCP header in half
+    EXPECT_THROW(PacketView(tcp_packet, 14 + 20 + 10), malformed_packet);
+}
+
+TEST_F(PacketViewTest, LengthShorterThanHeader) {
+    IP ip = IP("192.168.0.1") / TCP(22, 80);
+    PDU::serialization_type buffer = ip.serialize();
+    // Set the total length to less than the IP header's size
+    buffer[2] = 0;
+    buffer[3] = 10;
+    EXPECT_THROW(PacketView(&buffer[0], buffer.size(), PDU::IP), malformed_packet);
+
+    IPv6 ipv6 = IPv6("::1") / UDP(22, 80);
+    ipv6.add_header(IPv6::ExtensionHeader::HOP_BY_HOP);
+    buffer = ipv6.serialize();
+    // The payload length doesn't cover the extension header
+    buffer[4] = 0;
+    buffer[5] = 4;
+    EXPECT_THROW(PacketView(&buffer[0], buffer.size(), PDU::IPv6), malformed_packet);
+}
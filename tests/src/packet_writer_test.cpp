@@ -0,0 +1,98 @@
+#include <tins/config.h>
+#include <gtest/gtest.h>
+
+#ifdef TINS_HAVE_PCAP
+
+#include <cstdio>
+#include <vector>
+#include <stdint.h>
+#include <tins/packet_writer.h>
+#include <tins/mapped_file_sniffer.h>
+#include <tins/raw_packet.h>
+#include <tins/packet.h>
+#include <tins/ethernetII.h>
+#include <tins/ip.h>
+#include <tins/udp.h>
+#include <tins/exceptions.h>
+#include "tests/capture_file.h"
+
+using std::vector;
+
+using namespace Tins;
+
+class PacketWriterTest : public CaptureFileTest {
+public:
+    PacketWriterTest()
+    : CaptureFileTest("packet_writer_test.pcap") {
+
+    }
+
+    static PDU::serialization_type frame_data(const RawPacket& frame) {
+        return PDU::serialization_type(frame.data(), frame.data() + frame.size());
+    }
+};
+
+TEST_F(PacketWriterTest, WriteRawAndReadBack) {
+    const PDU::serialization_type first = make_udp_frame(1000);
+    const PDU::serialization_type second = make_udp_frame(1001);
+    // A buffer smaller than a record, so writes go through several flushes
+    PacketWriter writer(file_name, DataLinkType<EthernetII>(), 16);
+    writer.write_raw(&first[0], static_cast<uint32_t>(first.size()), 
+                     make_timestamp(100, 250), 1500);
+    RawPacket frame(&second[0], static_cast<uint32_t>(second.size()), 
+                    static_cast<uint32_t>(second.size()), make_timestamp(101, 999999));
+    writer.write_raw(frame);
+    EthernetII eth = EthernetII() / IP("1.2.3.4", "4.3.2.1") / UDP(53, 1002);
+    Packet packet(eth, make_timestamp(102));
+    writer.write(packet);
+    writer.flush();
+
+    // Every record is on disk once the writer is flushed
+    MappedFileSniffer sniffer(file_name);
+    EXPECT_EQ(DLT_EN10MB, sniffer.link_type());
+    ASSERT_TRUE(sniffer.next_frame(frame));
+    EXPECT_EQ(first, frame_data(frame));
+    EXPECT_EQ(1500U, frame.original_size());
+    EXPECT_TRUE(frame.is_truncated());
+    EXPECT_EQ(100, frame.timestamp().seconds());
+    EXPECT_EQ(250, frame.timestamp().microseconds());
+
+    ASSERT_TRUE(sniffer.next_frame(frame));
+    EXPECT_EQ(second, frame_data(frame));
+    EXPECT_EQ(second.size(), frame.original_size());
+    EXPECT_EQ(101, frame.timestamp().seconds());
+    EXPECT_EQ(999999, frame.timestamp().microseconds());
+
+    ASSERT_TRUE(sniffer.next_frame(frame));
+    EXPECT_EQ(make_udp_frame(1002), frame_data(frame));
+    EXPECT_EQ(102, frame.timestamp().seconds());
+    EXPECT_FALSE(sniffer.next_frame(frame));
+}
+
+TEST_F(PacketWriterTest, DefaultBufferSize) {
+    const PDU::serialization_type data = make_udp_frame(1000);
+    {
+        PacketWriter writer(file_name, DataLinkType<EthernetII>());
+        for (long i = 0; i < 100; ++i) {
+            write_frame(writer, data, make_timestamp(i));
+        }
+    }
+    MappedFileSniffer sniffer(file_name);
+    RawPacket frame;
+    long count = 0;
+    while (sniffer.next_frame(frame)) {
+        EXPECT_EQ(data, frame_data(frame));
+        EXPECT_EQ(count, frame.timestamp().seconds());
+        ++count;
+    }
+    EXPECT_EQ(100, count);
+}
+
+TEST_F(PacketWriterTest, InvalidFile) {
+    EXPECT_THROW(
+        PacketWriter("/this/directory/does/not/exist.pcap", DataLinkType<EthernetII>()),
+        pcap_error
+    );
+}
+
+#endif // TINS_HAVE_PCAP
@@ -0,0 +1,165 @@
+#include <tins/config.h>
+#include <gtest/gtest.h>
+
+#if defined(TINS_HAVE_PCAP) && defined(TINS_HAVE_CXX11)
+
+#include <cstdio>
+#include <set>
+#include <vector>
+#include <stdexcept>
+#include <stdint.h>
+#include <tins/parallel_file_processor.h>
+#include <tins/pdu_arena.h>
+#include <tins/packet_writer.h>
+#include <tins/ethernetII.h>
+#include <tins/ip.h>
+#include <tins/tcp.h>
+#include <tins/rawpdu.h>
+#include "tests/capture_file.h"
+
+using std::set;
+using std::vector;
+
+using namespace Tins;
+
+class ParallelFileProcessorTest : public CaptureFileTest {
+public:
+    static const uint32_t packet_count = 2000;
+
+    struct totals {
+        totals() : packets(0), bytes(0), ports(0) { }
+
+        uint64_t packets;
+        uint64_t bytes;
+        uint64_t ports;
+    };
+
+    ParallelFileProcessorTest()
+    : CaptureFileTest("parallel_file_processor_test.pcap") {
+
+    }
+
+    void SetUp() {
+        PacketWriter writer(file_name, DataLinkType<EthernetII>());
+        expected_bytes = 0;
+        expected_ports = 0;
+        for (uint32_t i = 0; i < packet_count; ++i) {
+            const uint16_t port = static_cast<uint16_t>(1000 + i);
+            EthernetII eth = EthernetII() / IP("1.2.3.4", "4.3.2.1") / TCP(80, port) /
+                             RawPDU(vector<uint8_t>(i % 100, 0));
+            PDU::serialization_type data = eth.serialize();
+            write_frame(writer, data, make_timestamp(i));
+            expected_bytes += data.size();
+            expected_ports += port;
+        }
+    }
+
+    static void add_packet(totals& state, Packet& packet) {
+        state.packets++;
+        state.bytes += packet.pdu()->size();
+        state.ports += packet.pdu()->rfind_pdu<TCP>().sport();
+    }
+
+    static void merge(totals& total, const totals& partial) {
+        total.packets += partial.packets;
+        total.bytes += partial.bytes;
+        total.ports += partial.ports;
+    }
+
+    uint64_t expected_bytes;
+    uint64_t expected_ports;
+};
+
+const uint32_t ParallelFileProcessorTest::packet_count;
+
+TEST_F(ParallelFileProcessorTest, DefaultWorkerCount) {
+    ParallelFileProcessor processor(file_name);
+    EXPECT_GE(processor.worker_count(), 1U);
+    EXPECT_EQ(ParallelFileProcessor::DEFAULT_CHUNK_SIZE, processor.chunk_size());
+}
+
+TEST_F(ParallelFileProcessorTest, MapReduce) {
+    ParallelFileProcessor processor(file_name, 4);
+    processor.set_chunk_size(4096);
+    totals result = processor.map_reduce(totals(), &add_packet, &merge);
+    EXPECT_EQ(packet_count, result.packets);
+    EXPECT_EQ(expected_bytes, result.bytes);
+    EXPECT_EQ(expected_ports, result.ports);
+}
+
+TEST_F(ParallelFileProcessorTest, SingleChunk) {
+    ParallelFileProcessor processor(file_name, 3);
+    totals result = processor.map_reduce(totals(), &add_packet, &merge);
+    EXPECT_EQ(packet_count, result.packets);
+    EXPECT_EQ(expected_ports, result.ports);
+}
+
+TEST_F(ParallelFileProcessorTest, PDUArenaIsOptIn) {
+    ParallelFileProcessor processor(file_name, 2);
+    processor.set_chunk_size(4096);
+    size_t with_arena = processor.map_reduce(
+        size_t(0),
+        [](size_t& state, Packet&) {
+            state += PDUArena::current() != 0;
+        },
+        [](size_t& total, size_t partial) {
+            total += partial;
+        }
+    );
+    EXPECT_EQ(0U, with_arena);
+
+    processor.set_use_pdu_arena(true);
+    with_arena = processor.map_reduce(
+        size_t(0),
+        [](size_t& state, Packet&) {
+            state += PDUArena::current() != 0;
+        },
+        [](size_t& total, size_t partial) {
+            total += partial;
+        }
+    );
+    EXPECT_EQ(packet_count, with_arena);
+}
+
+TEST_F(ParallelFileProcessorTest, EveryRecordIsProcessedOnce) {
+    ParallelFileProcessor processor(file_name, 4);
+    processor.set_chunk_size(1);
+    set<long> timestamps = processor.map_reduce_frames(
+        set<long>(),
+        [](set<long>& state, const RawPacket& frame) {
+            EXPECT_TRUE(state.insert(frame.timestamp().seconds()).second);
+        },
+        [](set<long>& total, const set<long>& partial) {
+            for (set<long>::const_iterator iter = partial.begin(); iter != partial.end(); ++iter) {
+                EXPECT_TRUE(total.insert(*iter).second);
+            }
+        }
+    );
+    ASSERT_EQ(packet_count, timestamps.size());
+    EXPECT_EQ(0, *timestamps.begin());
+    EXPECT_EQ(static_cast<long>(packet_count - 1), *timestamps.rbegin());
+}
+
+TEST_F(ParallelFileProcessorTest, ExceptionsArePropagated) {
+    ParallelFileProcessor processor(file_name, 4);
+    processor.set_chunk_size(4096);
+    EXPECT_THROW(
+        processor.map_reduce_frames(
+            0,
+            [](int&, const RawPacket& frame) {
+                if (frame.timestamp().seconds() == 1500) {
+                    throw std::runtime_error("error");
+                }
+            },
+            [](int&, const int&) { }
+        ),
+        std::runtime_error
+    );
+}
+
+TEST_F(ParallelFileProcessorTest, MissingFile) {
+    ParallelFileProcessor processor("/this/file/does/not/exist.pcap", 2);
+    EXPECT_THROW(processor.map_reduce(totals(), &add_packet, &merge), pcap_error);
+}
+
+#endif // TINS_HAVE_PCAP && TINS_HAVE_CXX11
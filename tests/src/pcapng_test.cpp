@@ -0,0 +1,297 @@
+#include <tins/config.h>
+#include <gtest/gtest.h>
+
+#ifdef TINS_HAVE_PCAP
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <stdexcept>
+#include <stdint.h>
+#include <tins/pcapng_reader.h>
+#include <tins/pcapng_writer.h>
+#include <tins/ethernetII.h>
+#include <tins/ip.h>
+#include <tins/tcp.h>
+#include <tins/udp.h>
+#include <tins/rawpdu.h>
+#include <tins/packet.h>
+#include <tins/exceptions.h>
+#include "tests/capture_file.h"
+
+using std::string;
+using std::vector;
+
+using namespace Tins;
+
+class PcapngTest : public CaptureFileTest {
+public:
+    PcapngTest()
+    : CaptureFileTest("pcapng_test.pcapng") {
+
+    }
+
+    // Helpers used to build big endian files by hand
+    static void add_uint16(vector<uint8_t>& buffer, uint16_t value) {
+        buffer.push_back(static_cast<uint8_t>(value >> 8));
+        buffer.push_back(static_cast<uint8_t>(value));
+    }
+
+    static void add_uint32(vector<uint8_t>& buffer, uint32_t value) {
+        add_uint16(buffer, static_cast<uint16_t>(value >> 16));
+        add_uint16(buffer, static_cast<uint16_t>(value));
+    }
+
+    static void add_block(vector<uint8_t>& buffer, uint32_t type, vector<uint8_t> body) {
+        body.resize((body.size() + 3) & ~3U);
+        const uint32_t length = static_cast<uint32_t>(body.size()) + 12;
+        add_uint32(buffer, type);
+        add_uint32(buffer, length);
+        buffer.insert(buffer.end(), body.begin(), body.end());
+        add_uint32(buffer, length);
+    }
+
+    static void add_section_header(vector<uint8_t>& buffer) {
+        vector<uint8_t> body;
+        add_uint32(body, 0x1a2b3c4d);
+        add_uint16(body, 1);
+        add_uint16(body, 0);
+        add_uint32(body, 0xffffffff);
+        add_uint32(body, 0xffffffff);
+        add_block(buffer, 0x0a0d0d0a, body);
+    }
+
+    static void add_interface(vector<uint8_t>& buffer, uint16_t link_type, 
+                              int resolution = -1, const string& name = "") {
+        vector<uint8_t> body;
+        add_uint16(body, link_type);
+        add_uint16(body, 0);
+        add_uint32(body, 0);
+        if (resolution != -1) {
+            add_uint16(body, 9);
+            add_uint16(body, 1);
+            add_uint32(body, static_cast<uint32_t>(resolution) << 24);
+        }
+        if (!name.empty()) {
+            add_uint16(body, 2);
+            add_uint16(body, static_cast<uint16_t>(name.size()));
+            body.insert(body.end(), name.begin(), name.end());
+            body.resize((body.size() + 3) & ~3U);
+        }
+        add_uint32(body, 0);
+        add_block(buffer, 1, body);
+    }
+
+    static void add_enhanced_packet(vector<uint8_t>& buffer, uint32_t interface_id,
+                                    uint64_t timestamp, const PDU::serialization_type& data) {
+        vector<uint8_t> body;
+        add_uint32(body, interface_id);
+        add_uint32(body, static_cast<uint32_t>(timestamp >> 32));
+        add_uint32(body, static_cast<uint32_t>(timestamp));
+        add_uint32(body, static_cast<uint32_t>(data.size()));
+        add_uint32(body, static_cast<uint32_t>(data.size()));
+        body.insert(body.end(), data.begin(), data.end());
+        add_block(buffer, 6, body);
+    }
+
+    void write_file(const vector<uint8_t>& buffer) {
+        std::ofstream output(file_name, std::ios::binary);
+        output.write((const char*)&buffer[0], buffer.size());
+    }
+};
+
+TEST_F(PcapngTest, WriteAndRead) {
+    EthernetII eth = EthernetII() / IP("1.2.3.4", "4.3.2.1") / TCP(22, 80) / RawPDU("foo");
+    IP ip = IP("4.3.2.1", "1.2.3.4") / UDP(53, 1024);
+    {
+        PcapngWriter writer(file_name);
+        EXPECT_EQ(0U, writer.add_interface(DataLinkType<EthernetII>(), "eth0"));
+        EXPECT_EQ(1U, writer.add_interface(DataLinkType<IP>(), "tun0", 1500));
+        EXPECT_EQ(2U, writer.interface_count());
+
+        Packet first(eth, make_timestamp(1000, 5));
+        writer.write(first);
+        Packet second(ip, make_timestamp(1001, 999999));
+        second.interface_id(1);
+        writer.write(second);
+        EXPECT_THROW(writer.write(ip, 2), std::runtime_error);
+    }
+
+    PcapngReader reader(file_name);
+    Packet packet(reader.next_packet());
+    ASSERT_TRUE(packet);
+    ASSERT_EQ(2U, reader.interfaces().size());
+    EXPECT_EQ(DLT_EN10MB, reader.interfaces()[0].link_type);
+    EXPECT_EQ("eth0", reader.interfaces()[0].name);
+    EXPECT_EQ(0U, reader.interfaces()[0].snap_len);
+    EXPECT_EQ(DLT_RAW, reader.interfaces()[1].link_type);
+    EXPECT_EQ("tun0", reader.interfaces()[1].name);
+    EXPECT_EQ(1500U, reader.interfaces()[1].snap_len);
+
+    EXPECT_EQ(0U, packet.interface_id());
+    EXPECT_EQ(1000, packet.timestamp().seconds());
+    EXPECT_EQ(5, packet.timestamp().microseconds());
+    EXPECT_EQ(eth.serialize(), packet.pdu()->serialize());
+
+    packet = reader.next_packet();
+    ASSERT_TRUE(packet);
+    EXPECT_EQ(1U, packet.interface_id());
+    EXPECT_EQ(1001, packet.timestamp().seconds());
+    EXPECT_EQ(999999, packet.timestamp().microseconds());
+    ASSERT_EQ(PDU::IP, packet.pdu()->pdu_type());
+    EXPECT_EQ(53, packet.pdu()->rfind_pdu<UDP>().dport());
+
+    EXPECT_FALSE(reader.next_packet());
+}
+
+TEST_F(PcapngTest, NextPacketOwnsPayloads) {
+    EthernetII eth = EthernetII() / IP("1.2.3.4", "4.3.2.1") / TCP(22, 80) / RawPDU("foo");
+    {
+        PcapngWriter writer(file_name);
+        writer.add_interface(DataLinkType<EthernetII>());
+        writer.write(eth);
+        writer.write(eth);
+    }
+
+    // The reader's buffer is reused for the next packet, so payloads can't
+    // be borrowed from it
+    RawPDU::borrow_scope scope;
+    PcapngReader reader(file_name);
+    Packet packet(reader.next_packet());
+    ASSERT_TRUE(packet);
+    Packet next(reader.next_packet());
+    EXPECT_TRUE(next);
+    const RawPDU& raw = packet.pdu()->rfind_pdu<RawPDU>();
+    EXPECT_TRUE(raw.owns_payload());
+    EXPECT_EQ("foo", string(raw.payload_data(), raw.payload_data() + raw.payload_size()));
+}
+
+TEST_F(PcapngTest, WriteFramesWithSmallBuffer) {
+    const PDU::serialization_type data = make_tcp_frame();
+    {
+        PcapngWriter writer(file_name, 64);
+        writer.add_interface(DataLinkType<EthernetII>());
+        for (uint32_t i = 0; i < 100; ++i) {
+            writer.write(RawPacket(&data[0], static_cast<uint32_t>(data.size()), 
+                                   static_cast<uint32_t>(data.size()) + i,
+                                   make_timestamp(i)));
+        }
+    }
+    PcapngReader reader(file_name);
+    uint32_t count = 0;
+    reader.sniff_frames([&](const RawPacket& frame) {
+        EXPECT_EQ(data, PDU::serialization_type(frame.data(), frame.data() + frame.size()));
+        EXPECT_EQ(data.size() + count, frame.original_size());
+        EXPECT_EQ(static_cast<long>(count), frame.timestamp().seconds());
+        count++;
+        return true;
+    });
+    EXPECT_EQ(100U, count);
+}
+
+TEST_F(PcapngTest, ReadBigEndianFile) {
+    const PDU::serialization_type data = make_tcp_frame();
+    vector<uint8_t> buffer;
+    add_section_header(buffer);
+    // Nanosecond resolution
+    add_interface(buffer, 1, 9, "eth0");
+    // Unknown block, should be skipped
+    add_block(buffer, 0x00000bad, vector<uint8_t>(10, 1));
+    add_enhanced_packet(buffer, 0, 1500000000123456789ULL, data);
+
+    // Simple packet block
+    vector<uint8_t> body;
+    add_uint32(body, static_cast<uint32_t>(data.size()));
+    body.insert(body.end(), data.begin(), data.end());
+    add_block(buffer, 3, body);
+
+    // Packet on an interface that was never described
+    add_enhanced_packet(buffer, 5, 0, data);
+    write_file(buffer);
+
+    PcapngReader reader(file_name);
+    RawPacket frame;
+    ASSERT_TRUE(reader.next_frame(frame));
+    ASSERT_EQ(1U, reader.interfaces().size());
+    EXPECT_EQ("eth0", reader.interfaces()[0].name);
+    EXPECT_EQ(1000000000U, reader.interfaces()[0].timestamp_units);
+    EXPECT_EQ(1500000000, frame.timestamp().seconds());
+    EXPECT_EQ(123456, frame.timestamp().microseconds());
+    EXPECT_EQ(data, PDU::serialization_type(frame.data(), frame.data() + frame.size()));
+
+    ASSERT_TRUE(reader.next_frame(frame));
+    EXPECT_EQ(0U, frame.interface_id());
+    EXPECT_EQ(data, PDU::serialization_type(frame.data(), frame.data() + frame.size()));
+    EXPECT_EQ(22, frame.view().header<TCP>().dport());
+
+    EXPECT_FALSE(reader.next_frame(frame));
+}
+
+TEST_F(PcapngTest, PowerOfTwoResolution) {
+    vector<uint8_t> buffer;
+    add_section_header(buffer);
+    // 2^-10 seconds
+    add_interface(buffer, 1, 0x80 | 10);
+    add_enhanced_packet(buffer, 0, 10 * 1024 + 512, make_tcp_frame());
+    write_file(buffer);
+
+    PcapngReader reader(file_name);
+    RawPacket frame;
+    ASSERT_TRUE(reader.next_frame(frame));
+    EXPECT_EQ(10, frame.timestamp().seconds());
+    EXPECT_EQ(500000, frame.timestamp().microseconds());
+}
+
+TEST_F(PcapngTest, SeveralSections) {
+    vector<uint8_t> buffer;
+    add_section_header(buffer);
+    add_interface(buffer, 1, -1, "first");
+    add_enhanced_packet(buffer, 0, 0, make_tcp_frame());
+    add_section_header(buffer);
+    add_interface(buffer, 101, -1, "second");
+    IP ip = IP("1.2.3.4", "4.3.2.1") / UDP(53, 1024);
+    add_enhanced_packet(buffer, 0, 0, ip.serialize());
+    write_file(buffer);
+
+    PcapngReader reader(file_name);
+    Packet packet(reader.next_packet());
+    ASSERT_TRUE(packet);
+    EXPECT_EQ(PDU::ETHERNET_II, packet.pdu()->pdu_type());
+    packet = reader.next_packet();
+    ASSERT_TRUE(packet);
+    ASSERT_EQ(1U, reader.interfaces().size());
+    EXPECT_EQ("second", reader.interfaces()[0].name);
+    EXPECT_EQ(DLT_RAW, reader.interfaces()[0].link_type);
+    EXPECT_EQ(PDU::IP, packet.pdu()->pdu_type());
+    EXPECT_FALSE(reader.next_packet());
+}
+
+TEST_F(PcapngTest, TruncatedFile) {
+    vector<uint8_t> buffer;
+    add_section_header(buffer);
+    add_interface(buffer, 1);
+    add_enhanced_packet(buffer, 0, 0, make_tcp_frame());
+    add_enhanced_packet(buffer, 0, 0, make_tcp_frame());
+    buffer.resize(buffer.size() - 10);
+    write_file(buffer);
+
+    PcapngReader reader(file_name);
+    RawPacket frame;
+    EXPECT_TRUE(reader.next_frame(frame));
+    EXPECT_FALSE(reader.next_frame(frame));
+}
+
+TEST_F(PcapngTest, InvalidFiles) {
+    EXPECT_THROW(PcapngReader("/this/file/does/not/exist.pcapng"), pcap_error);
+
+    // A classic pcap file header
+    const uint8_t pcap_header[] = {
+        0xd4, 0xc3, 0xb2, 0xa1, 2, 0, 4, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0xff, 0xff, 0, 0, 1, 0, 0, 0
+    };
+    write_file(vector<uint8_t>(pcap_header, pcap_header + sizeof(pcap_header)));
+    EXPECT_THROW(PcapngReader reader(file_name), pcap_error);
+}
+
+#endif // TINS_HAVE_PCAP
@@ -0,0 +1,222 @@
+#include <tins/config.h>
+#include <gtest/gtest.h>
+
+#ifdef TINS_HAVE_CXX11
+
+#include <thread>
+#include <vector>
+#include <stdint.h>
+#include <tins/pdu_arena.h>
+#include <tins/ethernetII.h>
+#include <tins/ip.h>
+#include <tins/tcp.h>
+#include <tins/rawpdu.h>
+
+using std::vector;
+
+using namespace Tins;
+
+class PDUArenaTest : public testing::Test {
+public:
+    static const uint8_t packet[];
+
+    static bool contains(const vector<const void*>& addresses, const void* ptr) {
+        for (size_t i = 0; i < addresses.size(); ++i) {
+            if (addresses[i] == ptr) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// Ethernet + IP + TCP (with options)
+const uint8_t PDUArenaTest::packet[] = {
+    10, 128, 57, 251, 101, 187, 76, 128, 147, 141, 144, 65, 8, 0, 69, 0, 0,
+    60, 152, 189, 64, 0, 64, 6, 0, 19, 10, 0, 0, 54, 198, 41, 209, 140, 180,
+    207, 1, 187, 114, 130, 185, 186, 0, 0, 0, 0, 160, 2, 114, 16, 44, 228, 0,
+    0, 2, 4, 5, 180, 4, 2, 8, 10, 3, 81, 33, 7, 0, 0, 0, 0, 1, 3, 3, 7
+};
+
+TEST_F(PDUArenaTest, NoArenaByDefault) {
+    EXPECT_TRUE(PDUArena::current() == 0);
+    PDU* pdu = new EthernetII(packet, sizeof(packet));
+    EXPECT_TRUE(pdu->find_pdu<TCP>() != 0);
+    delete pdu;
+}
+
+TEST_F(PDUArenaTest, Scope) {
+    PDUArena arena;
+    {
+        PDUArena::scope use_arena(arena);
+        EXPECT_EQ(&arena, PDUArena::current());
+        {
+            PDUArena other;
+            PDUArena::scope use_other(other);
+            EXPECT_EQ(&other, PDUArena::current());
+        }
+        EXPECT_EQ(&arena, PDUArena::current());
+    }
+    EXPECT_TRUE(PDUArena::current() == 0);
+}
+
+TEST_F(PDUArenaTest, ParsedLayersAreAllocatedInArena) {
+    PDUArena arena;
+    PDUArena::scope use_arena(arena);
+    PDU* pdu = new EthernetII(packet, sizeof(packet));
+    // EthernetII, IP and TCP
+    EXPECT_EQ(3U, arena.live_allocations());
+    EXPECT_EQ(PDUArena::DEFAULT_BLOCK_SIZE, arena.capacity());
+    EXPECT_TRUE(pdu->find_pdu<TCP>() != 0);
+    delete pdu;
+    EXPECT_EQ(0U, arena.live_allocations());
+}
+
+TEST_F(PDUArenaTest, MemoryIsReusedOnceEverythingIsReleased) {
+    PDUArena arena;
+    PDUArena::scope use_arena(arena);
+    vector<const void*> addresses;
+    PDU* pdu = new EthernetII(packet, sizeof(packet));
+    for (PDU* ptr = pdu; ptr; ptr = ptr->inner_pdu()) {
+        addresses.push_back(ptr);
+    }
+    delete pdu;
+
+    pdu = new EthernetII(packet, sizeof(packet));
+    for (PDU* ptr = pdu; ptr; ptr = ptr->inner_pdu()) {
+        EXPECT_TRUE(contains(addresses, ptr));
+    }
+    delete pdu;
+    EXPECT_EQ(PDUArena::DEFAULT_BLOCK_SIZE, arena.capacity());
+}
+
+TEST_F(PDUArenaTest, MemoryIsNotReusedWhileInUse) {
+    PDUArena arena;
+    PDUArena::scope use_arena(arena);
+    PDU* first = new EthernetII(packet, sizeof(packet));
+    PDU* second = new EthernetII(packet, sizeof(packet));
+    delete first;
+    PDU* third = new IP();
+    EXPECT_NE(static_cast<void*>(second), static_cast<void*>(third));
+    EXPECT_NE(static_cast<void*>(second->inner_pdu()), static_cast<void*>(third));
+    EXPECT_EQ(4U, arena.live_allocations());
+    delete second;
+    delete third;
+    EXPECT_EQ(0U, arena.live_allocations());
+}
+
+TEST_F(PDUArenaTest, GrowsWhenBlockIsFull) {
+    PDUArena arena(sizeof(IP) * 4);
+    PDUArena::scope use_arena(arena);
+    vector<PDU*> pdus;
+    for (size_t i = 0; i < 10; ++i) {
+        pdus.push_back(new IP());
+    }
+    EXPECT_EQ(10U, arena.live_allocations());
+    EXPECT_GT(arena.capacity(), sizeof(IP) * 4);
+    for (size_t i = 0; i < pdus.size(); ++i) {
+        delete pdus[i];
+    }
+    EXPECT_EQ(0U, arena.live_allocations());
+}
+
+TEST_F(PDUArenaTest, LongLivedPDUOnlyKeepsItsBlock) {
+    const size_t block_size = 1024;
+    PDUArena arena(block_size);
+    PDUArena::scope use_arena(arena);
+    PDU* long_lived = new IP();
+    for (size_t i = 0; i < 1000; ++i) {
+        PDU* pdu = new EthernetII(packet, sizeof(packet));
+        delete pdu;
+    }
+    EXPECT_EQ(1U, arena.live_allocations());
+    EXPECT_EQ(block_size * 2, arena.capacity());
+    delete long_lived;
+    EXPECT_EQ(0U, arena.live_allocations());
+}
+
+TEST_F(PDUArenaTest, ReleasedBlocksAreReused) {
+    const size_t block_size = 1024;
+    PDUArena arena(block_size);
+    PDUArena::scope use_arena(arena);
+    // This keeps the first block in use the whole time
+    PDU* long_lived = new IP();
+    for (size_t i = 0; i < 10; ++i) {
+        // Keep enough PDUs alive to span a few blocks
+        vector<PDU*> pdus;
+        for (size_t j = 0; j < 20; ++j) {
+            pdus.push_back(new IP());
+        }
+        std::thread releaser([&]() {
+            for (size_t j = 0; j < pdus.size(); ++j) {
+                delete pdus[j];
+            }
+        });
+        releaser.join();
+        EXPECT_EQ(1U, arena.live_allocations());
+    }
+    const size_t capacity = arena.capacity();
+    EXPECT_LT(capacity, block_size * 20);
+    for (size_t i = 0; i < 20; ++i) {
+        delete new IP();
+    }
+    EXPECT_EQ(capacity, arena.capacity());
+    delete long_lived;
+}
+
+TEST_F(PDUArenaTest, LargeObjectsFallBackToGlobalAllocation) {
+    PDUArena arena(sizeof(RawPDU));
+    PDUArena::scope use_arena(arena);
+    PDU* pdu = new IP();
+    EXPECT_EQ(0U, arena.live_allocations());
+    EXPECT_EQ(0U, arena.capacity());
+    delete pdu;
+}
+
+TEST_F(PDUArenaTest, PDUsCanOutliveArena) {
+    PDU* pdu = 0;
+    {
+        PDUArena arena;
+        PDUArena::scope use_arena(arena);
+        pdu = new EthernetII(packet, sizeof(packet));
+    }
+    EXPECT_TRUE(PDUArena::current() == 0);
+    EXPECT_EQ(sizeof(packet), pdu->size());
+    delete pdu;
+}
+
+TEST_F(PDUArenaTest, ReleaseOnOtherThread) {
+    PDUArena arena;
+    PDUArena::scope use_arena(arena);
+    PDU* pdu = new EthernetII(packet, sizeof(packet));
+    std::thread releaser([&]() {
+        EXPECT_TRUE(PDUArena::current() == 0);
+        delete pdu;
+    });
+    releaser.join();
+    EXPECT_EQ(0U, arena.live_allocations());
+}
+
+TEST_F(PDUArenaTest, CloneAndSerialize) {
+    PDUArena arena;
+    PDUArena::scope use_arena(arena);
+    EthernetII eth(packet, sizeof(packet));
+    PDU* cloned = eth.clone();
+    EXPECT_EQ(eth.serialize(), cloned->serialize());
+    delete cloned;
+    // Only IP and TCP, since eth lives on the stack
+    EXPECT_EQ(2U, arena.live_allocations());
+}
+
+TEST_F(PDUArenaTest, PlacementNew) {
+    PDUArena arena;
+    PDUArena::scope use_arena(arena);
+    void* buffer = ::operator new(sizeof(IP));
+    IP* ip = new (buffer) IP("1.2.3.4");
+    EXPECT_EQ(IPv4Address("1.2.3.4"), ip->dst_addr());
+    ip->~IP();
+    ::operator delete(buffer);
+    EXPECT_EQ(0U, arena.live_allocations());
+}
+
+#endif // TINS_HAVE_CXX11
@@ -0,0 +1,157 @@
+#include <tins/cxxstd.h>
+
+#if TINS_IS_CXX11
+
+#include <gtest/gtest.h>
+#include <vector>
+#include <stdint.h>
+#include <tins/pdu_stack.h>
+#include <tins/ethernetII.h>
+#include <tins/ip.h>
+#include <tins/ipv6.h>
+#include <tins/tcp.h>
+#include <tins/udp.h>
+#include <tins/rawpdu.h>
+#include <tins/exceptions.h>
+
+using namespace std;
+using namespace Tins;
+
+class PDUStackTest : public testing::Test {
+public:
+    typedef PDUStack<EthernetII, IP, UDP, RawPDU> udp_stack;
+
+    static EthernetII make_udp_packet();
+};
+
+EthernetII PDUStackTest::make_udp_packet() {
+    return EthernetII("00:01:02:03:04:05", "06:07:08:09:0a:0b") / 
+           IP("192.168.0.1", "192.168.0.100") / 
+           UDP(9000, 1234) / 
+           RawPDU("telemetry");
+}
+
+TEST_F(PDUStackTest, ConstructorFromBuffer) {
+    EthernetII eth = make_udp_packet();
+    PDU::serialization_type buffer = eth.serialize();
+    udp_stack stack(&buffer[0], buffer.size());
+    EXPECT_EQ(HWAddress<6>("00:01:02:03:04:05"), stack.get<EthernetII>().dst_addr());
+    EXPECT_EQ(IPv4Address("192.168.0.1"), stack.get<IP>().dst_addr());
+    EXPECT_EQ(9000, stack.get<UDP>().dport());
+    EXPECT_EQ(1234, stack.get<UDP>().sport());
+    const RawPDU& raw = stack.get<3>();
+    EXPECT_EQ("telemetry", string(raw.payload().begin(), raw.payload().end()));
+    
+    // Only the last layer may have inner PDUs
+    EXPECT_TRUE(stack.get<0>().inner_pdu() == 0);
+    EXPECT_TRUE(stack.get<1>().inner_pdu() == 0);
+    EXPECT_TRUE(stack.get<2>().inner_pdu() == 0);
+    EXPECT_EQ(buffer.size(), stack.size());
+}
+
+TEST_F(PDUStackTest, Serialize) {
+    EthernetII eth = make_udp_packet();
+    PDU::serialization_type expected = eth.serialize();
+    udp_stack stack(&expected[0], expected.size());
+    EXPECT_EQ(expected, stack.serialize());
+
+    // Fields depending on other layers are recalculated
+    stack.get<RawPDU>().payload(RawPDU::payload_type(100, 'a'));
+    stack.get<IP>().ttl(12);
+    eth.rfind_pdu<RawPDU>().payload(RawPDU::payload_type(100, 'a'));
+    eth.rfind_pdu<IP>().ttl(12);
+    expected = eth.serialize();
+    EXPECT_EQ(expected, stack.serialize());
+
+    // The layers are unlinked after serializing
+    EXPECT_TRUE(stack.get<IP>().inner_pdu() == 0);
+    EXPECT_TRUE(stack.get<RawPDU>().parent_pdu() == 0);
+}
+
+TEST_F(PDUStackTest, ConstructorFromLayers) {
+    udp_stack stack(
+        EthernetII("00:01:02:03:04:05", "06:07:08:09:0a:0b"),
+        IP("192.168.0.1", "192.168.0.100") / TCP(),
+        UDP(9000, 1234),
+        RawPDU("telemetry")
+    );
+    EXPECT_TRUE(stack.get<IP>().inner_pdu() == 0);
+    EthernetII eth = make_udp_packet();
+    EXPECT_EQ(eth.serialize(), stack.serialize());
+}
+
+TEST_F(PDUStackTest, SerializeInto) {
+    EthernetII eth = make_udp_packet();
+    PDU::serialization_type expected = eth.serialize();
+    udp_stack stack(&expected[0], expected.size());
+    vector<uint8_t> buffer(expected.size() + 10);
+    EXPECT_EQ(expected.size(), stack.serialize_into(&buffer[0], buffer.size()));
+    EXPECT_TRUE(equal(expected.begin(), expected.end(), buffer.begin()));
+    EXPECT_THROW(stack.serialize_into(&buffer[0], expected.size() - 1), serialization_error);
+}
+
+TEST_F(PDUStackTest, ConvertToAndFromPDU) {
+    EthernetII eth = make_udp_packet();
+    udp_stack stack(eth);
+    EXPECT_EQ(9000, stack.get<UDP>().dport());
+
+    EthernetII output = stack.to_pdu();
+    ASSERT_TRUE(output.find_pdu<IP>() != 0);
+    ASSERT_TRUE(output.find_pdu<UDP>() != 0);
+    ASSERT_TRUE(output.find_pdu<RawPDU>() != 0);
+    EXPECT_EQ(9000, output.rfind_pdu<UDP>().dport());
+    EXPECT_EQ(eth.serialize(), output.serialize());
+}
+
+TEST_F(PDUStackTest, EthernetPaddingIsTrimmed) {
+    EthernetII eth = EthernetII() / IP("192.168.0.1") / UDP(9000, 1234) / RawPDU("a");
+    const PDU::serialization_type expected = eth.serialize();
+    PDU::serialization_type buffer = expected;
+    // Padding and a frame check sequence
+    buffer.resize(buffer.size() + 4, 0xff);
+    udp_stack stack(&buffer[0], buffer.size());
+    EXPECT_EQ(1U, stack.get<RawPDU>().payload_size());
+    EXPECT_EQ(expected.size(), stack.size());
+    EXPECT_EQ(expected, stack.serialize());
+}
+
+TEST_F(PDUStackTest, LastLayerKeepsInnerPDUs) {
+    EthernetII eth = EthernetII() / IPv6("::1") / TCP(22, 1234) / RawPDU("ssh");
+    PDU::serialization_type buffer = eth.serialize();
+    PDUStack<EthernetII, IPv6, TCP> stack(&buffer[0], buffer.size());
+    ASSERT_TRUE(stack.get<TCP>().find_pdu<RawPDU>() != 0);
+    EXPECT_EQ(3U, stack.get<TCP>().rfind_pdu<RawPDU>().payload_size());
+    EXPECT_EQ(buffer, stack.serialize());
+}
+
+TEST_F(PDUStackTest, MismatchingLayers) {
+    EthernetII eth = EthernetII() / IP("192.168.0.1") / TCP(22, 1234) / RawPDU("ssh");
+    PDU::serialization_type buffer = eth.serialize();
+    EXPECT_THROW(udp_stack(&buffer[0], buffer.size()), pdu_not_found);
+    EXPECT_THROW(udp_stack(&buffer[0], 20), malformed_packet);
+    EXPECT_THROW((PDUStack<EthernetII, IPv6, TCP>(&buffer[0], buffer.size())), pdu_not_found);
+}
+
+TEST_F(PDUStackTest, FragmentsAreNotParsed) {
+    EthernetII eth = EthernetII() / IP("192.168.0.1") / TCP(80, 1234) / RawPDU("http");
+    eth.rfind_pdu<IP>().fragment_offset(10);
+    PDU::serialization_type buffer = eth.serialize();
+    EXPECT_THROW(udp_stack(&buffer[0], buffer.size()), pdu_not_found);
+
+    PDUStack<EthernetII, IP, RawPDU> stack(&buffer[0], buffer.size());
+    EXPECT_EQ(10, stack.get<IP>().fragment_offset());
+    EXPECT_EQ(24U, stack.get<RawPDU>().payload_size());
+}
+
+TEST_F(PDUStackTest, UnknownEthertype) {
+    PDU::serialization_type buffer = make_udp_packet().serialize();
+    // Serializing sets the ethertype from the inner PDU, so patch it
+    buffer[12] = 0x88;
+    buffer[13] = 0xb5;
+    EXPECT_THROW(udp_stack(&buffer[0], buffer.size()), pdu_not_found);
+
+    PDUStack<EthernetII, RawPDU> stack(&buffer[0], buffer.size());
+    EXPECT_EQ(0x88b5, stack.get<EthernetII>().payload_type());
+}
+
+#endif // TINS_IS_CXX11
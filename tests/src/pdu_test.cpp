@@ -1,13 +1,27 @@
+#include <tins/config.h>
 #include <gtest/gtest.h>
 #include <algorithm>
+#include <cstring>
 #include <string>
 #include <stdint.h>
 #include <tins/ip.h>
 #include <tins/tcp.h>
 #include <tins/udp.h>
+#include <tins/icmp.h>
+#include <tins/ipv6.h>
+#include <tins/ethernetII.h>
+#include <tins/dot1q.h>
+#include <tins/mpls.h>
+#include <tins/llc.h>
+#include <tins/snap.h>
+#include <tins/dns.h>
 #include <tins/rawpdu.h>
 #include <tins/pdu.h>
 #include <tins/packet.h>
+#ifdef TINS_HAVE_DOT11
+    #include <tins/radiotap.h>
+    #include <tins/dot11/dot11_data.h>
+#endif // TINS_HAVE_DOT11
 
 using namespace std;
 using namespace Tins;
@@ -28,6 +42,126 @@ TEST_F(PDUTest, FindPDU) {
     EXPECT_THROW(ip.rfind_pdu<UDP>(), pdu_not_found);
 }
 
+TEST_F(PDUTest, FindPDUAfterChangingInnerPDU) {
+    IP ip = IP("192.168.0.1") / TCP(22, 52) / RawPDU("Test");
+    ip.build_layer_index();
+    EXPECT_EQ(ip.inner_pdu(), ip.find_pdu<TCP>());
+    EXPECT_TRUE(ip.find_pdu<UDP>() == 0);
+    EXPECT_TRUE(ip.find_pdu<RawPDU>() != 0);
+
+    // Replace the TCP layer
+    ip.inner_pdu(UDP(53, 1234) / RawPDU("Other"));
+    EXPECT_TRUE(ip.find_pdu<TCP>() == 0);
+    ASSERT_TRUE(ip.find_pdu<UDP>() != 0);
+    EXPECT_EQ(53, ip.find_pdu<UDP>()->dport());
+    ASSERT_TRUE(ip.find_pdu<RawPDU>() != 0);
+    EXPECT_EQ(5U, ip.find_pdu<RawPDU>()->payload_size());
+
+    // Change a layer further down the chain
+    ip.build_layer_index();
+    UDP* udp = ip.find_pdu<UDP>();
+    udp->inner_pdu(0);
+    EXPECT_TRUE(ip.find_pdu<RawPDU>() == 0);
+    EXPECT_TRUE(udp->find_pdu<RawPDU>() == 0);
+    *udp /= RawPDU("Payload");
+    ASSERT_TRUE(ip.find_pdu<RawPDU>() != 0);
+    EXPECT_EQ(7U, ip.find_pdu<RawPDU>()->payload_size());
+
+    // Release it
+    ip.build_layer_index();
+    PDU* released = ip.release_inner_pdu();
+    EXPECT_TRUE(ip.find_pdu<UDP>() == 0);
+    EXPECT_TRUE(ip.find_pdu<RawPDU>() == 0);
+    EXPECT_EQ(&ip, ip.find_pdu<IP>());
+    delete released;
+}
+
+TEST_F(PDUTest, FindPDUMoreTypesThanIndexed) {
+    IP ip = IP("192.168.0.1") / TCP(22, 52) / RawPDU("Test");
+    ip.build_layer_index();
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_EQ(&ip, ip.find_pdu<IP>());
+        EXPECT_TRUE(ip.find_pdu<TCP>() != 0);
+        EXPECT_TRUE(ip.find_pdu<RawPDU>() != 0);
+        EXPECT_TRUE(ip.find_pdu<UDP>() == 0);
+        EXPECT_TRUE(ip.find_pdu<IPv6>() == 0);
+        EXPECT_TRUE(ip.find_pdu<ICMP>() == 0);
+    }
+}
+
+TEST_F(PDUTest, FindPDUOnLongChains) {
+    // More distinct layer types than are indexed
+    EthernetII eth = EthernetII() / Dot1Q() / MPLS() / LLC() / SNAP() / IPv6() / 
+                     IP() / UDP(53, 1234) / DNS() / RawPDU("Test");
+    eth.build_layer_index();
+    EXPECT_EQ(&eth, eth.find_pdu<EthernetII>());
+    EXPECT_TRUE(eth.find_pdu<MPLS>() != 0);
+    EXPECT_TRUE(eth.find_pdu<IP>() != 0);
+    EXPECT_TRUE(eth.find_pdu<DNS>() != 0);
+    EXPECT_TRUE(eth.find_pdu<RawPDU>() != 0);
+    EXPECT_TRUE(eth.find_pdu<TCP>() == 0);
+}
+
+TEST_F(PDUTest, FindPDUOnInnerLayers) {
+    IP ip = IP("192.168.0.1") / TCP(22, 52) / RawPDU("Test");
+    ip.build_layer_index();
+    ASSERT_TRUE(ip.find_pdu<RawPDU>() != 0);
+    TCP* tcp = ip.find_pdu<TCP>();
+    ASSERT_TRUE(tcp != 0);
+    // Only the outermost layer can be indexed
+    tcp->build_layer_index();
+    EXPECT_EQ(tcp, tcp->find_pdu<TCP>());
+    EXPECT_TRUE(tcp->find_pdu<IP>() == 0);
+    EXPECT_EQ(ip.find_pdu<RawPDU>(), tcp->find_pdu<RawPDU>());
+}
+
+TEST_F(PDUTest, FindPDUAfterBecomingAnInnerLayer) {
+    IP* ip = new IP(IP("192.168.0.1") / TCP(22, 52));
+    ip->build_layer_index();
+    ASSERT_TRUE(ip->find_pdu<TCP>() != 0);
+    EthernetII eth;
+    eth.inner_pdu(ip);
+    EXPECT_TRUE(ip->find_pdu<EthernetII>() == 0);
+    eth.build_layer_index();
+    EXPECT_EQ(ip, eth.find_pdu<IP>());
+    EXPECT_TRUE(ip->find_pdu<EthernetII>() == 0);
+
+    ip->inner_pdu(UDP(53, 1234));
+    EXPECT_TRUE(eth.find_pdu<TCP>() == 0);
+    EXPECT_EQ(ip->inner_pdu(), eth.find_pdu<UDP>());
+    EXPECT_TRUE(ip->find_pdu<TCP>() == 0);
+}
+
+#ifdef TINS_HAVE_DOT11
+TEST_F(PDUTest, FindPDUOfBaseType) {
+    RadioTap radio = RadioTap() / Dot11QoSData() / SNAP() / IP();
+    radio.build_layer_index();
+    EXPECT_EQ(radio.inner_pdu(), radio.find_pdu<Dot11>());
+    EXPECT_EQ(radio.inner_pdu(), radio.find_pdu<Dot11Data>());
+    EXPECT_EQ(radio.inner_pdu(), radio.find_pdu<Dot11QoSData>());
+    EXPECT_TRUE(radio.find_pdu<IP>() != 0);
+}
+#endif // TINS_HAVE_DOT11
+
+TEST_F(PDUTest, FindPDUOnCopies) {
+    IP ip = IP("192.168.0.1") / TCP(22, 52) / RawPDU("Test");
+    ip.build_layer_index();
+    ASSERT_TRUE(ip.find_pdu<TCP>() != 0);
+    
+    IP copied(ip);
+    EXPECT_EQ(copied.inner_pdu(), copied.find_pdu<TCP>());
+    EXPECT_NE(ip.find_pdu<TCP>(), copied.find_pdu<TCP>());
+
+    IP assigned;
+    ASSERT_TRUE(assigned.find_pdu<TCP>() == 0);
+    assigned = ip;
+    EXPECT_EQ(assigned.inner_pdu(), assigned.find_pdu<TCP>());
+
+    const IP& const_ip = ip;
+    EXPECT_EQ(ip.inner_pdu(), const_ip.find_pdu<TCP>());
+    EXPECT_TRUE(const_ip.find_pdu<UDP>() == 0);
+}
+
 TEST_F(PDUTest, PDURelationship) {
     IP packet = IP("192.168.0.1") / TCP(22, 52) / RawPDU("Test");
     IP* ip = packet.find_pdu<IP>();
@@ -89,6 +223,20 @@ TEST_F(PDUTest, MoveAssignment) {
     packet = IP("1.2.3.4");
     EXPECT_TRUE(packet.inner_pdu() == 0);
 }
+
+TEST_F(PDUTest, FindPDUAfterMove) {
+    IP packet = IP("192.168.0.1") / TCP(22, 52);
+    packet.build_layer_index();
+    ASSERT_TRUE(packet.find_pdu<TCP>() != 0);
+    packet = IP("1.2.3.4") / UDP(53, 1234);
+    EXPECT_TRUE(packet.find_pdu<TCP>() == 0);
+    EXPECT_TRUE(packet.find_pdu<UDP>() != 0);
+
+    packet.build_layer_index();
+    IP moved(std::move(packet));
+    EXPECT_TRUE(packet.find_pdu<UDP>() == 0);
+    EXPECT_EQ(moved.inner_pdu(), moved.find_pdu<UDP>());
+}
 #endif // TINS_IS_CXX11
 
 TEST_F(PDUTest, TinsCast) {
@@ -102,3 +250,35 @@ TEST_F(PDUTest, TinsCast) {
     EXPECT_THROW(tins_cast<UDP>(*pdu), bad_tins_cast);
 }
 
+
+TEST_F(PDUTest, SerializeIntoBuffer) {
+    IP packet = IP("192.168.0.1", "192.168.0.2") / TCP(22, 52) / RawPDU("Test");
+    const PDU::serialization_type expected = packet.serialize();
+    uint8_t buffer[128];
+    memset(buffer, 0xaa, sizeof(buffer));
+    ASSERT_EQ(expected.size(), packet.serialize_into(buffer, sizeof(buffer)));
+    EXPECT_TRUE(equal(expected.begin(), expected.end(), buffer));
+    // The rest of the buffer is left untouched
+    EXPECT_EQ(0xaa, buffer[expected.size()]);
+}
+
+TEST_F(PDUTest, SerializeIntoSmallBuffer) {
+    IP packet = IP("192.168.0.1", "192.168.0.2") / TCP(22, 52) / RawPDU("Test");
+    uint8_t buffer[128];
+    memset(buffer, 0xaa, sizeof(buffer));
+    EXPECT_THROW(packet.serialize_into(buffer, packet.size() - 1), serialization_error);
+    EXPECT_EQ(0xaa, buffer[0]);
+}
+
+TEST_F(PDUTest, SerializeIntoVector) {
+    IP large = IP("192.168.0.1", "192.168.0.2") / TCP(22, 52) / RawPDU(string(100, 'a'));
+    IP small = IP("192.168.0.1", "192.168.0.2") / UDP(22, 52) / RawPDU("Test");
+    PDU::serialization_type buffer;
+    EXPECT_EQ(large.size(), large.serialize_into(buffer));
+    EXPECT_EQ(large.serialize(), buffer);
+    const uint8_t* data = &buffer[0];
+    EXPECT_EQ(small.size(), small.serialize_into(buffer));
+    EXPECT_EQ(small.serialize(), buffer);
+    // Shrinking the vector keeps its memory
+    EXPECT_EQ(data, &buffer[0]);
+}
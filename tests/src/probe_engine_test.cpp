@@ -0,0 +1,138 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <stdint.h>
+#include <tins/probe_engine.h>
+#include <tins/packet_sender.h>
+#include <tins/ethernetII.h>
+#include <tins/ip.h>
+#include <tins/tcp.h>
+#include <tins/udp.h>
+#include <tins/icmp.h>
+#include <tins/rawpdu.h>
+
+#if defined(TINS_HAVE_PCAP) && defined(TINS_HAVE_CXX11)
+
+using std::vector;
+
+using namespace Tins;
+
+class ProbeEngineTest : public testing::Test {
+public:
+    static const IPv4Address source_address;
+    static const IPv4Address target_address;
+
+    ProbeEngineTest() 
+    : engine(sender, source_address, [](const ProbeEngine::probe_result&) { }) {
+        engine.key(0x0706050403020100ULL, 0x0f0e0d0c0b0a0908ULL);
+    }
+
+    EthernetII make_response(uint16_t port, uint32_t ack_seq, small_uint<12> flags) {
+        TCP tcp(ProbeEngine::DEFAULT_SOURCE_PORT, port);
+        tcp.ack_seq(ack_seq);
+        tcp.flags(flags);
+        IP ip(source_address, target_address);
+        ip.ttl(57);
+        return EthernetII() / ip / tcp;
+    }
+
+    EthernetII make_unreachable(uint16_t port, uint32_t seq) {
+        TCP probe(port, ProbeEngine::DEFAULT_SOURCE_PORT);
+        probe.seq(seq);
+        probe.set_flag(TCP::SYN, 1);
+        PDU::serialization_type quoted = (IP(target_address, source_address) / probe).serialize();
+        // Only the IP header and the first 8 bytes of the TCP header are quoted
+        quoted.resize(28);
+        ICMP icmp(ICMP::DEST_UNREACHABLE);
+        icmp.code(1);
+        return EthernetII() / IP(source_address, "10.0.0.254") / icmp / RawPDU(quoted);
+    }
+
+    PacketSender sender;
+    ProbeEngine engine;
+};
+
+const IPv4Address ProbeEngineTest::source_address("192.168.0.100");
+const IPv4Address ProbeEngineTest::target_address("10.0.0.1");
+
+TEST_F(ProbeEngineTest, Cookie) {
+    // SipHash-2-4 over the target's and the source's address and port
+    EXPECT_EQ(engine.cookie(target_address, 80), engine.cookie(target_address, 80));
+    EXPECT_NE(engine.cookie(target_address, 80), engine.cookie(target_address, 81));
+    EXPECT_NE(engine.cookie(target_address, 80), engine.cookie("10.0.0.2", 80));
+
+    const uint32_t cookie = engine.cookie(target_address, 80);
+    engine.source_port(1234);
+    EXPECT_NE(cookie, engine.cookie(target_address, 80));
+    engine.source_port(ProbeEngine::DEFAULT_SOURCE_PORT);
+    engine.key(1, 2);
+    EXPECT_NE(cookie, engine.cookie(target_address, 80));
+}
+
+TEST_F(ProbeEngineTest, MatchOpen) {
+    EthernetII response = make_response(443, engine.cookie(target_address, 443) + 1, 
+                                        TCP::SYN | TCP::ACK);
+    ProbeEngine::probe_result result;
+    ASSERT_TRUE(engine.match(response, result));
+    EXPECT_EQ(target_address, result.address);
+    EXPECT_EQ(443, result.port);
+    EXPECT_EQ(ProbeEngine::OPEN, result.status);
+    EXPECT_EQ(57, result.ttl);
+}
+
+TEST_F(ProbeEngineTest, MatchClosed) {
+    EthernetII response = make_response(22, engine.cookie(target_address, 22) + 1, 
+                                        TCP::RST | TCP::ACK);
+    ProbeEngine::probe_result result;
+    ASSERT_TRUE(engine.match(response, result));
+    EXPECT_EQ(22, result.port);
+    EXPECT_EQ(ProbeEngine::CLOSED, result.status);
+}
+
+TEST_F(ProbeEngineTest, MatchUnreachable) {
+    EthernetII response = make_unreachable(8080, engine.cookie(target_address, 8080));
+    ProbeEngine::probe_result result;
+    ASSERT_TRUE(engine.match(response, result));
+    EXPECT_EQ(target_address, result.address);
+    EXPECT_EQ(8080, result.port);
+    EXPECT_EQ(ProbeEngine::UNREACHABLE, result.status);
+}
+
+TEST_F(ProbeEngineTest, NoMatch) {
+    const uint32_t cookie = engine.cookie(target_address, 443);
+    ProbeEngine::probe_result result;
+    // Wrong acknowledgement number
+    EthernetII response = make_response(443, cookie, TCP::SYN | TCP::ACK);
+    EXPECT_FALSE(engine.match(response, result));
+    // Response for another port
+    response = make_response(80, cookie + 1, TCP::SYN | TCP::ACK);
+    EXPECT_FALSE(engine.match(response, result));
+    // No ACK flag
+    response = make_response(443, cookie + 1, TCP::SYN);
+    EXPECT_FALSE(engine.match(response, result));
+    // Sent to another address
+    response = make_response(443, cookie + 1, TCP::SYN | TCP::ACK);
+    response.rfind_pdu<IP>().dst_addr("192.168.0.101");
+    EXPECT_FALSE(engine.match(response, result));
+    // Quoting a different sequence number
+    response = make_unreachable(443, cookie + 1);
+    EXPECT_FALSE(engine.match(response, result));
+    // A different key
+    response = make_response(443, cookie + 1, TCP::SYN | TCP::ACK);
+    engine.key(1, 2);
+    EXPECT_FALSE(engine.match(response, result));
+    // Something else entirely
+    EthernetII udp = EthernetII() / IP(source_address, target_address) / UDP(1, 2);
+    EXPECT_FALSE(engine.match(udp, result));
+}
+
+TEST_F(ProbeEngineTest, SourcePort) {
+    engine.source_port(4444);
+    TCP tcp(4444, 443);
+    tcp.ack_seq(engine.cookie(target_address, 443) + 1);
+    tcp.flags(TCP::SYN | TCP::ACK);
+    EthernetII response = EthernetII() / IP(source_address, target_address) / tcp;
+    ProbeEngine::probe_result result;
+    EXPECT_TRUE(engine.match(response, result));
+}
+
+#endif // TINS_HAVE_PCAP && TINS_HAVE_CXX11
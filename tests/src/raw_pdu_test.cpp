@@ -1,5 +1,7 @@
 #include <gtest/gtest.h>
 #include <tins/rawpdu.h>
+#include <tins/udp.h>
+#include <tins/config.h>
 
 using namespace Tins;
 
@@ -18,4 +20,109 @@ TEST_F(RawPDUTest, ConstructFromPayloadType) {
     // The payload should have been copied
     payload.push_back(0x03);
     EXPECT_NE(payload, raw.payload());
-}
\ No newline at end of file
+}
+
+TEST_F(RawPDUTest, ConstructFromBuffer) {
+    const uint8_t buffer[] = { 0x01, 0x02, 0x03 };
+    RawPDU raw(buffer, sizeof(buffer));
+    EXPECT_TRUE(raw.owns_payload());
+    EXPECT_NE(buffer, raw.payload_data());
+    EXPECT_EQ(RawPDU::payload_type(buffer, buffer + sizeof(buffer)), raw.payload());
+}
+
+TEST_F(RawPDUTest, BorrowedPayload) {
+    uint8_t buffer[] = { 0x01, 0x02, 0x03, 0x04 };
+    RawPDU raw(buffer, sizeof(buffer), RawPDU::borrow_tag());
+    EXPECT_FALSE(raw.owns_payload());
+    EXPECT_EQ(buffer, raw.payload_data());
+    EXPECT_EQ(sizeof(buffer), raw.payload_size());
+    EXPECT_EQ(sizeof(buffer), raw.size());
+
+    // Changes to the buffer are visible while it's borrowed
+    buffer[0] = 0x05;
+    PDU::serialization_type serialized = raw.serialize();
+    EXPECT_EQ(PDU::serialization_type(buffer, buffer + sizeof(buffer)), serialized);
+}
+
+TEST_F(RawPDUTest, OwnBorrowedPayload) {
+    uint8_t buffer[] = { 0x01, 0x02, 0x03, 0x04 };
+    RawPDU raw(buffer, sizeof(buffer), RawPDU::borrow_tag());
+    raw.own();
+    EXPECT_TRUE(raw.owns_payload());
+    EXPECT_NE(buffer, raw.payload_data());
+
+    buffer[0] = 0x05;
+    EXPECT_EQ(0x01, raw.payload()[0]);
+    EXPECT_EQ(sizeof(buffer), raw.payload_size());
+}
+
+TEST_F(RawPDUTest, PayloadGetterOwnsBorrowedPayload) {
+    uint8_t buffer[] = { 0x01, 0x02, 0x03 };
+    const RawPDU raw(buffer, sizeof(buffer), RawPDU::borrow_tag());
+    const RawPDU::payload_type& payload = raw.payload();
+    EXPECT_TRUE(raw.owns_payload());
+    EXPECT_EQ(RawPDU::payload_type(buffer, buffer + sizeof(buffer)), payload);
+}
+
+TEST_F(RawPDUTest, CopiesOwnBorrowedPayload) {
+    uint8_t buffer[] = { 0x01, 0x02, 0x03 };
+    RawPDU raw(buffer, sizeof(buffer), RawPDU::borrow_tag());
+
+    RawPDU copied(raw);
+    EXPECT_TRUE(copied.owns_payload());
+    EXPECT_FALSE(raw.owns_payload());
+
+    RawPDU assigned(RawPDU::payload_type(10, 0));
+    assigned = raw;
+    EXPECT_TRUE(assigned.owns_payload());
+
+    PDU* cloned = raw.clone();
+    EXPECT_TRUE(static_cast<RawPDU*>(cloned)->owns_payload());
+    delete cloned;
+
+    buffer[0] = 0x05;
+    EXPECT_EQ(0x01, copied.payload()[0]);
+    EXPECT_EQ(0x01, assigned.payload()[0]);
+    EXPECT_EQ(sizeof(buffer), assigned.payload_size());
+}
+
+TEST_F(RawPDUTest, SetPayloadReplacesBorrowedPayload) {
+    uint8_t buffer[] = { 0x01, 0x02, 0x03 };
+    RawPDU raw(buffer, sizeof(buffer), RawPDU::borrow_tag());
+    raw.payload(RawPDU::payload_type(5, 0x07));
+    EXPECT_TRUE(raw.owns_payload());
+    EXPECT_EQ(5U, raw.payload_size());
+}
+
+#ifdef TINS_HAVE_CXX11
+
+TEST_F(RawPDUTest, BorrowScope) {
+    UDP udp = UDP(53, 1234) / RawPDU("hello world");
+    PDU::serialization_type buffer = udp.serialize();
+    EXPECT_FALSE(RawPDU::borrowing());
+    {
+        RawPDU::borrow_scope scope;
+        EXPECT_TRUE(RawPDU::borrowing());
+        {
+            RawPDU::borrow_scope nested_scope;
+            EXPECT_TRUE(RawPDU::borrowing());
+        }
+        EXPECT_TRUE(RawPDU::borrowing());
+
+        UDP parsed(&buffer[0], static_cast<uint32_t>(buffer.size()));
+        const RawPDU& raw = parsed.rfind_pdu<RawPDU>();
+        EXPECT_FALSE(raw.owns_payload());
+        EXPECT_EQ(&buffer[0] + 8, raw.payload_data());
+        EXPECT_EQ(buffer, parsed.serialize());
+
+        // Explicitly constructed RawPDUs still copy their payload
+        RawPDU explicitly_constructed(&buffer[0], static_cast<uint32_t>(buffer.size()));
+        EXPECT_TRUE(explicitly_constructed.owns_payload());
+    }
+    EXPECT_FALSE(RawPDU::borrowing());
+
+    UDP parsed(&buffer[0], static_cast<uint32_t>(buffer.size()));
+    EXPECT_TRUE(parsed.rfind_pdu<RawPDU>().owns_payload());
+}
+
+#endif // TINS_HAVE_CXX11
@@ -0,0 +1,231 @@
+#include <tins/config.h>
+#include <gtest/gtest.h>
+
+#if defined(TINS_HAVE_PCAP) && defined(TINS_HAVE_CXX11)
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <thread>
+#include <future>
+#include <chrono>
+#include <stdint.h>
+#include <tins/rotating_packet_writer.h>
+#include <tins/mapped_file_sniffer.h>
+#include <tins/ethernetII.h>
+#include <tins/ip.h>
+#include <tins/udp.h>
+#include <tins/packet.h>
+#include "tests/capture_file.h"
+
+using std::string;
+using std::vector;
+
+using namespace Tins;
+
+class RotatingPacketWriterTest : public testing::Test {
+public:
+    static const char* base_name;
+
+    void TearDown() {
+        for (size_t i = 0; i < file_names.size(); ++i) {
+            remove(file_names[i].c_str());
+        }
+    }
+
+    // Writes packets with timestamps 0, 1, 2, etc, whose source ports are
+    // their index
+    static void write_packets(RotatingPacketWriter& writer, uint16_t count) {
+        for (uint16_t i = 0; i < count; ++i) {
+            const PDU::serialization_type data = make_udp_frame(i);
+            EXPECT_TRUE(writer.write_raw(&data[0], static_cast<uint32_t>(data.size()),
+                                         make_timestamp(i), static_cast<uint32_t>(data.size())));
+        }
+    }
+
+    // Returns the source ports of the packets stored in each file
+    vector<vector<uint16_t> > read_files(const RotatingPacketWriter& writer) {
+        vector<vector<uint16_t> > output;
+        for (uint32_t i = 0; i < writer.stats().files; ++i) {
+            file_names.push_back(writer.file_name(i));
+            MappedFileSniffer sniffer(file_names.back());
+            vector<uint16_t> ports;
+            sniffer.sniff_loop([&](Packet& packet) {
+                ports.push_back(packet.pdu()->rfind_pdu<UDP>().sport());
+                return true;
+            });
+            output.push_back(ports);
+        }
+        return output;
+    }
+
+    vector<string> file_names;
+};
+
+const char* RotatingPacketWriterTest::base_name = "rotating_packet_writer_test";
+
+TEST_F(RotatingPacketWriterTest, FileNames) {
+    RotatingPacketWriter writer("/tmp/capture", DataLinkType<EthernetII>());
+    EXPECT_EQ("/tmp/capture_000000.pcap", writer.file_name(0));
+    EXPECT_EQ("/tmp/capture_000123.pcap", writer.file_name(123));
+    EXPECT_EQ(0U, writer.stats().files);
+}
+
+TEST_F(RotatingPacketWriterTest, RotateByPacketCount) {
+    RotatingPacketWriter::rotation_policy policy;
+    policy.max_packets = 3;
+    RotatingPacketWriter writer(base_name, DataLinkType<EthernetII>(), policy);
+    vector<string> completed;
+    writer.set_rotation_callback([&](const string& name) {
+        completed.push_back(name);
+    });
+    write_packets(writer, 10);
+    writer.close();
+
+    RotatingPacketWriter::statistics stats = writer.stats();
+    EXPECT_EQ(10U, stats.written);
+    EXPECT_EQ(0U, stats.dropped);
+    EXPECT_EQ(0U, stats.queue_usage);
+    EXPECT_EQ(4U, stats.files);
+    vector<vector<uint16_t> > files = read_files(writer);
+    ASSERT_EQ(4U, files.size());
+    EXPECT_EQ(3U, files[0].size());
+    EXPECT_EQ(3U, files[1].size());
+    EXPECT_EQ(3U, files[2].size());
+    ASSERT_EQ(1U, files[3].size());
+    EXPECT_EQ(9, files[3][0]);
+    ASSERT_EQ(4U, completed.size());
+    EXPECT_EQ(writer.file_name(0), completed[0]);
+    EXPECT_EQ(writer.file_name(3), completed[3]);
+}
+
+TEST_F(RotatingPacketWriterTest, RotateByFileSize) {
+    RotatingPacketWriter::rotation_policy policy;
+    // The file header plus two records
+    policy.max_file_size = 24 + 2 * (16 + make_udp_frame(0).size());
+    RotatingPacketWriter writer(base_name, DataLinkType<EthernetII>(), policy);
+    write_packets(writer, 5);
+    writer.close();
+
+    vector<vector<uint16_t> > files = read_files(writer);
+    ASSERT_EQ(3U, files.size());
+    EXPECT_EQ(2U, files[0].size());
+    EXPECT_EQ(2U, files[1].size());
+    EXPECT_EQ(1U, files[2].size());
+}
+
+TEST_F(RotatingPacketWriterTest, RotateByDuration) {
+    RotatingPacketWriter::rotation_policy policy;
+    policy.max_duration = 4;
+    RotatingPacketWriter writer(base_name, DataLinkType<EthernetII>(), policy);
+    write_packets(writer, 10);
+    writer.close();
+
+    vector<vector<uint16_t> > files = read_files(writer);
+    ASSERT_EQ(3U, files.size());
+    EXPECT_EQ(4U, files[0].size());
+    ASSERT_EQ(4U, files[1].size());
+    EXPECT_EQ(4, files[1][0]);
+    EXPECT_EQ(2U, files[2].size());
+}
+
+TEST_F(RotatingPacketWriterTest, DropWhenQueueIsFull) {
+    const size_t record_size = 24 + make_udp_frame(0).size();
+    RotatingPacketWriter::rotation_policy policy;
+    policy.max_packets = 1;
+    RotatingPacketWriter writer(base_name, DataLinkType<EthernetII>(), policy, 
+                                2 * record_size);
+    // Stall the background thread when the first file is completed
+    std::promise<void> entered;
+    std::promise<void> release;
+    std::shared_future<void> released(release.get_future());
+    bool first = true;
+    writer.set_rotation_callback([&](const string&) {
+        if (first) {
+            first = false;
+            entered.set_value();
+            released.wait();
+        }
+    });
+    write_packets(writer, 2);
+    entered.get_future().wait();
+
+    const PDU::serialization_type data = make_udp_frame(100);
+    uint32_t accepted = 0;
+    for (int i = 0; i < 8; ++i) {
+        if (writer.write_raw(&data[0], static_cast<uint32_t>(data.size()), 
+                             make_timestamp(100), static_cast<uint32_t>(data.size()))) {
+            ++accepted;
+        }
+    }
+    EXPECT_EQ(2U, accepted);
+    RotatingPacketWriter::statistics stats = writer.stats();
+    EXPECT_EQ(6U, stats.dropped);
+    EXPECT_EQ(2 * record_size, stats.queue_usage);
+    EXPECT_EQ(2 * record_size, stats.peak_queue_usage);
+
+    release.set_value();
+    writer.close();
+    stats = writer.stats();
+    EXPECT_EQ(4U, stats.written);
+    EXPECT_EQ(6U, stats.dropped);
+    EXPECT_EQ(0U, stats.blocked);
+    read_files(writer);
+}
+
+TEST_F(RotatingPacketWriterTest, BlockWhenQueueIsFull) {
+    const size_t record_size = 24 + make_udp_frame(0).size();
+    RotatingPacketWriter::rotation_policy policy;
+    policy.max_packets = 1;
+    RotatingPacketWriter writer(base_name, DataLinkType<EthernetII>(), policy, 
+                                2 * record_size, RotatingPacketWriter::BLOCK);
+    std::promise<void> entered;
+    std::promise<void> release;
+    std::shared_future<void> released(release.get_future());
+    bool first = true;
+    writer.set_rotation_callback([&](const string&) {
+        if (first) {
+            first = false;
+            entered.set_value();
+            released.wait();
+        }
+    });
+    write_packets(writer, 2);
+    entered.get_future().wait();
+
+    std::thread producer([&]() {
+        write_packets(writer, 3);
+    });
+    while (writer.stats().blocked == 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    release.set_value();
+    producer.join();
+    writer.close();
+
+    RotatingPacketWriter::statistics stats = writer.stats();
+    EXPECT_EQ(5U, stats.written);
+    EXPECT_EQ(0U, stats.dropped);
+    EXPECT_EQ(1U, stats.blocked);
+    EXPECT_EQ(5U, read_files(writer).size());
+}
+
+TEST_F(RotatingPacketWriterTest, WriteAfterClose) {
+    RotatingPacketWriter writer(base_name, DataLinkType<EthernetII>());
+    write_packets(writer, 1);
+    writer.close();
+    const PDU::serialization_type data = make_udp_frame(1);
+    EXPECT_FALSE(writer.write_raw(&data[0], static_cast<uint32_t>(data.size()), 
+                                  make_timestamp(1), static_cast<uint32_t>(data.size())));
+    EXPECT_EQ(1U, writer.stats().dropped);
+    EXPECT_EQ(1U, read_files(writer).size());
+}
+
+TEST_F(RotatingPacketWriterTest, WriteErrorIsRethrown) {
+    RotatingPacketWriter writer("/this/directory/does/not/exist/capture", 
+                                DataLinkType<EthernetII>());
+    write_packets(writer, 1);
+    EXPECT_THROW(writer.close(), pcap_error);
+}
+
+#endif // TINS_HAVE_PCAP && TINS_HAVE_CXX11
@@ -147,6 +147,11 @@ void FlowTest::run_test(uint32_t initial_seq, const ordering_info_type& chunks,
     Flow flow(IPv4Address("1.2.3.4"), 22, initial_seq);
     flow.data_callback(bind(&FlowTest::cumulative_flow_data_handler, this, _1));
     vector<EthernetII> packets = chunks_to_packets(initial_seq, chunks, payload);
+    // Processing the packets moves their payloads out, so serialize them first
+    vector<PDU::serialization_type> buffers;
+    for (size_t i = 0; i < packets.size(); ++i) {
+        buffers.push_back(packets[i].serialize());
+    }
     for (size_t i = 0; i < packets.size(); ++i) {
         flow.process_packet(packets[i]);
     }
@@ -154,6 +159,21 @@ void FlowTest::run_test(uint32_t initial_seq, const ordering_info_type& chunks,
     EXPECT_EQ(payload, string(flow_payload.begin(), flow_payload.end()));
     EXPECT_EQ(0U, flow.total_buffered_bytes());
     EXPECT_TRUE(flow.buffered_payload().empty());
+
+    // Now do the same with payloads borrowed from the serialized packets
+    flow_payload_chunks.clear();
+    Flow borrowing_flow(IPv4Address("1.2.3.4"), 22, initial_seq);
+    borrowing_flow.data_callback(bind(&FlowTest::cumulative_flow_data_handler, this, _1));
+    for (size_t i = 0; i < buffers.size(); ++i) {
+        RawPDU::borrow_scope scope;
+        EthernetII parsed(&buffers[i][0], static_cast<uint32_t>(buffers[i].size()));
+        EXPECT_FALSE(parsed.rfind_pdu<RawPDU>().owns_payload());
+        borrowing_flow.process_packet(parsed);
+    }
+    flow_payload = merge_chunks(flow_payload_chunks);
+    EXPECT_EQ(payload, string(flow_payload.begin(), flow_payload.end()));
+    EXPECT_EQ(0U, borrowing_flow.total_buffered_bytes());
+    EXPECT_TRUE(borrowing_flow.buffered_payload().empty());
 }
 
 void FlowTest::run_test(uint32_t initial_seq, const ordering_info_type& chunks) {
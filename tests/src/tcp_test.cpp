@@ -6,6 +6,7 @@
 #include <tins/tcp.h>
 #include <tins/ip.h>
 #include <tins/ethernetII.h>
+#include <tins/exceptions.h>
 
 using namespace std;
 using namespace Tins;
@@ -300,3 +301,82 @@ TEST_F(TCPTest, RemoveOption) {
     PDU::serialization_type new_buffer = tcp.serialize();
     EXPECT_EQ(old_buffer, new_buffer);
 }
+
+TEST_F(TCPTest, OptionViews) {
+    TCP tcp(expected_packet, sizeof(expected_packet));
+    const TCP::options_type& options = tcp.options();
+    const TCP::option_views_type views = tcp.option_views();
+    TCP::options_type::const_iterator opt = options.begin();
+    for (TCP::option_views_type::iterator it = views.begin(); it != views.end(); ++it, ++opt) {
+        ASSERT_TRUE(opt != options.end());
+        EXPECT_EQ(opt->option(), it->option());
+        EXPECT_EQ(opt->data_ptr(), it->data_ptr());
+        EXPECT_EQ(opt->data_size(), it->data_size());
+    }
+    EXPECT_TRUE(opt == options.end());
+    EXPECT_TRUE(TCP().option_views().empty());
+}
+
+#ifdef TINS_HAVE_CXX11
+
+TEST_F(TCPTest, LazyOptions) {
+    TCP eager(expected_packet, sizeof(expected_packet));
+    LazyOptions::scope lazy;
+    TCP tcp(expected_packet, sizeof(expected_packet));
+
+    const TCP::options_type& options = eager.options();
+    const TCP::option_views_type views = tcp.option_views();
+    TCP::options_type::const_iterator opt = options.begin();
+    for (TCP::option_views_type::iterator it = views.begin(); it != views.end(); ++it, ++opt) {
+        ASSERT_TRUE(opt != options.end());
+        EXPECT_EQ(opt->option(), it->option());
+        EXPECT_EQ(opt->length_field(), it->length_field());
+        ASSERT_EQ(opt->data_size(), it->data_size());
+        EXPECT_TRUE(std::equal(it->data_ptr(), it->data_ptr() + it->data_size(), 
+                               opt->data_ptr()));
+    }
+    EXPECT_TRUE(opt == options.end());
+
+    // Serializing doesn't need the options to be built
+    EXPECT_EQ(eager.serialize(), tcp.serialize());
+    TCP copy = tcp;
+    EXPECT_EQ(eager.serialize(), copy.serialize());
+
+    EXPECT_EQ(eager.mss(), tcp.mss());
+    EXPECT_EQ(eager.timestamp(), tcp.timestamp());
+    EXPECT_EQ(options.size(), tcp.options().size());
+    EXPECT_EQ(eager.serialize(), tcp.serialize());
+
+    // Copies keep their own raw options
+    TCP assigned;
+    assigned = copy;
+    EXPECT_EQ(options.size(), copy.options().size());
+    EXPECT_EQ(options.size(), assigned.options().size());
+}
+
+TEST_F(TCPTest, LazyOptionsModified) {
+    LazyOptions::scope lazy;
+    TCP tcp(expected_packet, sizeof(expected_packet));
+    EXPECT_TRUE(tcp.remove_option(TCP::SACK));
+    tcp.add_option(TCP::option(TCP::NOP));
+
+    TCP eager(expected_packet, sizeof(expected_packet));
+    EXPECT_EQ(eager.options().size(), tcp.options().size());
+    EXPECT_FALSE(tcp.search_option(TCP::SACK));
+    EXPECT_EQ(TCP::NOP, tcp.options().back().option());
+}
+
+TEST_F(TCPTest, LazyOptionsMalformed) {
+    LazyOptions::scope lazy;
+    // An option whose length doesn't cover its type and length fields
+    const uint8_t packet[] = {
+        127, 77, 79, 29, 241, 218, 229, 70, 95, 174, 209, 35, 96, 2, 113,
+        218, 0, 0, 31, 174, 2, 1, 0, 0
+    };
+    EXPECT_THROW(TCP(packet, sizeof(packet)), malformed_packet);
+    TCP tcp(malformed_option_after_eol_packet, sizeof(malformed_option_after_eol_packet));
+    EXPECT_TRUE(tcp.option_views().empty());
+    EXPECT_EQ(0U, tcp.options().size());
+}
+
+#endif // TINS_HAVE_CXX11
@@ -1,5 +1,7 @@
 #include <iostream>
 #include <stdexcept>
+#include <vector>
+#include <cstring>
 #include <gtest/gtest.h>
 #include <tins/utils.h>
 #include <tins/endianness.h>
@@ -19,6 +21,8 @@ public:
     static const uint8_t data[];
     static const uint32_t data_len;
 
+    static uint16_t word_by_word_sum(const uint8_t* start, const uint8_t* end);
+    static uint32_t nibble_crc32(const uint8_t* data, uint32_t data_size);
 };
 
 const uint32_t UtilsTest::zero_int_ip = 0; // "0.0.0.0"
@@ -65,9 +69,99 @@ const uint8_t UtilsTest::data[] = {
     };
 const uint32_t UtilsTest::data_len = 500;
 
+uint16_t UtilsTest::word_by_word_sum(const uint8_t* start, const uint8_t* end) {
+    uint64_t checksum = 0;
+    const uint8_t* ptr = start;
+    for (; end - ptr >= 2; ptr += 2) {
+        uint16_t word;
+        std::memcpy(&word, ptr, sizeof(word));
+        checksum += word;
+    }
+    if (ptr != end) {
+        checksum += Endian::host_to_le<uint16_t>(*ptr);
+    }
+    while (checksum >> 16) {
+        checksum = (checksum & 0xffff) + (checksum >> 16);
+    }
+    return checksum;
+}
+
+uint32_t UtilsTest::nibble_crc32(const uint8_t* data, uint32_t data_size) {
+    static const uint32_t crc_table[] = {
+        0x4DBDF21C, 0x500AE278, 0x76D3D2D4, 0x6B64C2B0,
+        0x3B61B38C, 0x26D6A3E8, 0x000F9344, 0x1DB88320,
+        0xA005713C, 0xBDB26158, 0x9B6B51F4, 0x86DC4190,
+        0xD6D930AC, 0xCB6E20C8, 0xEDB71064, 0xF0000000
+    };
+    uint32_t crc = 0;
+    for (uint32_t i = 0; i < data_size; ++i) {
+        crc = (crc >> 4) ^ crc_table[(crc ^ data[i]) & 0x0F];
+        crc = (crc >> 4) ^ crc_table[(crc ^ (data[i] >> 4)) & 0x0F];
+    }
+    return crc;
+}
 
 TEST_F(UtilsTest, Crc32) {
     uint32_t crc = Utils::crc32(data, data_len);
 
     EXPECT_EQ(crc, 0x78840f54U);
 }
+
+TEST_F(UtilsTest, Crc32CheckValue) {
+    const char input[] = "123456789";
+    EXPECT_EQ(0xcbf43926U, Utils::crc32((const uint8_t*)input, sizeof(input) - 1));
+    EXPECT_EQ(0U, Utils::crc32(data, 0));
+}
+
+TEST_F(UtilsTest, Crc32MatchesNibbleTable) {
+    // Covers every alignment and every length around the 8 byte slices and
+    // the 16/64 byte folding blocks
+    for (uint32_t offset = 0; offset < 32; ++offset) {
+        for (uint32_t size = 0; offset + size <= data_len; ++size) {
+            ASSERT_EQ(nibble_crc32(data + offset, size), Utils::crc32(data + offset, size))
+                << "offset " << offset << ", size " << size;
+        }
+    }
+}
+
+TEST_F(UtilsTest, Crc32LargeBuffer) {
+    std::vector<uint8_t> buffer(1024 * 1024 + 13);
+    for (size_t i = 0; i < buffer.size(); ++i) {
+        buffer[i] = static_cast<uint8_t>(i * 31 + (i >> 8));
+    }
+    const uint32_t size = static_cast<uint32_t>(buffer.size());
+    EXPECT_EQ(nibble_crc32(&buffer[0], size), Utils::crc32(&buffer[0], size));
+    EXPECT_EQ(nibble_crc32(&buffer[0] + 3, size - 3), Utils::crc32(&buffer[0] + 3, size - 3));
+}
+
+TEST_F(UtilsTest, SumRange) {
+    // Covers every alignment and every length, including the scalar tail
+    // handling of the vectorized implementations
+    for (uint32_t offset = 0; offset < 32; ++offset) {
+        for (uint32_t size = 0; offset + size <= data_len; ++size) {
+            const uint8_t* start = data + offset;
+            ASSERT_EQ(word_by_word_sum(start, start + size),
+                      Utils::sum_range(start, start + size))
+                << "offset " << offset << ", size " << size;
+        }
+    }
+}
+
+TEST_F(UtilsTest, SumRangeEmptyAndZeroes) {
+    std::vector<uint8_t> buffer(1501, 0);
+    EXPECT_EQ(0, Utils::sum_range(&buffer[0], &buffer[0]));
+    EXPECT_EQ(0, Utils::sum_range(&buffer[0], &buffer[0] + buffer.size()));
+}
+
+TEST_F(UtilsTest, SumRangeLargeBuffer) {
+    // Large enough for the vector accumulators to be flushed several times
+    std::vector<uint8_t> buffer(3 * 1024 * 1024 + 7, 0xff);
+    const uint8_t* start = &buffer[0];
+    const uint8_t* end = start + buffer.size();
+    EXPECT_EQ(word_by_word_sum(start, end), Utils::sum_range(start, end));
+    for (size_t i = 0; i < buffer.size(); ++i) {
+        buffer[i] = static_cast<uint8_t>(i * 7 + (i >> 8));
+    }
+    EXPECT_EQ(word_by_word_sum(start, end), Utils::sum_range(start, end));
+    EXPECT_EQ(word_by_word_sum(start + 1, end), Utils::sum_range(start + 1, end));
+}